@@ -48,6 +48,8 @@ SEARCHD_COMMAND_KEYWORDS	= 3
 SEARCHD_COMMAND_PERSIST		= 4
 SEARCHD_COMMAND_STATUS		= 5
 SEARCHD_COMMAND_FLUSHATTRS	= 7
+SEARCHD_COMMAND_INSERT		= 12
+SEARCHD_COMMAND_REPLACE		= 13
 
 # current client-side command implementation versions
 VER_COMMAND_SEARCH		= 0x120
@@ -56,6 +58,7 @@ VER_COMMAND_UPDATE		= 0x103
 VER_COMMAND_KEYWORDS	= 0x100
 VER_COMMAND_STATUS		= 0x101
 VER_COMMAND_FLUSHATTRS	= 0x100
+VER_COMMAND_INSERT		= 0x100
 
 # known searchd status codes
 SEARCHD_OK				= 0
@@ -108,6 +111,7 @@ SPH_ATTR_BOOL			= 4
 SPH_ATTR_FLOAT			= 5
 SPH_ATTR_BIGINT			= 6
 SPH_ATTR_STRING			= 7
+SPH_ATTR_JSON			= 12
 SPH_ATTR_FACTORS		= 1001
 SPH_ATTR_MULTI			= long(0X40000001)
 SPH_ATTR_MULTI64		= long(0X40000002)
@@ -1131,6 +1135,82 @@ class SphinxClient:
 		return updated
 
 
+	def InsertDocuments ( self, index, columns, rows, replace=False ):
+		"""
+		Insert (or replace) documents into given RT index, using the binary protocol (no SphinxQL parsing).
+		Returns amount of inserted documents on success, or -1 on failure.
+
+		'columns' must be a list of (name, type) tuples, and must contain ('id', SPH_ATTR_BIGINT).
+		Full-text fields are sent as SPH_ATTR_STRING; attribute types must match the index schema.
+		'rows' must be a list of lists of values, in the same order as 'columns'.
+		MVA values (SPH_ATTR_MULTI, SPH_ATTR_MULTI64) are lists of ints.
+
+		Example:
+			res = cl.InsertDocuments ( 'rt', [ ('id', SPH_ATTR_BIGINT), ('title', SPH_ATTR_STRING), ('gid', SPH_ATTR_INTEGER) ],
+				[ [ 1, 'hello world', 123 ], [ 2, 'bye world', 456 ] ] )
+		"""
+		assert ( isinstance ( index, str ) )
+		assert ( isinstance ( columns, list ) )
+		assert ( isinstance ( rows, list ) )
+		for name, attr_type in columns:
+			assert ( isinstance ( name, str ) )
+		for row in rows:
+			assert ( isinstance ( row, list ) )
+			assert ( len(columns)==len(row) )
+
+		# build request
+		req = bytearray()
+		index = str_bytes(index)
+		req.extend ( pack('>L',len(index)) + index )
+
+		req.extend ( pack('>L',len(columns)) )
+		for name, attr_type in columns:
+			name = str_bytes(name)
+			req.extend ( pack('>L',len(name)) + name )
+			req.extend ( pack('>L',attr_type) )
+
+		req.extend ( pack('>L',len(rows)) )
+		for row in rows:
+			for (name, attr_type), val in zip ( columns, row ):
+				if attr_type==SPH_ATTR_BIGINT:
+					req.extend ( pack('>Q',val & 0xFFFFFFFFFFFFFFFF) )
+				elif attr_type==SPH_ATTR_FLOAT:
+					req.extend ( pack('>f',val) )
+				elif attr_type in (SPH_ATTR_STRING, SPH_ATTR_JSON):
+					val = str_bytes(val)
+					req.extend ( pack('>L',len(val)) + val )
+				elif attr_type==SPH_ATTR_MULTI:
+					req.extend ( pack('>L',len(val)) )
+					for v in val:
+						req.extend ( pack('>L',v) )
+				elif attr_type==SPH_ATTR_MULTI64:
+					req.extend ( pack('>L',len(val)) )
+					for v in val:
+						req.extend ( pack('>Q',v & 0xFFFFFFFFFFFFFFFF) )
+				else:
+					req.extend ( pack('>L',val) )
+
+		# connect, send query, get response
+		sock = self._Connect()
+		if not sock:
+			return -1
+
+		command = SEARCHD_COMMAND_INSERT
+		if replace: command = SEARCHD_COMMAND_REPLACE
+		req_all = bytearray()
+		req_all.extend ( pack ( '>2HL', command, VER_COMMAND_INSERT, len(req) ) )
+		req_all.extend ( req )
+		self._Send ( sock, req_all )
+
+		response = self._GetResponse ( sock, VER_COMMAND_INSERT )
+		if not response:
+			return -1
+
+		# parse response
+		inserted = unpack ( '>L', response[0:4] )[0]
+		return inserted
+
+
 	def BuildKeywords ( self, query, index, hits ):
 		"""
 		Connect to searchd server, and generate keywords list for a given query.
@@ -5,6 +5,8 @@
 #include <gtest/gtest.h>
 
 #include "sphinxint.h"
+#include "sphinxqcache.h"
+#include "sphinxplugin.h"
 #include "json/cJSON.h"
 #include <math.h>
 
@@ -329,6 +331,178 @@ TEST (functions, Mutex)
 	ASSERT_TRUE ( sphThreadJoin ( &th ) ) << "timedlock thread done";
 }
 
+TEST ( functions, AutoEventTimedWait )
+{
+	CSphAutoEvent tEvent;
+	int64_t tmStart = sphMicroTimer();
+	ASSERT_FALSE ( tEvent.WaitEvent ( 50 ) ) << "nothing sent, must time out";
+	ASSERT_GE ( sphMicroTimer()-tmStart, 40000 );
+
+	tEvent.SetEvent();
+	ASSERT_TRUE ( tEvent.WaitEvent ( 50 ) ) << "sent before wait";
+}
+
+TEST ( functions, QcacheFlightFollowerGivesUp )
+{
+	const QcacheStatus_t & tStatus = QcacheGetStatus();
+	int64_t iMaxBytes = tStatus.m_iMaxBytes;
+	int iThreshMsec = tStatus.m_iThreshMsec;
+	int iTtlSec = tStatus.m_iTtlSec;
+	QcacheSetup ( 1024*1024, 0, 60 );
+
+	CSphQuery tQuery;
+	tQuery.m_sQuery = "hello";
+	CSphSchema tSchema;
+
+	QcacheFlight_t * pLeader = nullptr;
+	ASSERT_FALSE ( QcacheJoinFlight ( 1, tQuery, tSchema, 0, &pLeader ) );
+	ASSERT_TRUE ( pLeader ) << "first query leads";
+
+	// max_query_time elapses while the leader still works
+	QcacheFlight_t * pFollower = nullptr;
+	int64_t tmStart = sphMicroTimer();
+	ASSERT_FALSE ( QcacheJoinFlight ( 1, tQuery, tSchema, tmStart+50000, &pFollower ) );
+	ASSERT_FALSE ( pFollower ) << "follower must not lead";
+	ASSERT_GE ( sphMicroTimer()-tmStart, 40000 );
+
+	// killed follower
+	ASSERT_TRUE ( sphInitQueryControl() );
+	QueryControl_c tControl;
+	tControl.Stop ( QUERY_KILLED );
+	{
+		QueryControlScope_c tScope ( &tControl );
+		ASSERT_FALSE ( QcacheJoinFlight ( 1, tQuery, tSchema, 0, &pFollower ) );
+		ASSERT_FALSE ( pFollower );
+	}
+	ASSERT_EQ ( tStatus.m_iInFlight, 1 );
+
+	QcacheLeaveFlight ( pLeader, nullptr );
+	ASSERT_EQ ( tStatus.m_iInFlight, 0 );
+	ASSERT_EQ ( tStatus.m_iCoalesced, 0 );
+	QcacheSetup ( iMaxBytes, iThreshMsec, iTtlSec );
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#if HAVE_DLOPEN && defined ( GTESTS_UDF_DIR )
+
+// final stage evaluation of UDFs from gtests_udf.c stub library; its batch calls add 1000000 to the result
+class UdfBatch : public ::testing::Test
+{
+protected:
+	static const int ROWS = CSphQueryContext::CALC_BLOCK_SIZE + 44;
+	static const int64_t BATCH_MARK = 1000000;
+
+	CSphSchema					m_tSchema;
+	CSphFixedVector<CSphMatch>	m_dMatches { 0 };
+	CSphVector<CSphMatch *>		m_dPtrs;
+	CSphString					m_sError;
+
+	void SetUp() override
+	{
+		sphPluginInit ( GTESTS_UDF_DIR );
+		ASSERT_TRUE ( sphPluginCreate ( GTESTS_UDF_LIB, PLUGIN_FUNCTION, "stubsumf", SPH_ATTR_FLOAT, m_sError ) ) << m_sError.cstr();
+
+		CSphColumnInfo tA ( "a", SPH_ATTR_INTEGER );
+		CSphColumnInfo tB ( "b", SPH_ATTR_BIGINT );
+		CSphColumnInfo tC ( "c", SPH_ATTR_FLOAT );
+		CSphColumnInfo tRes ( "res", SPH_ATTR_BIGINT );
+		CSphColumnInfo tResF ( "resf", SPH_ATTR_FLOAT );
+		m_tSchema.AddAttr ( tA, true );
+		m_tSchema.AddAttr ( tB, true );
+		m_tSchema.AddAttr ( tC, true );
+		m_tSchema.AddAttr ( tRes, true );
+		m_tSchema.AddAttr ( tResF, true );
+
+		m_dMatches.Reset ( ROWS );
+		ARRAY_FOREACH ( i, m_dMatches )
+		{
+			CSphMatch & tMatch = m_dMatches[i];
+			tMatch.Reset ( m_tSchema.GetDynamicSize() );
+			tMatch.SetAttr ( m_tSchema.GetAttr ( "a" )->m_tLocator, i );
+			tMatch.SetAttr ( m_tSchema.GetAttr ( "b" )->m_tLocator, 10*(int64_t)i );
+			tMatch.SetAttrFloat ( m_tSchema.GetAttr ( "c" )->m_tLocator, i+0.5f );
+			m_dPtrs.Add ( &tMatch );
+		}
+	}
+
+	void TearDown() override
+	{
+		sphPluginDrop ( PLUGIN_FUNCTION, "stubsum", m_sError );
+		sphPluginDrop ( PLUGIN_FUNCTION, "stubsumf", m_sError );
+	}
+
+	// whole set is computed in blocks, the way final stage does; or match by match
+	void CalcFinal ( bool bBlock )
+	{
+		CSphQuery tQuery;
+		CSphQueryContext tCtx ( tQuery );
+
+		const char * dExprs[] = { "stubsum(a, b, c, 'abc')", "stubsumf(a, c)" };
+		const char * dAttrs[] = { "res", "resf" };
+		for ( int i=0; i<2; ++i )
+		{
+			ESphAttr eType = SPH_ATTR_NONE;
+			ISphExpr * pExpr = sphExprParse ( dExprs[i], m_tSchema, &eType, nullptr, m_sError, nullptr );
+			ASSERT_TRUE ( pExpr ) << m_sError.cstr();
+
+			CSphQueryContext::CalcItem_t & tItem = tCtx.m_dCalcFinal.Add();
+			tItem.m_pExpr = pExpr;
+			tItem.m_eType = eType;
+			tItem.m_tLoc = m_tSchema.GetAttr ( dAttrs[i] )->m_tLocator;
+		}
+
+		if ( !bBlock )
+		{
+			for ( auto & tMatch : m_dMatches )
+				tCtx.CalcFinal ( tMatch );
+			return;
+		}
+
+		for ( int iStart=0; iStart<ROWS; iStart+=CSphQueryContext::CALC_BLOCK_SIZE )
+			tCtx.CalcFinal ( m_dPtrs.Begin()+iStart, Min ( ROWS-iStart, CSphQueryContext::CALC_BLOCK_SIZE ) );
+	}
+
+	void CheckResults ( int64_t iMark )
+	{
+		const CSphAttrLocator & tRes = m_tSchema.GetAttr ( "res" )->m_tLocator;
+		const CSphAttrLocator & tResF = m_tSchema.GetAttr ( "resf" )->m_tLocator;
+		ARRAY_FOREACH ( i, m_dMatches )
+		{
+			// a + b + trunc(c) + strlen('abc')
+			ASSERT_EQ ( m_dMatches[i].GetAttr ( tRes ), iMark + i + 10*i + i + 3 ) << "row " << i;
+			ASSERT_FLOAT_EQ ( m_dMatches[i].GetAttrFloat ( tResF ), float ( iMark + i + i ) ) << "row " << i;
+		}
+	}
+};
+
+TEST_F ( UdfBatch, block_calls_batch )
+{
+	ASSERT_TRUE ( sphPluginCreate ( GTESTS_UDF_LIB, PLUGIN_FUNCTION, "stubsum", SPH_ATTR_INTEGER, m_sError ) ) << m_sError.cstr();
+	CalcFinal ( true );
+	CheckResults ( BATCH_MARK );
+}
+
+TEST_F ( UdfBatch, row_calls_row )
+{
+	ASSERT_TRUE ( sphPluginCreate ( GTESTS_UDF_LIB, PLUGIN_FUNCTION, "stubsum", SPH_ATTR_INTEGER, m_sError ) ) << m_sError.cstr();
+	CalcFinal ( false );
+	CheckResults ( 0 );
+}
+
+// v.9 library exports stubsum_batch too, but it must not be looked up
+TEST_F ( UdfBatch, old_library_calls_row )
+{
+	ASSERT_TRUE ( sphPluginCreate ( GTESTS_UDF9_LIB, PLUGIN_FUNCTION, "stubsum", SPH_ATTR_INTEGER, m_sError ) ) << m_sError.cstr();
+	CalcFinal ( true );
+
+	const CSphAttrLocator & tRes = m_tSchema.GetAttr ( "res" )->m_tLocator;
+	ARRAY_FOREACH ( i, m_dMatches )
+		ASSERT_EQ ( m_dMatches[i].GetAttr ( tRes ), i + 10*i + i + 3 ) << "row " << i;
+}
+
+#endif // HAVE_DLOPEN
+
 //////////////////////////////////////////////////////////////////////////
 
 static int g_iRwlock;
@@ -1172,6 +1346,25 @@ TEST ( functions, vector )
 	ASSERT_EQ (dVec.GetLength (),8);
 }
 
+TEST ( functions, vector_shrink )
+{
+	CSphTightVector<int> dVec;
+	for ( int i=0; i<1500; ++i )
+		dVec.Add ( i );
+	ASSERT_GT ( dVec.GetLimit (), dVec.GetLength () );
+
+	dVec.Shrink ();
+	ASSERT_EQ ( dVec.GetLimit (), 1500 );
+	ASSERT_EQ ( dVec.GetLength (), 1500 );
+	ASSERT_EQ ( dVec[0], 0 );
+	ASSERT_EQ ( dVec.Last (), 1499 );
+
+	dVec.Resize ( 0 );
+	dVec.Shrink ();
+	ASSERT_EQ ( dVec.GetLimit (), 0 );
+	ASSERT_EQ ( dVec.Begin (), nullptr );
+}
+
 TEST ( functions, sphSplit )
 {
 	StrVec_t dParts;
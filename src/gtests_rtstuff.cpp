@@ -5,6 +5,7 @@
 #include <gtest/gtest.h>
 
 #include "sphinxint.h"
+#include "sphinxqcache.h"
 
 #include <gmock/gmock.h>
 
@@ -569,4 +570,689 @@ TEST_F ( RT, SendVsMerge )
 	SafeDelete ( pIndex );
 	SafeDelete ( pSrc );
 	pTok = nullptr; // owned and deleted by index
-}
\ No newline at end of file
+}
+// same prefix and infix expansions should match the same docs, with and without in-RAM keyword directory
+TEST_F ( RT, KeywordDirectory )
+{
+	using namespace testing;
+
+	tDictSettings.m_bWordDict = true;
+	CSphDictRefPtr_c pDict { sphCreateDictionaryKeywords ( tDictSettings, NULL, pTok, "rt", sError ) };
+
+	tCol.m_sName = "tag1";
+	tCol.m_eAttrType = SPH_ATTR_INTEGER;
+	tSrcSchema.AddAttr ( tCol, true );
+
+	tCol.m_sName = "tag2";
+	tCol.m_eAttrType = SPH_ATTR_INTEGER;
+	tSrcSchema.AddAttr ( tCol, true );
+
+	auto pSrc = new MockDocRandomizer_c ( tSrcSchema );
+
+	EXPECT_CALL ( *pSrc, Connect ( _ ) ).WillOnce ( Return ( true ) );
+	EXPECT_CALL ( *pSrc, GetFieldLengths () ).Times ( 801 ).WillRepeatedly ( Return ( pSrc->m_dFieldLengths ) );
+	EXPECT_CALL ( *pSrc, Disconnect () );
+
+	pSrc->SetTokenizer ( pTok );
+	pSrc->SetDict ( pDict );
+
+	pSrc->Setup ( CSphSourceSettings() );
+	ASSERT_TRUE ( pSrc->Connect ( sError ) );
+	ASSERT_TRUE ( pSrc->IterateStart ( sError ) );
+	ASSERT_TRUE ( pSrc->UpdateSchema ( &tSrcSchema, sError ) );
+
+	CSphSchema tSchema; // source schema must be all dynamic attrs; but index ones must be static
+	for ( int i=0; i<tSrcSchema.GetFieldsCount(); i++ )
+		tSchema.AddField ( tSrcSchema.GetField(i) );
+
+	for ( int i=0; i<tSrcSchema.GetAttrsCount(); i++ )
+		tSchema.AddAttr ( tSrcSchema.GetAttr(i), false );
+
+	CSphIndexSettings tSettings;
+	tSettings.m_iMinInfixLen = 2;
+
+	auto fnCreate = [&]()
+	{
+		ISphRtIndex * pIndex = sphCreateIndexRT ( tSchema, "testrt", 128 * 1024, RT_INDEX_FILE_NAME, true );
+		pIndex->Setup ( tSettings );
+		pIndex->SetTokenizer ( pTok->Clone ( SPH_CLONE_INDEX ) );
+		pIndex->SetDictionary ( pDict->Clone () );
+		pIndex->PostSetup ();
+		EXPECT_TRUE ( pIndex->Prealloc ( false ) );
+		return pIndex;
+	};
+
+	const char * dQueries[] = { "title1*", "contentwashere2*", "*ntentwashere3*", "*itle4*", "cat", "ca*" };
+	const int iQueries = sizeof(dQueries)/sizeof(dQueries[0]);
+	auto fnSearch = [&] ( ISphRtIndex * pIndex, CSphVector<int> & dTotals )
+	{
+		for ( int i=0; i<iQueries; ++i )
+		{
+			CSphQuery tQuery;
+			CSphQueryResult tResult;
+			KillListVector tKill;
+			CSphMultiQueryArgs tArgs ( tKill, 1 );
+			tQuery.m_sQuery = dQueries[i];
+			tQuery.m_pQueryParser = sphCreatePlainQueryParser();
+
+			SphQueueSettings_t tQueueSettings ( tQuery, pIndex->GetMatchSchema (), tResult.m_sError );
+			tQueueSettings.m_bComputeItems = false;
+			auto pSorter = sphCreateQueue ( tQueueSettings );
+			ASSERT_TRUE ( pSorter );
+			ASSERT_TRUE ( pIndex->MultiQuery ( &tQuery, &tResult, 1, &pSorter, tArgs ) );
+			sphFlattenQueue ( pSorter, &tResult, 0 );
+			dTotals.Add ( tResult.m_dMatches.GetLength() );
+
+			SafeDelete ( pSorter );
+			SafeDelete ( tQuery.m_pQueryParser );
+		}
+	};
+
+	ISphRtIndex * pIndex = fnCreate();
+	CSphString sFilter;
+	CSphVector<DWORD> dMvas;
+	while (true)
+	{
+		ASSERT_TRUE ( pSrc->IterateDocument ( sError ) );
+		if ( !pSrc->m_tDocInfo.m_uDocID )
+			break;
+
+		pIndex->AddDocument ( pIndex->CloneIndexingTokenizer (), pSrc->GetFieldCount (), pSrc->GetFields ()
+			, pSrc->m_tDocInfo, false, sFilter, NULL, dMvas, sError, sWarning, NULL );
+		pIndex->Commit ( NULL, NULL );
+	}
+	pSrc->Disconnect ();
+
+	CSphVector<int> dPlain;
+	fnSearch ( pIndex, dPlain );
+	SafeDelete ( pIndex );
+
+	// reload disk chunks with directory
+	sphSetKeywordDirectory ( true );
+	pIndex = fnCreate();
+	CSphVector<int> dDirectory;
+	fnSearch ( pIndex, dDirectory );
+
+	// expansions must come from disk chunks too even when no stats are requested
+	GetKeywordsSettings_t tKwSettings;
+	CSphVector<CSphKeywordInfo> dStats, dNoStats;
+	ASSERT_TRUE ( pIndex->GetKeywords ( dStats, "title1*", tKwSettings, &sError ) );
+	tKwSettings.m_bStats = false;
+	ASSERT_TRUE ( pIndex->GetKeywords ( dNoStats, "title1*", tKwSettings, &sError ) );
+	ASSERT_GT ( dStats.GetLength(), 1 );
+	ASSERT_EQ ( dNoStats.GetLength(), dStats.GetLength() );
+	for ( const CSphKeywordInfo & tInfo : dStats )
+		ASSERT_TRUE ( dNoStats.Contains ( bind ( &CSphKeywordInfo::m_sNormalized ), tInfo.m_sNormalized ) ) << tInfo.m_sNormalized.cstr();
+
+	SafeDelete ( pIndex );
+	sphSetKeywordDirectory ( false );
+
+	// same queries several times over expansion and doclist caches; later passes must be served from cache
+	sphSetExpansionCacheSize ( 1024 * 1024 );
+	sphSetDoclistCacheSize ( 1024 * 1024 );
+	pIndex = fnCreate();
+	CSphVector<int> dCached;
+	fnSearch ( pIndex, dCached );
+	int64_t iHits = sphGetExpansionCacheStatus().m_iHits;
+	ASSERT_GT ( sphGetExpansionCacheStatus().m_iUsedBytes, 0 );
+	fnSearch ( pIndex, dCached );
+	ASSERT_GT ( sphGetExpansionCacheStatus().m_iHits, iHits );
+	ASSERT_GT ( sphGetDoclistCacheStatus().m_iUsedBytes, 0 );
+	iHits = sphGetDoclistCacheStatus().m_iHits;
+	fnSearch ( pIndex, dCached );
+	ASSERT_GT ( sphGetDoclistCacheStatus().m_iHits, iHits );
+	int64_t iAllExpansions = sphGetExpansionCacheStatus().m_iUsedBytes;
+	SafeDelete ( pIndex );
+	ASSERT_EQ ( sphGetExpansionCacheStatus().m_iUsedBytes, 0 );
+	ASSERT_EQ ( sphGetDoclistCacheStatus().m_iUsedBytes, 0 );
+
+	// limit is shared by all disk chunks, and the least recently used expansions go first
+	sphSetExpansionCacheSize ( iAllExpansions/2 );
+	pIndex = fnCreate();
+	CSphVector<int> dEvicted;
+	fnSearch ( pIndex, dEvicted );
+	fnSearch ( pIndex, dEvicted );
+	ASSERT_GT ( sphGetExpansionCacheStatus().m_iUsedBytes, 0 );
+	ASSERT_LE ( sphGetExpansionCacheStatus().m_iUsedBytes, iAllExpansions/2 );
+	sphSetExpansionCacheSize ( iAllExpansions/4 );
+	ASSERT_LE ( sphGetExpansionCacheStatus().m_iUsedBytes, iAllExpansions/4 );
+	SafeDelete ( pIndex );
+	ASSERT_EQ ( sphGetExpansionCacheStatus().m_iUsedBytes, 0 );
+	for ( int i=0; i<iQueries; ++i )
+	{
+		ASSERT_EQ ( dPlain[i], dEvicted[i] ) << dQueries[i];
+		ASSERT_EQ ( dPlain[i], dEvicted[iQueries+i] ) << dQueries[i];
+	}
+	sphSetExpansionCacheSize ( 0 );
+	sphSetDoclistCacheSize ( 0 );
+
+	ASSERT_EQ ( dPlain.GetLength(), iQueries );
+	ASSERT_EQ ( dDirectory.GetLength(), iQueries );
+	ASSERT_EQ ( dCached.GetLength(), 3*iQueries );
+	ASSERT_EQ ( dPlain[4], 801 ) << "cat";
+	ASSERT_EQ ( dPlain[5], 801 ) << "ca*";
+	for ( int i=0; i<iQueries; ++i )
+	{
+		ASSERT_EQ ( dPlain[i], dDirectory[i] ) << dQueries[i];
+		ASSERT_EQ ( dPlain[i], dCached[i] ) << dQueries[i];
+		ASSERT_EQ ( dPlain[i], dCached[iQueries+i] ) << dQueries[i];
+		ASSERT_EQ ( dPlain[i], dCached[2*iQueries+i] ) << dQueries[i];
+	}
+
+	SafeDelete ( pSrc );
+
+	// disk chunks
+	CSphString sName;
+	for ( int i=1; i<32; ++i )
+		for ( const char * sExt : { "spa", "spd", "spe", "sph", "spi", "spk", "spm", "spp", "sps" } )
+		{
+			sName.SetSprintf ( "%s.%d.%s", RT_INDEX_FILE_NAME, i, sExt );
+			unlink ( sName.cstr() );
+		}
+}
+
+TEST ( RtCache, Counters )
+{
+	CacheCounters_c tCache;
+	ASSERT_FALSE ( tCache.IsEnabled() );
+	tCache.SetMaxBytes ( -1 );
+	ASSERT_FALSE ( tCache.IsEnabled() );
+	tCache.SetMaxBytes ( 1024 );
+	ASSERT_TRUE ( tCache.IsEnabled() );
+
+	tCache.Miss();
+	tCache.Hit();
+	tCache.Hit();
+	tCache.AddBytes ( 100 );
+	tCache.SubBytes ( 40 );
+
+	CacheStatus_t tStatus = tCache.GetStatus();
+	ASSERT_EQ ( tStatus.m_iMaxBytes, 1024 );
+	ASSERT_EQ ( tStatus.m_iUsedBytes, 60 );
+	ASSERT_EQ ( tStatus.m_iHits, 2 );
+	ASSERT_EQ ( tStatus.m_iMisses, 1 );
+}
+
+// total matches of a full-text query
+static int64_t RtQueryTotal ( ISphRtIndex * pIndex, const char * sQuery, int iCutoff=0 )
+{
+	CSphQuery tQuery;
+	CSphQueryResult tResult;
+	KillListVector tKill;
+	CSphMultiQueryArgs tArgs ( tKill, 1 );
+	tQuery.m_sQuery = sQuery;
+	tQuery.m_iCutoff = iCutoff;
+	tQuery.m_pQueryParser = sphCreatePlainQueryParser();
+
+	SphQueueSettings_t tQueueSettings ( tQuery, pIndex->GetMatchSchema (), tResult.m_sError );
+	tQueueSettings.m_bComputeItems = false;
+	ISphMatchSorter * pSorter = sphCreateQueue ( tQueueSettings );
+	EXPECT_TRUE ( pSorter );
+	EXPECT_TRUE ( pIndex->MultiQuery ( &tQuery, &tResult, 1, &pSorter, tArgs ) );
+	int64_t iTotal = pSorter->GetTotalCount();
+
+	SafeDelete ( pSorter );
+	SafeDelete ( tQuery.m_pQueryParser );
+	return iTotal;
+}
+
+TEST_F ( RT, QcacheSkipsIncompleteResult )
+{
+	CSphDictRefPtr_c pDict { sphCreateDictionaryCRC ( tDictSettings, NULL, pTok, "rt", sError ) };
+
+	CSphSchema tSchema;
+	tSchema.AddField ( "title" );
+	tCol.m_sName = "tag";
+	tCol.m_eAttrType = SPH_ATTR_INTEGER;
+	tSchema.AddAttr ( tCol, false );
+
+	ISphRtIndex * pIndex = sphCreateIndexRT ( tSchema, "testrt", 32 * 1024 * 1024, RT_INDEX_FILE_NAME, true );
+	pIndex->Setup ( CSphIndexSettings() );
+	pIndex->SetTokenizer ( pTok->Clone ( SPH_CLONE_INDEX ) );
+	pIndex->SetDictionary ( pDict->Clone () );
+	pIndex->PostSetup ();
+	ASSERT_TRUE ( pIndex->Prealloc ( false ) );
+
+	CSphString sFilter;
+	CSphVector<DWORD> dMvas;
+	const char * dFields[] = { "hello world" };
+	CSphMatch tDoc;
+	tDoc.Reset ( tSchema.GetRowSize() );
+	for ( int i=0; i<2000; ++i )
+	{
+		tDoc.m_uDocID = i+1;
+		ASSERT_TRUE ( pIndex->AddDocument ( pIndex->CloneIndexingTokenizer (), 1, dFields, tDoc, false, sFilter, NULL, dMvas, sError, sWarning, NULL ) );
+	}
+	pIndex->Commit ( NULL, NULL );
+
+	// RAM segments skip the query cache, disk chunks use it
+	pIndex->ForceDiskChunk();
+
+	const QcacheStatus_t & tStatus = QcacheGetStatus();
+	int64_t iMaxBytes = tStatus.m_iMaxBytes;
+	int iThreshMsec = tStatus.m_iThreshMsec;
+	int iTtlSec = tStatus.m_iTtlSec;
+	QcacheSetup ( 0, 0, 60 );
+	QcacheSetup ( 16*1024*1024, 0, 60 );
+	ASSERT_EQ ( tStatus.m_iCachedQueries, 0 );
+
+	// killed query gets nothing, and must not leave its empty result to the others
+	ASSERT_TRUE ( sphInitQueryControl() );
+	QueryControl_c tControl;
+	tControl.Stop ( QUERY_KILLED );
+	{
+		QueryControlScope_c tScope ( &tControl );
+		EXPECT_EQ ( RtQueryTotal ( pIndex, "hello" ), 0 );
+	}
+	EXPECT_EQ ( tStatus.m_iCachedQueries, 0 );
+
+	// cutoff stops the search a few doclist chunks early; the others with no cutoff need all the matches
+	EXPECT_EQ ( RtQueryTotal ( pIndex, "hello", 10 ), 10 );
+	EXPECT_EQ ( tStatus.m_iCachedQueries, 0 );
+
+	EXPECT_EQ ( RtQueryTotal ( pIndex, "hello" ), 2000 );
+	EXPECT_EQ ( tStatus.m_iCachedQueries, 1 );
+	int64_t iHits = tStatus.m_iHits;
+	EXPECT_EQ ( RtQueryTotal ( pIndex, "hello" ), 2000 );
+	EXPECT_EQ ( tStatus.m_iHits, iHits+1 );
+
+	QcacheSetup ( 0, 0, 60 );
+	QcacheSetup ( iMaxBytes, iThreshMsec, iTtlSec );
+	SafeDelete ( pIndex );
+}
+
+TEST_F ( RT, ForcedDumpOfLargeCommit )
+{
+	CSphDictRefPtr_c pDict { sphCreateDictionaryCRC ( tDictSettings, NULL, pTok, "rt", sError ) };
+
+	CSphSchema tSchema;
+	tSchema.AddField ( "title" );
+	tCol.m_sName = "tag";
+	tCol.m_eAttrType = SPH_ATTR_INTEGER;
+	tSchema.AddAttr ( tCol, false );
+
+	const int64_t iRamLimit = 256*1024;
+	ISphRtIndex * pIndex = sphCreateIndexRT ( tSchema, "testrt", iRamLimit, RT_INDEX_FILE_NAME, true );
+	pIndex->Setup ( CSphIndexSettings() );
+	pIndex->SetTokenizer ( pTok->Clone ( SPH_CLONE_INDEX ) );
+	pIndex->SetDictionary ( pDict->Clone () );
+	pIndex->PostSetup ();
+	ASSERT_TRUE ( pIndex->Prealloc ( false ) );
+
+	CSphString sFilter;
+	CSphVector<DWORD> dMvas;
+	CSphMatch tDoc;
+	tDoc.Reset ( tSchema.GetRowSize() );
+	CSphString sTitle;
+	const char * dFields[] = { nullptr };
+	auto fnAdd = [&] ( int iFrom, int iCount, const char * sWord )
+	{
+		for ( int i=iFrom; i<iFrom+iCount; ++i )
+		{
+			sTitle.SetSprintf ( "%s word%d", sWord, i );
+			dFields[0] = sTitle.cstr();
+			tDoc.m_uDocID = i;
+			ASSERT_TRUE ( pIndex->AddDocument ( pIndex->CloneIndexingTokenizer (), 1, dFields, tDoc, false, sFilter, NULL, dMvas, sError, sWarning, NULL ) );
+		}
+		pIndex->Commit ( NULL, NULL );
+	};
+
+	// small commit stays in RAM chunk
+	CSphIndexStatus tStatus;
+	fnAdd ( 1, 10, "small" );
+	pIndex->GetStatus ( &tStatus );
+	ASSERT_EQ ( tStatus.m_iNumChunks, 0 );
+
+	// commit over the threshold dumps the whole RAM chunk, the small commit included, into one new disk chunk
+	fnAdd ( 11, 5000, "large" );
+	pIndex->GetStatus ( &tStatus );
+	ASSERT_EQ ( tStatus.m_iNumChunks, 1 );
+	ASSERT_EQ ( pIndex->GetDiskChunk(0)->GetStats().m_iTotalDocuments, 5010 );
+
+	// and RAM chunk is empty then
+	fnAdd ( 5011, 10, "tail" );
+	pIndex->GetStatus ( &tStatus );
+	ASSERT_EQ ( tStatus.m_iNumChunks, 1 );
+
+	EXPECT_EQ ( RtQueryTotal ( pIndex, "small" ), 10 );
+	EXPECT_EQ ( RtQueryTotal ( pIndex, "large" ), 5000 );
+	EXPECT_EQ ( RtQueryTotal ( pIndex, "tail" ), 10 );
+	EXPECT_EQ ( RtQueryTotal ( pIndex, "word5000" ), 1 );
+	EXPECT_EQ ( RtQueryTotal ( pIndex, "word5" ), 1 );
+
+	SafeDelete ( pIndex );
+}
+
+TEST_F ( RT, InfixNgrams )
+{
+	tDictSettings.m_bWordDict = true;
+	CSphDictRefPtr_c pDict { sphCreateDictionaryKeywords ( tDictSettings, NULL, pTok, "rt", sError ) };
+
+	CSphSchema tSchema;
+	tSchema.AddField ( "title" );
+	tCol.m_sName = "tag";
+	tCol.m_eAttrType = SPH_ATTR_INTEGER;
+	tSchema.AddAttr ( tCol, false );
+
+	CSphIndexSettings tSettings;
+	tSettings.m_iMinInfixLen = 3;
+
+	ISphRtIndex * pIndex = sphCreateIndexRT ( tSchema, "testrt", 32 * 1024 * 1024, RT_INDEX_FILE_NAME, true );
+	pIndex->Setup ( tSettings );
+	pIndex->SetTokenizer ( pTok->Clone ( SPH_CLONE_INDEX ) );
+	pIndex->SetDictionary ( pDict->Clone () );
+	pIndex->PostSetup ();
+	ASSERT_TRUE ( pIndex->Prealloc ( false ) );
+
+	// single commit, so that RAM segment is large enough to get ngram index
+	CSphString sFilter;
+	CSphVector<DWORD> dMvas;
+	char sTitle[32];
+	const char * dFields[] = { sTitle };
+	CSphMatch tDoc;
+	tDoc.Reset ( tSchema.GetRowSize() );
+	for ( int i=0; i<3000; ++i )
+	{
+		snprintf ( sTitle, sizeof(sTitle), "item%d", i );
+		tDoc.m_uDocID = i+1;
+		ASSERT_TRUE ( pIndex->AddDocument ( pIndex->CloneIndexingTokenizer (), 1, dFields, tDoc, false, sFilter, NULL, dMvas, sError, sWarning, NULL ) );
+	}
+	pIndex->Commit ( NULL, NULL );
+
+	struct InfixQuery_t { const char * m_sQuery; int m_iMatches; };
+	InfixQuery_t dQueries[] = { { "*tem12*", 111 }, { "*m299*", 11 }, { "*2999", 1 }, { "it*", 3000 }, { "*tem12x*", 0 }, { "item5", 1 } };
+	for ( const auto & tQ : dQueries )
+	{
+		CSphQuery tQuery;
+		CSphQueryResult tResult;
+		KillListVector tKill;
+		CSphMultiQueryArgs tArgs ( tKill, 1 );
+		tQuery.m_sQuery = tQ.m_sQuery;
+		tQuery.m_pQueryParser = sphCreatePlainQueryParser();
+		tQuery.m_iMaxMatches = 1000;
+		tQuery.m_iLimit = 1000;
+
+		SphQueueSettings_t tQueueSettings ( tQuery, pIndex->GetMatchSchema (), tResult.m_sError );
+		tQueueSettings.m_bComputeItems = false;
+		auto pSorter = sphCreateQueue ( tQueueSettings );
+		ASSERT_TRUE ( pSorter );
+		ASSERT_TRUE ( pIndex->MultiQuery ( &tQuery, &tResult, 1, &pSorter, tArgs ) );
+		EXPECT_EQ ( pSorter->GetTotalCount(), tQ.m_iMatches ) << tQ.m_sQuery;
+
+		SafeDelete ( pSorter );
+		SafeDelete ( tQuery.m_pQueryParser );
+	}
+
+	SafeDelete ( pIndex );
+}
+
+// binlog replay after emulated crashes; binlog mode might be switched between the restarts
+class RtBinlog : public RT
+{
+protected:
+	void SetUp () override
+	{
+		RT::SetUp();
+		CleanupBinlogs();
+		m_pDict = sphCreateDictionaryCRC ( tDictSettings, NULL, pTok, "rt", sError );
+
+		m_tSchema.AddField ( "title" );
+		tCol.m_sName = "tag";
+		tCol.m_eAttrType = SPH_ATTR_INTEGER;
+		m_tSchema.AddAttr ( tCol, false );
+	}
+
+	void TearDown () override
+	{
+		for ( auto & pIndex : m_dIndexes )
+			SafeDelete ( pIndex );
+		RT::TearDown();
+		DeleteIndexFiles ( RT_INDEX_FILE_NAME "2" );
+		CleanupBinlogs();
+	}
+
+	static void CleanupBinlogs ()
+	{
+		const char * dPrefixes[] = { "binlog", "binlog.testrt", "binlog.testrt2" };
+		CSphString sName;
+		for ( const char * sPrefix : dPrefixes )
+		{
+			sName.SetSprintf ( "%s.meta", sPrefix );
+			unlink ( sName.cstr() );
+			for ( int i=1; i<10; ++i )
+			{
+				sName.SetSprintf ( "%s.%03d", sPrefix, i );
+				unlink ( sName.cstr() );
+			}
+		}
+	}
+
+	// (re)start the binlog in the given mode with the given number of indexes, and replay whatever is logged
+	void Start ( bool bCommon, int iIndexes=1, int iReplayThreads=1 )
+	{
+		sphRTDone();
+		CSphConfigSection tRTConfig;
+		CSphString sThreads;
+		sThreads.SetSprintf ( "%d", iReplayThreads );
+		tRTConfig.Add ( CSphVariant ( ".", 0 ), "binlog_path" );
+		tRTConfig.Add ( CSphVariant ( bCommon ? "1" : "0", 0 ), "binlog_common" );
+		tRTConfig.Add ( CSphVariant ( sThreads.cstr(), 0 ), "binlog_replay_threads" );
+		sphRTInit ( tRTConfig, true, nullptr );
+		sphRTConfigure ( tRTConfig, true );
+
+		const char * dNames[] = { "testrt", "testrt2" };
+		const char * dPaths[] = { RT_INDEX_FILE_NAME, RT_INDEX_FILE_NAME "2" };
+		SmallStringHash_T<CSphIndex *> hIndexes;
+		for ( int i=0; i<iIndexes; ++i )
+		{
+			ISphRtIndex * pIndex = sphCreateIndexRT ( m_tSchema, dNames[i], 32 * 1024 * 1024, dPaths[i], true );
+			pIndex->Setup ( CSphIndexSettings() );
+			pIndex->SetTokenizer ( pTok->Clone ( SPH_CLONE_INDEX ) );
+			pIndex->SetDictionary ( m_pDict->Clone () );
+			pIndex->PostSetup ();
+			EXPECT_TRUE ( pIndex->Prealloc ( false ) );
+			hIndexes.Add ( pIndex, dNames[i] );
+			m_dIndexes.Add ( pIndex );
+		}
+
+		BinlogFlushInfo_t tBinlogFlush;
+		sphReplayBinlog ( hIndexes, 0, nullptr, tBinlogFlush );
+	}
+
+	// binlog goes away first, so that closed indexes do not release it; then saved index data is dropped
+	void Crash ()
+	{
+		sphRTDone();
+		for ( auto & pIndex : m_dIndexes )
+			SafeDelete ( pIndex );
+		m_dIndexes.Reset();
+		DeleteIndexFiles ( RT_INDEX_FILE_NAME );
+		DeleteIndexFiles ( RT_INDEX_FILE_NAME "2" );
+		TestRTInit();
+	}
+
+	// one doc per commit
+	void AddDocs ( int iIndex, int iFrom, int iCount, const char * sTitle = "hello world" )
+	{
+		ISphRtIndex * pIndex = m_dIndexes[iIndex];
+		CSphString sFilter;
+		CSphVector<DWORD> dMvas;
+		const char * dFields[] = { sTitle };
+		CSphMatch tDoc;
+		tDoc.Reset ( m_tSchema.GetRowSize() );
+		for ( int i=0; i<iCount; ++i )
+		{
+			tDoc.m_uDocID = iFrom+i;
+			ASSERT_TRUE ( pIndex->AddDocument ( pIndex->CloneIndexingTokenizer (), 1, dFields, tDoc, false, sFilter, NULL, dMvas, sError, sWarning, NULL ) );
+			pIndex->Commit ( NULL, NULL );
+		}
+	}
+
+	int64_t GetDocs ( int iIndex ) const
+	{
+		return m_dIndexes[iIndex]->GetStats().m_iTotalDocuments;
+	}
+
+	// one replace per commit
+	void Replace ( int iIndex, SphDocID_t uID, const char * sTitle, int iTag )
+	{
+		ISphRtIndex * pIndex = m_dIndexes[iIndex];
+		CSphString sFilter;
+		CSphVector<DWORD> dMvas;
+		const char * dFields[] = { sTitle };
+		CSphMatch tDoc;
+		tDoc.Reset ( m_tSchema.GetRowSize() );
+		tDoc.m_uDocID = uID;
+		tDoc.SetAttr ( m_tSchema.GetAttr ( "tag" )->m_tLocator, iTag );
+		ASSERT_TRUE ( pIndex->AddDocument ( pIndex->CloneIndexingTokenizer (), 1, dFields, tDoc, true, sFilter, NULL, dMvas, sError, sWarning, NULL ) );
+		pIndex->Commit ( NULL, NULL );
+	}
+
+	void Delete ( int iIndex, SphDocID_t uID )
+	{
+		ISphRtIndex * pIndex = m_dIndexes[iIndex];
+		ASSERT_TRUE ( pIndex->DeleteDocument ( &uID, 1, sError, NULL ) );
+		pIndex->Commit ( NULL, NULL );
+	}
+
+	// matches of a full-text query, optionally only the given doc with the given tag
+	int64_t Count ( int iIndex, const char * sQuery, SphDocID_t uID=0, int iTag=-1 )
+	{
+		ISphRtIndex * pIndex = m_dIndexes[iIndex];
+		CSphQuery tQuery;
+		tQuery.m_sQuery = sQuery;
+		tQuery.m_pQueryParser = sphCreatePlainQueryParser();
+		if ( uID )
+		{
+			CSphFilterSettings & tID = tQuery.m_dFilters.Add();
+			tID.m_sAttrName = "@id";
+			tID.m_eType = SPH_FILTER_RANGE;
+			tID.m_iMinValue = tID.m_iMaxValue = uID;
+		}
+		if ( iTag>=0 )
+		{
+			CSphFilterSettings & tTag = tQuery.m_dFilters.Add();
+			tTag.m_sAttrName = "tag";
+			tTag.m_dValues.Add ( iTag );
+		}
+
+		CSphQueryResult tResult;
+		KillListVector tKill;
+		CSphMultiQueryArgs tArgs ( tKill, 1 );
+		SphQueueSettings_t tQueueSettings ( tQuery, pIndex->GetMatchSchema (), tResult.m_sError );
+		ISphMatchSorter * pSorter = sphCreateQueue ( tQueueSettings );
+		EXPECT_TRUE ( pSorter );
+		EXPECT_TRUE ( pIndex->MultiQuery ( &tQuery, &tResult, 1, &pSorter, tArgs ) ) << tResult.m_sError.cstr();
+		int64_t iTotal = pSorter->GetTotalCount();
+		SafeDelete ( pSorter );
+		SafeDelete ( tQuery.m_pQueryParser );
+		return iTotal;
+	}
+
+	CSphSchema					m_tSchema;
+	CSphDictRefPtr_c			m_pDict;
+	CSphVector<ISphRtIndex *>	m_dIndexes;
+};
+
+TEST_F ( RtBinlog, streams_to_common )
+{
+	Start ( false );
+	AddDocs ( 0, 1, 10 );
+	ASSERT_TRUE ( sphIsReadable ( "binlog.testrt.meta" ) );
+	Crash();
+
+	// replay with the common log; stream data must not be lost
+	Start ( true );
+	ASSERT_EQ ( GetDocs ( 0 ), 10 );
+
+	// newer txns go into the common log while the stream still holds the older ones
+	AddDocs ( 0, 11, 5 );
+	Crash();
+
+	// stream has to be replayed prior to the newer common log
+	Start ( true );
+	ASSERT_EQ ( GetDocs ( 0 ), 15 );
+
+	// once the index is flushed, the stream is released
+	SafeDelete ( m_dIndexes[0] );
+	m_dIndexes.Reset();
+	EXPECT_FALSE ( sphIsReadable ( "binlog.testrt.001" ) );
+}
+
+TEST_F ( RtBinlog, common_to_streams )
+{
+	Start ( true );
+	AddDocs ( 0, 1, 10 );
+	Crash();
+
+	Start ( false );
+	ASSERT_EQ ( GetDocs ( 0 ), 10 );
+	AddDocs ( 0, 11, 5 );
+	ASSERT_TRUE ( sphIsReadable ( "binlog.testrt.meta" ) );
+	Crash();
+
+	// common log holds the older txns, stream the newer ones
+	Start ( false );
+	ASSERT_EQ ( GetDocs ( 0 ), 15 );
+	AddDocs ( 0, 16, 5 );
+	Crash();
+
+	// and back again
+	Start ( true );
+	ASSERT_EQ ( GetDocs ( 0 ), 20 );
+}
+
+// transactions of two indexes interleaved in one log must replay in their own order, and never leak into each other
+TEST_F ( RtBinlog, interleaved_indexes )
+{
+	for ( bool bCommon : { true, false } )
+	{
+		CleanupBinlogs();
+		Start ( bCommon, 2, 4 );
+
+		// expected doc id to tag, per index
+		CSphOrderedHash<int, SphDocID_t, IdentityHash_fn, 64> dExpected[2];
+		for ( int iRound=1; iRound<=40; ++iRound )
+		{
+			SphDocID_t uAlpha = iRound%5+1;
+			Replace ( 0, uAlpha, "alpha", iRound );
+			dExpected[0].Delete ( uAlpha );
+			dExpected[0].Add ( iRound, uAlpha );
+
+			SphDocID_t uBeta = iRound%3+1;
+			Replace ( 1, uBeta, "beta", 100+iRound );
+			dExpected[1].Delete ( uBeta );
+			dExpected[1].Add ( 100+iRound, uBeta );
+
+			if ( iRound%4==0 )
+			{
+				uAlpha = ( iRound+2 )%5+1;
+				Delete ( 0, uAlpha );
+				dExpected[0].Delete ( uAlpha );
+
+				Replace ( 1, 50+iRound, "beta gamma", 100+iRound );
+				dExpected[1].Add ( 100+iRound, 50+iRound );
+			}
+		}
+		Crash();
+
+		Start ( bCommon, 2, 4 );
+		const char * dWords[] = { "alpha", "beta" };
+		for ( int iIndex=0; iIndex<2; ++iIndex )
+		{
+			ASSERT_EQ ( Count ( iIndex, "" ), dExpected[iIndex].GetLength() ) << "index " << iIndex;
+			ASSERT_EQ ( Count ( iIndex, dWords[iIndex] ), dExpected[iIndex].GetLength() ) << "index " << iIndex;
+			ASSERT_EQ ( Count ( iIndex, dWords[1-iIndex] ), 0 ) << "index " << iIndex;
+
+			// every doc holds the last version written to it
+			dExpected[iIndex].IterateStart();
+			while ( dExpected[iIndex].IterateNext() )
+				ASSERT_EQ ( Count ( iIndex, "", dExpected[iIndex].IterateGetKey(), dExpected[iIndex].IterateGet() ), 1 )
+					<< "index " << iIndex << " doc " << dExpected[iIndex].IterateGetKey();
+		}
+		ASSERT_EQ ( Count ( 0, "gamma" ), 0 );
+		ASSERT_EQ ( Count ( 1, "gamma" ), 10 );
+
+		Crash();
+	}
+}
@@ -243,4 +243,1446 @@ TEST ( searchd_stuff, iovec_behaviour )
 	ASSERT_EQ ( tIO.IOSize (), 1 );
 	tIO.StepForward (4);
 	ASSERT_EQ ( tIO.IOSize (), 0 );
-}
\ No newline at end of file
+}
+
+// glue all the chunks of a reply together, as the client would see them
+static void CollectChunks ( const SmartOutputBuffer_t & tSrc, CSphVector<BYTE> & dOut )
+{
+	CSphVector<sphIovec> dIOVec;
+	tSrc.GetIOVec ( dIOVec );
+	dOut.Reset();
+	for ( const auto & tIOVec : dIOVec )
+		dOut.Append ( (const BYTE *) IOPTR ( tIOVec ), (int) IOLEN ( tIOVec ) );
+}
+
+// split raw bytes into mysql packets; checks that packet ids are sequential
+static void ParseMysqlPackets ( const CSphVector<BYTE> & dRaw, CSphVector<CSphString> & dPackets, BYTE uFirstID=0 )
+{
+	dPackets.Reset();
+	BYTE uID = uFirstID;
+	for ( int iPos = 0; iPos<dRaw.GetLength(); )
+	{
+		ASSERT_LE ( iPos+4, dRaw.GetLength() );
+		int iLen = dRaw[iPos] + ( dRaw[iPos+1]<<8 ) + ( dRaw[iPos+2]<<16 );
+		ASSERT_EQ ( dRaw[iPos+3], uID++ );
+		iPos += 4;
+		ASSERT_LE ( iPos+iLen, dRaw.GetLength() );
+		dPackets.Add().SetBinary ( (const char *) dRaw.Begin()+iPos, iLen );
+		iPos += iLen;
+	}
+}
+
+TEST ( searchd_stuff, sqlrow_across_chunks )
+{
+	SmartOutputBuffer_t tOut;
+	BYTE uPacketID = 0;
+	const int ROWS = 2000;
+	{
+		SqlRowBuffer_c tRow ( &uPacketID, &tOut, 0, true );
+		for ( int i=0; i<ROWS; ++i )
+		{
+			CSphString sVal;
+			sVal.SetSprintf ( "row %d %0*d", i, i % 97, 0 ); // rows of varying length
+			tRow.PutNumeric<int> ( "%d", i );
+			tRow.PutString ( sVal.cstr() );
+			tRow.Commit();
+		}
+	}
+
+	// rows were committed right into the buffer, and it was cut into several chunks at packet edges
+	ASSERT_TRUE ( tOut.HasChunks() );
+	CSphVector<sphIovec> dIOVec;
+	tOut.GetIOVec ( dIOVec );
+	ASSERT_GT ( dIOVec.GetLength(), 2 );
+
+	CSphVector<BYTE> dRaw;
+	CollectChunks ( tOut, dRaw );
+	CSphVector<CSphString> dPackets;
+	ParseMysqlPackets ( dRaw, dPackets );
+	ASSERT_EQ ( dPackets.GetLength(), ROWS );
+	ASSERT_EQ ( uPacketID, BYTE ( ROWS ) );
+
+	for ( int i=0; i<ROWS; ++i )
+	{
+		CSphString sNum, sVal, sRow;
+		sNum.SetSprintf ( "%d", i );
+		sVal.SetSprintf ( "row %d %0*d", i, i % 97, 0 ); // rows of varying length
+		sRow.SetSprintf ( "%c%s%c%s", sNum.Length(), sNum.cstr(), sVal.Length(), sVal.cstr() );
+		ASSERT_STREQ ( dPackets[i].cstr(), sRow.cstr() ) << "row " << i;
+	}
+}
+
+TEST ( searchd_stuff, sqlrow_reset_partial )
+{
+	SmartOutputBuffer_t tOut;
+	BYTE uPacketID = 0;
+	{
+		SqlRowBuffer_c tRow ( &uPacketID, &tOut, 0, true );
+		tRow.PutString ( "first" );
+		tRow.Commit();
+		int iCommitted = tOut.GetSentCount();
+
+		// half-built row is dropped along with its header placeholder
+		tRow.PutString ( "partial" );
+		tRow.PutNumeric<int> ( "%d", 12345 );
+		ASSERT_GT ( tOut.GetSentCount(), iCommitted );
+		tRow.Reset();
+		ASSERT_EQ ( tOut.GetSentCount(), iCommitted );
+		ASSERT_EQ ( tRow.Length(), 0 );
+
+		// reset with no row in progress changes nothing
+		tRow.Reset();
+		ASSERT_EQ ( tOut.GetSentCount(), iCommitted );
+
+		tRow.PutString ( "second" );
+		tRow.Commit();
+
+		// partial row left on destruction is dropped as well
+		tRow.PutString ( "leftover" );
+	}
+
+	CSphVector<BYTE> dRaw;
+	CollectChunks ( tOut, dRaw );
+	CSphVector<CSphString> dPackets;
+	ParseMysqlPackets ( dRaw, dPackets );
+	ASSERT_EQ ( dPackets.GetLength(), 2 );
+	ASSERT_STREQ ( dPackets[0].cstr(), "\005first" );
+	ASSERT_STREQ ( dPackets[1].cstr(), "\006second" );
+	ASSERT_EQ ( uPacketID, 2 );
+}
+
+#if !USE_WINDOWS
+// more chunks than one sendmsg() can take; all of them must arrive, in order
+TEST ( searchd_stuff, iovec_send_many_chunks )
+{
+	const int CHUNKS = UIO_MAXIOV*2+17;
+	SmartOutputBuffer_t tSrc;
+	for ( int i=0; i<CHUNKS; ++i )
+	{
+		tSrc.SendDword ( i );
+		tSrc.StartNewChunk ( 16 );
+	}
+	IOVec_c tIO;
+	tIO.BuildFrom ( tSrc );
+	ASSERT_TRUE ( tIO.HasUnsent() );
+	ASSERT_EQ ( tIO.IOSize(), (size_t) UIO_MAXIOV );
+
+	int dSockets[2] = { -1, -1 };
+	ASSERT_EQ ( socketpair ( AF_LOCAL, SOCK_STREAM, 0, dSockets ), 0 );
+
+	// small send buffer, so that sends are partial and would block on the way
+	int iSndBuf = 4096;
+	setsockopt ( dSockets[0], SOL_SOCKET, SO_SNDBUF, &iSndBuf, sizeof ( iSndBuf ) );
+
+	CSphVector<BYTE> dGot;
+	BYTE dBuf[8192];
+	int iCalls = 0;
+	while ( tIO.HasUnsent() )
+	{
+		ASSERT_LE ( tIO.IOSize(), (size_t) UIO_MAXIOV );
+		int iRes = NetSendIOVec ( dSockets[0], tIO );
+		ASSERT_GE ( iRes, 0 );
+		tIO.StepForward ( iRes );
+		++iCalls;
+
+		int iGot;
+		while ( ( iGot = recv ( dSockets[1], dBuf, sizeof ( dBuf ), MSG_DONTWAIT ) )>0 )
+			dGot.Append ( dBuf, iGot );
+	}
+	ASSERT_GT ( iCalls, 2 );
+
+	::close ( dSockets[0] );
+	int iGot;
+	while ( ( iGot = recv ( dSockets[1], dBuf, sizeof ( dBuf ), 0 ) )>0 )
+		dGot.Append ( dBuf, iGot );
+	::close ( dSockets[1] );
+
+	ASSERT_EQ ( dGot.GetLength(), CHUNKS*4 );
+	for ( int i=0; i<CHUNKS; ++i )
+		ASSERT_EQ ( sphUnalignedRead ( *(DWORD *) ( dGot.Begin()+i*4 ) ), ntohl ( i ) ) << "chunk " << i;
+}
+#endif
+
+// query log writer writes into g_iQueryLogFile; point it to a scratch file
+class QueryLogWriter : public ::testing::Test
+{
+protected:
+	void SetUp () override
+	{
+		m_iSavedFile = g_iQueryLogFile;
+		g_iQueryLogFile = open ( QLOG_FILE, O_CREAT | O_RDWR | O_TRUNC | O_APPEND, S_IREAD | S_IWRITE );
+		ASSERT_GE ( g_iQueryLogFile, 0 );
+	}
+
+	void TearDown () override
+	{
+		::close ( g_iQueryLogFile );
+		g_iQueryLogFile = m_iSavedFile;
+		unlink ( QLOG_FILE );
+	}
+
+	CSphString ReadLog ()
+	{
+		CSphString sLog;
+		int64_t iSize = sphSeek ( g_iQueryLogFile, 0, SEEK_END );
+		if ( iSize<=0 )
+			return sLog;
+
+		CSphVector<char> dData ( (int)iSize );
+		sphSeek ( g_iQueryLogFile, 0, SEEK_SET );
+		EXPECT_EQ ( ::read ( g_iQueryLogFile, dData.Begin(), (size_t)iSize ), iSize );
+		sLog.SetBinary ( dData.Begin(), dData.GetLength() );
+		return sLog;
+	}
+
+	void Write ( QueryLogWriter_c & tWriter, const char * sLine )
+	{
+		tWriter.Write ( sLine, (int)strlen ( sLine ) );
+	}
+
+	static constexpr const char * QLOG_FILE = "__querylog.tmp";
+	int m_iSavedFile = -1;
+};
+
+TEST_F ( QueryLogWriter, unbuffered )
+{
+	QueryLogWriter_c tWriter;
+	tWriter.Setup ( 0, true );
+	ASSERT_FALSE ( tWriter.IsBuffered() );
+	Write ( tWriter, "line1\n" );
+	ASSERT_STREQ ( ReadLog().cstr(), "line1\n" );
+}
+
+TEST_F ( QueryLogWriter, block_keeps_all_lines_in_order )
+{
+	QueryLogWriter_c tWriter;
+	tWriter.Setup ( 12, true );
+	ASSERT_TRUE ( tWriter.IsBuffered() );
+
+	Write ( tWriter, "line1\n" );
+	Write ( tWriter, "line2\n" );
+	ASSERT_TRUE ( ReadLog().IsEmpty() ) << "lines must stay in buffer until flush";
+
+	// does not fit; the writer flushes the buffer itself
+	Write ( tWriter, "line3\n" );
+	ASSERT_STREQ ( ReadLog().cstr(), "line1\nline2\n" );
+
+	// line longer than the whole buffer still goes in
+	Write ( tWriter, "very long line\n" );
+	tWriter.Flush();
+	ASSERT_STREQ ( ReadLog().cstr(), "line1\nline2\nline3\nvery long line\n" );
+	ASSERT_EQ ( tWriter.GetDropped(), 0 );
+}
+
+TEST_F ( QueryLogWriter, drop_when_full )
+{
+	QueryLogWriter_c tWriter;
+	tWriter.Setup ( 12, false );
+
+	Write ( tWriter, "line1\n" );
+	Write ( tWriter, "line2\n" );
+	Write ( tWriter, "line3\n" );
+	Write ( tWriter, "line4\n" );
+	ASSERT_EQ ( tWriter.GetDropped(), 2 );
+	ASSERT_TRUE ( ReadLog().IsEmpty() ) << "drop policy never writes from the worker";
+
+	tWriter.Flush();
+	Write ( tWriter, "line5\n" );
+	tWriter.Flush();
+	ASSERT_STREQ ( ReadLog().cstr(), "line1\nline2\nline5\n" );
+	ASSERT_EQ ( tWriter.GetDropped(), 2 );
+}
+
+static bool IsLocalSql ( const char * sQuery )
+{
+	CSphVector<BYTE> dBuf;
+	dBuf.Add ( MYSQL_COM_QUERY );
+	dBuf.Append ( sQuery, (int)strlen ( sQuery ) );
+	return IsLocalSqlRequest ( dBuf );
+}
+
+TEST ( searchd_stuff, net_local_requests )
+{
+	int iSavedMaxPacket = g_iNetLocalMaxPacket;
+	ServedDesc_t tDesc;
+	g_pLocalIndexes->AddUniq ( new ServedIndex_c ( tDesc ), "local1" );
+	g_pDistIndexes->AddUniq ( new ServedIndex_c ( tDesc ), "dist1" );
+	ServedDesc_t tRtDesc;
+	tRtDesc.m_eType = eITYPE::RT;
+	g_pLocalIndexes->AddUniq ( new ServedIndex_c ( tRtDesc ), "rt1" );
+
+	g_iNetLocalMaxPacket = 0;
+	ASSERT_FALSE ( IsLocalApiRequest ( SEARCHD_COMMAND_PING, 8 ) ) << "disabled";
+	ASSERT_FALSE ( IsLocalSql ( "show status" ) ) << "disabled";
+
+	g_iNetLocalMaxPacket = 128;
+	ASSERT_TRUE ( IsLocalApiRequest ( SEARCHD_COMMAND_PING, 8 ) );
+	ASSERT_TRUE ( IsLocalApiRequest ( SEARCHD_COMMAND_STATUS, 8 ) );
+	ASSERT_FALSE ( IsLocalApiRequest ( SEARCHD_COMMAND_PING, 256 ) ) << "too big";
+	ASSERT_FALSE ( IsLocalApiRequest ( SEARCHD_COMMAND_SEARCH, 8 ) );
+	ASSERT_FALSE ( IsLocalApiRequest ( SEARCHD_COMMAND_UPDATE, 8 ) );
+	ASSERT_FALSE ( IsLocalApiRequest ( SEARCHD_COMMAND_FLUSHATTRS, 8 ) );
+
+	ASSERT_TRUE ( IsLocalSql ( "SHOW STATUS" ) );
+	ASSERT_TRUE ( IsLocalSql ( "select @@version_comment limit 1" ) );
+	ASSERT_TRUE ( IsLocalSql ( "SELECT * FROM local1 WHERE id=5" ) );
+	ASSERT_TRUE ( IsLocalSql ( "select id, gid from LOCAL1 where ID = 100 limit 1" ) );
+	ASSERT_TRUE ( IsLocalSql ( "select * from local1 where id=100 limit 0, 1" ) );
+
+	ASSERT_FALSE ( IsLocalSql ( "SELECT * FROM local1" ) ) << "full scan";
+	ASSERT_FALSE ( IsLocalSql ( "select id from local1 where id>100 order by id desc" ) ) << "range scan";
+	ASSERT_FALSE ( IsLocalSql ( "SELECT * FROM local1 WHERE id=5 AND gid=1" ) );
+	ASSERT_FALSE ( IsLocalSql ( "SELECT * FROM local1 WHERE id=5 OR gid=1" ) );
+	ASSERT_FALSE ( IsLocalSql ( "SELECT * FROM local1 WHERE id=5 OPTION max_matches=1" ) );
+	ASSERT_FALSE ( IsLocalSql ( "SELECT * FROM local1 WHERE id=gid" ) );
+	ASSERT_FALSE ( IsLocalSql ( "SELECT * FROM rt1 WHERE id=5" ) ) << "RT readers might wait for a commit";
+	ASSERT_FALSE ( IsLocalSql ( "SELECT * FROM dist1 WHERE id=5" ) ) << "distributed";
+	ASSERT_FALSE ( IsLocalSql ( "SELECT * FROM local1, local1 WHERE id=5" ) ) << "several indexes";
+	ASSERT_FALSE ( IsLocalSql ( "SELECT gid, count(*) FROM local1 GROUP BY gid" ) );
+	ASSERT_FALSE ( IsLocalSql ( "SELECT * FROM local1 WHERE id=5 FACET gid" ) );
+	ASSERT_FALSE ( IsLocalSql ( "SELECT * FROM local1 WHERE id=5; SELECT * FROM local1" ) );
+	ASSERT_FALSE ( IsLocalSql ( "SELECT * FROM (SELECT * FROM local1 WHERE id=5)" ) );
+	ASSERT_FALSE ( IsLocalSql ( "UPDATE local1 SET gid=1 WHERE id=1" ) );
+	ASSERT_FALSE ( IsLocalSql ( "FLUSH RTINDEX local1" ) );
+	ASSERT_FALSE ( IsLocalSql ( "OPTIMIZE INDEX local1" ) );
+	ASSERT_FALSE ( IsLocalSql ( "SELECT * FROM local1 WHERE match('a very long query that does not fit into the local packet limit at all, and thus goes to the pool')" ) );
+
+	ASSERT_FALSE ( IsLocalSql ( "SELECT * FROM local1 WHERE match('hello')" ) ) << "full-text";
+	ASSERT_FALSE ( IsLocalSql ( "SELECT * FROM local1 WHERE match('hello') AND id=5" ) ) << "full-text";
+
+	g_iNetLocalMaxPacket = iSavedMaxPacket;
+	g_pLocalIndexes->Delete ( "local1" );
+	g_pLocalIndexes->Delete ( "rt1" );
+	g_pDistIndexes->Delete ( "dist1" );
+}
+
+static void AdmissionTicket ( AdmissionTicket_t & tTicket, const char * sClient, const char * sIndex, bool bExpensive=false )
+{
+	tTicket.m_sClient = sClient;
+	tTicket.m_dIndexes.Add ( sIndex );
+	tTicket.m_bExpensive = bExpensive;
+}
+
+TEST ( searchd_stuff, admission_budgets )
+{
+	AdmissionSettings_t tSettings;
+	tSettings.m_iMaxPerClient = 1;
+	tSettings.m_iMaxPerIndex = 2;
+	tSettings.m_iMaxExpensive = 1;
+	tSettings.m_iExpensiveMsec = 100;
+	tSettings.m_iWaitMsec = 20;
+
+	AdmissionControl_c tAdmission;
+	tAdmission.Setup ( tSettings );
+	ASSERT_TRUE ( tAdmission.IsEnabled() );
+	ASSERT_TRUE ( tAdmission.NeedCost() );
+
+	AdmissionTicket_t t1, t2, t3, t4, t5;
+	AdmissionTicket ( t1, "client1", "idx1", true );
+	AdmissionTicket ( t2, "client1", "idx2" );
+	AdmissionTicket ( t3, "client2", "idx1", true );
+	AdmissionTicket ( t4, "client3", "idx1" );
+	AdmissionTicket ( t5, "client4", "idx1" );
+
+	ASSERT_TRUE ( tAdmission.Acquire ( t1 ) );
+	ASSERT_FALSE ( tAdmission.Acquire ( t2 ) ) << "per client";
+	ASSERT_FALSE ( tAdmission.Acquire ( t3 ) ) << "expensive lane";
+	ASSERT_TRUE ( tAdmission.Acquire ( t4 ) );
+	ASSERT_FALSE ( tAdmission.Acquire ( t5 ) ) << "per index";
+
+	int iQueued;
+	int64_t iWaited, iRejected;
+	tAdmission.GetStatus ( iQueued, iWaited, iRejected );
+	ASSERT_EQ ( iQueued, 0 );
+	ASSERT_EQ ( iWaited, 3 );
+	ASSERT_EQ ( iRejected, 3 );
+
+	// released slots are reusable
+	tAdmission.Release ( t1 );
+	ASSERT_TRUE ( tAdmission.Acquire ( t2 ) );
+	ASSERT_TRUE ( tAdmission.Acquire ( t3 ) );
+	tAdmission.Release ( t2 );
+	tAdmission.Release ( t3 );
+	tAdmission.Release ( t4 );
+	tAdmission.Release ( t5 ); // never granted, must be no-op
+}
+
+static AdmissionControl_c * g_pAdmission = nullptr;
+static AdmissionTicket_t * g_pWaitingTicket = nullptr;
+static volatile bool g_bWaitingGranted = false;
+
+static void AdmissionWaiter ( void * )
+{
+	g_bWaitingGranted = g_pAdmission->Acquire ( *g_pWaitingTicket );
+}
+
+TEST ( searchd_stuff, admission_queue )
+{
+	AdmissionSettings_t tSettings;
+	tSettings.m_iMaxPerClient = 1;
+	tSettings.m_iWaitMsec = 5000;
+
+	AdmissionControl_c tAdmission;
+	tAdmission.Setup ( tSettings );
+
+	AdmissionTicket_t tBusy, tWaiting, tOther;
+	AdmissionTicket ( tBusy, "client1", "idx1" );
+	AdmissionTicket ( tWaiting, "client1", "idx1" );
+	AdmissionTicket ( tOther, "client2", "idx1" );
+	ASSERT_TRUE ( tAdmission.Acquire ( tBusy ) );
+
+	g_pAdmission = &tAdmission;
+	g_pWaitingTicket = &tWaiting;
+	g_bWaitingGranted = false;
+	SphThread_t tThd;
+	ASSERT_TRUE ( sphThreadCreate ( &tThd, AdmissionWaiter, nullptr ) );
+
+	int iQueued = 0;
+	int64_t iWaited, iRejected;
+	for ( int i=0; i<500 && !iQueued; ++i )
+	{
+		sphSleepMsec ( 10 );
+		tAdmission.GetStatus ( iQueued, iWaited, iRejected );
+	}
+	ASSERT_EQ ( iQueued, 1 );
+
+	// another client fits, so it must not wait behind the queued one
+	int64_t tmStart = sphMicroTimer();
+	ASSERT_TRUE ( tAdmission.Acquire ( tOther ) );
+	ASSERT_LT ( sphMicroTimer()-tmStart, 1000000 );
+	tAdmission.GetStatus ( iQueued, iWaited, iRejected );
+	ASSERT_EQ ( iWaited, 1 );
+
+	// freed slot goes to the waiting one
+	tAdmission.Release ( tBusy );
+	ASSERT_TRUE ( sphThreadJoin ( &tThd ) );
+	ASSERT_TRUE ( g_bWaitingGranted );
+	tAdmission.GetStatus ( iQueued, iWaited, iRejected );
+	ASSERT_EQ ( iQueued, 0 );
+	ASSERT_EQ ( iRejected, 0 );
+
+	tAdmission.Release ( tWaiting );
+	tAdmission.Release ( tOther );
+}
+
+TEST ( searchd_stuff, query_control_memory )
+{
+	QueryControl_c tShared;
+	tShared.m_iMaxMemory = 1000;
+
+	QueryControl_c tFirst, tSecond;
+	tFirst.m_iMaxMemory = 800;
+	tFirst.m_pShared = &tShared;
+	tSecond.m_pShared = &tShared;
+
+	// own limit
+	tFirst.TrackMemory ( 500 );
+	ASSERT_FALSE ( tFirst.IsStopped() );
+	tFirst.TrackMemory ( 400 );
+	ASSERT_EQ ( tFirst.GetStopReason(), QUERY_MEMORY_LIMIT );
+	ASSERT_STREQ ( tFirst.GetStopMessage(), "query exceeded max_query_memory" );
+	tFirst.TrackMemory ( -400 );
+	ASSERT_EQ ( tFirst.GetMemory(), 500 );
+	ASSERT_EQ ( tFirst.GetPeakMemory(), 900 );
+
+	// shared budget is hit by the query that crosses it; first reason wins
+	tSecond.TrackMemory ( 400 );
+	ASSERT_FALSE ( tSecond.IsStopped() );
+	tSecond.TrackMemory ( 200 );
+	ASSERT_EQ ( tSecond.GetStopReason(), QUERY_CLIENT_MEMORY );
+	ASSERT_EQ ( tShared.GetMemory(), 1100 );
+	ASSERT_EQ ( tFirst.GetStopReason(), QUERY_MEMORY_LIMIT );
+}
+
+TEST ( searchd_stuff, query_control_cpu_time )
+{
+	ASSERT_TRUE ( sphInitQueryControl() );
+
+	// query asks for less than daemon cap
+	int iOldCpu = g_iMaxQueryCpuMsec;
+	g_iMaxQueryCpuMsec = 1000;
+	ThdDesc_t tThd;
+	CSphQuery tQuery;
+	tQuery.m_iMaxQueryCpuMsec = 5;
+	ClientQueryControl_c tControl ( tThd, tQuery );
+	g_iMaxQueryCpuMsec = iOldCpu;
+	ASSERT_EQ ( tControl.m_iMaxCpuTime, 5000 );
+	ASSERT_EQ ( tThd.m_pQueryControl, &tControl );
+
+	bool bStopped = false;
+	{
+		QueryControlScope_c tScope ( &tControl );
+		ASSERT_EQ ( sphGetQueryControl(), &tControl );
+
+		int64_t tmEnd = sphMicroTimer() + 5000000;
+		volatile DWORD uSpin = 0;
+		while ( !bStopped && sphMicroTimer()<tmEnd )
+		{
+			for ( int i=0; i<10000; ++i )
+				uSpin = uSpin + i;
+			bStopped = sphQueryStopped();
+		}
+	}
+
+	ASSERT_TRUE ( bStopped );
+	ASSERT_EQ ( tControl.GetStopReason(), QUERY_CPU_LIMIT );
+	ASSERT_GE ( tControl.GetCpuTime(), 5000 );
+	ASSERT_EQ ( sphGetQueryControl(), nullptr );
+}
+
+TEST ( searchd_stuff, query_control_kill )
+{
+	ThdDesc_t tThd;
+	tThd.m_iTid = 1234567;
+	CSphQuery tQuery;
+	ClientQueryControl_c tControl ( tThd, tQuery );
+	ThreadAdd ( &tThd );
+
+	SqlStmt_t tStmt;
+	tStmt.m_iIntParam = tThd.m_iTid;
+	BYTE uPacketID = 0;
+	ISphOutputBuffer tBuf;
+
+	// plain connection is refused
+	{
+		SqlRowBuffer_c tOut ( &uPacketID, &tBuf, 0, true );
+		HandleMysqlKill ( tOut, tStmt, false );
+	}
+	ASSERT_FALSE ( tControl.IsStopped() );
+
+	// vip one stops the query
+	{
+		SqlRowBuffer_c tOut ( &uPacketID, &tBuf, 0, true );
+		HandleMysqlKill ( tOut, tStmt, true );
+	}
+	ThreadRemove ( &tThd );
+	ASSERT_EQ ( tControl.GetStopReason(), QUERY_KILLED );
+	ASSERT_STREQ ( tControl.GetStopMessage(), "query was killed" );
+}
+
+#if !USE_WINDOWS
+// connected loopback tcp pair; the client side is the one the daemon talks to
+static void LoopbackPair ( int & iServer, int & iClient )
+{
+	int iListen = socket ( AF_INET, SOCK_STREAM, 0 );
+	ASSERT_GE ( iListen, 0 );
+	sockaddr_in tAddr;
+	memset ( &tAddr, 0, sizeof(tAddr) );
+	tAddr.sin_family = AF_INET;
+	tAddr.sin_addr.s_addr = htonl ( INADDR_LOOPBACK );
+	socklen_t iLen = sizeof(tAddr);
+	ASSERT_EQ ( bind ( iListen, (sockaddr *)&tAddr, iLen ), 0 );
+	ASSERT_EQ ( listen ( iListen, 1 ), 0 );
+	ASSERT_EQ ( getsockname ( iListen, (sockaddr *)&tAddr, &iLen ), 0 );
+
+	iClient = socket ( AF_INET, SOCK_STREAM, 0 );
+	ASSERT_EQ ( connect ( iClient, (sockaddr *)&tAddr, iLen ), 0 );
+	iServer = accept ( iListen, nullptr, nullptr );
+	ASSERT_GE ( iServer, 0 );
+	close ( iListen );
+}
+
+TEST ( searchd_stuff, query_control_client_gone )
+{
+	CSphQuery tQuery;
+
+	// half-closed client still waits for the reply
+	int iServer = -1, iClient = -1;
+	LoopbackPair ( iServer, iClient );
+	{
+		ThdDesc_t tThd;
+		tThd.m_iClientSock = iServer;
+		ClientQueryControl_c tControl ( tThd, tQuery );
+		ASSERT_FALSE ( tControl.IsClientGone() );
+
+		ASSERT_EQ ( shutdown ( iClient, SHUT_WR ), 0 );
+		sphSleepMsec ( 50 );
+		ASSERT_FALSE ( tControl.IsClientGone() );
+	}
+	close ( iClient );
+	close ( iServer );
+
+	// reset connection means nobody listens
+	LoopbackPair ( iServer, iClient );
+	{
+		ThdDesc_t tThd;
+		tThd.m_iClientSock = iServer;
+		ClientQueryControl_c tControl ( tThd, tQuery );
+
+		linger tLinger;
+		tLinger.l_onoff = 1;
+		tLinger.l_linger = 0;
+		ASSERT_EQ ( setsockopt ( iClient, SOL_SOCKET, SO_LINGER, (const char *)&tLinger, sizeof(tLinger) ), 0 );
+		close ( iClient );
+		sphSleepMsec ( 50 );
+		ASSERT_TRUE ( tControl.IsClientGone() );
+	}
+	close ( iServer );
+}
+#endif
+
+static int HttpLength ( const char * sBuf, int iLen=-1 )
+{
+	return HttpRequestLength ( (const BYTE *) sBuf, iLen<0 ? (int) strlen ( sBuf ) : iLen );
+}
+
+TEST ( searchd_stuff, http_request_length )
+{
+	const char * sGet = "GET /search?q=a HTTP/1.1\r\nHost: localhost\r\n\r\n";
+	const char * sPost = "POST /sql HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello";
+	int iGet = (int) strlen ( sGet );
+	int iPost = (int) strlen ( sPost );
+
+	ASSERT_EQ ( HttpLength ( sGet ), iGet );
+	ASSERT_EQ ( HttpLength ( sPost ), iPost );
+
+	// pipelined requests are cut one by one
+	CSphString sPipe;
+	sPipe.SetSprintf ( "%s%s%s", sPost, sGet, sPost );
+	const char * pPipe = sPipe.cstr();
+	int iPipe = sPipe.Length();
+	ASSERT_EQ ( HttpLength ( pPipe, iPipe ), iPost );
+	ASSERT_EQ ( HttpLength ( pPipe+iPost, iPipe-iPost ), iGet );
+	ASSERT_EQ ( HttpLength ( pPipe+iPost+iGet, iPipe-iPost-iGet ), iPost );
+
+	// partial request (header or body) is not complete yet
+	ASSERT_EQ ( HttpLength ( "" ), 0 );
+	ASSERT_EQ ( HttpLength ( sGet, iGet-1 ), 0 );
+	ASSERT_EQ ( HttpLength ( sPost, iPost-1 ), 0 );
+	ASSERT_EQ ( HttpLength ( pPipe, iPost+10 ), iPost ) << "tail of the next request stays";
+	ASSERT_EQ ( HttpLength ( pPipe+iPost, 10 ), 0 );
+
+	// ill-formed length is refused even before the body arrives
+	int iSavedMaxPacket = g_iMaxPacketSize;
+	g_iMaxPacketSize = 1024;
+	ASSERT_EQ ( HttpLength ( "POST /sql HTTP/1.1\r\nContent-Length: -5\r\n\r\nhello" ), -1 );
+	ASSERT_EQ ( HttpLength ( "POST /sql HTTP/1.1\r\nContent-Length: 2000\r\n\r\nhello" ), -1 );
+	ASSERT_EQ ( HttpLength ( "POST /sql HTTP/1.1\r\nContent-Length: 900\r\n\r\nhello" ), 0 );
+	g_iMaxPacketSize = iSavedMaxPacket;
+}
+
+static CSphString ChunkString ( const SmartOutputBuffer_t & tOut )
+{
+	CSphVector<BYTE> dRaw;
+	CollectChunks ( tOut, dRaw );
+	CSphString sRes;
+	sRes.SetBinary ( (const char *) dRaw.Begin(), dRaw.GetLength() );
+	return sRes;
+}
+
+// body of the given size, encoded and flushed piece by piece as the result encoder does
+static void HttpChunkedBody ( HttpChunkedReply_c & tReply, CSphString & sBody, int iSize )
+{
+	StringBuilder_c tBody;
+	StringBuilder_c tAll;
+	tReply.Start ( SPH_HTTP_STATUS_200, "application/json" );
+	for ( int i=0; tAll.Length()<iSize; ++i )
+	{
+		CSphString sPiece;
+		sPiece.SetSprintf ( "{\"_id\":\"%d\",\"_score\":1,\"_source\":{}},", i );
+		tBody += sPiece.cstr();
+		tAll += sPiece.cstr();
+		tReply.Flush ( tBody );
+	}
+	tReply.Finish ( tBody );
+	sBody = tAll.cstr();
+}
+
+// decodes chunked body; checks the framing along the way
+static void HttpDechunk ( const CSphString & sReply, CSphString & sBody, int & iChunks )
+{
+	const char * sHeaderEnd = strstr ( sReply.cstr(), "\r\n\r\n" );
+	ASSERT_TRUE ( sHeaderEnd );
+	const char * p = sHeaderEnd + 4;
+	const char * pEnd = sReply.cstr() + sReply.Length();
+	StringBuilder_c tBody;
+	iChunks = 0;
+	while ( true )
+	{
+		char * pSizeEnd = nullptr;
+		int iSize = (int) strtol ( p, &pSizeEnd, 16 );
+		ASSERT_TRUE ( pSizeEnd>p );
+		ASSERT_EQ ( strncmp ( pSizeEnd, "\r\n", 2 ), 0 );
+		p = pSizeEnd + 2;
+		if ( !iSize )
+			break;
+
+		++iChunks;
+		ASSERT_LE ( p+iSize+2, pEnd );
+		tBody.Appendf ( "%.*s", iSize, p );
+		p += iSize;
+		ASSERT_EQ ( strncmp ( p, "\r\n", 2 ), 0 );
+		p += 2;
+	}
+	ASSERT_EQ ( strncmp ( p, "\r\n", 2 ), 0 );
+	ASSERT_EQ ( p+2, pEnd ) << "nothing after the last chunk";
+	sBody = tBody.cstr();
+}
+
+TEST ( searchd_stuff, http_chunked_reply_small )
+{
+	SmartOutputBuffer_t tOut;
+	HttpChunkedReply_c tReply ( tOut, -1 );
+	CSphString sBody;
+	HttpChunkedBody ( tReply, sBody, 500 );
+
+	CSphString sReply = ChunkString ( tOut );
+	CSphString sTail;
+	sTail.SetSprintf ( "Content-Length:%d\r\n\r\n%s", sBody.Length(), sBody.cstr() );
+	ASSERT_TRUE ( sReply.Begins ( "HTTP/1.1 200 OK\r\n" ) );
+	ASSERT_TRUE ( sReply.Ends ( sTail.cstr() ) );
+	ASSERT_FALSE ( strstr ( sReply.cstr(), "Transfer-Encoding" ) );
+}
+
+TEST ( searchd_stuff, http_chunked_reply_big )
+{
+	SmartOutputBuffer_t tOut;
+	HttpChunkedReply_c tReply ( tOut, -1 );
+	CSphString sBody;
+	HttpChunkedBody ( tReply, sBody, NETOUTCHUNK*3+100 );
+
+	CSphString sReply = ChunkString ( tOut );
+	ASSERT_TRUE ( sReply.Begins ( "HTTP/1.1 200 OK\r\n" ) );
+	ASSERT_TRUE ( strstr ( sReply.cstr(), "\r\nTransfer-Encoding: chunked\r\n\r\n" ) );
+	ASSERT_FALSE ( strstr ( sReply.cstr(), "Content-Length" ) );
+	ASSERT_TRUE ( sReply.Ends ( "\r\n0\r\n\r\n" ) );
+
+	CSphString sGot;
+	int iChunks = 0;
+	HttpDechunk ( sReply, sGot, iChunks );
+	ASSERT_EQ ( iChunks, 4 ) << "three full chunks and the tail";
+	ASSERT_STREQ ( sGot.cstr(), sBody.cstr() );
+}
+
+#if !USE_WINDOWS
+TEST ( searchd_stuff, http_chunked_reply_push )
+{
+	// whole framed reply, as it goes when nothing is pushed
+	SmartOutputBuffer_t tRef;
+	HttpChunkedReply_c tRefReply ( tRef, -1 );
+	CSphString sBody;
+	HttpChunkedBody ( tRefReply, sBody, NETOUTCHUNK*4 );
+	CSphString sRef = ChunkString ( tRef );
+
+	int dSockets[2] = { -1, -1 };
+	ASSERT_EQ ( socketpair ( AF_LOCAL, SOCK_STREAM, 0, dSockets ), 0 );
+	ASSERT_TRUE ( sphSetSockNB ( dSockets[0] )>=0 );
+
+	// part is pushed right away, the rest that socket didn't take is queued; together they make the same reply
+	SmartOutputBuffer_t tOut;
+	HttpChunkedReply_c tReply ( tOut, dSockets[0] );
+	HttpChunkedBody ( tReply, sBody, NETOUTCHUNK*4 );
+	::close ( dSockets[0] );
+
+	StringBuilder_c tGot;
+	char dBuf[8192];
+	int iGot;
+	while ( ( iGot = recv ( dSockets[1], dBuf, sizeof ( dBuf ), 0 ) )>0 )
+		tGot.Appendf ( "%.*s", iGot, dBuf );
+	::close ( dSockets[1] );
+	ASSERT_GT ( tGot.Length(), 0 ) << "nothing was pushed";
+
+	tGot += ChunkString ( tOut ).cstr();
+	ASSERT_STREQ ( tGot.cstr(), sRef.cstr() );
+
+	// earlier pipelined reply is still queued; nothing is pushed ahead of it
+	ASSERT_EQ ( socketpair ( AF_LOCAL, SOCK_STREAM, 0, dSockets ), 0 );
+	SmartOutputBuffer_t tPipe;
+	tPipe.SendBytes ( "earlier", 7 );
+	HttpChunkedReply_c tPipeReply ( tPipe, dSockets[0] );
+	HttpChunkedBody ( tPipeReply, sBody, NETOUTCHUNK*2 );
+	ASSERT_EQ ( recv ( dSockets[1], dBuf, sizeof ( dBuf ), MSG_DONTWAIT ), -1 );
+	::close ( dSockets[0] );
+	::close ( dSockets[1] );
+
+	CSphString sPipe = ChunkString ( tPipe );
+	ASSERT_TRUE ( sPipe.Begins ( "earlier" "HTTP/1.1 200 OK\r\n" ) );
+	ASSERT_TRUE ( sPipe.Ends ( "\r\n0\r\n\r\n" ) );
+}
+#endif
+
+class JsonProfileStub_c : public CSphQueryProfile
+{
+public:
+	bool m_bResult = true;
+
+	void BuildResult ( XQNode_t *, const CSphSchema &, const StrVec_t & ) override {}
+	cJSON * LeakResultAsJson () override
+	{
+		if ( !m_bResult )
+			return nullptr;
+		return cJSON_Parse ( R"j({"type":"AND","description":"AND(KEYWORD(hello, querypos=1))","children":[{"type":"KEYWORD","word":"hello","querypos":1}]})j" );
+	}
+	const char * GetResultAsStr () const override { return ""; }
+};
+
+// takes every piece as soon as it is encoded
+class JsonSinkStub_c : public EncodedResultSink_i
+{
+public:
+	StringBuilder_c m_tGot;
+	int m_iFlushes = 0;
+
+	void Flush ( StringBuilder_c & tOut ) override
+	{
+		m_tGot += tOut.cstr();
+		tOut.Clear();
+		++m_iFlushes;
+	}
+};
+
+static CSphString EncodeJson ( const AggrResult_t & tRes, CSphQueryProfile * pProfile, JsonSinkStub_c * pSink=nullptr )
+{
+	CSphQuery tQuery;
+	StringBuilder_c tOut;
+	sphEncodeResultJson ( tRes, tQuery, pProfile, false, tOut, pSink );
+	if ( !pSink )
+		return tOut.cstr();
+
+	pSink->m_tGot += tOut.cstr();
+	return pSink->m_tGot.cstr();
+}
+
+// encoding is checked against the whole result printed as one cJSON tree
+static void CheckJsonIsTreePrint ( const CSphString & sJson )
+{
+	cJSON * pRoot = cJSON_Parse ( sJson.cstr() );
+	ASSERT_TRUE ( pRoot ) << sJson.cstr();
+	CSphString sTree = sphJsonToString ( pRoot );
+	cJSON_Delete ( pRoot );
+	ASSERT_STREQ ( sJson.cstr(), sTree.cstr() );
+}
+
+TEST ( searchd_stuff, encode_result_json )
+{
+	AggrResult_t tRes;
+	CSphColumnInfo tGid ( "gid", SPH_ATTR_INTEGER );
+	CSphColumnInfo tPrice ( "price", SPH_ATTR_FLOAT );
+	CSphColumnInfo tFlag ( "flag", SPH_ATTR_BOOL );
+	CSphColumnInfo tBig ( "big", SPH_ATTR_BIGINT );
+	tRes.m_tSchema.AddAttr ( tGid, true );
+	tRes.m_tSchema.AddAttr ( tPrice, true );
+	tRes.m_tSchema.AddAttr ( tFlag, true );
+	tRes.m_tSchema.AddAttr ( tBig, true );
+
+	const int MATCHES = 30;
+	tRes.m_dMatches.Resize ( MATCHES );
+	ARRAY_FOREACH ( i, tRes.m_dMatches )
+	{
+		CSphMatch & tMatch = tRes.m_dMatches[i];
+		tMatch.Reset ( tRes.m_tSchema.GetDynamicSize() );
+		tMatch.m_uDocID = 1000+i;
+		tMatch.m_iWeight = 1500+i;
+		tMatch.SetAttr ( tRes.m_tSchema.GetAttr ( "gid" )->m_tLocator, i % 7 );
+		tMatch.SetAttrFloat ( tRes.m_tSchema.GetAttr ( "price" )->m_tLocator, i*0.1f );
+		tMatch.SetAttr ( tRes.m_tSchema.GetAttr ( "flag" )->m_tLocator, i & 1 );
+		tMatch.SetAttr ( tRes.m_tSchema.GetAttr ( "big" )->m_tLocator, ( (int64_t) i<<33 ) + i );
+	}
+	tRes.m_iSuccesses = 1;
+	tRes.m_iQueryTime = 12;
+	tRes.m_iTotalMatches = 12345;
+	tRes.m_iCount = MATCHES;
+
+	CSphString sJson = EncodeJson ( tRes, nullptr );
+	CheckJsonIsTreePrint ( sJson );
+	ASSERT_TRUE ( sJson.Begins ( R"({"took":12,"timed_out":false,"hits":{"total":12345,"hits":[{"_id":"1000","_score":1500,"_source":{"gid":0,"price":0,"flag":false,"big":0}},)" ) ) << sJson.cstr();
+	ASSERT_TRUE ( sJson.Ends ( "}}]}}" ) );
+
+	// same bytes, whether flushed hit by hit or not
+	JsonSinkStub_c tSink;
+	ASSERT_STREQ ( EncodeJson ( tRes, nullptr, &tSink ).cstr(), sJson.cstr() );
+	ASSERT_EQ ( tSink.m_iFlushes, MATCHES );
+
+	// profile goes after the hits
+	JsonProfileStub_c tProfile;
+	CSphString sProfiled = EncodeJson ( tRes, &tProfile );
+	CheckJsonIsTreePrint ( sProfiled );
+	ASSERT_TRUE ( sProfiled.Begins ( sJson.SubString ( 0, sJson.Length()-1 ).cstr() ) );
+	ASSERT_TRUE ( sProfiled.Ends ( R"j(}}]},"profile":{"query":{"type":"AND","description":"AND(KEYWORD(hello, querypos=1))","children":[{"type":"KEYWORD","word":"hello","querypos":1}]}}})j" ) ) << sProfiled.cstr();
+	JsonSinkStub_c tProfileSink;
+	ASSERT_STREQ ( EncodeJson ( tRes, &tProfile, &tProfileSink ).cstr(), sProfiled.cstr() );
+
+	tProfile.m_bResult = false;
+	CSphString sNullProfile = EncodeJson ( tRes, &tProfile );
+	CheckJsonIsTreePrint ( sNullProfile );
+	ASSERT_TRUE ( sNullProfile.Ends ( R"(}}]},"profile":null})" ) );
+
+	// offset, warning, and no hits at all
+	tRes.m_iOffset = 10;
+	tRes.m_iCount = 3;
+	tRes.m_sWarning = "a \"quoted\" warning";
+	CSphString sPage = EncodeJson ( tRes, &tProfile );
+	CheckJsonIsTreePrint ( sPage );
+	ASSERT_TRUE ( sPage.Begins ( R"({"took":12,"timed_out":false,"warning":{"reason":"a \"quoted\" warning"},"hits":{"total":12345,"hits":[{"_id":"1010",)" ) ) << sPage.cstr();
+
+	tRes.m_iCount = 0;
+	CSphString sEmpty = EncodeJson ( tRes, nullptr );
+	CheckJsonIsTreePrint ( sEmpty );
+	ASSERT_TRUE ( sEmpty.Ends ( R"("hits":{"total":12345,"hits":[]}})" ) ) << sEmpty.cstr();
+}
+
+// binary bulk insert over API, into a real RT index
+#define INSERT_INDEX_PATH "test_insert"
+
+class BinaryInsert : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		DeleteFiles();
+		CSphConfigSection tRTConfig;
+		sphRTInit ( tRTConfig, true, nullptr );
+		sphRTConfigure ( tRTConfig, true );
+		SmallStringHash_T<CSphIndex *> hIndexes;
+		BinlogFlushInfo_t tBinlogFlush;
+		sphReplayBinlog ( hIndexes, 0, nullptr, tBinlogFlush );
+
+		CSphSchema tSchema;
+		tSchema.AddField ( "title" );
+		const char * dNames[] = { "gid", "price", "big", "tags", "tags64", "name", "meta" };
+		ESphAttr dTypes[] = { SPH_ATTR_INTEGER, SPH_ATTR_FLOAT, SPH_ATTR_BIGINT, SPH_ATTR_UINT32SET, SPH_ATTR_INT64SET, SPH_ATTR_STRING, SPH_ATTR_JSON };
+		for ( int i=0; i<(int)( sizeof(dNames)/sizeof(dNames[0]) ); ++i )
+		{
+			CSphColumnInfo tCol ( dNames[i], dTypes[i] );
+			tSchema.AddAttr ( tCol, false );
+		}
+
+		CSphString sError;
+		ISphTokenizerRefPtr_c pTok { sphCreateUTF8Tokenizer() };
+		CSphDictRefPtr_c pDict { sphCreateDictionaryCRC ( CSphDictSettings(), nullptr, pTok, "insert", sError ) };
+		m_pIndex = sphCreateIndexRT ( tSchema, "insert", 32*1024*1024, INSERT_INDEX_PATH, false );
+		m_pIndex->SetTokenizer ( pTok->Clone ( SPH_CLONE_INDEX ) );
+		m_pIndex->SetDictionary ( pDict->Clone() );
+		m_pIndex->PostSetup();
+		ASSERT_TRUE ( m_pIndex->Prealloc ( false ) );
+
+		ServedDesc_t tDesc;
+		tDesc.m_eType = eITYPE::RT;
+		tDesc.m_pIndex = m_pIndex;
+		g_pLocalIndexes->AddUniq ( new ServedIndex_c ( tDesc ), "insert" );
+		tDesc.m_pIndex = nullptr; // now owned by the served index
+	}
+
+	void TearDown() override
+	{
+		g_pLocalIndexes->Delete ( "insert" );
+		sphRTDone();
+		DeleteFiles();
+	}
+
+	static void DeleteFiles()
+	{
+		const char * dExts[] = { "kill", "lock", "meta", "ram" };
+		for ( const char * sExt : dExts )
+		{
+			CSphString sName;
+			sName.SetSprintf ( "%s.%s", INSERT_INDEX_PATH, sExt );
+			unlink ( sName.cstr() );
+		}
+	}
+
+	// request head: index name and column list
+	void Columns ( std::initializer_list<std::pair<const char *, ESphAttr>> dColumns, int iRows )
+	{
+		m_tReq.ResizeBuf ( 0 );
+		m_tReq.SendString ( "insert" );
+		m_tReq.SendInt ( (int) dColumns.size() );
+		for ( const auto & tCol : dColumns )
+		{
+			m_tReq.SendString ( tCol.first );
+			m_tReq.SendDword ( tCol.second );
+		}
+		m_tReq.SendInt ( iRows );
+	}
+
+	// id, title, gid, price, big, tags, tags64, name, meta
+	void Row ( uint64_t uID, const char * sTitle, DWORD uGid, float fPrice, int64_t iBig, std::initializer_list<DWORD> dTags,
+		std::initializer_list<int64_t> dTags64, const char * sName, const char * sMeta )
+	{
+		m_tReq.SendUint64 ( uID );
+		m_tReq.SendString ( sTitle );
+		m_tReq.SendDword ( uGid );
+		m_tReq.SendFloat ( fPrice );
+		m_tReq.SendUint64 ( iBig );
+		m_tReq.SendInt ( (int) dTags.size() );
+		for ( DWORD uTag : dTags )
+			m_tReq.SendDword ( uTag );
+		m_tReq.SendInt ( (int) dTags64.size() );
+		for ( int64_t iTag : dTags64 )
+			m_tReq.SendUint64 ( iTag );
+		m_tReq.SendString ( sName );
+		m_tReq.SendString ( sMeta );
+	}
+
+	void AllColumns ( int iRows )
+	{
+		Columns ( { { "id", SPH_ATTR_BIGINT }, { "title", SPH_ATTR_STRING }, { "gid", SPH_ATTR_INTEGER },
+			{ "price", SPH_ATTR_FLOAT }, { "big", SPH_ATTR_BIGINT }, { "tags", SPH_ATTR_UINT32SET },
+			{ "tags64", SPH_ATTR_INT64SET }, { "name", SPH_ATTR_STRING }, { "meta", SPH_ATTR_JSON } }, iRows );
+	}
+
+	// sends the request; returns inserted rows count, or -1 and the error message
+	int Send ( bool bReplace=false )
+	{
+		InputBuffer_c tReq ( (const BYTE *) m_tReq.GetBufPtr(), m_tReq.GetSentCount() );
+		ISphOutputBuffer tOut;
+		HandleCommandInsert ( tOut, VER_COMMAND_INSERT, tReq, bReplace );
+
+		InputBuffer_c tReply ( (const BYTE *) tOut.GetBufPtr(), tOut.GetSentCount() );
+		WORD uStatus = tReply.GetWord();
+		tReply.GetWord();
+		tReply.GetInt();
+		m_sError = "";
+		if ( uStatus==SEARCHD_ERROR )
+		{
+			m_sError = tReply.GetString();
+			return -1;
+		}
+		if ( uStatus==SEARCHD_WARNING )
+			tReply.GetString();
+		return tReply.GetInt();
+	}
+
+	// total of matches of a full-text query, with an optional filter
+	int64_t Total ( const char * sQuery, const CSphFilterSettings * pFilter=nullptr )
+	{
+		CSphQuery tQuery;
+		CSphQueryResult tResult;
+		KillListVector tKill;
+		CSphMultiQueryArgs tArgs ( tKill, 1 );
+		tQuery.m_sQuery = sQuery;
+		tQuery.m_pQueryParser = sphCreatePlainQueryParser();
+		if ( pFilter )
+			tQuery.m_dFilters.Add ( *pFilter );
+
+		SphQueueSettings_t tQueueSettings ( tQuery, m_pIndex->GetMatchSchema(), tResult.m_sError );
+		ISphMatchSorter * pSorter = sphCreateQueue ( tQueueSettings );
+		EXPECT_TRUE ( pSorter );
+		EXPECT_TRUE ( m_pIndex->MultiQuery ( &tQuery, &tResult, 1, &pSorter, tArgs ) ) << tResult.m_sError.cstr();
+		int64_t iTotal = pSorter->GetTotalCount();
+
+		SafeDelete ( pSorter );
+		SafeDelete ( tQuery.m_pQueryParser );
+		return iTotal;
+	}
+
+	int64_t TotalValues ( const char * sAttr, std::initializer_list<SphAttr_t> dValues )
+	{
+		CSphFilterSettings tFilter;
+		tFilter.m_sAttrName = sAttr;
+		tFilter.m_eType = SPH_FILTER_VALUES;
+		for ( SphAttr_t iValue : dValues )
+			tFilter.m_dValues.Add ( iValue );
+		return Total ( "", &tFilter );
+	}
+
+	int64_t TotalString ( const char * sAttr, const char * sValue )
+	{
+		CSphFilterSettings tFilter;
+		tFilter.m_sAttrName = sAttr;
+		tFilter.m_eType = SPH_FILTER_STRING;
+		tFilter.m_dStrings.Add ( sValue );
+		return Total ( "", &tFilter );
+	}
+
+	int64_t TotalFloat ( const char * sAttr, float fMin, float fMax )
+	{
+		CSphFilterSettings tFilter;
+		tFilter.m_sAttrName = sAttr;
+		tFilter.m_eType = SPH_FILTER_FLOATRANGE;
+		tFilter.m_fMinValue = fMin;
+		tFilter.m_fMaxValue = fMax;
+		return Total ( "", &tFilter );
+	}
+
+	ISphRtIndex *	m_pIndex = nullptr;
+	ISphOutputBuffer m_tReq;
+	CSphString		m_sError;
+};
+
+TEST_F ( BinaryInsert, round_trip )
+{
+	AllColumns ( 3 );
+	Row ( 1, "hello world", 10, 1.5f, 1LL<<40, { 3, 1, 2, 1 }, { 1LL<<35 }, "first", R"({"color":"red","size":5})" );
+	Row ( 2, "hello there", 20, 2.5f, -7, {}, { 5, 6 }, "second", "" );
+	Row ( 3, "goodbye", 30, 3.5f, 0, { 7 }, {}, "", R"({"color":"blue","size":7})" );
+	ASSERT_EQ ( Send(), 3 ) << m_sError.cstr();
+
+	ASSERT_EQ ( Total ( "" ), 3 );
+	ASSERT_EQ ( Total ( "hello" ), 2 );
+	ASSERT_EQ ( Total ( "goodbye" ), 1 );
+	ASSERT_EQ ( TotalValues ( "gid", { 20 } ), 1 );
+	ASSERT_EQ ( TotalFloat ( "price", 2.0f, 4.0f ), 2 );
+	ASSERT_EQ ( TotalValues ( "big", { 1LL<<40 } ), 1 );
+	ASSERT_EQ ( TotalValues ( "big", { -7 } ), 1 );
+	ASSERT_EQ ( TotalValues ( "tags", { 2 } ), 1 );
+	ASSERT_EQ ( TotalValues ( "tags", { 7 } ), 1 );
+	ASSERT_EQ ( TotalValues ( "tags64", { 1LL<<35 } ), 1 );
+	ASSERT_EQ ( TotalValues ( "tags64", { 6 } ), 1 );
+	ASSERT_EQ ( TotalString ( "name", "first" ), 1 );
+	ASSERT_EQ ( TotalString ( "name", "second" ), 1 );
+
+	CSphFilterSettings tMeta;
+	tMeta.m_sAttrName = "meta";
+	tMeta.m_eType = SPH_FILTER_NULL;
+	tMeta.m_bIsNull = false;
+	ASSERT_EQ ( Total ( "", &tMeta ), 2 );
+	tMeta.m_bIsNull = true;
+	ASSERT_EQ ( Total ( "", &tMeta ), 1 );
+
+	// columns may go in any order and some may be omitted
+	Columns ( { { "gid", SPH_ATTR_INTEGER }, { "id", SPH_ATTR_BIGINT } }, 1 );
+	m_tReq.SendDword ( 40 );
+	m_tReq.SendUint64 ( (uint64_t) 4 );
+	ASSERT_EQ ( Send(), 1 ) << m_sError.cstr();
+	ASSERT_EQ ( Total ( "" ), 4 );
+	ASSERT_EQ ( TotalValues ( "gid", { 40 } ), 1 );
+
+	// existing document is refused by insert, but replaced by replace
+	AllColumns ( 1 );
+	Row ( 2, "replaced", 21, 0.0f, 0, {}, {}, "second", "" );
+	ASSERT_EQ ( Send(), -1 );
+	ASSERT_EQ ( TotalValues ( "gid", { 20 } ), 1 );
+	ASSERT_EQ ( Send ( true ), 1 ) << m_sError.cstr();
+	ASSERT_EQ ( Total ( "" ), 4 );
+	ASSERT_EQ ( TotalValues ( "gid", { 20 } ), 0 );
+	ASSERT_EQ ( TotalValues ( "gid", { 21 } ), 1 );
+	ASSERT_EQ ( Total ( "hello" ), 1 );
+	ASSERT_EQ ( Total ( "replaced" ), 1 );
+}
+
+TEST_F ( BinaryInsert, type_mismatch )
+{
+	Columns ( { { "id", SPH_ATTR_BIGINT }, { "gid", SPH_ATTR_FLOAT } }, 0 );
+	ASSERT_EQ ( Send(), -1 );
+	ASSERT_STREQ ( m_sError.cstr(), "column 'gid': type mismatch (expected 1, got 5)" );
+
+	Columns ( { { "id", SPH_ATTR_INTEGER }, { "gid", SPH_ATTR_INTEGER } }, 0 );
+	ASSERT_EQ ( Send(), -1 );
+	ASSERT_STREQ ( m_sError.cstr(), "column 'id' must be sent as bigint" );
+
+	Columns ( { { "id", SPH_ATTR_BIGINT }, { "tags", SPH_ATTR_INT64SET } }, 0 );
+	ASSERT_EQ ( Send(), -1 );
+	ASSERT_TRUE ( m_sError.Begins ( "column 'tags': type mismatch" ) );
+
+	Columns ( { { "id", SPH_ATTR_BIGINT }, { "nosuch", SPH_ATTR_INTEGER } }, 0 );
+	ASSERT_EQ ( Send(), -1 );
+	ASSERT_STREQ ( m_sError.cstr(), "unknown column: 'nosuch'" );
+
+	Columns ( { { "id", SPH_ATTR_BIGINT }, { "gid", SPH_ATTR_INTEGER }, { "GID", SPH_ATTR_INTEGER } }, 0 );
+	ASSERT_EQ ( Send(), -1 );
+	ASSERT_STREQ ( m_sError.cstr(), "column 'gid' specified twice" );
+
+	Columns ( { { "gid", SPH_ATTR_INTEGER } }, 0 );
+	ASSERT_EQ ( Send(), -1 );
+	ASSERT_STREQ ( m_sError.cstr(), "column list must contain an 'id' column" );
+	ASSERT_EQ ( Total ( "" ), 0 );
+}
+
+TEST_F ( BinaryInsert, truncated )
+{
+	// rows count says 3, but only 2 are here
+	AllColumns ( 3 );
+	Row ( 1, "hello", 10, 1.0f, 1, {}, {}, "a", "" );
+	Row ( 2, "hello", 20, 2.0f, 2, {}, {}, "b", "" );
+	ASSERT_EQ ( Send(), -1 );
+	ASSERT_STREQ ( m_sError.cstr(), "row 3: invalid or truncated request" );
+	ASSERT_EQ ( Total ( "" ), 0 );
+
+	// row cut in the middle of a string
+	AllColumns ( 1 );
+	Row ( 1, "hello", 10, 1.0f, 1, {}, {}, "a long enough name", "" );
+	m_tReq.ResizeBuf ( m_tReq.GetBufLength()-12 );
+	ASSERT_EQ ( Send(), -1 );
+	ASSERT_STREQ ( m_sError.cstr(), "row 1: invalid or truncated request" );
+
+	// MVA longer than the whole request
+	Columns ( { { "id", SPH_ATTR_BIGINT }, { "tags", SPH_ATTR_UINT32SET } }, 1 );
+	m_tReq.SendUint64 ( (uint64_t) 1 );
+	m_tReq.SendInt ( 1000 );
+	m_tReq.SendDword ( 1 );
+	ASSERT_EQ ( Send(), -1 );
+	ASSERT_STREQ ( m_sError.cstr(), "row 1, column 'tags': invalid MVA length 1000" );
+	ASSERT_EQ ( Total ( "" ), 0 );
+}
+
+TEST_F ( BinaryInsert, rollback_on_bad_row )
+{
+	AllColumns ( 1 );
+	Row ( 100, "committed before", 1, 1.0f, 1, {}, {}, "x", "" );
+	ASSERT_EQ ( Send(), 1 ) << m_sError.cstr();
+
+	// second row has a broken MVA; the first one must not get in either
+	Columns ( { { "id", SPH_ATTR_BIGINT }, { "title", SPH_ATTR_STRING }, { "tags", SPH_ATTR_UINT32SET } }, 3 );
+	m_tReq.SendUint64 ( (uint64_t) 1 );
+	m_tReq.SendString ( "hello" );
+	m_tReq.SendInt ( 1 );
+	m_tReq.SendDword ( 1 );
+	m_tReq.SendUint64 ( (uint64_t) 2 );
+	m_tReq.SendString ( "hello" );
+	m_tReq.SendInt ( -1 );
+	m_tReq.SendUint64 ( (uint64_t) 3 );
+	m_tReq.SendString ( "hello" );
+	m_tReq.SendInt ( 0 );
+	ASSERT_EQ ( Send(), -1 );
+	ASSERT_STREQ ( m_sError.cstr(), "row 2, column 'tags': invalid MVA length -1" );
+	ASSERT_EQ ( Total ( "" ), 1 );
+	ASSERT_EQ ( Total ( "hello" ), 0 );
+
+	// same with a duplicate id within the batch
+	AllColumns ( 2 );
+	Row ( 1, "hello", 10, 1.0f, 1, {}, {}, "a", "" );
+	Row ( 100, "hello", 20, 2.0f, 2, {}, {}, "b", "" );
+	ASSERT_EQ ( Send(), -1 );
+	ASSERT_EQ ( Total ( "" ), 1 );
+
+	// and the index is still fine for the next batch
+	AllColumns ( 2 );
+	Row ( 1, "hello", 10, 1.0f, 1, {}, {}, "a", "" );
+	Row ( 2, "hello", 20, 2.0f, 2, {}, {}, "b", "" );
+	ASSERT_EQ ( Send(), 2 ) << m_sError.cstr();
+	ASSERT_EQ ( Total ( "hello" ), 2 );
+}
+
+// term stats cache shares the binary insert RT index setup
+class TermStats : public BinaryInsert
+{
+protected:
+	int InsertRow ( uint64_t uID, const char * sTitle )
+	{
+		AllColumns ( 1 );
+		Row ( uID, sTitle, 1, 1.0f, 1, {}, {}, "", "" );
+		return Send();
+	}
+};
+
+TEST_F ( TermStats, hit_miss_invalidate )
+{
+	ASSERT_EQ ( InsertRow ( 1, "hello world" ), 1 ) << m_sError.cstr();
+
+	TermStatsCache_c tCache;
+	tCache.Setup ( 1024*1024, 0 );
+	int64_t iDocs = 0, iHits = 0;
+	ASSERT_FALSE ( tCache.Get ( "insert hello", m_pIndex, iDocs, iHits ) );
+	tCache.Add ( "insert hello", m_pIndex, 5, 7 );
+	ASSERT_TRUE ( tCache.Get ( "insert hello", m_pIndex, iDocs, iHits ) );
+	ASSERT_EQ ( iDocs, 5 );
+	ASSERT_EQ ( iHits, 7 );
+
+	// any change of RT index drops its entries when there is no ttl
+	ASSERT_EQ ( InsertRow ( 2, "hello" ), 1 ) << m_sError.cstr();
+	ASSERT_FALSE ( tCache.Get ( "insert hello", m_pIndex, iDocs, iHits ) );
+	tCache.Add ( "insert hello", m_pIndex, 2, 2 );
+	ASSERT_TRUE ( tCache.Get ( "insert hello", m_pIndex, iDocs, iHits ) );
+	ASSERT_EQ ( iDocs, 2 );
+
+	CacheStatus_t tStatus = tCache.GetStatus();
+	ASSERT_EQ ( tStatus.m_iHits, 2 );
+	ASSERT_EQ ( tStatus.m_iMisses, 2 );
+	ASSERT_GT ( tStatus.m_iUsedBytes, 0 );
+
+	// with ttl, entries of a changed RT index are still served for a while
+	tCache.Setup ( 1024*1024, 60 );
+	ASSERT_EQ ( tCache.GetStatus().m_iUsedBytes, 0 );
+	tCache.Add ( "insert hello", m_pIndex, 2, 2 );
+	ASSERT_EQ ( InsertRow ( 3, "hello" ), 1 ) << m_sError.cstr();
+	ASSERT_TRUE ( tCache.Get ( "insert hello", m_pIndex, iDocs, iHits ) );
+	ASSERT_EQ ( iDocs, 2 );
+}
+
+TEST_F ( TermStats, evict_oldest )
+{
+	TermStatsCache_c tCache;
+	tCache.Setup ( 1024, 0 );
+	CSphString sKey;
+	for ( int i=0; i<100; i++ )
+	{
+		sKey.SetSprintf ( "insert term%d", i );
+		tCache.Add ( sKey, m_pIndex, i, i );
+	}
+	ASSERT_LE ( tCache.GetStatus().m_iUsedBytes, 1024 );
+
+	int64_t iDocs = 0, iHits = 0;
+	ASSERT_FALSE ( tCache.Get ( "insert term0", m_pIndex, iDocs, iHits ) );
+	ASSERT_TRUE ( tCache.Get ( "insert term99", m_pIndex, iDocs, iHits ) );
+	ASSERT_EQ ( iDocs, 99 );
+}
+
+TEST_F ( TermStats, fill_keywords )
+{
+	ASSERT_EQ ( InsertRow ( 1, "hello world" ), 1 ) << m_sError.cstr();
+	ASSERT_EQ ( InsertRow ( 2, "hello there" ), 1 ) << m_sError.cstr();
+
+	GetKeywordsSettings_t tSettings;
+	CSphVector<CSphKeywordInfo> dExpected;
+	ASSERT_TRUE ( m_pIndex->GetKeywords ( dExpected, "hello world nosuch", tSettings, nullptr ) );
+	UniqKeywords ( dExpected );
+
+	// tokenize only, as SetupLocalDF does, and fill the docs from the cache or the dictionary
+	auto fnFill = [&] ()
+	{
+		GetKeywordsSettings_t tNoStats;
+		tNoStats.m_bStats = false;
+		CSphVector<CSphKeywordInfo> dKeywords;
+		EXPECT_TRUE ( m_pIndex->GetKeywords ( dKeywords, "hello world nosuch", tNoStats, nullptr ) );
+		UniqKeywords ( dKeywords );
+		FillCachedKeywords ( "insert", m_pIndex, dKeywords, true );
+		EXPECT_EQ ( dKeywords.GetLength(), dExpected.GetLength() );
+		ARRAY_FOREACH ( i, dKeywords )
+		{
+			EXPECT_STREQ ( dKeywords[i].m_sNormalized.cstr(), dExpected[i].m_sNormalized.cstr() );
+			EXPECT_EQ ( dKeywords[i].m_iDocs, dExpected[i].m_iDocs ) << dExpected[i].m_sNormalized.cstr();
+			EXPECT_EQ ( dKeywords[i].m_iHits, dExpected[i].m_iHits ) << dExpected[i].m_sNormalized.cstr();
+		}
+	};
+
+	g_tTermStatsCache.Setup ( 1024*1024, 0 );
+	fnFill();
+	CacheStatus_t tStatus = g_tTermStatsCache.GetStatus();
+	ASSERT_EQ ( tStatus.m_iHits, 0 );
+	ASSERT_EQ ( tStatus.m_iMisses, 3 );
+
+	// second time, every term is served by the cache
+	fnFill();
+	tStatus = g_tTermStatsCache.GetStatus();
+	ASSERT_EQ ( tStatus.m_iHits, 3 );
+	ASSERT_EQ ( tStatus.m_iMisses, 3 );
+
+	// a new document invalidates them all
+	ASSERT_EQ ( InsertRow ( 3, "world" ), 1 ) << m_sError.cstr();
+	dExpected.Resize ( 0 );
+	ASSERT_TRUE ( m_pIndex->GetKeywords ( dExpected, "hello world nosuch", tSettings, nullptr ) );
+	UniqKeywords ( dExpected );
+	fnFill();
+	tStatus = g_tTermStatsCache.GetStatus();
+	ASSERT_EQ ( tStatus.m_iHits, 3 );
+	ASSERT_EQ ( tStatus.m_iMisses, 6 );
+
+	g_tTermStatsCache.Setup ( 0, 0 );
+}
+
+// bucket bounds are inclusive, and buckets are cumulative in the output
+TEST ( QueryHistogram, bucket_bounds )
+{
+	QueryHistogram_t tHist;
+	tHist.Add ( 0 );
+	tHist.Add ( 1000 );		// exactly 1ms still goes to the first bucket
+	tHist.Add ( 1001 );
+	tHist.Add ( 250000 );
+	tHist.Add ( 10000000 );	// exactly the last bound
+	tHist.Add ( 10000001 );	// past all the bounds
+
+	ASSERT_EQ ( (int64_t) tHist.m_dBuckets[0], 2 );
+	ASSERT_EQ ( (int64_t) tHist.m_dBuckets[1], 1 );
+	ASSERT_EQ ( (int64_t) tHist.m_dBuckets[7], 1 );
+	ASSERT_EQ ( (int64_t) tHist.m_dBuckets[QueryHistogram_t::BUCKETS-1], 1 );
+	ASSERT_EQ ( (int64_t) tHist.m_dBuckets[QueryHistogram_t::BUCKETS], 1 );
+
+	StringBuilder_c sOut;
+	tHist.Format ( sOut, "lat", "index=\"i\"" );
+	ASSERT_STREQ ( sOut.cstr(),
+		"lat_bucket{index=\"i\",le=\"0.001\"} 2\n"
+		"lat_bucket{index=\"i\",le=\"0.002\"} 3\n"
+		"lat_bucket{index=\"i\",le=\"0.005\"} 3\n"
+		"lat_bucket{index=\"i\",le=\"0.010\"} 3\n"
+		"lat_bucket{index=\"i\",le=\"0.025\"} 3\n"
+		"lat_bucket{index=\"i\",le=\"0.050\"} 3\n"
+		"lat_bucket{index=\"i\",le=\"0.100\"} 3\n"
+		"lat_bucket{index=\"i\",le=\"0.250\"} 4\n"
+		"lat_bucket{index=\"i\",le=\"0.500\"} 4\n"
+		"lat_bucket{index=\"i\",le=\"1.000\"} 4\n"
+		"lat_bucket{index=\"i\",le=\"5.000\"} 4\n"
+		"lat_bucket{index=\"i\",le=\"10.000\"} 5\n"
+		"lat_bucket{index=\"i\",le=\"+Inf\"} 6\n"
+		"lat_sum{index=\"i\"} 20.252002\n"
+		"lat_count{index=\"i\"} 6\n" );
+}
+
+// /metrics output of a daemon serving one RT index must be valid Prometheus text exposition
+class MetricsExposition : public BinaryInsert
+{};
+
+TEST_F ( MetricsExposition, format )
+{
+	QueryMetrics_t tMetrics;
+	tMetrics.m_iFiltered = I64C(5000000000); // does not fit 32 bits
+	ServedIndexRefPtr_c pServed = GetServed ( "insert" );
+	ASSERT_TRUE ( pServed );
+	pServed->AddQueryMetrics ( tMetrics );
+	pServed->AddQueryStat ( 3, 1500 );
+	pServed = ServedIndexRefPtr_c();
+
+	StringBuilder_c sOut;
+	BuildMetrics ( sOut );
+
+	StrVec_t dLines;
+	sphSplit ( dLines, sOut.cstr(), "\n" );
+	ASSERT_FALSE ( dLines.IsEmpty() );
+
+	// every family has HELP and TYPE right before its samples, and its samples are contiguous
+	SmallStringHash_T<CSphString> hFamilies;
+	CSphString sFamily, sType;
+	bool bFilteredSeen = false, bHistogramSeen = false;
+	for ( const CSphString & sLine : dLines )
+	{
+		const char * szLine = sLine.cstr();
+		if ( sLine.Begins ( "# HELP " ) )
+		{
+			const char * szName = szLine + 7;
+			const char * szEnd = strchr ( szName, ' ' );
+			ASSERT_TRUE ( szEnd ) << szLine;
+			sFamily.SetBinary ( szName, int ( szEnd-szName ) );
+			ASSERT_TRUE ( hFamilies.Add ( sType, sFamily ) ) << "family repeats: " << sFamily.cstr();
+			sType = "";
+			continue;
+		}
+
+		if ( sLine.Begins ( "# TYPE " ) )
+		{
+			CSphString sExpected;
+			sExpected.SetSprintf ( "# TYPE %s ", sFamily.cstr() );
+			ASSERT_TRUE ( sLine.Begins ( sExpected.cstr() ) ) << szLine;
+			sType = szLine + sExpected.Length();
+			ASSERT_TRUE ( sType=="counter" || sType=="gauge" || sType=="histogram" ) << szLine;
+			continue;
+		}
+
+		ASSERT_FALSE ( sType.IsEmpty() ) << "sample without TYPE: " << szLine;
+
+		// name{labels} value, or name value
+		const char * szValue = strchr ( szLine, ' ' );
+		const char * szLabels = strchr ( szLine, '{' );
+		if ( szLabels && szLabels<szValue )
+		{
+			const char * szClose = strstr ( szLabels, "} " );
+			ASSERT_TRUE ( szClose ) << szLine;
+			szValue = szClose+1;
+		} else
+			szLabels = szValue;
+		ASSERT_TRUE ( szValue ) << szLine;
+
+		CSphString sName;
+		sName.SetBinary ( szLine, int ( szLabels-szLine ) );
+		if ( sType=="histogram" )
+		{
+			ASSERT_TRUE ( sName.Begins ( sFamily.cstr() ) ) << szLine;
+			const char * szSuffix = sName.cstr() + sFamily.Length();
+			ASSERT_TRUE ( !strcmp ( szSuffix, "_bucket" ) || !strcmp ( szSuffix, "_sum" ) || !strcmp ( szSuffix, "_count" ) ) << szLine;
+			bHistogramSeen |= ( sName=="manticore_index_query_duration_seconds_count" && strstr ( szLine, "index=\"insert\"" ) );
+		} else
+			ASSERT_STREQ ( sName.cstr(), sFamily.cstr() ) << szLine;
+
+		char * szEnd = nullptr;
+		strtod ( szValue+1, &szEnd );
+		ASSERT_TRUE ( szEnd && szEnd>szValue+1 && !*szEnd ) << "bad value: " << szLine;
+
+		if ( sName=="manticore_index_filtered_matches_total" && strstr ( szLine, "index=\"insert\"" ) )
+		{
+			ASSERT_STREQ ( szValue+1, "5000000000" );
+			bFilteredSeen = true;
+		}
+	}
+
+	ASSERT_TRUE ( bFilteredSeen );
+	ASSERT_TRUE ( bHistogramSeen );
+}
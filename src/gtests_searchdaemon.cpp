@@ -608,4 +608,118 @@ TEST ( T_IndexHash, served_pointer_manipulations )
 		delete pHash;
 //		auto & x = dVec[0];
 	}
-}
\ No newline at end of file
+}
+// reply to mux command, as agent sends it
+static void MuxHandshakeReply ( ISphOutputBuffer & tOut, WORD uStatus, const char * sMessage = nullptr )
+{
+	tOut.SendDword ( SPHINX_SEARCHD_PROTO );
+	tOut.SendWord ( uStatus );
+	tOut.SendWord ( 1 );
+	if ( sMessage )
+	{
+		tOut.SendInt ( 4 + strlen ( sMessage ) );
+		tOut.SendString ( sMessage );
+	} else
+		tOut.SendInt ( 0 );
+}
+
+static void MuxFrame ( ISphOutputBuffer & tOut, DWORD uId, WORD uStatus, const char * sBody )
+{
+	tOut.SendDword ( uId );
+	tOut.SendWord ( uStatus );
+	tOut.SendWord ( 1 );
+	tOut.SendInt ( strlen ( sBody ) );
+	tOut.SendBytes ( sBody, strlen ( sBody ) );
+}
+
+TEST ( T_MuxReplies, frames_in_any_order_and_pieces )
+{
+	ISphOutputBuffer tOut;
+	MuxHandshakeReply ( tOut, SEARCHD_OK );
+	MuxFrame ( tOut, 7, SEARCHD_OK, "seven" );
+	MuxFrame ( tOut, 3, SEARCHD_WARNING, "" );
+	MuxFrame ( tOut, 5, SEARCHD_ERROR, "five" );
+	auto * pBuf = ( const BYTE * ) tOut.GetBufPtr ();
+	int iLen = tOut.GetBufLength ();
+
+	// everything at once
+	bool bHandshake = true;
+	CSphVector<MuxFrame_t> dFrames;
+	int iParsed = 0;
+	CSphString sError;
+	ASSERT_EQ ( ParseMuxReplies ( pBuf, iLen, bHandshake, dFrames, iParsed, sError ), MUX_PARSE_OK );
+	ASSERT_FALSE ( bHandshake );
+	ASSERT_EQ ( iParsed, iLen );
+	ASSERT_EQ ( dFrames.GetLength (), 3 );
+	ASSERT_EQ ( dFrames[0].m_uId, 7u );
+	ASSERT_EQ ( dFrames[0].m_uStatus, SEARCHD_OK );
+	ASSERT_EQ ( dFrames[0].m_iLen, 5 );
+	ASSERT_EQ ( memcmp ( pBuf + dFrames[0].m_iOffset, "seven", 5 ), 0 );
+	ASSERT_EQ ( dFrames[1].m_uId, 3u );
+	ASSERT_EQ ( dFrames[1].m_uStatus, SEARCHD_WARNING );
+	ASSERT_EQ ( dFrames[1].m_iLen, 0 );
+	ASSERT_EQ ( dFrames[2].m_uId, 5u );
+	ASSERT_EQ ( memcmp ( pBuf + dFrames[2].m_iOffset, "five", 4 ), 0 );
+
+	// byte by byte, keeping the unparsed tail as the mux thread does
+	CSphVector<BYTE> dIn;
+	CSphVector<DWORD> dIds;
+	bHandshake = true;
+	for ( int i=0; i<iLen; ++i )
+	{
+		dIn.Add ( pBuf[i] );
+		dFrames.Resize ( 0 );
+		ASSERT_EQ ( ParseMuxReplies ( dIn.Begin (), dIn.GetLength (), bHandshake, dFrames, iParsed, sError ), MUX_PARSE_OK );
+		for ( const auto & tFrame : dFrames )
+			dIds.Add ( tFrame.m_uId );
+		int iRest = dIn.GetLength () - iParsed;
+		memmove ( dIn.Begin (), dIn.Begin () + iParsed, iRest );
+		dIn.Resize ( iRest );
+	}
+	ASSERT_FALSE ( bHandshake );
+	ASSERT_EQ ( dIn.GetLength (), 0 );
+	ASSERT_EQ ( dIds.GetLength (), 3 );
+	ASSERT_EQ ( dIds[0], 7u );
+	ASSERT_EQ ( dIds[1], 3u );
+	ASSERT_EQ ( dIds[2], 5u );
+}
+
+TEST ( T_MuxReplies, handshake_fallback )
+{
+	bool bHandshake = true;
+	CSphVector<MuxFrame_t> dFrames;
+	int iParsed = 0;
+	CSphString sError;
+
+	// old agent replies error to unknown command; that is known only when the whole reply is here
+	ISphOutputBuffer tOut;
+	MuxHandshakeReply ( tOut, SEARCHD_ERROR, "unknown command (code=12)" );
+	auto * pBuf = ( const BYTE * ) tOut.GetBufPtr ();
+	ASSERT_EQ ( ParseMuxReplies ( pBuf, tOut.GetBufLength ()-1, bHandshake, dFrames, iParsed, sError ), MUX_PARSE_OK );
+	ASSERT_TRUE ( bHandshake );
+	ASSERT_EQ ( iParsed, 0 );
+	ASSERT_EQ ( ParseMuxReplies ( pBuf, tOut.GetBufLength (), bHandshake, dFrames, iParsed, sError ), MUX_PARSE_UNSUPPORTED );
+	ASSERT_TRUE ( bHandshake );
+	ASSERT_EQ ( dFrames.GetLength (), 0 );
+
+	// that is not a daemon at all
+	ISphOutputBuffer tGarbage;
+	tGarbage.SendDword ( 0x48545450 );
+	tGarbage.SendDword ( 0 );
+	tGarbage.SendDword ( 0 );
+	ASSERT_EQ ( ParseMuxReplies ( ( const BYTE * ) tGarbage.GetBufPtr (), tGarbage.GetBufLength (), bHandshake, dFrames,
+		iParsed, sError ), MUX_PARSE_BROKEN );
+	ASSERT_FALSE ( sError.IsEmpty () );
+
+	// oversized frame breaks the connection instead of waiting for it forever
+	ISphOutputBuffer tHuge;
+	tHuge.SendDword ( 1 );
+	tHuge.SendWord ( SEARCHD_OK );
+	tHuge.SendWord ( 1 );
+	tHuge.SendInt ( g_iMaxPacketSize+1 );
+	bHandshake = false;
+	sError = "";
+	ASSERT_EQ ( ParseMuxReplies ( ( const BYTE * ) tHuge.GetBufPtr (), tHuge.GetBufLength (), bHandshake, dFrames,
+		iParsed, sError ), MUX_PARSE_BROKEN );
+	ASSERT_FALSE ( sError.IsEmpty () );
+}
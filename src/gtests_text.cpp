@@ -5,6 +5,7 @@
 #include <gtest/gtest.h>
 
 #include "sphinxint.h"
+#include "sphinxjson.h"
 
 
 // Miscelaneous tests mostly processing texts with many test cases: HTML Stripper, levenstein,
@@ -399,8 +400,352 @@ TEST ( Text, expression_parser )
 	SafeDeleteArray ( pRow );
 }
 
+TEST ( Text, expression_compiler )
+{
+	CSphColumnInfo tCol;
+	tCol.m_eAttrType = SPH_ATTR_INTEGER;
+
+	CSphSchema tSchema;
+	tCol.m_sName = "aaa";
+	tSchema.AddAttr ( tCol, false );
+	tCol.m_sName = "bbb";
+	tSchema.AddAttr ( tCol, false );
+	tCol.m_sName = "ccc";
+	tSchema.AddAttr ( tCol, false );
+
+	// more rows than a single compiled block, to cover the chunking
+	const int MATCHES = 300;
+	const int iStride = tSchema.GetRowSize ();
+	CSphVector<CSphRowitem> dRows ( MATCHES*iStride );
+	CSphMatch dMatches[MATCHES];
+	CSphVector<CSphMatch *> dPtrs ( MATCHES );
+	for ( int i=0; i<MATCHES; ++i )
+	{
+		CSphRowitem * pRow = dRows.Begin() + i*iStride;
+		pRow[0] = i % 17;
+		pRow[1] = i % 5 + 1;
+		pRow[2] = i;
+		dMatches[i].m_uDocID = 1000 + i;
+		dMatches[i].m_iWeight = i % 3;
+		dMatches[i].m_pStatic = pRow;
+		dPtrs[i] = &dMatches[i];
+	}
+
+	struct ExprTest_t
+	{
+		const char * m_sExpr;
+		float ( *m_fnRef ) ( int a, int b, int c );
+	};
+	ExprTest_t dTests[] =
+	{
+		{ "aaa*bbb+ccc*2-1",					[] ( int a, int b, int c ) { return float ( a*b+c*2-1 ); } },
+		{ "if(aaa>bbb,aaa-bbb,bbb-aaa)*3+ccc",	[] ( int a, int b, int c ) { return float ( ( a>b ? a-b : b-a )*3+c ); } },
+		{ "max(aaa,ccc)/2+min(bbb,ccc)*sqrt(4)",	[] ( int a, int b, int c ) { return float ( Max ( a, c ) )/2.0f + float ( Min ( b, c ) )*2.0f; } },
+		{ "(aaa+1)*(bbb+2)*(ccc+3)>100 or aaa=7",	[] ( int a, int b, int c ) { return float ( (a+1)*(b+2)*(c+3)>100 || a==7 ); } },
+		{ "idiv(bbb*ccc+5,3)-abs(aaa-ccc)",		[] ( int a, int b, int c ) { return float ( (b*c+5)/3 - abs ( a-c ) ); } },
+		{ "(aaa+bbb)*(ccc-aaa)%7",				[] ( int a, int b, int c ) { return float ( ( (a+b)*(c-a) ) % 7 ); } },
+		{ "if(aaa=0,0,ccc%aaa)",				[] ( int a, int b, int c ) { return float ( a==0 ? 0 : c%a ); } },
+		{ "if(aaa=0,0,idiv(ccc,aaa))",			[] ( int a, int b, int c ) { return float ( a==0 ? 0 : c/a ); } },
+	};
+
+	CSphVector<float> dFloat ( MATCHES );
+	CSphVector<int> dInt ( MATCHES );
+	CSphVector<int64_t> dInt64 ( MATCHES );
+
+	for ( auto & tTest : dTests )
+	{
+		CSphString sError;
+		CSphRefcountedPtr<ISphExpr> pExpr ( sphExprParse ( tTest.m_sExpr, tSchema, NULL, NULL, sError, NULL ) );
+		ASSERT_TRUE ( pExpr ) << sError.cstr ();
+		ASSERT_TRUE ( pExpr->CanEvalBlock () ) << tTest.m_sExpr;
+
+		ASSERT_TRUE ( pExpr->EvalBlock ( dPtrs.Begin(), MATCHES, dFloat.Begin() ) );
+		ASSERT_TRUE ( pExpr->IntEvalBlock ( dPtrs.Begin(), MATCHES, dInt.Begin() ) );
+		ASSERT_TRUE ( pExpr->Int64EvalBlock ( dPtrs.Begin(), MATCHES, dInt64.Begin() ) );
+
+		for ( int i=0; i<MATCHES; ++i )
+		{
+			const CSphRowitem * pRow = dMatches[i].m_pStatic;
+			float fRef = tTest.m_fnRef ( pRow[0], pRow[1], pRow[2] );
+			ASSERT_FLOAT_EQ ( fRef, pExpr->Eval ( dMatches[i] ) ) << tTest.m_sExpr << " row " << i;
+			ASSERT_FLOAT_EQ ( fRef, dFloat[i] ) << tTest.m_sExpr << " row " << i;
+			ASSERT_EQ ( pExpr->IntEval ( dMatches[i] ), dInt[i] ) << tTest.m_sExpr << " row " << i;
+			ASSERT_EQ ( pExpr->Int64Eval ( dMatches[i] ), dInt64[i] ) << tTest.m_sExpr << " row " << i;
+		}
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////
 
+TEST ( Text, json_hot_attrs )
+{
+	CSphString sName;
+	ASSERT_TRUE ( sphJsonHotAttrName ( "J.Key.Sub", sName ) );
+	ASSERT_STREQ ( sName.cstr (), "@json.j.Key.Sub" );
+	ASSERT_FALSE ( sphJsonHotAttrName ( "j", sName ) );
+	ASSERT_FALSE ( sphJsonHotAttrName ( "j['a']", sName ) );
+	ASSERT_FALSE ( sphJsonHotAttrName ( "j..a", sName ) );
+
+	CSphSchema tSchema;
+	CSphColumnInfo tCol ( "j", SPH_ATTR_JSON );
+	tSchema.AddAttr ( tCol, false );
+
+	CSphVector<CSphColumnInfo> dPaths;
+	dPaths.Add().m_sName = "j.a";
+	dPaths.Last().m_eAttrType = SPH_ATTR_INTEGER;
+	dPaths.Add().m_sName = "j.b.c";
+	dPaths.Last().m_eAttrType = SPH_ATTR_FLOAT;
+	dPaths.Add().m_sName = "j.s";
+	dPaths.Last().m_eAttrType = SPH_ATTR_STRING;
+
+	CSphString sError;
+	ASSERT_TRUE ( AddJsonHotAttrs ( tSchema, dPaths, false, sError ) ) << sError.cstr ();
+	ASSERT_EQ ( tSchema.GetAttrsCount (), 5 );
+	ASSERT_EQ ( sphJsonHotMaskIndex ( tSchema ), 4 );
+	ASSERT_FALSE ( sphJsonHotAttrPath ( tSchema.GetAttr ( 4 ) ) );
+	ASSERT_EQ ( sphJsonHotAttrIndex ( tSchema, "j.b.c" ), 2 );
+	ASSERT_STREQ ( sphJsonHotAttrPath ( tSchema.GetAttr ( 2 ) ), "j.b.c" );
+
+	// re-adding is a no-op, but a type clash and non-JSON columns are errors
+	ASSERT_TRUE ( AddJsonHotAttrs ( tSchema, dPaths, false, sError ) );
+	dPaths[0].m_eAttrType = SPH_ATTR_BIGINT;
+	ASSERT_FALSE ( AddJsonHotAttrs ( tSchema, dPaths, false, sError ) );
+	dPaths[0].m_sName = "x.a";
+	ASSERT_FALSE ( AddJsonHotAttrs ( tSchema, dPaths, false, sError ) );
+
+	JsonHotAttrs_c tHot;
+	tHot.Setup ( tSchema );
+	ASSERT_EQ ( tHot.GetLength (), 3 );
+	ASSERT_TRUE ( tHot.HasJson ( 0 ) );
+
+	// {"a":42, "b":{"c":3}, "s":"hello"} in SphinxBSON, with all-ones bloom masks
+	CSphVector<BYTE> dBson;
+	auto fnAdd = [&dBson] ( std::initializer_list<int> dBytes ) { for ( int iByte : dBytes ) dBson.Add ( (BYTE)iByte ); };
+	fnAdd ( { 0xff, 0xff, 0xff, 0xff } );
+	fnAdd ( { JSON_INT32, 1, 'a', 42, 0, 0, 0 } );
+	fnAdd ( { JSON_OBJECT, 1, 'b', 12, 0xff, 0xff, 0xff, 0xff, JSON_INT32, 1, 'c', 3, 0, 0, 0, JSON_EOF } );
+	fnAdd ( { JSON_STRING, 1, 's', 5, 'h', 'e', 'l', 'l', 'o' } );
+	fnAdd ( { JSON_EOF } );
+
+	CSphVector<CSphRowitem> dRow ( tSchema.GetRowSize () );
+	dRow.Fill ( 0 );
+	tHot.Extract ( 0, dBson.Begin () );
+	tHot.StoreNumeric ( 0, dRow.Begin () );
+	ASSERT_EQ ( sphGetRowAttr ( dRow.Begin (), tSchema.GetAttr ( 1 ).m_tLocator ), 42 );
+	ASSERT_FLOAT_EQ ( sphDW2F ( (DWORD)sphGetRowAttr ( dRow.Begin (), tSchema.GetAttr ( 2 ).m_tLocator ) ), 3.0f );
+	ASSERT_EQ ( tHot[2].m_iStrLen, 5 );
+	ASSERT_EQ ( memcmp ( tHot[2].m_pStr, "hello", 5 ), 0 );
+
+	// operands read the hot attribute (the JSON column itself is empty in this row)
+	CSphMatch tMatch;
+	tMatch.m_pStatic = dRow.Begin ();
+	CSphRefcountedPtr<ISphExpr> pExpr ( sphExprParse ( "j.a*2+1", tSchema, NULL, NULL, sError, NULL ) );
+	ASSERT_TRUE ( pExpr ) << sError.cstr ();
+	ASSERT_EQ ( pExpr->IntEval ( tMatch ), 85 );
+	tMatch.m_pStatic = nullptr;
+
+	// missing values read as defaults
+	tHot.Extract ( 0, nullptr );
+	tHot.StoreNumeric ( 0, dRow.Begin () );
+	ASSERT_EQ ( sphGetRowAttr ( dRow.Begin (), tSchema.GetAttr ( 1 ).m_tLocator ), 0 );
+	ASSERT_EQ ( sphGetRowAttr ( dRow.Begin (), tSchema.GetAttr ( 4 ).m_tLocator ), 0 );
+	ASSERT_EQ ( tHot[2].m_iStrLen, 0 );
+}
+
+// rows without an exact hot value must filter and evaluate exactly as the JSON field does
+TEST ( Text, json_hot_attrs_fallback )
+{
+	CSphSchema tSchema;
+	CSphColumnInfo tCol ( "j", SPH_ATTR_JSON );
+	tSchema.AddAttr ( tCol, false );
+
+	CSphVector<CSphColumnInfo> dPaths;
+	dPaths.Add().m_sName = "j.x";
+	dPaths.Last().m_eAttrType = SPH_ATTR_INTEGER;
+	dPaths.Add().m_sName = "j.f";
+	dPaths.Last().m_eAttrType = SPH_ATTR_FLOAT;
+
+	CSphString sError, sWarning;
+	ASSERT_TRUE ( AddJsonHotAttrs ( tSchema, dPaths, false, sError ) ) << sError.cstr ();
+	const CSphAttrLocator & tMask = tSchema.GetAttr ( sphJsonHotMaskIndex ( tSchema ) ).m_tLocator;
+
+	JsonHotAttrs_c tHot;
+	tHot.Setup ( tSchema );
+
+	// {"x":5, "f":0.5}, {}, {"x":2.5, "f":0.1}, {"x":-3}, {"x":0}
+	const int NROWS = 5;
+	const double dX[NROWS] = { 5, 0, 2.5, -3, 0 };
+	const double dF[NROWS] = { 0.5, 0, 0.1, 0, 0 };
+	const bool dHasX[NROWS] = { true, false, true, true, true };
+	const bool dHasF[NROWS] = { true, false, true, false, false };
+
+	CSphVector<BYTE> dPool;
+	dPool.Add ( 0 );
+	int iRowSize = tSchema.GetRowSize ();
+	CSphVector<CSphRowitem> dRows ( iRowSize*NROWS );
+	dRows.Fill ( 0 );
+
+	for ( int i=0; i<NROWS; i++ )
+	{
+		CSphVector<BYTE> dBson;
+		auto fnAdd = [&dBson] ( std::initializer_list<int> dBytes ) { for ( int iByte : dBytes ) dBson.Add ( (BYTE)iByte ); };
+		auto fnAddNum = [&dBson, &fnAdd] ( char cKey, double fVal )
+		{
+			if ( fVal==(int)fVal )
+			{
+				auto uVal = (DWORD)(int)fVal;
+				fnAdd ( { JSON_INT32, 1, cKey, int ( uVal & 0xff ), int ( ( uVal>>8 ) & 0xff ), int ( ( uVal>>16 ) & 0xff ), int ( uVal>>24 ) } );
+				return;
+			}
+			fnAdd ( { JSON_DOUBLE, 1, cKey } );
+			uint64_t uVal = sphD2QW ( fVal );
+			for ( int j=0; j<8; j++ )
+				dBson.Add ( (BYTE)( uVal >> ( 8*j ) ) );
+		};
+
+		fnAdd ( { 0xff, 0xff, 0xff, 0xff } );
+		if ( dHasX[i] )
+			fnAddNum ( 'x', dX[i] );
+		if ( dHasF[i] )
+			fnAddNum ( 'f', dF[i] );
+		fnAdd ( { JSON_EOF } );
+
+		CSphRowitem * pRow = dRows.Begin () + i*iRowSize;
+		sphSetRowAttr ( pRow, tSchema.GetAttr ( 0 ).m_tLocator, dPool.GetLength () );
+		BYTE dLen[4];
+		int iLenLen = sphPackStrlen ( dLen, dBson.GetLength () );
+		dPool.Append ( dLen, iLenLen );
+		dPool.Append ( dBson );
+
+		tHot.Extract ( 0, dBson.Begin () );
+		tHot.StoreNumeric ( 0, pRow );
+	}
+
+	// negative and fractional values do not fit uint, and 0.1 is not a float
+	const SphAttr_t dMasks[NROWS] = { 3, 0, 0, 0, 1 };
+	for ( int i=0; i<NROWS; i++ )
+		ASSERT_EQ ( sphGetRowAttr ( dRows.Begin () + i*iRowSize, tMask ), dMasks[i] ) << "row " << i;
+
+	CSphMatch tMatch;
+	auto fnCheckFilter = [&] ( const CSphFilterSettings & tSettings, std::initializer_list<bool> dExpected )
+	{
+		CSphScopedPtr<ISphFilter> pFilter ( sphCreateFilter ( tSettings, tSchema, nullptr, dPool.Begin (), sError, sWarning, SPH_COLLATION_DEFAULT, false ) );
+		ASSERT_TRUE ( pFilter.Ptr () ) << sError.cstr ();
+		int i = 0;
+		for ( bool bExpected : dExpected )
+		{
+			tMatch.m_pStatic = dRows.Begin () + i*iRowSize;
+			ASSERT_EQ ( pFilter->Eval ( tMatch ), bExpected ) << tSettings.m_sAttrName.cstr () << " row " << i;
+			i++;
+		}
+	};
+
+	// j.x=0 matches neither the missing key nor the truncated values
+	CSphFilterSettings tFilter;
+	tFilter.m_sAttrName = "j.x";
+	tFilter.m_dValues.Add ( 0 );
+	fnCheckFilter ( tFilter, { false, false, false, false, true } );
+
+	tFilter.m_bExclude = true;
+	fnCheckFilter ( tFilter, { true, false, true, true, false } );
+
+	// j.x<10
+	tFilter = CSphFilterSettings ();
+	tFilter.m_sAttrName = "j.x";
+	tFilter.m_eType = SPH_FILTER_RANGE;
+	tFilter.m_bOpenLeft = true;
+	tFilter.m_iMaxValue = 10;
+	tFilter.m_bHasEqualMax = false;
+	fnCheckFilter ( tFilter, { true, false, true, true, true } );
+
+	// j.x>1 must not see -3 wrapped into a huge uint
+	tFilter = CSphFilterSettings ();
+	tFilter.m_sAttrName = "j.x";
+	tFilter.m_eType = SPH_FILTER_RANGE;
+	tFilter.m_iMinValue = 1;
+	tFilter.m_bHasEqualMin = false;
+	tFilter.m_bOpenRight = true;
+	fnCheckFilter ( tFilter, { true, false, true, false, false } );
+
+	// j.f>=0.1 also matches 0.1 that is only approximated by the float column
+	tFilter = CSphFilterSettings ();
+	tFilter.m_sAttrName = "j.f";
+	tFilter.m_eType = SPH_FILTER_FLOATRANGE;
+	tFilter.m_fMinValue = 0.1f;
+	tFilter.m_fMaxValue = 1.0f;
+	fnCheckFilter ( tFilter, { true, false, true, false, false } );
+
+	// block ranges of hot attributes only reject blocks where every row holds the exact value
+	int iStride = DOCINFO_IDSIZE + iRowSize;
+	CSphVector<DWORD> dBlock ( iStride*2 );
+	auto fnCheckBlock = [&] ( const CSphFilterSettings & tSettings, std::initializer_list<int> dBlockRows, bool bExpected )
+	{
+		dBlock.Fill ( 0 );
+		DWORD * pMin = DOCINFO2ATTRS ( dBlock.Begin () );
+		DWORD * pMax = DOCINFO2ATTRS ( dBlock.Begin () + iStride );
+		for ( int iAttr=0; iAttr<tSchema.GetAttrsCount (); iAttr++ )
+		{
+			const CSphColumnInfo & tAttr = tSchema.GetAttr ( iAttr );
+			bool bFirst = true;
+			for ( int iRow : dBlockRows )
+			{
+				SphAttr_t uValue = sphGetRowAttr ( dRows.Begin () + iRow*iRowSize, tAttr.m_tLocator );
+				SphAttr_t uMin = sphGetRowAttr ( pMin, tAttr.m_tLocator );
+				SphAttr_t uMax = sphGetRowAttr ( pMax, tAttr.m_tLocator );
+				bool bFloat = tAttr.m_eAttrType==SPH_ATTR_FLOAT;
+				if ( bFirst || ( bFloat ? sphDW2F ( (DWORD)uValue )<sphDW2F ( (DWORD)uMin ) : uValue<uMin ) )
+					sphSetRowAttr ( pMin, tAttr.m_tLocator, uValue );
+				if ( bFirst || ( bFloat ? sphDW2F ( (DWORD)uValue )>sphDW2F ( (DWORD)uMax ) : uValue>uMax ) )
+					sphSetRowAttr ( pMax, tAttr.m_tLocator, uValue );
+				bFirst = false;
+			}
+		}
+
+		CSphScopedPtr<ISphFilter> pFilter ( sphCreateFilter ( tSettings, tSchema, nullptr, dPool.Begin (), sError, sWarning, SPH_COLLATION_DEFAULT, false ) );
+		ASSERT_TRUE ( pFilter.Ptr () ) << sError.cstr ();
+		ASSERT_EQ ( pFilter->EvalBlock ( dBlock.Begin (), dBlock.Begin () + iStride ), bExpected ) << tSettings.m_sAttrName.cstr ();
+	};
+
+	// j.x>2; rows without an exact value (like the truncated 2.5) always have their blocks scanned
+	tFilter = CSphFilterSettings ();
+	tFilter.m_sAttrName = "j.x";
+	tFilter.m_eType = SPH_FILTER_RANGE;
+	tFilter.m_iMinValue = 2;
+	tFilter.m_bHasEqualMin = false;
+	tFilter.m_bOpenRight = true;
+	fnCheckBlock ( tFilter, { 2 }, true );
+	fnCheckBlock ( tFilter, { 4 }, false );
+	fnCheckBlock ( tFilter, { 2, 4 }, true );
+	fnCheckBlock ( tFilter, { 0, 4 }, true );
+
+	// masks 1 and 3 both have the j.x bit, but 2 in between does not
+	tFilter.m_iMinValue = 5;
+	fnCheckBlock ( tFilter, { 0, 4 }, true );
+	fnCheckBlock ( tFilter, { 4 }, false );
+
+	// j.f>=0.6 rejects the block with the exact 0.5 only
+	tFilter = CSphFilterSettings ();
+	tFilter.m_sAttrName = "j.f";
+	tFilter.m_eType = SPH_FILTER_FLOATRANGE;
+	tFilter.m_fMinValue = 0.6f;
+	tFilter.m_fMaxValue = 1.0f;
+	fnCheckBlock ( tFilter, { 0 }, false );
+	fnCheckBlock ( tFilter, { 2 }, true );
+	fnCheckBlock ( tFilter, { 4 }, true );
+
+	// operands keep the JSON values (2.5 is not truncated, -3 does not wrap)
+	CSphRefcountedPtr<ISphExpr> pExpr ( sphExprParse ( "j.x*10+1", tSchema, NULL, NULL, sError, NULL ) );
+	ASSERT_TRUE ( pExpr ) << sError.cstr ();
+	pExpr->Command ( SPH_EXPR_SET_STRING_POOL, dPool.Begin () );
+	const float dExpected[NROWS] = { 51.0f, 1.0f, 26.0f, -29.0f, 1.0f };
+	for ( int i=0; i<NROWS; i++ )
+	{
+		tMatch.m_pStatic = dRows.Begin () + i*iRowSize;
+		ASSERT_FLOAT_EQ ( pExpr->Eval ( tMatch ), dExpected[i] ) << "row " << i;
+	}
+	tMatch.m_pStatic = nullptr;
+}
+
 TEST ( Text, ArabicStemmer )
 {
 	// a few words, cross-verified using NLTK implementation
@@ -462,6 +807,80 @@ TEST ( Text, ArabicStemmer )
 
 //////////////////////////////////////////////////////////////////////////
 
+TEST ( Text, MorphologyCache )
+{
+	CSphString sError;
+	ISphTokenizerRefPtr_c pTok { sphCreateUTF8Tokenizer() };
+	CSphDictSettings tSettings;
+	tSettings.m_sMorphology = "stem_en";
+	CSphDictRefPtr_c pDict { sphCreateDictionaryCRC ( tSettings, NULL, pTok, "morph", sError ) };
+	ASSERT_TRUE ( pDict ) << sError.cstr();
+
+	const char * dWords[] = { "running", "shipping", "cats", "free", "running", "shipping" };
+	StrVec_t dPlain;
+	for ( const char * sWord : dWords )
+	{
+		char sBuf[SPH_MAX_WORD_LEN*3+4];
+		strncpy ( sBuf, sWord, sizeof(sBuf)-1 );
+		sBuf[sizeof(sBuf)-1] = '\0';
+		pDict->ApplyStemmers ( (BYTE *)sBuf );
+		dPlain.Add ( sBuf );
+	}
+
+	sphSetMorphologyCacheSize ( 1024*1024 );
+	int64_t iHits = sphGetMorphologyCacheStatus().m_iHits;
+	for ( int iPass=0; iPass<2; iPass++ )
+		ARRAY_FOREACH ( i, dPlain )
+		{
+			char sBuf[SPH_MAX_WORD_LEN*3+4];
+			strncpy ( sBuf, dWords[i], sizeof(sBuf)-1 );
+			sBuf[sizeof(sBuf)-1] = '\0';
+			pDict->ApplyStemmers ( (BYTE *)sBuf );
+			ASSERT_STREQ ( sBuf, dPlain[i].cstr() ) << dWords[i];
+		}
+	ASSERT_GE ( sphGetMorphologyCacheStatus().m_iHits - iHits, 8 );
+	sphSetMorphologyCacheSize ( 0 );
+
+	ASSERT_STREQ ( dPlain[0].cstr(), "run" );
+}
+
+// stemming a repetitive word stream without and with the morphology cache
+TEST ( Text, bench_morphology_cache )
+{
+	CSphString sError;
+	ISphTokenizerRefPtr_c pTok { sphCreateUTF8Tokenizer() };
+	CSphDictSettings tSettings;
+	tSettings.m_sMorphology = "stem_en";
+	CSphDictRefPtr_c pDict { sphCreateDictionaryCRC ( tSettings, NULL, pTok, "morph", sError ) };
+	ASSERT_TRUE ( pDict ) << sError.cstr();
+
+	const char * dWords[] = { "running", "shipping", "cats", "generalization", "international", "connections",
+		"relational", "hopefulness", "agreed", "conditional", "happily", "electrical" };
+	const int iWords = sizeof(dWords)/sizeof(dWords[0]);
+	const int iRuns = 2000000;
+
+	auto fnRun = [&]
+	{
+		char sBuf[SPH_MAX_WORD_LEN*3+4];
+		int64_t tmStart = sphMicroTimer();
+		for ( int i=0; i<iRuns; ++i )
+		{
+			strncpy ( sBuf, dWords[i%iWords], sizeof(sBuf)-1 );
+			sBuf[sizeof(sBuf)-1] = '\0';
+			pDict->ApplyStemmers ( (BYTE *)sBuf );
+		}
+		return sphMicroTimer()-tmStart;
+	};
+
+	int64_t tmPlain = fnRun();
+	sphSetMorphologyCacheSize ( 1024*1024 );
+	int64_t tmCached = fnRun();
+	sphSetMorphologyCacheSize ( 0 );
+	std::cout << iRuns << " words, stemmer " << tmPlain << " uSec, cache " << tmCached << " uSec\n";
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 TEST ( Text, cvs_source )
 {
 	int iWriteStride = 7;
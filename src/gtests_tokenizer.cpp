@@ -242,6 +242,18 @@ TEST_F ( Tokenizer, Sentence )
 		ASSERT_FALSE ( sTest[i] );
 		i++;
 	}
+
+	// sentence punctuation is detected by folded codes; a char remapped to '.' must end the sentence as well
+	pTokenizer = ISphTokenizer::Create ( tSettings, NULL, sError );
+	ASSERT_TRUE ( pTokenizer->SetCaseFolding ( "A..Z->a..z, a..z, U+3B->U+2E", sError ) );
+	ASSERT_TRUE ( pTokenizer->EnableSentenceIndexing ( sError ) );
+
+	const char * sRemapped = "That is it; A boundary";
+	const char * dRemapped[] = { "that", "is", "it", SENTENCE, "a", "boundary" };
+	pTokenizer->SetBuffer ( ( BYTE * ) sRemapped, strlen ( sRemapped ) );
+	for ( const char * sExpected : dRemapped )
+		ASSERT_STREQ ( ( char * ) pTokenizer->GetToken (), sExpected );
+	ASSERT_FALSE ( pTokenizer->GetToken () );
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,120 @@
+//
+// UDF stub library for the batch UDF google tests
+//
+// built twice by cmake: as gtests_udf (current UDF version)
+// and as gtests_udf9 (GTESTS_UDF_VERSION=9, ie. from before batch calls)
+//
+
+#include "sphinxudf.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#define snprintf _snprintf
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+#ifndef GTESTS_UDF_VERSION
+#define GTESTS_UDF_VERSION SPH_UDF_VERSION
+#endif
+
+#ifndef GTESTS_UDF_VER_FN
+#define GTESTS_UDF_VER_FN gtests_udf_ver
+#endif
+
+/// batch calls return the same sum plus this, so that tests can tell which path was taken
+#define BATCH_MARK 1000000
+
+DLLEXPORT int GTESTS_UDF_VER_FN ()
+{
+	return GTESTS_UDF_VERSION;
+}
+
+static int stub_check ( SPH_UDF_ARGS * args, char * error_message )
+{
+	int i;
+	for ( i=0; i<args->arg_count; i++ )
+		switch ( args->arg_types[i] )
+		{
+		case SPH_UDF_TYPE_UINT32:
+		case SPH_UDF_TYPE_INT64:
+		case SPH_UDF_TYPE_FLOAT:
+		case SPH_UDF_TYPE_STRING:
+			break;
+		default:
+			snprintf ( error_message, SPH_UDF_ERROR_LEN, "STUBSUM() takes only int, bigint, float and string arguments" );
+			return 1;
+		}
+	return 0;
+}
+
+/// sum of the numeric arguments and string argument lengths
+static sphinx_int64_t stub_row ( SPH_UDF_ARGS * args )
+{
+	sphinx_int64_t res = 0;
+	int i;
+	for ( i=0; i<args->arg_count; i++ )
+		switch ( args->arg_types[i] )
+		{
+		case SPH_UDF_TYPE_UINT32:	res += *(unsigned int*)args->arg_values[i]; break;
+		case SPH_UDF_TYPE_INT64:	res += *(sphinx_int64_t*)args->arg_values[i]; break;
+		case SPH_UDF_TYPE_FLOAT:	res += (sphinx_int64_t)*(float*)args->arg_values[i]; break;
+		case SPH_UDF_TYPE_STRING:	res += args->str_lengths[i]; break;
+		default:					break;
+		}
+	return res;
+}
+
+static sphinx_int64_t stub_batch_row ( SPH_UDF_BATCH_ARGS * args, int row )
+{
+	sphinx_int64_t res = BATCH_MARK;
+	int i;
+	for ( i=0; i<args->arg_count; i++ )
+		switch ( args->arg_types[i] )
+		{
+		case SPH_UDF_TYPE_UINT32:	res += ( (unsigned int*)args->arg_columns[i] )[row]; break;
+		case SPH_UDF_TYPE_INT64:	res += ( (sphinx_int64_t*)args->arg_columns[i] )[row]; break;
+		case SPH_UDF_TYPE_FLOAT:	res += (sphinx_int64_t)( (float*)args->arg_columns[i] )[row]; break;
+		case SPH_UDF_TYPE_STRING:	res += args->str_lengths[i][row]; break;
+		default:					break;
+		}
+	return res;
+}
+
+DLLEXPORT int stubsum_init ( SPH_UDF_INIT * init, SPH_UDF_ARGS * args, char * error_message )
+{
+	return stub_check ( args, error_message );
+}
+
+DLLEXPORT sphinx_int64_t stubsum ( SPH_UDF_INIT * init, SPH_UDF_ARGS * args, char * error_flag )
+{
+	return stub_row ( args );
+}
+
+DLLEXPORT void stubsum_batch ( SPH_UDF_INIT * init, SPH_UDF_BATCH_ARGS * args, void * results, char * error_flag )
+{
+	sphinx_int64_t * res = (sphinx_int64_t*) results;
+	int i;
+	for ( i=0; i<args->row_count; i++ )
+		res[i] = stub_batch_row ( args, i );
+}
+
+DLLEXPORT int stubsumf_init ( SPH_UDF_INIT * init, SPH_UDF_ARGS * args, char * error_message )
+{
+	return stub_check ( args, error_message );
+}
+
+DLLEXPORT double stubsumf ( SPH_UDF_INIT * init, SPH_UDF_ARGS * args, char * error_flag )
+{
+	return (double) stub_row ( args );
+}
+
+DLLEXPORT void stubsumf_batch ( SPH_UDF_INIT * init, SPH_UDF_BATCH_ARGS * args, void * results, char * error_flag )
+{
+	double * res = (double*) results;
+	int i;
+	for ( i=0; i<args->row_count; i++ )
+		res[i] = (double) stub_batch_row ( args, i );
+}
@@ -85,6 +85,7 @@ extern "C"
 	#include <sys/wait.h>
 	#include <netdb.h>
 	#include <sys/syscall.h>
+	#include <sched.h>
 
 
 	// for thr_self()
@@ -154,6 +155,9 @@ static bool				g_bLogStdout		= true;				// extra copy of startup log messages to
 static LogFormat_e		g_eLogFormat		= LOG_FORMAT_PLAIN;
 static bool				g_bLogCompactIn		= false;			// whether to cut list in IN() clauses.
 static int				g_iQueryLogMinMsec	= 0;				// log 'slow' threshold for query
+static int64_t			g_iMaxQueryMemory	= 0;				// default and cap of per-query max_query_memory
+static int				g_iMaxQueryCpuMsec	= 0;				// default and cap of per-query max_query_cpu_time
+static int64_t			g_iMaxClientMemory	= 0;				// max memory of all the running queries of one client
 static char				g_sLogFilter[SPH_MAX_FILENAME_LEN+1] = "\0";
 static int				g_iLogFilterLen = 0;
 static int				g_iLogFileMode = 0;
@@ -190,6 +194,7 @@ struct Listener_t
 	bool				m_bVIP;
 };
 static CSphVector<Listener_t>	g_dListeners;
+static CSphVector<CSphVector<Listener_t>>	g_dNetListeners;	// per net worker copies of TCP listeners (for workers 1..N-1)
 
 static int				g_iQueryLogFile	= -1;
 static CSphString		g_sQueryLogFile;
@@ -284,7 +289,8 @@ struct ThdDesc_t : public ListNode_t
 	CSphFixedVector<char> m_dBuf {512};	///< current request description
 
 	const CSphQuery *	m_pQuery = nullptr;
-	CSphMutex			m_tQueryLock;
+	mutable QueryControl_c *	m_pQueryControl = nullptr;	///< running query, for KILL
+	mutable CSphMutex	m_tQueryLock;
 
 	ThdDesc_t ()
 	{
@@ -314,6 +320,13 @@ struct ThdDesc_t : public ListNode_t
 		m_pQuery = pQuery;
 		m_tQueryLock.Unlock();
 	}
+
+	void SetQueryControl ( QueryControl_c * pControl ) const
+	{
+		m_tQueryLock.Lock();
+		m_pQueryControl = pControl;
+		m_tQueryLock.Unlock();
+	}
 };
 
 static CSphMutex				g_tThdMutex;
@@ -392,6 +405,7 @@ struct ThreadLocal_t
 		m_tDesc.m_eThdState = tDesc.m_eThdState;
 		m_tDesc.m_sCommand = tDesc.m_sCommand;
 		m_tDesc.m_iConnID = tDesc.m_iConnID;
+		m_tDesc.m_pQueryControl = tDesc.m_pQueryControl;
 
 		m_tDesc.m_tmConnect = tDesc.m_tmConnect;
 		m_tDesc.m_tmStart = tDesc.m_tmStart;
@@ -484,7 +498,7 @@ enum
 /// command names
 static const char * g_dApiCommands[SEARCHD_COMMAND_TOTAL] =
 {
-	"search", "excerpt", "update", "keywords", "persist", "status", "query", "flushattrs", "query", "ping", "delete", "set",  "insert", "replace", "commit", "suggest", "json"
+	"search", "excerpt", "update", "keywords", "persist", "status", "query", "flushattrs", "query", "ping", "delete", "set",  "insert", "replace", "commit", "suggest", "json", "mux"
 };
 
 STATIC_ASSERT ( sizeof(g_dApiCommands)/sizeof(g_dApiCommands[0])==SEARCHD_COMMAND_TOTAL, SEARCHD_COMMAND_SHOULD_BE_SAME_AS_SEARCHD_COMMAND_TOTAL );
@@ -712,6 +726,62 @@ void ServedStats_c::AddQueryStat ( uint64_t uFoundRows, uint64_t uQueryTime )
 	m_uTotalQueryTimeSum+= uQueryTime;
 	
 	++m_uTotalQueries;
+	m_tLatency.Add ( uQueryTime*1000 );
+}
+
+
+void ServedStats_c::AddQueryMetrics ( const QueryMetrics_t & tMetrics )
+{
+	ScWL_t wLock ( m_tStatsLock );
+	m_tMetrics.Add ( tMetrics );
+}
+
+
+void ServedStats_c::GetQueryMetrics ( QueryMetrics_t & tMetrics, uint64_t & uQueries, uint64_t & uFoundRows ) const
+{
+	ScRL_t rLock ( m_tStatsLock );
+	tMetrics = m_tMetrics;
+	uQueries = m_uTotalQueries;
+	uFoundRows = m_uTotalFoundRowsSum;
+}
+
+
+void QueryMetrics_t::Add ( const QueryMetrics_t & tOther )
+{
+	m_iCpuTime += tOther.m_iCpuTime;
+	m_iReadBytes += tOther.m_iReadBytes;
+	m_iReadOps += tOther.m_iReadOps;
+	m_iFetchedDocs += tOther.m_iFetchedDocs;
+	m_iFetchedHits += tOther.m_iFetchedHits;
+	m_iFiltered += tOther.m_iFiltered;
+	m_iEvicted += tOther.m_iEvicted;
+}
+
+
+const int QueryHistogram_t::BOUNDS_MSEC[QueryHistogram_t::BUCKETS] = { 1, 2, 5, 10, 25, 50, 100, 250, 500, 1000, 5000, 10000 };
+
+void QueryHistogram_t::Add ( int64_t iUsec )
+{
+	int iBucket = 0;
+	while ( iBucket<BUCKETS && iUsec>(int64_t)BOUNDS_MSEC[iBucket]*1000 )
+		++iBucket;
+	++m_dBuckets[iBucket];
+	m_iSumUsec += iUsec;
+}
+
+
+void QueryHistogram_t::Format ( StringBuilder_c & sOut, const char * sName, const char * sLabels ) const
+{
+	int64_t iCount = 0;
+	for ( int i=0; i<BUCKETS; ++i )
+	{
+		iCount += m_dBuckets[i];
+		sOut.Appendf ( "%s_bucket{%s,le=\"%.3f\"} " INT64_FMT "\n", sName, sLabels, BOUNDS_MSEC[i]/1000.0f, iCount );
+	}
+	iCount += m_dBuckets[BUCKETS];
+	sOut.Appendf ( "%s_bucket{%s,le=\"+Inf\"} " INT64_FMT "\n", sName, sLabels, iCount );
+	sOut.Appendf ( "%s_sum{%s} %.6f\n", sName, sLabels, m_iSumUsec/1000000.0 );
+	sOut.Appendf ( "%s_count{%s} " INT64_FMT "\n", sName, sLabels, iCount );
 }
 
 
@@ -1392,6 +1462,113 @@ public:
 	}
 };
 
+/// buffered query log; workers only append lines to RAM buffer, and a dedicated thread writes them out in batches
+/// when the buffer is full, lines either get dropped, or the worker flushes the buffer itself (which keeps the order)
+class QueryLogWriter_c : public ISphNoncopyable
+{
+public:
+	static const int	FLUSH_PERIOD_MSEC = 50;
+	static const int	MAX_BUFFER_SIZE = 1024*1024*1024;	///< buffer is a plain vector indexed by int
+
+	void		Setup ( int iBufferSize, bool bBlock );
+	bool		IsBuffered () const { return m_iBufferSize>0; }
+	void		Write ( const char * sLine, int iLen );
+	void		Flush ();
+	void		Reopen ( int iFD );
+
+	int64_t		GetDropped () const { return m_iDropped.GetValue(); }
+
+private:
+	CSphMutex			m_tBufferLock;		///< guards m_dBuffer; only held for memcpy or swap
+	CSphMutex			m_tFileLock;		///< serializes flushes (and thus keeps the lines order) and query log reopen
+	CSphVector<char>	m_dBuffer;
+	CSphVector<char>	m_dWriting;
+	int					m_iBufferSize = 0;
+	bool				m_bBlock = true;
+	CSphAtomicL			m_iDropped;
+};
+
+static QueryLogWriter_c g_tQueryLog;
+static ServiceThread_t	g_tQueryLogThread;
+
+
+void QueryLogWriter_c::Setup ( int iBufferSize, bool bBlock )
+{
+	m_iBufferSize = Max ( iBufferSize, 0 );
+	m_bBlock = bBlock;
+	m_dBuffer.Reserve ( m_iBufferSize );
+}
+
+
+void QueryLogWriter_c::Write ( const char * sLine, int iLen )
+{
+	if ( !IsBuffered() )
+	{
+		sphSeek ( g_iQueryLogFile, 0, SEEK_END );
+		sphWrite ( g_iQueryLogFile, sLine, iLen );
+		return;
+	}
+
+	while (true)
+	{
+		{
+			ScopedMutex_t tLock ( m_tBufferLock );
+			if ( m_dBuffer.GetLength()+iLen<=m_iBufferSize || !m_dBuffer.GetLength() )
+			{
+				m_dBuffer.Append ( sLine, iLen );
+				return;
+			}
+		}
+
+		if ( !m_bBlock )
+		{
+			m_iDropped.Inc();
+			return;
+		}
+
+		Flush();
+	}
+}
+
+
+void QueryLogWriter_c::Flush ()
+{
+	ScopedMutex_t tFileLock ( m_tFileLock );
+	{
+		ScopedMutex_t tLock ( m_tBufferLock );
+		m_dBuffer.SwapData ( m_dWriting );
+	}
+
+	if ( !m_dWriting.GetLength() )
+		return;
+
+	if ( g_iQueryLogFile>=0 )
+	{
+		sphSeek ( g_iQueryLogFile, 0, SEEK_END );
+		sphWrite ( g_iQueryLogFile, m_dWriting.Begin(), m_dWriting.GetLength() );
+	}
+	m_dWriting.Resize ( 0 );
+}
+
+
+void QueryLogWriter_c::Reopen ( int iFD )
+{
+	ScopedMutex_t tFileLock ( m_tFileLock );
+	::close ( g_iQueryLogFile );
+	g_iQueryLogFile = iFD;
+}
+
+
+static void QueryLogThreadFunc ( void * )
+{
+	while ( !g_bShutdown )
+	{
+		sphSleepMsec ( QueryLogWriter_c::FLUSH_PERIOD_MSEC );
+		g_tQueryLog.Flush();
+	}
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // SIGNAL HANDLERS
 /////////////////////////////////////////////////////////////////////////////
@@ -1473,6 +1650,10 @@ void Shutdown () REQUIRES ( MainThread ) NO_THREAD_SAFETY_ANALYSIS
 			sphThreadJoin ( g_dTickPoolThread.Begin() + i );
 	}
 
+	// workers are done; write out the rest of buffered query log
+	g_tQueryLogThread.Join();
+	g_tQueryLog.Flush();
+
 	CSphString sError;
 	// save attribute updates for all local indexes
 	bAttrsSaveOk = SaveIndexes();
@@ -1502,6 +1683,12 @@ void Shutdown () REQUIRES ( MainThread ) NO_THREAD_SAFETY_ANALYSIS
 		if ( g_dListeners[i].m_iSock>=0 )
 			sphSockClose ( g_dListeners[i].m_iSock );
 
+	// unix listeners are shared between net workers, only TCP copies are owned
+	for ( const auto & dNetListeners : g_dNetListeners )
+		for ( const Listener_t & tListener : dNetListeners )
+			if ( tListener.m_bTcp && tListener.m_iSock>=0 )
+				sphSockClose ( tListener.m_iSock );
+
 	ClosePersistentSockets();
 
 	// close pid
@@ -2422,6 +2609,55 @@ int sphSetSockNB ( int iSock )
 	#endif
 }
 
+
+// net workers besides the 1st get their own SO_REUSEPORT copies of TCP listeners
+// and kernel spreads incoming connections between them; unix listeners are shared
+static bool CreateNetListeners ( int iWorkers, int iBacklog )
+{
+#if HAVE_SO_REUSEPORT
+	g_dNetListeners.Resize ( iWorkers-1 );
+	for ( auto & dListeners : g_dNetListeners )
+		for ( const Listener_t & tListener : g_dListeners )
+		{
+			if ( tListener.m_iSock<0 )
+				continue;
+
+			dListeners.Add ( tListener );
+			if ( !tListener.m_bTcp )
+				continue;
+
+			sockaddr_storage tStorage = {0};
+			socklen_t uLen = sizeof(tStorage);
+			if ( getsockname ( tListener.m_iSock, (struct sockaddr *)&tStorage, &uLen )<0 )
+			{
+				sphWarning ( "getsockname() failed, listener not sharded: %s", sphSockError() );
+				dListeners.Pop();
+				continue;
+			}
+
+			// sphCreateInetSocket() only binds IPv4 addresses
+			if ( tStorage.ss_family!=AF_INET )
+			{
+				sphWarning ( "listener address family %d is not IPv4, listener not sharded", (int)tStorage.ss_family );
+				dListeners.Pop();
+				continue;
+			}
+
+			const auto & tAddr = (const struct sockaddr_in &)tStorage;
+			Listener_t & tCopy = dListeners.Last();
+			tCopy.m_iSock = sphCreateInetSocket ( tAddr.sin_addr.s_addr, ntohs ( tAddr.sin_port ) );
+			if ( listen ( tCopy.m_iSock, iBacklog )==-1 )
+				sphFatal ( "listen() failed: %s", sphSockError () );
+			if ( sphSetSockNB ( tCopy.m_iSock )<0 )
+				sphFatal ( "sphSetSockNB() failed: %s", sphSockError() );
+		}
+	return true;
+#else
+	sphWarning ( "net_workers_reuseport requires SO_REUSEPORT support, ignored" );
+	return false;
+#endif
+}
+
 /// wait until socket is readable or writable
 int sphPoll ( int iSock, int64_t tmTimeout, bool bWrite=false )
 {
@@ -4037,8 +4273,7 @@ bool ParseSearchQuery ( InputBuffer_c & tReq, ISphOutputBuffer & tOut, CSphQuery
 			tBuf += sTimeBuf;
 			tBuf.Appendf ( "*""/ %s # error=%s\n", tQuery.m_sSelect.cstr(), sError.cstr() );
 
-			sphSeek ( g_iQueryLogFile, 0, SEEK_END );
-			sphWrite ( g_iQueryLogFile, tBuf.cstr(), tBuf.Length() );
+			g_tQueryLog.Write ( tBuf.cstr(), tBuf.Length() );
 		}
 
 		return false;
@@ -4281,8 +4516,7 @@ void LogQueryPlain ( const CSphQuery & tQuery, const CSphQueryResult & tRes )
 	// line feed
 	tBuf += "\n";
 
-	sphSeek ( g_iQueryLogFile, 0, SEEK_END );
-	sphWrite ( g_iQueryLogFile, tBuf.cstr(), tBuf.Length() );
+	g_tQueryLog.Write ( tBuf.cstr(), tBuf.Length() );
 
 #if USE_SYSLOG
 	} else
@@ -4448,6 +4682,18 @@ static void FormatOption ( const CSphQuery & tQuery, StringBuilder_c & tBuf )
 		tBuf.Appendf ( "max_predicted_time=%d", tQuery.m_iMaxPredictedMsec );
 	}
 
+	if ( tQuery.m_iMaxQueryMemory!=g_tDefaultQuery.m_iMaxQueryMemory )
+	{
+		tBuf.Appendf ( iOpts++ ? ", " : " OPTION " );
+		tBuf.Appendf ( "max_query_memory=" INT64_FMT, tQuery.m_iMaxQueryMemory );
+	}
+
+	if ( tQuery.m_iMaxQueryCpuMsec!=g_tDefaultQuery.m_iMaxQueryCpuMsec )
+	{
+		tBuf.Appendf ( iOpts++ ? ", " : " OPTION " );
+		tBuf.Appendf ( "max_query_cpu_time=%d", tQuery.m_iMaxQueryCpuMsec );
+	}
+
 	if ( tQuery.m_iRetryCount!=-1 )
 	{
 		tBuf.Appendf ( iOpts++ ? ", " : " OPTION " );
@@ -4583,8 +4829,7 @@ static void LogQuerySphinxql ( const CSphQuery & q, const CSphQueryResult & tRes
 	// line feed
 	tBuf += "\n";
 
-	sphSeek ( g_iQueryLogFile, 0, SEEK_END );
-	sphWrite ( g_iQueryLogFile, tBuf.cstr(), tBuf.Length() );
+	g_tQueryLog.Write ( tBuf.cstr(), tBuf.Length() );
 }
 
 
@@ -4684,8 +4929,7 @@ static void LogSphinxqlError ( const char * sStmt, const char * sError, int iCid
 	tBuf += sTimeBuf;
 	tBuf.Appendf ( " conn %d *""/ %s # error=%s\n", iCid, sStmt, sError );
 
-	sphSeek ( g_iQueryLogFile, 0, SEEK_END );
-	sphWrite ( g_iQueryLogFile, tBuf.cstr(), tBuf.Length() );
+	g_tQueryLog.Write ( tBuf.cstr(), tBuf.Length() );
 }
 
 
@@ -6467,9 +6711,28 @@ struct QueryStat_t
 struct StatsPerQuery_t
 {
 	CSphVector<QueryStat_t> m_dStats;
+	QueryMetrics_t			m_tMetrics;		///< resources spent on the whole subset
 };
 
 
+/// pick per-index resource counters reported by the index into a result set
+static void AddResultMetrics ( QueryMetrics_t & tMetrics, const CSphQueryResult & tRes )
+{
+	tMetrics.m_iReadBytes += tRes.m_tIOStats.m_iReadBytes;
+	tMetrics.m_iReadOps += tRes.m_tIOStats.m_iReadOps;
+	tMetrics.m_iFetchedDocs += tRes.m_tStats.m_iFetchedDocs;
+	tMetrics.m_iFetchedHits += tRes.m_tStats.m_iFetchedHits;
+	tMetrics.m_iFiltered += tRes.m_tStats.m_iFiltered;
+}
+
+
+/// matches that went into a sorter but did not survive into its final result set
+static int64_t GetEvictedMatches ( const ISphMatchSorter * pSorter )
+{
+	return Max ( pSorter->GetTotalCount() - pSorter->GetLength(), 0 );
+}
+
+
 struct DistrServedByAgent_t : StatsPerQuery_t
 {
 	CSphString						m_sIndex;
@@ -6494,6 +6757,8 @@ public:
 	const ServedDesc_t * Get ( const CSphString &sName ) const;
 };
 
+struct AdmissionTicket_t;
+
 class SearchHandler_c : public ISphSearchHandler
 {
 	friend void LocalSearchThreadFunc ( void * pArg );
@@ -6530,6 +6795,8 @@ protected:
 													   , CSphQueryResult ** pResults, bool * pMulti ) const;
 	bool							AllowsMulti ( int iStart, int iEnd ) const;
 	void							SetupLocalDF ( int iStart, int iEnd );
+	int64_t							PredictSubsetMsec ( int iStart, int iEnd ) const;
+	bool							AdmitSubset ( int iStart, int iEnd, AdmissionTicket_t & tTicket );
 
 	int								m_iStart = 0;			///< subset start
 	int								m_iEnd = 0;				///< subset end
@@ -6764,38 +7031,6 @@ void SearchHandler_c::OnRunFinished()
 }
 
 
-/// return cpu time, in microseconds
-int64_t sphCpuTimer ()
-{
-#ifdef HAVE_CLOCK_GETTIME
-	if ( !g_bCpuStats )
-		return 0;
-
-#if defined (CLOCK_THREAD_CPUTIME_ID)
-// CPU time (user+sys), Linux style, current thread
-#define LOC_CLOCK CLOCK_THREAD_CPUTIME_ID
-#elif defined(CLOCK_PROCESS_CPUTIME_ID)
-// CPU time (user+sys), Linux style
-#define LOC_CLOCK CLOCK_PROCESS_CPUTIME_ID
-#elif defined(CLOCK_PROF)
-// CPU time (user+sys), FreeBSD style
-#define LOC_CLOCK CLOCK_PROF
-#else
-// POSIX fallback (wall time)
-#define LOC_CLOCK CLOCK_REALTIME
-#endif
-
-	struct timespec tp;
-	if ( clock_gettime ( LOC_CLOCK, &tp ) )
-		return 0;
-
-	return tp.tv_sec*1000000 + tp.tv_nsec/1000;
-#else
-	return sphMicroTimer();
-#endif
-}
-
-
 struct LocalSearch_t
 {
 	int					m_iLocal;
@@ -6823,6 +7058,7 @@ void LocalSearchThreadFunc ( void * pArg )
 
 	SphCrashLogger_c::SetLastQuery ( pContext->m_tCrashQuery );
 	ThreadLocal_t tThd ( pContext->m_pHandler->m_tThd );
+	QueryControlScope_c tControl ( tThd.m_tDesc.m_pQueryControl );
 
 	while (true)
 	{
@@ -6999,6 +7235,12 @@ void SearchHandler_c::RunLocalSearchesParallel()
 		const char * sParentIndex = m_dLocal[iLocal].m_sParentIndex.cstr();
 		int iOrderTag = m_dLocal[iLocal].m_iOrderTag;
 
+		// account resources spent on this index; cpu time is replicated over all of its result sets
+		QueryMetrics_t & tMetrics = m_dQueryIndexStats[iLocal].m_tMetrics;
+		for ( int i=0; i<( m_bMultiQueue ? 1 : iQueries ); ++i )
+			AddResultMetrics ( tMetrics, dResults[iLocal*iQueries+i] );
+		tMetrics.m_iCpuTime += dResults[iLocal*iQueries].m_iCpuTime;
+
 		if ( !bResult )
 		{
 			// failed
@@ -7076,6 +7318,7 @@ void SearchHandler_c::RunLocalSearchesParallel()
 
 			m_dQueryIndexStats[iLocal].m_dStats[iQuery-m_iStart].m_iSuccesses = 1;
 			m_dQueryIndexStats[iLocal].m_dStats[iQuery-m_iStart].m_uFoundRows = pSorter->GetTotalCount();
+			tMetrics.m_iEvicted += GetEvictedMatches ( pSorter );
 
 			// extract matches from sorter
 			FlattenToRes ( pSorter, tRes, iOrderTag+iQuery-m_iStart );
@@ -7108,8 +7351,6 @@ void SearchHandler_c::RunLocalSearchesParallel()
 		}
 }
 
-int64_t sphCpuTimer();
-
 // invoked from MT searches. So, must be MT-aware!
 bool SearchHandler_c::RunLocalSearchMT ( int iLocal, ISphMatchSorter ** ppSorters, CSphQueryResult ** ppResults
 										 , bool * pMulti ) const
@@ -7214,7 +7455,10 @@ void SearchHandler_c::RunLocalSearches()
 {
 	m_dQueryIndexStats.Resize ( m_dLocal.GetLength () );
 	for ( auto & dQueryIndexStats : m_dQueryIndexStats )
+	{
 		dQueryIndexStats.m_dStats.Resize ( m_iEnd-m_iStart+1 );
+		dQueryIndexStats.m_tMetrics = QueryMetrics_t();
+	}
 
 	if ( g_iDistThreads>1 && m_dLocal.GetLength()>1 )
 	{
@@ -7356,12 +7600,18 @@ void SearchHandler_c::RunLocalSearches()
 			tMultiArgs.m_iTotalDocs = m_iTotalDocs;
 		}
 
+		// result sets are shared by all the indexes in non-multi-queue case, so account the deltas
+		QueryMetrics_t & tMetrics = m_dQueryIndexStats[iLocal].m_tMetrics;
+		QueryMetrics_t tMetricsBefore;
+		int64_t tmIndexCpu = sphCpuTimer();
+
 		bool bResult = false;
 		if ( m_bMultiQueue )
 		{
 			tStats.m_tIOStats.Start();
 			bResult = pServed->m_pIndex->MultiQuery ( &m_dQueries[m_iStart], &tStats, dSorters.GetLength(), dSorters.Begin(), tMultiArgs );
 			tStats.m_tIOStats.Stop();
+			AddResultMetrics ( tMetrics, tStats );
 		} else
 		{
 			CSphVector<CSphQueryResult*> dResults ( m_dResults.GetLength() );
@@ -7372,10 +7622,22 @@ void SearchHandler_c::RunLocalSearches()
 				dResults[i]->m_pStrings = nullptr;
 			}
 
+			for ( int iQuery=m_iStart; iQuery<=m_iEnd; ++iQuery )
+				AddResultMetrics ( tMetricsBefore, m_dResults[iQuery] );
+
 			dResults[m_iStart]->m_tIOStats.Start();
 			bResult = pServed->m_pIndex->MultiQueryEx ( dSorters.GetLength(), &m_dQueries[m_iStart], &dResults[m_iStart], &dSorters[0], tMultiArgs );
 			dResults[m_iStart]->m_tIOStats.Stop();
+
+			for ( int iQuery=m_iStart; iQuery<=m_iEnd; ++iQuery )
+				AddResultMetrics ( tMetrics, m_dResults[iQuery] );
+			tMetrics.m_iReadBytes -= tMetricsBefore.m_iReadBytes;
+			tMetrics.m_iReadOps -= tMetricsBefore.m_iReadOps;
+			tMetrics.m_iFetchedDocs -= tMetricsBefore.m_iFetchedDocs;
+			tMetrics.m_iFetchedHits -= tMetricsBefore.m_iFetchedHits;
+			tMetrics.m_iFiltered -= tMetricsBefore.m_iFiltered;
 		}
+		tMetrics.m_iCpuTime += sphCpuTimer() - tmIndexCpu;
 
 		// handle results
 		if ( !bResult )
@@ -7432,6 +7694,7 @@ void SearchHandler_c::RunLocalSearches()
 				m_dQueryIndexStats[iLocal].m_dStats[iQuery-m_iStart].m_iSuccesses = 1;
 				m_dQueryIndexStats[iLocal].m_dStats[iQuery-m_iStart].m_uQueryTime = iQTimeForStats;
 				m_dQueryIndexStats[iLocal].m_dStats[iQuery-m_iStart].m_uFoundRows = pSorter->GetTotalCount();
+				tMetrics.m_iEvicted += GetEvictedMatches ( pSorter );
 
 				// extract matches from sorter
 				FlattenToRes ( pSorter, tRes, iOrderTag+iQuery-m_iStart );
@@ -7492,6 +7755,182 @@ bool SearchHandler_c::AllowsMulti ( int iStart, int iEnd ) const
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// LOCAL DF TERM STATS CACHE
+/////////////////////////////////////////////////////////////////////////////
+
+/// docs (and hits) count of a term, or of a whole query, in one local index, as of given index instance and its changes count
+struct TermStatsEntry_t
+{
+	int64_t		m_iIndexId = 0;
+	int64_t		m_iChanges = 0;
+	int64_t		m_tmAdded = 0;
+	int64_t		m_iDocs = 0;
+	int64_t		m_iHits = 0;
+};
+
+/// per-index term docs counts shared by all the local_df queries, so that repeated terms skip dictionary lookups in every local index
+/// also keeps per-query totals for the admission control cost prediction
+/// entries go stale once their index gets rotated; RT ones also once the index got changed and the entry is older than ttl
+class TermStatsCache_c : public CacheCounters_c
+{
+public:
+	void		Setup ( int64_t iMaxBytes, int iTtlSec );
+	bool		Get ( const CSphString & sKey, const CSphIndex * pIndex, int64_t & iDocs, int64_t & iHits );
+	void		Add ( const CSphString & sKey, const CSphIndex * pIndex, int64_t iDocs, int64_t iHits );
+
+private:
+	static const int	HASH_LENGTH = 16384;
+
+	mutable CSphMutex									m_tLock;
+	SmallStringHash_T<TermStatsEntry_t, HASH_LENGTH>	m_hEntries;	///< also keeps insertion order, for eviction
+	int64_t				m_iTtl = 0;		///< in usec
+	int64_t				m_iBytes = 0;
+
+	static int64_t		GetEntryBytes ( const CSphString & sKey ) { return sizeof(TermStatsEntry_t) + sKey.Length() + 3*sizeof(void*); }
+};
+
+static TermStatsCache_c g_tTermStatsCache;
+
+
+void TermStatsCache_c::Setup ( int64_t iMaxBytes, int iTtlSec )
+{
+	ScopedMutex_t tLock ( m_tLock );
+	SetMaxBytes ( iMaxBytes );
+	m_iTtl = int64_t ( Max ( iTtlSec, 0 ) ) * 1000000;
+	m_hEntries.Reset();
+	SubBytes ( m_iBytes );
+	m_iBytes = 0;
+}
+
+
+bool TermStatsCache_c::Get ( const CSphString & sKey, const CSphIndex * pIndex, int64_t & iDocs, int64_t & iHits )
+{
+	ScopedMutex_t tLock ( m_tLock );
+	const TermStatsEntry_t * pEntry = m_hEntries ( sKey );
+	bool bFresh = pEntry && pEntry->m_iIndexId==pIndex->GetIndexId()
+		&& ( pEntry->m_iChanges==pIndex->m_iChanges || sphMicroTimer()-pEntry->m_tmAdded<m_iTtl );
+
+	if ( !bFresh )
+	{
+		Miss();
+		return false;
+	}
+
+	Hit();
+	iDocs = pEntry->m_iDocs;
+	iHits = pEntry->m_iHits;
+	return true;
+}
+
+
+void TermStatsCache_c::Add ( const CSphString & sKey, const CSphIndex * pIndex, int64_t iDocs, int64_t iHits )
+{
+	TermStatsEntry_t tEntry;
+	tEntry.m_iIndexId = pIndex->GetIndexId();
+	tEntry.m_iChanges = pIndex->m_iChanges;
+	tEntry.m_tmAdded = sphMicroTimer();
+	tEntry.m_iDocs = iDocs;
+	tEntry.m_iHits = iHits;
+
+	ScopedMutex_t tLock ( m_tLock );
+	TermStatsEntry_t * pEntry = m_hEntries ( sKey );
+	if ( pEntry )
+	{
+		// refresh stale entry in place
+		*pEntry = tEntry;
+		return;
+	}
+
+	int64_t iBytes = GetEntryBytes ( sKey );
+	while ( m_iBytes+iBytes>GetMaxBytes() && m_hEntries.GetLength() )
+	{
+		// evict oldest
+		m_hEntries.IterateStart();
+		m_hEntries.IterateNext();
+		CSphString sOldest = m_hEntries.IterateGetKey();
+		m_iBytes -= GetEntryBytes ( sOldest );
+		SubBytes ( GetEntryBytes ( sOldest ) );
+		m_hEntries.Delete ( sOldest );
+	}
+
+	if ( m_iBytes+iBytes>GetMaxBytes() )
+		return;
+
+	m_hEntries.Add ( tEntry, sKey );
+	m_iBytes += iBytes;
+	AddBytes ( iBytes );
+}
+
+
+/// fill keywords docs from term stats cache, and look up only the missing ones in the index
+/// wildcard expansions of a tokenizing pass already come with their docs, and can not be looked up by their tokenized form anyway
+static void FillCachedKeywords ( const CSphString & sIndex, const CSphIndex * pIndex, CSphVector<CSphKeywordInfo> & dKeywords, bool bSkipExpanded )
+{
+	CSphString sKey;
+	int64_t iDocs, iHits;
+	CSphVector<CSphKeywordInfo> dMissing;
+	CSphVector<int> dMissingIdx;
+	ARRAY_FOREACH ( i, dKeywords )
+	{
+		CSphKeywordInfo & tKw = dKeywords[i];
+		if ( bSkipExpanded && sphHasExpandableWildcards ( tKw.m_sTokenized.cstr() ) )
+			continue;
+
+		sKey.SetSprintf ( "%s %s", sIndex.cstr(), tKw.m_sNormalized.cstr() );
+		if ( g_tTermStatsCache.Get ( sKey, pIndex, iDocs, iHits ) )
+		{
+			tKw.m_iDocs = (int)iDocs;
+			tKw.m_iHits = (int)iHits;
+			continue;
+		}
+
+		dMissing.Add ( tKw );
+		dMissing.Last().m_iDocs = 0;
+		dMissing.Last().m_iHits = 0;
+		dMissingIdx.Add ( i );
+	}
+
+	if ( !dMissing.GetLength() )
+		return;
+
+	pIndex->FillKeywords ( dMissing );
+	ARRAY_FOREACH ( i, dMissing )
+	{
+		const CSphKeywordInfo & tKw = dMissing[i];
+		dKeywords[dMissingIdx[i]].m_iDocs = tKw.m_iDocs;
+		dKeywords[dMissingIdx[i]].m_iHits = tKw.m_iHits;
+
+		sKey.SetSprintf ( "%s %s", sIndex.cstr(), tKw.m_sNormalized.cstr() );
+		g_tTermStatsCache.Add ( sKey, pIndex, tKw.m_iDocs, tKw.m_iHits );
+	}
+}
+
+
+/// custom uniq - got rid of word duplicates
+static void UniqKeywords ( CSphVector<CSphKeywordInfo> & dKeywords )
+{
+	// FIXME!!! move duplicate removal to GetKeywords to do less QWord setup and dict searching
+	dKeywords.Sort ( bind ( &CSphKeywordInfo::m_sNormalized ) );
+	if ( dKeywords.GetLength()<=1 )
+		return;
+
+	int iSrc = 1, iDst = 1;
+	while ( iSrc<dKeywords.GetLength() )
+	{
+		if ( dKeywords[iDst-1].m_sNormalized==dKeywords[iSrc].m_sNormalized )
+			iSrc++;
+		else
+		{
+			Swap ( dKeywords[iDst], dKeywords[iSrc] );
+			iDst++;
+			iSrc++;
+		}
+	}
+	dKeywords.Resize ( iDst );
+}
+
+
 struct IndexSettings_t
 {
 	uint64_t	m_uHash;
@@ -7570,6 +8009,7 @@ void SearchHandler_c::SetupLocalDF ( int iStart, int iEnd )
 
 	// gather per-term docs count
 	CSphVector < CSphKeywordInfo > dKeywords;
+	const bool bCache = g_tTermStatsCache.IsEnabled();
 	ARRAY_FOREACH ( i, dLocal )
 	{
 		int iLocalIndex = dLocal[i].m_iLocal;
@@ -7578,40 +8018,29 @@ void SearchHandler_c::SetupLocalDF ( int iStart, int iEnd )
 			continue;
 
 		m_iTotalDocs += pIndex->m_pIndex->GetStats().m_iTotalDocuments;
+		const CSphString & sIndex = m_dLocal[iLocalIndex].m_sName;
 
 		if ( i && dLocal[i].m_uHash==dLocal[i-1].m_uHash )
 		{
-			ARRAY_FOREACH ( kw, dKeywords )
-				dKeywords[kw].m_iDocs = 0;
-
 			// no need to tokenize query just fill docs count
-			pIndex->m_pIndex->FillKeywords ( dKeywords );
+			if ( bCache )
+				FillCachedKeywords ( sIndex, pIndex->m_pIndex, dKeywords, false );
+			else
+			{
+				ARRAY_FOREACH ( kw, dKeywords )
+					dKeywords[kw].m_iDocs = 0;
+				pIndex->m_pIndex->FillKeywords ( dKeywords );
+			}
 		} else
 		{
+			// with term stats cache, only tokenize the query, and look up the dictionary for the terms missing in the cache
 			GetKeywordsSettings_t tSettings;
-			tSettings.m_bStats = true;
+			tSettings.m_bStats = !bCache;
 			dKeywords.Resize ( 0 );
 			pIndex->m_pIndex->GetKeywords ( dKeywords, dQuery.Begin(), tSettings, NULL );
-
-			// FIXME!!! move duplicate removal to GetKeywords to do less QWord setup and dict searching
-			// custom uniq - got rid of word duplicates
-			dKeywords.Sort ( bind ( &CSphKeywordInfo::m_sNormalized ) );
-			if ( dKeywords.GetLength()>1 )
-			{
-				int iSrc = 1, iDst = 1;
-				while ( iSrc<dKeywords.GetLength() )
-				{
-					if ( dKeywords[iDst-1].m_sNormalized==dKeywords[iSrc].m_sNormalized )
-						iSrc++;
-					else
-					{
-						Swap ( dKeywords[iDst], dKeywords[iSrc] );
-						iDst++;
-						iSrc++;
-					}
-				}
-				dKeywords.Resize ( iDst );
-			}
+			UniqKeywords ( dKeywords );
+			if ( bCache )
+				FillCachedKeywords ( sIndex, pIndex->m_pIndex, dKeywords, true );
 		}
 
 		ARRAY_FOREACH ( j, dKeywords )
@@ -7629,20 +8058,452 @@ void SearchHandler_c::SetupLocalDF ( int iStart, int iEnd )
 }
 
 
-static int GetIndexWeight ( const CSphString& sName, const CSphVector<CSphNamedInt> & dIndexWeights, int iDefaultWeight )
-{
-	for ( auto& dWeight : dIndexWeights )
-		if ( dWeight.m_sName==sName )
-			return dWeight.m_iValue;
-
-	// distributed index adds {'*', weight} to all agents in case it got custom weight
-	if ( dIndexWeights.GetLength() && dIndexWeights.Last().m_sName=="*" )
-		return dIndexWeights[0].m_iValue;
+//////////////////////////////////////////////////////////////////////////
+// ADMISSION CONTROL
+//////////////////////////////////////////////////////////////////////////
 
-	return iDefaultWeight;
-}
+struct AdmissionSettings_t
+{
+	int			m_iMaxExpensive = 0;	///< max expensive queries running at once; 0 means no limit
+	int			m_iExpensiveMsec = 0;	///< predicted time that makes query expensive; 0 means no cost prediction
+	int			m_iRejectMsec = 0;		///< predicted time that makes query rejected right away; 0 means never
+	int			m_iMaxPerClient = 0;	///< max queries running at once from one client address; 0 means no limit
+	int			m_iMaxPerIndex = 0;		///< max queries running at once against one local index; 0 means no limit
+	int			m_iWaitMsec = 1000;		///< how long query waits for a free slot before being rejected
+};
 
-static uint64_t CalculateMass ( const CSphIndexStatus & dStats )
+/// slots one query subset asks for
+struct AdmissionTicket_t
+{
+	CSphString		m_sClient;
+	StrVec_t		m_dIndexes;
+	bool			m_bExpensive = false;
+	bool			m_bGranted = false;
+	CSphAutoEvent	m_tGranted;
+};
+
+/// per-client, per-index and expensive lane concurrency budgets in front of the local searches
+/// waiting queries get the freed slots in arrival order, skipping the ones whose budgets are still exhausted,
+/// so that a busy client or index does not hold back the others
+class AdmissionControl_c : public ISphNoncopyable
+{
+public:
+	void		Setup ( const AdmissionSettings_t & tSettings ) { m_tSettings = tSettings; }
+	bool		IsEnabled () const { return m_tSettings.m_iMaxPerClient>0 || m_tSettings.m_iMaxPerIndex>0 || NeedCost(); }
+	bool		NeedCost () const { return ( m_tSettings.m_iMaxExpensive>0 && m_tSettings.m_iExpensiveMsec>0 ) || m_tSettings.m_iRejectMsec>0; }
+	const AdmissionSettings_t & GetSettings () const { return m_tSettings; }
+
+	bool		Acquire ( AdmissionTicket_t & tTicket );	///< false if no slot got free within wait timeout
+	void		Release ( AdmissionTicket_t & tTicket );
+	void		CountRejected ();
+	void		GetStatus ( int & iQueued, int64_t & iWaited, int64_t & iRejected ) const;
+
+private:
+	AdmissionSettings_t					m_tSettings;
+
+	mutable CSphMutex					m_tLock;
+	SmallStringHash_T<int>				m_hClients;
+	SmallStringHash_T<int>				m_hIndexes;
+	int									m_iExpensive = 0;
+	CSphVector<AdmissionTicket_t *>		m_dQueue;
+	int64_t								m_iWaited = 0;
+	int64_t								m_iRejected = 0;
+
+	bool		Fits ( const AdmissionTicket_t & tTicket ) const;
+	void		Take ( AdmissionTicket_t & tTicket );
+	static void	Dec ( SmallStringHash_T<int> & hCounts, const CSphString & sKey );
+};
+
+static AdmissionControl_c g_tAdmission;
+
+
+/// client address without port, to share budgets between the connections of one client
+static CSphString GetClientAddress ( const ThdDesc_t & tThd )
+{
+	const char * sClient = tThd.m_sClientName.cstr();
+	const char * sPort = strchr ( sClient, ':' );
+
+	// length as size_t, so that the compiler does not see a negative memcpy bound in SetBinary
+	size_t uLen = sPort ? size_t ( sPort-sClient ) : strlen ( sClient );
+	CSphString sAddress;
+	if ( uLen && uLen<=INT_MAX )
+		sAddress.SetBinary ( sClient, (int)uLen );
+	return sAddress;
+}
+
+
+bool AdmissionControl_c::Fits ( const AdmissionTicket_t & tTicket ) const
+{
+	if ( tTicket.m_bExpensive && m_tSettings.m_iMaxExpensive>0 && m_iExpensive>=m_tSettings.m_iMaxExpensive )
+		return false;
+
+	if ( m_tSettings.m_iMaxPerClient>0 )
+	{
+		const int * pRunning = m_hClients ( tTicket.m_sClient );
+		if ( pRunning && *pRunning>=m_tSettings.m_iMaxPerClient )
+			return false;
+	}
+
+	if ( m_tSettings.m_iMaxPerIndex>0 )
+		for ( const auto & sIndex : tTicket.m_dIndexes )
+		{
+			const int * pRunning = m_hIndexes ( sIndex );
+			if ( pRunning && *pRunning>=m_tSettings.m_iMaxPerIndex )
+				return false;
+		}
+
+	return true;
+}
+
+
+void AdmissionControl_c::Take ( AdmissionTicket_t & tTicket )
+{
+	if ( tTicket.m_bExpensive )
+		++m_iExpensive;
+
+	int * pRunning = m_hClients ( tTicket.m_sClient );
+	if ( pRunning )
+		++*pRunning;
+	else
+		m_hClients.Add ( 1, tTicket.m_sClient );
+
+	for ( const auto & sIndex : tTicket.m_dIndexes )
+	{
+		pRunning = m_hIndexes ( sIndex );
+		if ( pRunning )
+			++*pRunning;
+		else
+			m_hIndexes.Add ( 1, sIndex );
+	}
+
+	tTicket.m_bGranted = true;
+}
+
+
+void AdmissionControl_c::Dec ( SmallStringHash_T<int> & hCounts, const CSphString & sKey )
+{
+	int * pRunning = hCounts ( sKey );
+	if ( !pRunning )
+		return;
+
+	if ( --*pRunning<=0 )
+		hCounts.Delete ( sKey );
+}
+
+
+bool AdmissionControl_c::Acquire ( AdmissionTicket_t & tTicket )
+{
+	{
+		ScopedMutex_t tLock ( m_tLock );
+		// Release() hands the freed slots over right away, so whoever still waits does not fit
+		// and a fitting newcomer does not take anything from them
+		if ( Fits ( tTicket ) )
+		{
+			Take ( tTicket );
+			return true;
+		}
+
+		m_dQueue.Add ( &tTicket );
+		++m_iWaited;
+	}
+
+	if ( tTicket.m_tGranted.WaitEvent ( m_tSettings.m_iWaitMsec ) )
+		return true;
+
+	// timed out; but the slot might have been granted right after that
+	ScopedMutex_t tLock ( m_tLock );
+	if ( tTicket.m_bGranted )
+		return true;
+
+	m_dQueue.RemoveValue ( &tTicket );
+	++m_iRejected;
+	return false;
+}
+
+
+void AdmissionControl_c::Release ( AdmissionTicket_t & tTicket )
+{
+	if ( !tTicket.m_bGranted )
+		return;
+
+	ScopedMutex_t tLock ( m_tLock );
+	if ( tTicket.m_bExpensive )
+		--m_iExpensive;
+	Dec ( m_hClients, tTicket.m_sClient );
+	for ( const auto & sIndex : tTicket.m_dIndexes )
+		Dec ( m_hIndexes, sIndex );
+	tTicket.m_bGranted = false;
+
+	// hand the freed slots over to the waiting queries, oldest first
+	for ( int i=0; i<m_dQueue.GetLength(); )
+	{
+		AdmissionTicket_t * pWaiting = m_dQueue[i];
+		if ( !Fits ( *pWaiting ) )
+		{
+			++i;
+			continue;
+		}
+
+		Take ( *pWaiting );
+		m_dQueue.Remove ( i );
+		pWaiting->m_tGranted.SetEvent();
+	}
+}
+
+
+void AdmissionControl_c::CountRejected ()
+{
+	ScopedMutex_t tLock ( m_tLock );
+	++m_iRejected;
+}
+
+
+void AdmissionControl_c::GetStatus ( int & iQueued, int64_t & iWaited, int64_t & iRejected ) const
+{
+	ScopedMutex_t tLock ( m_tLock );
+	iQueued = m_dQueue.GetLength();
+	iWaited = m_iWaited;
+	iRejected = m_iRejected;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// QUERY LIMITS
+//////////////////////////////////////////////////////////////////////////
+
+/// memory of all the running queries of one client, for max_client_memory
+struct ClientMemory_t : public QueryControl_c
+{
+	int		m_iQueries = 0;
+};
+
+static CSphMutex						g_tClientMemoryLock;
+static SmallStringHash_T<ClientMemory_t *>	g_hClientMemory;
+
+
+static QueryControl_c * AcquireClientMemory ( const CSphString & sClient )
+{
+	ScopedMutex_t tLock ( g_tClientMemoryLock );
+	ClientMemory_t ** ppClient = g_hClientMemory ( sClient );
+	ClientMemory_t * pClient = ppClient ? *ppClient : nullptr;
+	if ( !pClient )
+	{
+		pClient = new ClientMemory_t;
+		pClient->m_iMaxMemory = g_iMaxClientMemory;
+		g_hClientMemory.Add ( pClient, sClient );
+	}
+
+	++pClient->m_iQueries;
+	return pClient;
+}
+
+
+static void ReleaseClientMemory ( const CSphString & sClient )
+{
+	ScopedMutex_t tLock ( g_tClientMemoryLock );
+	ClientMemory_t ** ppClient = g_hClientMemory ( sClient );
+	if ( !ppClient || --(*ppClient)->m_iQueries>0 )
+		return;
+
+	SafeDelete ( *ppClient );
+	g_hClientMemory.Delete ( sClient );
+}
+
+
+/// query control of a query subset run on behalf of a client connection
+/// registers itself with the thread for KILL, and stops the query once the client hangs up
+class ClientQueryControl_c : public QueryControl_c
+{
+public:
+	ClientQueryControl_c ( const ThdDesc_t & tThd, const CSphQuery & tQuery )
+		: m_tThd ( tThd )
+		, m_iSock ( tThd.m_iClientSock )
+	{
+		m_iMaxMemory = GetLimit ( tQuery.m_iMaxQueryMemory, g_iMaxQueryMemory );
+		m_iMaxCpuTime = GetLimit ( tQuery.m_iMaxQueryCpuMsec, g_iMaxQueryCpuMsec )*1000;
+
+		if ( g_iMaxClientMemory>0 )
+		{
+			m_sClient = GetClientAddress ( tThd );
+			m_pShared = AcquireClientMemory ( m_sClient );
+		}
+
+		m_tThd.SetQueryControl ( this );
+	}
+
+	~ClientQueryControl_c () override
+	{
+		m_tThd.SetQueryControl ( nullptr );
+
+		if ( m_pShared )
+		{
+			TrackMemory ( -GetMemory() );
+			ReleaseClientMemory ( m_sClient );
+		}
+	}
+
+	bool IsClientGone () override
+	{
+#if USE_WINDOWS
+		return false;
+#else
+		if ( m_iSock<=0 )
+			return false;
+
+		// zero bytes might be a mere half-close (SHUT_WR) by a client that still waits for the reply
+		// so only reset or other socket error means nobody listens; pipelined data, if any, stays in the socket
+		char cByte;
+		int iRes = recv ( m_iSock, &cByte, 1, MSG_PEEK | MSG_DONTWAIT );
+		if ( iRes>=0 )
+			return false;
+
+		int iErr = sphSockPeekErrno();
+		return iErr!=EINTR && iErr!=EAGAIN && iErr!=EWOULDBLOCK;
+#endif
+	}
+
+private:
+	const ThdDesc_t &	m_tThd;
+	int					m_iSock;
+	CSphString			m_sClient;
+
+	/// query asks for its own limit, daemon one is both the default and the cap
+	static int64_t GetLimit ( int64_t iQuery, int64_t iDaemon )
+	{
+		if ( iQuery<=0 )
+			return iDaemon;
+		return iDaemon>0 ? Min ( iQuery, iDaemon ) : iQuery;
+	}
+};
+
+
+/// docs and hits over all the query terms in one local index, for the cost prediction; cached in term stats cache
+/// docs and hits of the wildcard expansions are folded into their terms
+static void GetPredictorStats ( const CSphString & sIndex, const CSphIndex * pIndex, const CSphString & sQuery, int64_t & iDocs, int64_t & iHits )
+{
+	// whole query keys never clash with the term ones, as terms have no control chars
+	CSphString sKey;
+	const bool bCache = g_tTermStatsCache.IsEnabled();
+	if ( bCache )
+	{
+		sKey.SetSprintf ( "%s\x01%s", sIndex.cstr(), sQuery.cstr() );
+		if ( g_tTermStatsCache.Get ( sKey, pIndex, iDocs, iHits ) )
+			return;
+	}
+
+	GetKeywordsSettings_t tSettings;
+	tSettings.m_bStats = true;
+	tSettings.m_bFoldLemmas = true;
+	tSettings.m_bFoldBlended = true;
+	tSettings.m_bFoldWildcards = true;
+
+	CSphVector<CSphKeywordInfo> dKeywords;
+	pIndex->GetKeywords ( dKeywords, sQuery.cstr(), tSettings, nullptr );
+	iDocs = iHits = 0;
+	for ( const auto & tKw : dKeywords )
+	{
+		iDocs += tKw.m_iDocs;
+		iHits += tKw.m_iHits;
+	}
+
+	if ( bCache )
+		g_tTermStatsCache.Add ( sKey, pIndex, iDocs, iHits );
+}
+
+
+/// a-priori subset time over its local indexes, in msec; made from the dictionary stats and predicted_time_costs
+/// filters are not accounted for
+int64_t SearchHandler_c::PredictSubsetMsec ( int iStart, int iEnd ) const
+{
+	int64_t iNanoCost = 0;
+	for ( const auto & tLocal : m_dLocal )
+	{
+		const auto * pServed = m_dLocked.Get ( tLocal.m_sName );
+		if ( !pServed )
+			continue;
+
+		const CSphIndex * pIndex = pServed->m_pIndex;
+		const int64_t iTotalDocs = pIndex->GetStats().m_iTotalDocuments;
+
+		// batches (facets, for one) usually repeat the same full-text query
+		const CSphString * pLastQuery = nullptr;
+		int64_t iQueryDocs = 0, iQueryHits = 0;
+		for ( int iQuery=iStart; iQuery<=iEnd; ++iQuery )
+		{
+			const CSphQuery & tQuery = m_dQueries[iQuery];
+			int64_t iDocs = iTotalDocs;
+			int64_t iHits = 0;
+			if ( !tQuery.m_sQuery.IsEmpty() )
+			{
+				if ( !pLastQuery || *pLastQuery!=tQuery.m_sQuery )
+				{
+					GetPredictorStats ( tLocal.m_sName, pIndex, tQuery.m_sQuery, iQueryDocs, iQueryHits );
+					pLastQuery = &tQuery.m_sQuery;
+				}
+				iDocs = iQueryDocs;
+				iHits = iQueryHits;
+			}
+
+			// every doc of every term gets decoded, but no more than the whole index might match
+			int64_t iMatches = Min ( iDocs, iTotalDocs );
+			iNanoCost += g_iPredictorCostDoc*iDocs + g_iPredictorCostMatch*iMatches*( tQuery.m_sGroupBy.IsEmpty() ? 1 : 2 );
+			if ( tQuery.m_eRanker!=SPH_RANK_NONE )
+				iNanoCost += g_iPredictorCostHit*iHits;
+		}
+	}
+
+	return iNanoCost/1000000;
+}
+
+
+/// get the admission control slots for the subset; on reject, fills the errors in
+bool SearchHandler_c::AdmitSubset ( int iStart, int iEnd, AdmissionTicket_t & tTicket )
+{
+	const AdmissionSettings_t & tSettings = g_tAdmission.GetSettings();
+	int64_t iPredictedMsec = 0;
+	if ( g_tAdmission.NeedCost() && !m_dLocal.IsEmpty() )
+		iPredictedMsec = PredictSubsetMsec ( iStart, iEnd );
+
+	CSphString sError;
+	if ( tSettings.m_iRejectMsec>0 && iPredictedMsec>tSettings.m_iRejectMsec )
+	{
+		g_tAdmission.CountRejected();
+		sError.SetSprintf ( "query rejected by admission control: predicted time %d msec exceeds reject_query_msec=%d",
+			(int)iPredictedMsec, tSettings.m_iRejectMsec );
+	} else
+	{
+		tTicket.m_sClient = GetClientAddress ( m_tThd );
+		for ( const auto & tLocal : m_dLocal )
+			tTicket.m_dIndexes.Add ( tLocal.m_sName );
+		tTicket.m_bExpensive = ( tSettings.m_iExpensiveMsec>0 && iPredictedMsec>=tSettings.m_iExpensiveMsec );
+
+		if ( g_tAdmission.Acquire ( tTicket ) )
+			return true;
+
+		sError.SetSprintf ( "query rejected by admission control: no free slot within %d msec (predicted time %d msec)",
+			tSettings.m_iWaitMsec, (int)iPredictedMsec );
+	}
+
+	for ( int iRes=iStart; iRes<=iEnd; ++iRes )
+		m_dResults[iRes].m_sError = sError;
+	return false;
+}
+
+
+static int GetIndexWeight ( const CSphString& sName, const CSphVector<CSphNamedInt> & dIndexWeights, int iDefaultWeight )
+{
+	for ( auto& dWeight : dIndexWeights )
+		if ( dWeight.m_sName==sName )
+			return dWeight.m_iValue;
+
+	// distributed index adds {'*', weight} to all agents in case it got custom weight
+	if ( dIndexWeights.GetLength() && dIndexWeights.Last().m_sName=="*" )
+		return dIndexWeights[0].m_iValue;
+
+	return iDefaultWeight;
+}
+
+static uint64_t CalculateMass ( const CSphIndexStatus & dStats )
 {
 	return dStats.m_iNumChunks * 1000000 + dStats.m_iRamUse + dStats.m_iDiskUse * 10;
 }
@@ -7915,6 +8776,16 @@ void SearchHandler_c::RunSubset ( int iStart, int iEnd )
 		return;
 	}
 
+	// admission control; the slots are held until the subset is done, agents included
+	AdmissionTicket_t tTicket;
+	if ( g_tAdmission.IsEnabled() && !AdmitSubset ( iStart, iEnd, tTicket ) )
+		return;
+	auto tReleaseTicket = AtScopeExit ( [&tTicket] { g_tAdmission.Release ( tTicket ); } );
+
+	// per-query limits and cancellation, polled by the local searches
+	ClientQueryControl_c tControl ( m_tThd, tFirst );
+	QueryControlScope_c tControlScope ( &tControl );
+
 	m_dQueryIndexStats.Resize ( m_dLocal.GetLength () );
 
 	for ( int iRes=iStart; iRes<=iEnd; ++iRes )
@@ -8097,6 +8968,24 @@ void SearchHandler_c::RunSubset ( int iStart, int iEnd )
 		}
 	}
 
+	// matches collected from local indexes and agents are now on the query too
+	for ( int iRes=iStart; iRes<=iEnd; ++iRes )
+	{
+		const AggrResult_t & tRes = m_dResults[iRes];
+		tControl.TrackMemory ( int64_t ( tRes.m_dMatches.GetLimit() ) * ( sizeof(CSphMatch) + tRes.m_tSchema.GetRowSize()*sizeof(CSphRowitem) ) );
+	}
+
+	// query got killed, its client is gone, or it went over its limits
+	if ( tControl.IsStopped() )
+	{
+		for ( int iRes=iStart; iRes<=iEnd; ++iRes )
+		{
+			m_dResults[iRes].m_sError = tControl.GetStopMessage();
+			m_dResults[iRes].m_iSuccesses = 0;
+		}
+		return;
+	}
+
 	/////////////////////
 	// merge all results
 	/////////////////////
@@ -8308,20 +9197,30 @@ void SearchHandler_c::RunSubset ( int iStart, int iEnd )
 				}
 			}
 		}
+
+		QueryMetrics_t & tMetrics = m_dQueryIndexStats[iLocal].m_tMetrics;
+		pServed->AddQueryMetrics ( tMetrics );
+		for ( auto &tDistr : dDistrServedByAgent )
+			if ( tDistr.m_dLocalNames.Contains ( m_dLocal[iLocal].m_sName ) )
+				tDistr.m_tMetrics.Add ( tMetrics );
+		tMetrics = QueryMetrics_t();
 	}
 
 	for ( auto &tDistr : dDistrServedByAgent )
 	{
 		auto pServedDistIndex = GetDistr ( tDistr.m_sIndex );
-		if ( pServedDistIndex )
-			for ( int iQuery=iStart; iQuery<=iEnd; ++iQuery )
-			{
-				auto & tStat = tDistr.m_dStats[iQuery-iStart];
-				if ( !tStat.m_iSuccesses )
-					continue;
+		if ( !pServedDistIndex )
+			continue;
 
-				pServedDistIndex->AddQueryStat ( tStat.m_uFoundRows, tStat.m_uQueryTime );
-			}
+		for ( int iQuery=iStart; iQuery<=iEnd; ++iQuery )
+		{
+			auto & tStat = tDistr.m_dStats[iQuery-iStart];
+			if ( !tStat.m_iSuccesses )
+				continue;
+
+			pServedDistIndex->AddQueryStat ( tStat.m_uFoundRows, tStat.m_uQueryTime );
+		}
+		pServedDistIndex->AddQueryMetrics ( tDistr.m_tMetrics );
 	}
 
 	g_tStats.m_iQueries += iQueries;
@@ -8619,7 +9518,7 @@ static const char * g_dSqlStmts[] =
 	"show_index_status", "show_profile", "alter_add", "alter_drop", "show_plan",
 	"select_dual", "show_databases", "create_plugin", "drop_plugin", "show_plugins", "show_threads",
 	"facet", "alter_reconfigure", "show_index_settings", "flush_index", "reload_plugins", "reload_index",
-	"flush_hostnames", "flush_logs", "reload_indexes", "sysfilters", "debug"
+	"flush_hostnames", "flush_logs", "reload_indexes", "sysfilters", "debug", "kill"
 };
 
 
@@ -9120,6 +10019,14 @@ bool SqlParser_c::AddOption ( const SqlNode_t & tIdent, const SqlNode_t & tValue
 	{
 		m_pQuery->m_uMaxQueryMsec = (int)tValue.m_iValue;
 
+	} else if ( sOpt=="max_query_memory" )
+	{
+		m_pQuery->m_iMaxQueryMemory = Max ( tValue.m_iValue, 0 );
+
+	} else if ( sOpt=="max_query_cpu_time" )
+	{
+		m_pQuery->m_iMaxQueryCpuMsec = Max ( (int)tValue.m_iValue, 0 );
+
 	} else if ( sOpt=="retry_count" )
 	{
 		m_pQuery->m_iRetryCount = (int)tValue.m_iValue;
@@ -11105,6 +12012,20 @@ static inline void FormatMsec ( CSphString & sOut, int64_t tmTime )
 	sOut.SetSprintf ( "%d.%03d", (int)( tmTime/1000000 ), (int)( (tmTime%1000000)/1000 ) );
 }
 
+static void BuildCacheStatus ( VectorLike & dStatus, const char * sCache, const CacheStatus_t & tCache )
+{
+	CSphString sName;
+	if ( dStatus.MatchAdd ( sName.SetSprintf ( "%s_max_bytes", sCache ).cstr() ) )
+		dStatus.Add().SetSprintf ( INT64_FMT, tCache.m_iMaxBytes );
+	if ( dStatus.MatchAdd ( sName.SetSprintf ( "%s_used_bytes", sCache ).cstr() ) )
+		dStatus.Add().SetSprintf ( INT64_FMT, tCache.m_iUsedBytes );
+	if ( dStatus.MatchAdd ( sName.SetSprintf ( "%s_hits", sCache ).cstr() ) )
+		dStatus.Add().SetSprintf ( INT64_FMT, tCache.m_iHits );
+	if ( dStatus.MatchAdd ( sName.SetSprintf ( "%s_misses", sCache ).cstr() ) )
+		dStatus.Add().SetSprintf ( INT64_FMT, tCache.m_iMisses );
+}
+
+
 void BuildStatus ( VectorLike & dStatus )
 {
 	const char * FMT64 = INT64_FMT;
@@ -11293,17 +12214,134 @@ void BuildStatus ( VectorLike & dStatus )
 		dStatus.Add().SetSprintf ( INT64_FMT, s.m_iUsedBytes );
 	if ( dStatus.MatchAdd ( "qcache_hits" ) )
 		dStatus.Add().SetSprintf ( INT64_FMT, s.m_iHits );
+	if ( dStatus.MatchAdd ( "qcache_in_flight" ) )
+		dStatus.Add().SetSprintf ( "%d", s.m_iInFlight );
+	if ( dStatus.MatchAdd ( "qcache_coalesced" ) )
+		dStatus.Add().SetSprintf ( INT64_FMT, s.m_iCoalesced );
+
+	BuildCacheStatus ( dStatus, "expansion_cache", sphGetExpansionCacheStatus() );
+	BuildCacheStatus ( dStatus, "morphology_cache", sphGetMorphologyCacheStatus() );
+	BuildCacheStatus ( dStatus, "doclist_cache", sphGetDoclistCacheStatus() );
+	BuildCacheStatus ( dStatus, "term_stats_cache", g_tTermStatsCache.GetStatus() );
+
+	int iAdmissionQueued;
+	int64_t iAdmissionWaited, iAdmissionRejected;
+	g_tAdmission.GetStatus ( iAdmissionQueued, iAdmissionWaited, iAdmissionRejected );
+	if ( dStatus.MatchAdd ( "admission_queued" ) )
+		dStatus.Add().SetSprintf ( "%d", iAdmissionQueued );
+	if ( dStatus.MatchAdd ( "admission_waited" ) )
+		dStatus.Add().SetSprintf ( INT64_FMT, iAdmissionWaited );
+	if ( dStatus.MatchAdd ( "admission_rejected" ) )
+		dStatus.Add().SetSprintf ( INT64_FMT, iAdmissionRejected );
+
+	if ( dStatus.MatchAdd ( "query_log_dropped_lines" ) )
+		dStatus.Add().SetSprintf ( INT64_FMT, g_tQueryLog.GetDropped() );
+}
+
+struct MetricsIndex_t
+{
+	CSphString				m_sLabels;
+	const ServedStats_c *	m_pStats = nullptr;
+	QueryMetrics_t			m_tMetrics;
+	uint64_t				m_uQueries = 0;
+	uint64_t				m_uFoundRows = 0;
+};
+
+static void MetricsHeader ( StringBuilder_c & sOut, const char * sName, const char * sType, const char * sHelp )
+{
+	sOut.Appendf ( "# HELP %s %s\n# TYPE %s %s\n", sName, sHelp, sName, sType );
 }
 
-void BuildOneAgentStatus ( VectorLike & dStatus, HostDashboard_t* pDash, const char * sPrefix="agent" )
+void BuildMetrics ( StringBuilder_c & sOut )
 {
-	assert ( pDash );
+	MetricsHeader ( sOut, "manticore_uptime_seconds", "gauge", "Seconds since the daemon started." );
+	sOut.Appendf ( "manticore_uptime_seconds %u\n", (DWORD)time(NULL)-g_tStats.m_uStarted );
+	MetricsHeader ( sOut, "manticore_connections_total", "counter", "Accepted client connections." );
+	sOut.Appendf ( "manticore_connections_total " INT64_FMT "\n", (int64_t) g_tStats.m_iConnections );
+	MetricsHeader ( sOut, "manticore_queries_total", "counter", "Search queries, including each query of a multi-query batch." );
+	sOut.Appendf ( "manticore_queries_total " INT64_FMT "\n", (int64_t) g_tStats.m_iQueries );
+	MetricsHeader ( sOut, "manticore_query_wall_seconds_total", "counter", "Wall time spent in search queries." );
+	sOut.Appendf ( "manticore_query_wall_seconds_total %.6f\n", g_tStats.m_iQueryTime/1000000.0 );
+	MetricsHeader ( sOut, "manticore_query_cpu_seconds_total", "counter", "CPU time spent in search queries." );
+	sOut.Appendf ( "manticore_query_cpu_seconds_total %.6f\n", g_tStats.m_iQueryCpuTime/1000000.0 );
+	MetricsHeader ( sOut, "manticore_disk_read_bytes_total", "counter", "Bytes read from index files by search queries." );
+	sOut.Appendf ( "manticore_disk_read_bytes_total " INT64_FMT "\n", (int64_t) g_tStats.m_iDiskReadBytes );
+	MetricsHeader ( sOut, "manticore_disk_reads_total", "counter", "Read calls issued against index files by search queries." );
+	sOut.Appendf ( "manticore_disk_reads_total " INT64_FMT "\n", (int64_t) g_tStats.m_iDiskReads );
 
-	const char * FMT64 = UINT64_FMT;
-	const char * FLOAT = "%.2f";
+	// snapshot per-index counters first, since every metric family must be contiguous
+	VecRefPtrs_t<ISphRefcountedMT *> dHold;
+	CSphVector<MetricsIndex_t> dIndexes;
+	for ( RLockedServedIt_c it ( g_pLocalIndexes ); it.Next(); )
+	{
+		ServedIndexRefPtr_c pServed = it.Get();
+		if ( !pServed )
+			continue;
+		MetricsIndex_t & tIndex = dIndexes.Add();
+		tIndex.m_sLabels.SetSprintf ( "index=\"%s\",type=\"local\"", it.GetName().cstr() );
+		tIndex.m_pStats = pServed;
+		pServed->GetQueryMetrics ( tIndex.m_tMetrics, tIndex.m_uQueries, tIndex.m_uFoundRows );
+		dHold.Add ( pServed.Leak() );
+	}
+	for ( RLockedDistrIt_c it ( g_pDistIndexes ); it.Next(); )
+	{
+		DistributedIndexRefPtr_t pDistr = it.Get();
+		if ( !pDistr )
+			continue;
+		MetricsIndex_t & tIndex = dIndexes.Add();
+		tIndex.m_sLabels.SetSprintf ( "index=\"%s\",type=\"distributed\"", it.GetName().cstr() );
+		tIndex.m_pStats = pDistr;
+		pDistr->GetQueryMetrics ( tIndex.m_tMetrics, tIndex.m_uQueries, tIndex.m_uFoundRows );
+		dHold.Add ( pDistr.Leak() );
+	}
 
+	auto fnIndexCounter = [&] ( const char * sName, const char * sHelp, std::function<int64_t ( const MetricsIndex_t & )> fnValue )
 	{
-		CSphScopedRLock tGuard ( pDash->m_dDataLock );
+		MetricsHeader ( sOut, sName, "counter", sHelp );
+		for ( const auto & tIndex : dIndexes )
+			sOut.Appendf ( "%s{%s} " INT64_FMT "\n", sName, tIndex.m_sLabels.cstr(), fnValue ( tIndex ) );
+	};
+
+	fnIndexCounter ( "manticore_index_queries_total", "Queries served by the index.", [] ( const MetricsIndex_t & t ) { return (int64_t)t.m_uQueries; } );
+	fnIndexCounter ( "manticore_index_found_rows_total", "Matches found by the index, before limits.", [] ( const MetricsIndex_t & t ) { return (int64_t)t.m_uFoundRows; } );
+	fnIndexCounter ( "manticore_index_cpu_microseconds_total", "Thread CPU time spent searching the index.", [] ( const MetricsIndex_t & t ) { return t.m_tMetrics.m_iCpuTime; } );
+	fnIndexCounter ( "manticore_index_read_bytes_total", "Bytes read from the index files.", [] ( const MetricsIndex_t & t ) { return t.m_tMetrics.m_iReadBytes; } );
+	fnIndexCounter ( "manticore_index_reads_total", "Read calls issued against the index files.", [] ( const MetricsIndex_t & t ) { return t.m_tMetrics.m_iReadOps; } );
+	fnIndexCounter ( "manticore_index_fetched_docs_total", "Documents decoded from doclists, or scanned by full-scan.", [] ( const MetricsIndex_t & t ) { return t.m_tMetrics.m_iFetchedDocs; } );
+	fnIndexCounter ( "manticore_index_fetched_hits_total", "Hits decoded from hitlists.", [] ( const MetricsIndex_t & t ) { return t.m_tMetrics.m_iFetchedHits; } );
+	fnIndexCounter ( "manticore_index_filtered_matches_total", "Matches rejected by attribute filters.", [] ( const MetricsIndex_t & t ) { return t.m_tMetrics.m_iFiltered; } );
+	fnIndexCounter ( "manticore_index_evicted_matches_total", "Matches accepted by sorters but evicted from the top-N.", [] ( const MetricsIndex_t & t ) { return t.m_tMetrics.m_iEvicted; } );
+
+	MetricsHeader ( sOut, "manticore_index_query_duration_seconds", "histogram", "Per-index query wall time." );
+	for ( const auto & tIndex : dIndexes )
+		tIndex.m_pStats->GetQueryHistogram().Format ( sOut, "manticore_index_query_duration_seconds", tIndex.m_sLabels.cstr() );
+
+	// per-agent counters live in host dashboards
+	VecRefPtrs_t<HostDashboard_t *> dDashes;
+	g_tDashes.GetActiveDashes ( dDashes );
+	CSphVector<CSphString> dAgentLabels;
+	for ( const auto * pDash : dDashes )
+		dAgentLabels.Add().SetSprintf ( "agent=\"%s\"", pDash->m_tHost.GetMyUrl().cstr() );
+
+	MetricsHeader ( sOut, "manticore_agent_events_total", "counter", "Remote agent query outcomes, by kind." );
+	ARRAY_FOREACH ( i, dDashes )
+		for ( int k=0; k<eMaxAgentStat; ++k )
+			sOut.Appendf ( "manticore_agent_events_total{%s,event=\"%s\"} " INT64_FMT "\n", dAgentLabels[i].cstr(), sAgentStatsNames[k], (int64_t) dDashes[i]->m_dTotalCounters[k] );
+
+	MetricsHeader ( sOut, "manticore_agent_query_duration_seconds", "histogram", "Remote agent query wall time, from connect to reply." );
+	ARRAY_FOREACH ( i, dDashes )
+		dDashes[i]->m_tLatency.Format ( sOut, "manticore_agent_query_duration_seconds", dAgentLabels[i].cstr() );
+}
+
+void BuildOneAgentStatus ( VectorLike & dStatus, HostDashboard_t* pDash, const char * sPrefix="agent" )
+{
+	assert ( pDash );
+
+	const char * FMT64 = UINT64_FMT;
+	const char * FLOAT = "%.2f";
+
+	{
+		CSphScopedRLock tGuard ( pDash->m_dDataLock );
 		if ( dStatus.MatchAddVa ( "%s_hostname", sPrefix ) )
 			dStatus.Add().SetSprintf ( "%s", pDash->m_tHost.GetMyUrl().cstr() );
 
@@ -11636,6 +12674,7 @@ void HandleCommandSphinxql ( ISphOutputBuffer & tOut, WORD uVer, InputBuffer_c &
 void HandleCommandJson ( ISphOutputBuffer & tOut, WORD uVer, InputBuffer_c & tReq, ThdDesc_t & tThd );
 void StatCountCommand ( SearchdCommand_e eCmd );
 void HandleCommandUserVar ( ISphOutputBuffer & tOut, WORD uVer, InputBuffer_c & tReq );
+void HandleCommandInsert ( ISphOutputBuffer & tOut, WORD uVer, InputBuffer_c & tReq, bool bReplace );
 
 /// ping/pong exchange over API
 void HandleCommandPing ( ISphOutputBuffer & tOut, WORD uVer, InputBuffer_c & tReq )
@@ -11850,6 +12889,9 @@ bool LoopClientSphinx ( SearchdCommand_e eCommand, WORD uCommandVer, int iLength
 		case SEARCHD_COMMAND_JSON:		HandleCommandJson ( tOut, uCommandVer, tBuf, tThd ); break;
 		case SEARCHD_COMMAND_PING:		HandleCommandPing ( tOut, uCommandVer, tBuf ); break;
 		case SEARCHD_COMMAND_UVAR:		HandleCommandUserVar ( tOut, uCommandVer, tBuf ); break;
+		case SEARCHD_COMMAND_INSERT:	HandleCommandInsert ( tOut, uCommandVer, tBuf, false ); break;
+		case SEARCHD_COMMAND_REPLACE:	HandleCommandInsert ( tOut, uCommandVer, tBuf, true ); break;
+		case SEARCHD_COMMAND_MUX:		SendErrorReply ( tOut, "connection multiplexing is only available with workers=thread_pool" ); break;
 		default:						assert ( 0 && "INTERNAL ERROR: unhandled command" ); break;
 	}
 
@@ -12055,10 +13097,7 @@ class SqlRowBuffer_c : public ISphNoncopyable, public IDataTupleter
 public:
 
 	SqlRowBuffer_c ( BYTE * pPacketID, ISphOutputBuffer * pOut, int iCID, bool bAutoCommit )
-		: m_pBuf ( NULL )
-		, m_iLen ( 0 )
-		, m_iLimit ( sizeof ( m_dBuf ) )
-		, m_uPacketID ( *pPacketID )
+		: m_uPacketID ( *pPacketID )
 		, m_tOut ( *pOut )
 		, m_iSize ( 0 )
 		, m_iCID ( iCID )
@@ -12067,33 +13106,29 @@ public:
 
 	~SqlRowBuffer_c ()
 	{
-		SafeDeleteArray ( m_pBuf );
+		Reset();
 	}
 
+	// row is built right in the output buffer, after a placeholder for the packet header
 	char * Reserve ( int iLen )
 	{
-		int iNewSize = m_iLen+iLen;
-		if ( iNewSize<=m_iLimit )
-			return Get();
-
-		int iNewLimit = Max ( m_iLimit*2, iNewSize );
-		char * pBuf = new char [iNewLimit];
-		memcpy ( pBuf, m_pBuf ? m_pBuf : m_dBuf, m_iLen );
-		SafeDeleteArray ( m_pBuf );
-		m_pBuf = pBuf;
-		m_iLimit = iNewLimit;
+		StartRow();
+		int iNewSize = m_iRowStart + m_iLen + iLen;
+		if ( iNewSize>m_tOut.GetBufLength() )
+			m_tOut.ResizeBuf ( iNewSize );
 		return Get();
 	}
 
 	char * Get ()
 	{
-		return m_pBuf ? m_pBuf+m_iLen : m_dBuf+m_iLen;
+		return Off ( m_iLen );
 	}
 
 	char * Off ( int iOff )
 	{
-		assert ( iOff<m_iLimit );
-		return m_pBuf ? m_pBuf+iOff : m_dBuf+iOff;
+		StartRow();
+		assert ( m_iRowStart+iOff<=m_tOut.GetBufLength() );
+		return (char *)m_tOut.GetBufAt ( m_iRowStart+iOff );
 	}
 
 	int Length () const
@@ -12103,12 +13138,16 @@ public:
 
 	void IncPtr ( int iLen	)
 	{
-		assert ( m_iLen+iLen<=m_iLimit );
+		assert ( m_iRowStart>0 && m_iRowStart+m_iLen+iLen<=m_tOut.GetBufLength() );
 		m_iLen += iLen;
 	}
 
+	// drops the row being built
 	void Reset ()
 	{
+		if ( m_iRowStart>0 )
+			m_tOut.ResizeBuf ( m_iRowStart-4 );
+		m_iRowStart = 0;
 		m_iLen = 0;
 	}
 
@@ -12159,19 +13198,30 @@ public:
 	// sends collected data, then reset
 	void Commit()
 	{
-		m_tOut.SendLSBDword ( ((m_uPacketID++)<<24) + ( Length() ) );
-		m_tOut.SendBytes ( Off ( 0 ), Length() );
-		Reset();
+		StartRow();
+
+		// cut the reserved tail, then fill in the header
+		m_tOut.ResizeBuf ( m_iRowStart+m_iLen );
+		DWORD uHeader = ((m_uPacketID++)<<24) + ( Length() );
+		BYTE * pHeader = m_tOut.GetBufAt ( m_iRowStart-4 );
+		for ( int i=0; i<4; i++, uHeader >>= 8 )
+			pHeader[i] = (BYTE)( uHeader & 0xff );
+
+		m_iRowStart = 0;
+		m_iLen = 0;
+		m_tOut.FinishPacket();
 	}
 
 	// wrappers for popular packets
 	inline void Eof ( bool bMoreResults=false, int iWarns=0 )
 	{
+		Reset();
 		SendMysqlEofPacket ( m_tOut, m_uPacketID++, iWarns, bMoreResults, m_bAutoCommit );
 	}
 
 	inline void Error ( const char * sStmt, const char * sError, MysqlErrors_e iErr = MYSQL_ERR_PARSE_ERROR )
 	{
+		Reset();
 		SendMysqlErrorPacket ( m_tOut, m_uPacketID, sStmt, sError, m_iCID, iErr );
 	}
 
@@ -12189,6 +13239,7 @@ public:
 
 	inline void Ok ( int iAffectedRows=0, int iWarns=0, const char * sMessage=NULL, bool bMoreResults=false )
 	{
+		Reset();
 		SendMysqlOkPacket ( m_tOut, m_uPacketID, iAffectedRows, iWarns, sMessage, bMoreResults, m_bAutoCommit );
 		if ( bMoreResults )
 			m_uPacketID++;
@@ -12197,6 +13248,7 @@ public:
 	// Header of the table with defined num of columns
 	inline void HeadBegin ( int iColumns )
 	{
+		Reset();
 		m_tOut.SendLSBDword ( ((m_uPacketID++)<<24) + MysqlPackedLen ( iColumns ) );
 		m_tOut.SendMysqlInt ( iColumns );
 		m_iSize = iColumns;
@@ -12212,6 +13264,7 @@ public:
 	inline void HeadColumn ( const char * sName, MysqlColumnType_e uType=MYSQL_COL_STRING, WORD uFlags=0 )
 	{
 		assert ( m_iSize>0 && "you try to send more mysql columns than declared in InitHead" );
+		Reset();
 		SendMysqlFieldPacket ( m_tOut, m_uPacketID++, sName, uType, uFlags );
 		--m_iSize;
 	}
@@ -12250,10 +13303,16 @@ public:
 	}
 
 private:
-	char m_dBuf[4096];
-	char * m_pBuf;
-	int m_iLen;
-	int m_iLimit;
+	void StartRow ()
+	{
+		if ( m_iRowStart>0 )
+			return;
+		m_tOut.SendLSBDword ( 0 );
+		m_iRowStart = m_tOut.GetBufLength();
+	}
+
+	int					m_iRowStart = 0;	///< row data offset in the output buffer, 0 if no row is being built
+	int					m_iLen = 0;			///< row data length
 
 private:
 	BYTE &				m_uPacketID;
@@ -12860,6 +13919,43 @@ struct StringPtrTraits_t
 		}
 	}
 
+	// pack JSON text of string attribute iStr; pointer is set later by RemapJson(), as packed data may move
+	// empty text means NULL attribute
+	bool AddJson ( char * szJson, int iStr, CSphString & sError, CSphString & sWarning )
+	{
+		if ( !szJson || !*szJson )
+			return true;
+
+		// sphJsonParse must be terminated with a double zero
+		if ( !String2JsonPack ( szJson, m_dParserBuf, sError, sWarning ) )
+			return false;
+
+		if ( m_dParserBuf.GetLength() )
+		{
+			m_dOff[iStr] = m_dPackedData.GetLength();
+
+			const int iLenBytes = 4;
+			BYTE * pPacked = m_dPackedData.AddN ( iLenBytes + m_dParserBuf.GetLength() );
+			sphPackStrlen ( pPacked, m_dParserBuf.GetLength() );
+			memcpy ( pPacked + iLenBytes, m_dParserBuf.Begin(), m_dParserBuf.GetLength() );
+		}
+		return true;
+	}
+
+	// point JSON attributes of a document to their packed values
+	void RemapJson ( CSphVector<const char *> & dStrings ) const
+	{
+		ARRAY_FOREACH ( i, dStrings )
+		{
+			int iOff = m_dOff[i];
+			if ( iOff==-1 )
+				continue;
+
+			assert ( !dStrings[i] );
+			dStrings[i] = (const char *)m_dPackedData.Begin() + iOff;
+		}
+	}
+
 	void Reset ()
 	{
 		m_dPackedData.Resize ( 0 );
@@ -13352,6 +14448,26 @@ protected:
 };
 
 
+// append MVA values the way accumulator expects them: count of DWORDs, then values (64-bit ones as low and high DWORDs)
+static void AddMvaAttr ( CSphVector<DWORD> & dMvas, const VecTraits_T<SphAttr_t> & dValues, bool b64 )
+{
+	if ( b64 )
+	{
+		dMvas.Add ( dValues.GetLength()*2 );
+		for ( SphAttr_t iValue : dValues )
+		{
+			dMvas.Add ( (DWORD)iValue );
+			dMvas.Add ( (DWORD)( (uint64_t)iValue>>32 ) );
+		}
+	} else
+	{
+		dMvas.Add ( dValues.GetLength() );
+		for ( SphAttr_t iValue : dValues )
+			dMvas.Add ( (DWORD)iValue );
+	}
+}
+
+
 void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, const SqlStmt_t & tStmt, bool bReplace, bool bCommit, CSphString & sWarning, CSphSessionAccum & tAcc, ESphCollation	eCollation )
 {
 	MEMORY ( MEM_SQL_INSERT );
@@ -13389,6 +14505,14 @@ void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, const SqlStmt_t & tStmt,
 	int iSchemaSz = tSchema.GetAttrsCount() + tSchema.GetFieldsCount() + 1;
 	if ( pIndex->GetSettings().m_bIndexFieldLens )
 		iSchemaSz -= tSchema.GetFieldsCount();
+
+	// hot JSON paths are computed from their JSON columns, and live at the very end of the schema
+	int iHotAttrs = 0;
+	for ( int i=0; i<tSchema.GetAttrsCount(); i++ )
+		if ( sphIsJsonHotAttr ( tSchema.GetAttr(i) ) )
+			iHotAttrs++;
+	iSchemaSz -= iHotAttrs;
+
 	int iExp = tStmt.m_iSchemaSz;
 	int iGot = tStmt.m_dInsertValues.GetLength();
 	if ( !tStmt.m_dInsertSchema.GetLength() && ( iSchemaSz!=tStmt.m_iSchemaSz ) )
@@ -13529,7 +14653,7 @@ void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, const SqlStmt_t & tStmt,
 		tStrings.Reset();
 		dMvas.Resize ( 0 );
 
-		int iSchemaAttrCount = tSchema.GetAttrsCount();
+		int iSchemaAttrCount = tSchema.GetAttrsCount() - iHotAttrs;
 		if ( pIndex->GetSettings().m_bIndexFieldLens )
 			iSchemaAttrCount -= tSchema.GetFieldsCount();
 		for ( int i=0; i<iSchemaAttrCount; i++ )
@@ -13575,29 +14699,12 @@ void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, const SqlStmt_t & tStmt,
 				{
 					// collect data from scattered insvals
 					// FIXME! maybe remove this mess, and just have a single m_dMvas pool in parser instead?
-					int iLen = 0;
 					if ( tVal.m_pVals )
 					{
 						tVal.m_pVals->Uniq();
-						iLen = tVal.m_pVals->GetLength();
-					}
-					if ( tCol.m_eAttrType==SPH_ATTR_INT64SET )
-					{
-						dMvas.Add ( iLen*2 );
-						for ( int j=0; j<iLen; j++ )
-						{
-							uint64_t uVal = ( *tVal.m_pVals )[j];
-							DWORD uLow = (DWORD)uVal;
-							DWORD uHi = (DWORD)( uVal>>32 );
-							dMvas.Add ( uLow );
-							dMvas.Add ( uHi );
-						}
+						AddMvaAttr ( dMvas, *tVal.m_pVals, tCol.m_eAttrType==SPH_ATTR_INT64SET );
 					} else
-					{
-						dMvas.Add ( iLen );
-						for ( int j=0; j<iLen; j++ )
-							dMvas.Add ( (DWORD)( *tVal.m_pVals )[j] );
-					}
+						dMvas.Add ( 0 );
 				}
 
 				// FIXME? index schema is lawfully static, but our temp match obviously needs to be dynamic
@@ -13610,23 +14717,9 @@ void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, const SqlStmt_t & tStmt,
 					int iStrCount = dStrings.GetLength();
 					dStrings.Add ( nullptr );
 
-					// empty source string means NULL attribute
-					if ( !tVal.m_sVal.IsEmpty() )
-					{
-						// sphJsonParse must be terminated with a double zero however usual CSphString have SAFETY_GAP of 4 zeros
-						if ( !String2JsonPack ( (char *)tVal.m_sVal.cstr(), tStrings.m_dParserBuf, sError, sWarning ) )
-							break;
-
-						if ( tStrings.m_dParserBuf.GetLength() )
-						{
-							tStrings.m_dOff[iStrCount] = tStrings.m_dPackedData.GetLength();
-
-							const int iLenBytes = 4;
-							BYTE * pPacked = tStrings.m_dPackedData.AddN ( iLenBytes + tStrings.m_dParserBuf.GetLength() );
-							sphPackStrlen ( pPacked, tStrings.m_dParserBuf.GetLength() );
-							memcpy ( pPacked + iLenBytes, tStrings.m_dParserBuf.Begin(), tStrings.m_dParserBuf.GetLength() );
-						}
-					}
+					// usual CSphString have SAFETY_GAP of 4 zeros, that is enough for the JSON parser
+					if ( !tStrings.AddJson ( (char *)tVal.m_sVal.cstr(), iStrCount, sError, sWarning ) )
+						break;
 				}
 			}
 
@@ -13640,15 +14733,7 @@ void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, const SqlStmt_t & tStmt,
 			break;
 
 		// remap JSON to string pointers
-		ARRAY_FOREACH ( i, dStrings )
-		{
-			int iOff = tStrings.m_dOff[i];
-			if ( iOff==-1 )
-				continue;
-
-			assert ( !dStrings[i] );
-			dStrings[i] = (const char *)tStrings.m_dPackedData.Begin() + iOff;
-		}
+		tStrings.RemapJson ( dStrings );
 
 		// convert fields
 		CSphVector<const char*> dFields;
@@ -13709,6 +14794,373 @@ void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, const SqlStmt_t & tStmt,
 }
 
 
+/// binary bulk INSERT/REPLACE over API
+/// values come typed and length-prefixed, so rows go to the accumulator without any text parsing
+struct InsertColumn_t
+{
+	CSphString	m_sName;
+	ESphAttr	m_eType = SPH_ATTR_NONE;	///< wire type, as declared by client
+	int			m_iField = -1;				///< full-text field index, or -1
+	int			m_iAttr = -1;				///< attribute index, or -1
+	int			m_iOff = -1;				///< per-row offset of the string value in the blob
+	int			m_iAttrOff = -1;			///< per-row offset of the attribute copy of a field value
+};
+
+
+static bool IsInsertableAttr ( ESphAttr eType )
+{
+	switch ( eType )
+	{
+	case SPH_ATTR_INTEGER:
+	case SPH_ATTR_TIMESTAMP:
+	case SPH_ATTR_BOOL:
+	case SPH_ATTR_BIGINT:
+	case SPH_ATTR_FLOAT:
+	case SPH_ATTR_STRING:
+	case SPH_ATTR_JSON:
+	case SPH_ATTR_UINT32SET:
+	case SPH_ATTR_INT64SET:
+		return true;
+	default:
+		return false;
+	}
+}
+
+
+void HandleCommandInsert ( ISphOutputBuffer & tOut, WORD uVer, InputBuffer_c & tReq, bool bReplace )
+{
+	if ( !CheckCommandVersion ( uVer, VER_COMMAND_INSERT, tOut ) )
+		return;
+
+	MEMORY ( MEM_SQL_INSERT );
+
+	CSphString sIndex = tReq.GetString ();
+	ServedDescRPtr_c pServed ( GetServed ( sIndex ) );
+	if ( !pServed )
+	{
+		SendErrorReply ( tOut, "no such index '%s'", sIndex.cstr() );
+		return;
+	}
+
+	if ( pServed->m_eType!=eITYPE::RT )
+	{
+		SendErrorReply ( tOut, "index '%s' does not support INSERT", sIndex.cstr() );
+		return;
+	}
+
+	auto * pIndex = (ISphRtIndex *)pServed->m_pIndex;
+	const CSphSchema & tSchema = pIndex->GetInternalSchema();
+
+	// hot JSON paths and field lengths are computed by the index, and live at the very end of the schema
+	int iSchemaAttrCount = tSchema.GetAttrsCount();
+	for ( int i=0; i<tSchema.GetAttrsCount(); i++ )
+		if ( sphIsJsonHotAttr ( tSchema.GetAttr(i) ) )
+			iSchemaAttrCount--;
+	if ( pIndex->GetSettings().m_bIndexFieldLens )
+		iSchemaAttrCount -= tSchema.GetFieldsCount();
+
+	// map columns
+	int iColumns = tReq.GetInt();
+	if ( tReq.GetError() || iColumns<=0 || iColumns>tSchema.GetFieldsCount()+iSchemaAttrCount+1 )
+	{
+		SendErrorReply ( tOut, "invalid column count %d", iColumns );
+		return;
+	}
+
+	CSphFixedVector<InsertColumn_t> dColumns ( iColumns );
+	CSphFixedVector<CSphVector<SphAttr_t>> dColumnMvas ( iColumns );
+	int iIdColumn = -1;
+	ARRAY_FOREACH ( i, dColumns )
+	{
+		InsertColumn_t & tCol = dColumns[i];
+		tCol.m_sName = tReq.GetString();
+		tCol.m_sName.ToLower();
+		tCol.m_eType = (ESphAttr)tReq.GetDword();
+		if ( tReq.GetError() )
+			break;
+
+		for ( int j=0; j<i; j++ )
+			if ( dColumns[j].m_sName==tCol.m_sName )
+			{
+				SendErrorReply ( tOut, "column '%s' specified twice", tCol.m_sName.cstr() );
+				return;
+			}
+
+		if ( tCol.m_sName=="id" )
+		{
+			if ( tCol.m_eType!=SPH_ATTR_BIGINT )
+			{
+				SendErrorReply ( tOut, "column 'id' must be sent as bigint" );
+				return;
+			}
+			iIdColumn = i;
+			continue;
+		}
+
+		tCol.m_iField = tSchema.GetFieldIndex ( tCol.m_sName.cstr() );
+		tCol.m_iAttr = tSchema.GetAttrIndex ( tCol.m_sName.cstr() );
+		if ( tCol.m_iAttr>=iSchemaAttrCount )
+			tCol.m_iAttr = -1;
+
+		if ( tCol.m_iField<0 && tCol.m_iAttr<0 )
+		{
+			SendErrorReply ( tOut, "unknown column: '%s'", tCol.m_sName.cstr() );
+			return;
+		}
+
+		// a field sharing its name with an attribute carries one value for both, so it must be a string
+		ESphAttr eExpected = ( tCol.m_iAttr>=0 ? tSchema.GetAttr ( tCol.m_iAttr ).m_eAttrType : SPH_ATTR_STRING );
+		if ( tCol.m_iField>=0 && eExpected!=SPH_ATTR_STRING )
+		{
+			SendErrorReply ( tOut, "column '%s' is both a field and a non-string attribute", tCol.m_sName.cstr() );
+			return;
+		}
+
+		if ( tCol.m_iAttr>=0 && !IsInsertableAttr ( eExpected ) )
+		{
+			SendErrorReply ( tOut, "column '%s': unsupported attribute type %d", tCol.m_sName.cstr(), eExpected );
+			return;
+		}
+
+		if ( tCol.m_eType!=eExpected )
+		{
+			SendErrorReply ( tOut, "column '%s': type mismatch (expected %d, got %d)", tCol.m_sName.cstr(), eExpected, tCol.m_eType );
+			return;
+		}
+	}
+
+	int iRows = tReq.GetInt();
+	if ( tReq.GetError() || iRows<0 )
+	{
+		SendErrorReply ( tOut, "invalid or truncated request" );
+		return;
+	}
+
+	if ( iIdColumn<0 )
+	{
+		SendErrorReply ( tOut, "column list must contain an 'id' column" );
+		return;
+	}
+
+	CSphString sError, sWarning;
+	CSphSessionAccum tAcc ( true );
+	ISphRtAccum * pAccum = tAcc.GetAcc ( pIndex, sError );
+	if ( !pAccum )
+	{
+		SendErrorReply ( tOut, "%s", sError.cstr() );
+		return;
+	}
+
+	// index schema is lawfully static, but our temp match obviously needs to be dynamic
+	CSphFixedVector<CSphAttrLocator> dLocators ( iSchemaAttrCount );
+	ARRAY_FOREACH ( i, dLocators )
+	{
+		dLocators[i] = tSchema.GetAttr(i).m_tLocator;
+		dLocators[i].m_bDynamic = true;
+	}
+
+	// per-attribute and per-field source columns
+	CSphFixedVector<int> dAttrColumn ( iSchemaAttrCount );
+	CSphFixedVector<int> dFieldColumn ( tSchema.GetFieldsCount() );
+	dAttrColumn.Fill ( -1 );
+	dFieldColumn.Fill ( -1 );
+	ARRAY_FOREACH ( i, dColumns )
+	{
+		if ( dColumns[i].m_iAttr>=0 )
+			dAttrColumn[dColumns[i].m_iAttr] = i;
+		if ( dColumns[i].m_iField>=0 )
+			dFieldColumn[dColumns[i].m_iField] = i;
+	}
+
+	CSphVector<BYTE> dBlob;
+	CSphVector<DWORD> dMvas;
+	CSphVector<const char *> dStrings;
+	CSphVector<const char *> dFields;
+	StringPtrTraits_t tStrings;
+	tStrings.m_dOff.Reset ( tSchema.GetAttrsCount() );
+	CSphString sNoFilterOptions;
+
+	CSphMatch tDoc;
+	tDoc.Reset ( tSchema.GetRowSize() );
+
+	for ( int iRow=0; iRow<iRows; iRow++ )
+	{
+		// decode the row; numeric values are read straight from the request buffer, while strings are
+		// copied into the row blob, as the JSON parser and the tokenizer need zero terminated text
+		SphDocID_t uDocid = 0;
+		dBlob.Resize ( 0 );
+		ARRAY_FOREACH ( i, dColumns )
+		{
+			InsertColumn_t & tCol = dColumns[i];
+			switch ( tCol.m_eType )
+			{
+			case SPH_ATTR_INTEGER:
+			case SPH_ATTR_TIMESTAMP:
+			case SPH_ATTR_BOOL:
+				tDoc.SetAttr ( dLocators[tCol.m_iAttr], tReq.GetDword() );
+				break;
+
+			case SPH_ATTR_FLOAT:
+				tDoc.SetAttrFloat ( dLocators[tCol.m_iAttr], tReq.GetFloat() );
+				break;
+
+			case SPH_ATTR_BIGINT:
+				if ( i==iIdColumn )
+					uDocid = (SphDocID_t)tReq.GetUint64();
+				else
+					tDoc.SetAttr ( dLocators[tCol.m_iAttr], (SphAttr_t)tReq.GetUint64() );
+				break;
+
+			case SPH_ATTR_STRING:
+			case SPH_ATTR_JSON:
+			{
+				tCol.m_iOff = dBlob.GetLength();
+				int iStart = tCol.m_iOff;
+				tReq.GetString ( dBlob );
+				int iLen = dBlob.GetLength() - iStart;
+				dBlob.Add ( 0 );
+				dBlob.Add ( 0 ); // JSON parser expects a double zero
+
+				// html stripper may modify the field text in place, so the attribute gets its own copy
+				tCol.m_iAttrOff = tCol.m_iOff;
+				if ( tCol.m_iField>=0 && tCol.m_iAttr>=0 )
+				{
+					tCol.m_iAttrOff = dBlob.GetLength();
+					BYTE * pCopy = dBlob.AddN ( iLen+1 );
+					memcpy ( pCopy, dBlob.Begin()+iStart, iLen+1 );
+				}
+				break;
+			}
+
+			case SPH_ATTR_UINT32SET:
+			case SPH_ATTR_INT64SET:
+			{
+				CSphVector<SphAttr_t> & dValues = dColumnMvas[i];
+				int iCount = tReq.GetInt();
+				if ( iCount<0 || iCount>tReq.HasBytes()/4 )
+				{
+					sError.SetSprintf ( "row %d, column '%s': invalid MVA length %d", 1+iRow, tCol.m_sName.cstr(), iCount ); // 1 for human base
+					break;
+				}
+
+				dValues.Resize ( iCount );
+				for ( auto & iValue : dValues )
+					iValue = ( tCol.m_eType==SPH_ATTR_UINT32SET ) ? (int64_t)tReq.GetDword() : (int64_t)tReq.GetUint64();
+				dValues.Uniq(); // don't need dupes within MVA
+				break;
+			}
+
+			default:
+				assert ( 0 && "INTERNAL ERROR: unchecked insert column type" );
+				break;
+			}
+
+			if ( !sError.IsEmpty() )
+				break;
+		}
+
+		if ( sError.IsEmpty() && tReq.GetError() )
+			sError.SetSprintf ( "row %d: invalid or truncated request", 1+iRow ); // 1 for human base
+		if ( !sError.IsEmpty() )
+			break;
+
+		// assemble the document in schema order
+		tDoc.m_uDocID = uDocid;
+		dStrings.Resize ( 0 );
+		dMvas.Resize ( 0 );
+		tStrings.Reset();
+
+		for ( int i=0; i<iSchemaAttrCount; i++ )
+		{
+			const CSphColumnInfo & tAttr = tSchema.GetAttr(i);
+			int iCol = dAttrColumn[i];
+
+			switch ( tAttr.m_eAttrType )
+			{
+			case SPH_ATTR_STRING:
+				tDoc.SetAttr ( dLocators[i], 0 );
+				dStrings.Add ( iCol<0 ? nullptr : (const char *)dBlob.Begin() + dColumns[iCol].m_iAttrOff );
+				break;
+
+			case SPH_ATTR_JSON:
+			{
+				tDoc.SetAttr ( dLocators[i], 0 );
+				int iStrCount = dStrings.GetLength();
+				dStrings.Add ( nullptr );
+
+				char * szJson = ( iCol<0 ? nullptr : (char *)dBlob.Begin() + dColumns[iCol].m_iOff );
+				tStrings.AddJson ( szJson, iStrCount, sError, sWarning );
+				break;
+			}
+
+			case SPH_ATTR_UINT32SET:
+			case SPH_ATTR_INT64SET:
+			{
+				tDoc.SetAttr ( dLocators[i], 0 );
+				if ( iCol<0 )
+				{
+					dMvas.Add ( 0 );
+					break;
+				}
+
+				AddMvaAttr ( dMvas, dColumnMvas[iCol], tAttr.m_eAttrType==SPH_ATTR_INT64SET );
+				break;
+			}
+
+			default:
+				if ( iCol<0 )
+					tDoc.SetAttr ( dLocators[i], 0 );
+				break;
+			}
+
+			if ( !sError.IsEmpty() )
+				break;
+		}
+		if ( !sError.IsEmpty() )
+			break;
+
+		// remap JSON to string pointers
+		tStrings.RemapJson ( dStrings );
+
+		dFields.Resize ( 0 );
+		for ( int iCol : dFieldColumn )
+			dFields.Add ( iCol<0 ? "" : (const char *)dBlob.Begin() + dColumns[iCol].m_iOff );
+
+		// do add
+		pIndex->AddDocument ( pIndex->CloneIndexingTokenizer(), dFields.GetLength(), dFields.Begin(), tDoc,
+			bReplace, sNoFilterOptions, dStrings.Begin(), dMvas, sError, sWarning, pAccum );
+
+		if ( !sError.IsEmpty() )
+			break;
+	}
+
+	// fire exit
+	if ( !sError.IsEmpty() )
+	{
+		pIndex->RollBack ( pAccum ); // clean up collected data
+		SendErrorReply ( tOut, "%s", sError.cstr() );
+		return;
+	}
+
+	pIndex->Commit ( nullptr, pAccum );
+
+	if ( sWarning.IsEmpty() )
+	{
+		tOut.SendWord ( SEARCHD_OK );
+		tOut.SendWord ( VER_COMMAND_INSERT );
+		tOut.SendInt ( 4 );
+	} else
+	{
+		tOut.SendWord ( SEARCHD_WARNING );
+		tOut.SendWord ( VER_COMMAND_INSERT );
+		tOut.SendInt ( 8 + sWarning.Length() );
+		tOut.SendString ( sWarning.cstr() );
+	}
+	tOut.SendInt ( iRows );
+	tOut.Flush ();
+}
+
+
 // our copy of enum_server_command
 // we can't rely on mysql_com.h because it might be unavailable
 //
@@ -14643,6 +16095,49 @@ void HandleMysqlShowThreads ( SqlRowBuffer_c & tOut, const SqlStmt_t & tStmt )
 	g_tThdMutex.Unlock();
 }
 
+void HandleMysqlKill ( SqlRowBuffer_c & tOut, const SqlStmt_t & tStmt, bool bVipConn )
+{
+	// any client could otherwise stop the queries of everybody else
+	if ( !bVipConn )
+	{
+		tOut.Error ( tStmt.m_sStmt, "KILL is only allowed on VIP connections" );
+		return;
+	}
+
+	int iKilled = 0;
+	bool bFound = false;
+
+	g_tThdMutex.Lock();
+	const ListNode_t * pIt = g_dThd.Begin();
+	while ( pIt!=g_dThd.End() )
+	{
+		const ThdDesc_t * pThd = (const ThdDesc_t *)pIt;
+		pIt = pIt->m_pNext;
+		if ( pThd->m_iTid!=tStmt.m_iIntParam )
+			continue;
+
+		bFound = true;
+		pThd->m_tQueryLock.Lock();
+		if ( pThd->m_pQueryControl )
+		{
+			pThd->m_pQueryControl->Stop ( QUERY_KILLED );
+			iKilled++;
+		}
+		pThd->m_tQueryLock.Unlock();
+	}
+	g_tThdMutex.Unlock();
+
+	if ( !bFound )
+	{
+		CSphString sError;
+		sError.SetSprintf ( "unknown thread id %d", tStmt.m_iIntParam );
+		tOut.Error ( tStmt.m_sStmt, sError.cstr() );
+		return;
+	}
+
+	tOut.Ok ( iKilled );
+}
+
 void HandleMysqlFlushHostnames ( SqlRowBuffer_c & tOut )
 {
 	SmallStringHash_T<DWORD> hHosts;
@@ -17874,6 +19369,10 @@ public:
 			HandleMysqlDebug ( tOut, *pStmt, m_tVars.m_bVIP );
 			return true;
 
+		case STMT_KILL:
+			HandleMysqlKill ( tOut, *pStmt, m_tVars.m_bVIP );
+			return true;
+
 		default:
 			m_sError.SetSprintf ( "internal error: unhandled statement type (value=%d)", eStmt );
 			tOut.Error ( sQuery.cstr(), m_sError.cstr() );
@@ -19452,6 +20951,13 @@ ESphAddIndex AddRTIndex ( const char * szIndexName, const CSphConfigSection &hIn
 			return ADD_ERROR;
 		}
 
+	// hot JSON paths go after field lengths, at the very end of the schema
+	if ( !AddJsonHotAttrs ( tSchema, tSettings.m_dJsonHotAttrs, false, sError ) )
+	{
+		sphWarning ( "index '%s': %s - NOT SERVING", szIndexName, sError.cstr () );
+		return ADD_ERROR;
+	}
+
 	bool bWordDict = strcmp ( hIndex.GetStr ( "dict", "keywords" ), "keywords" )==0;
 	if ( !bWordDict )
 		sphWarning ( "dict=crc deprecated, use dict=keywords instead" );
@@ -19756,6 +21262,17 @@ void InitPersistentPool()
 		if ( !pHost->m_pPersPool )
 			pHost->m_pPersPool = new PersistentConnectionsPool_c;
 		pHost->m_pPersPool->ReInit ( g_iPersistentPoolSize );
+
+		if ( g_iPersistentMux>0 )
+		{
+			if ( !pHost->m_pMux )
+				pHost->m_pMux = new MuxHost_c ( pHost->m_tHost );
+			pHost->m_pMux->ReInit ( g_iPersistentMux );
+		} else if ( pHost->m_pMux )
+		{
+			pHost->m_pMux->Shutdown ();
+			SafeRelease ( pHost->m_pMux );
+		}
 	} );
 }
 
@@ -20098,8 +21615,7 @@ void CheckReopenLogs () REQUIRES ( MainThread )
 			sphWarning ( "failed to reopen query log file '%s': %s", g_sQueryLogFile.cstr(), strerrorm(errno) );
 		} else
 		{
-			::close ( g_iQueryLogFile );
-			g_iQueryLogFile = iFD;
+			g_tQueryLog.Reopen ( iFD );
 			LogChangeMode ( g_iQueryLogFile, g_iLogFileMode );
 			sphInfo ( "query log reopened" );
 		}
@@ -21196,8 +22712,12 @@ struct NetSendData_t : public ISphNetAction
 	CSphScopedPtr<NetStateCommon_t>		m_tState;
 	ProtocolType_e						m_eProto;
 	bool								m_bContinue;
+	SmartOutputBuffer_t *				m_pChunks = nullptr;	///< chained reply to send scattered instead of state buffer
+	IOVec_c								m_tIOVec;
 
 	NetSendData_t ( NetStateCommon_t * pState, ProtocolType_e eProto );
+	NetSendData_t ( NetStateCommon_t * pState, ProtocolType_e eProto, SmartOutputBuffer_t * pChunks );
+	~NetSendData_t () override;
 
 	NetEvent_e		Tick ( DWORD uGotEvents, CSphVector<ISphNetAction *> & dNextTick, CSphNetLoop * pLoop ) override;
 	NetEvent_e		Setup ( int64_t tmNow ) override;
@@ -21232,6 +22752,56 @@ struct NetReceiveDataHttp_t : public ISphNetAction
 	void			CloseSocket () override;
 };
 
+/// multiplexed API connection (see SEARCHD_COMMAND_MUX)
+/// every request frame is tagged with an id; requests are handled concurrently,
+/// and replies are sent back tagged with the same id, in the order they are ready
+struct MuxSession_t : public ISphRefcountedMT
+{
+	CSphScopedPtr<NetStateAPI_t>	m_tState;	///< socket and client info; the socket is closed with the last reference
+
+	explicit MuxSession_t ( NetStateAPI_t * pState );
+
+	bool				SendReply ( DWORD uId, const ISphOutputBuffer & tReply );
+	bool				Send ( const ISphOutputBuffer & tOut );
+	void				Shutdown ();
+
+protected:
+	~MuxSession_t () override {}
+
+private:
+	CSphMutex			m_tSendLock;
+	bool				m_bBroken = false;
+};
+
+enum ActionMux_e
+{
+	AMUX_HEADER = 0,
+	AMUX_BODY,
+	AMUX_TOTAL
+};
+
+struct NetReceiveDataMux_t : public ISphNetAction
+{
+	CSphRefcountedPtr<MuxSession_t>	m_pSession;
+	CSphVector<BYTE>	m_dBuf;
+	int					m_iPos = 0;
+	int					m_iLeft = 0;
+	ActionMux_e			m_ePhase = AMUX_HEADER;
+
+	DWORD				m_uId = 0;
+	SearchdCommand_e	m_eCommand = SEARCHD_COMMAND_WRONG;
+	WORD				m_uCommandVer = VER_COMMAND_WRONG;
+
+	explicit NetReceiveDataMux_t ( MuxSession_t * pSession );
+
+	NetEvent_e		Tick ( DWORD uGotEvents, CSphVector<ISphNetAction *> & dNextTick, CSphNetLoop * pLoop ) override;
+	NetEvent_e		Setup ( int64_t tmNow ) override;
+	void			CloseSocket () override;
+
+	void				SetupHeaderPhase ();
+	void				AddJobMux ( CSphNetLoop * pLoop );
+};
+
 struct EventsIterator_t
 {
 	ISphNetAction * m_pWork = nullptr;
@@ -21557,16 +23127,108 @@ struct ThdJobCleanup_t : public ISphJob
 {
 	CSphVector<ISphNetAction *> m_dCleanup;
 
-	explicit ThdJobCleanup_t ( CSphVector<ISphNetAction *> & dCleanup );
-	~ThdJobCleanup_t () override;
+	explicit ThdJobCleanup_t ( CSphVector<ISphNetAction *> & dCleanup );
+	~ThdJobCleanup_t () override;
+
+	void				Call () override;
+	void				Clear();
+};
+
+static int	g_iNetWorkers = 1;
+static bool	g_bNetReuseport = false;	// every net worker accepts on its own SO_REUSEPORT listeners and sticks to a core
+static int	g_iNetLocalMaxPacket = 0;	// requests up to that size are handled by the net worker that received them
+static int	g_iThrottleAction = 0;
+static int	g_iThrottleAccept = 0;
+
+// net loop runs requests itself only when these are small, cheap, and never block (see net_local_max_packet)
+// API: only ping and status
+static bool IsLocalApiRequest ( SearchdCommand_e eCommand, int iPacketBytes )
+{
+	if ( g_iNetLocalMaxPacket<=0 || iPacketBytes>g_iNetLocalMaxPacket )
+		return false;
+
+	return eCommand==SEARCHD_COMMAND_PING || eCommand==SEARCHD_COMMAND_STATUS;
+}
+
+// SphinxQL: SHOW STATUS, and lookups by id from a single plain index, ie. SELECT ... FROM idx WHERE id=N [LIMIT ...]
+// RT and percolate indexes never qualify, as their readers might wait for a commit or optimize
+// selects from indexes never qualify with admission control on, as these might wait for other queries
+// the check is a plain token scan; anything it is not sure about goes to the workers
+static bool IsLocalSqlRequest ( const CSphVector<BYTE> & dBuf )
+{
+	if ( g_iNetLocalMaxPacket<=0 || dBuf.GetLength()>g_iNetLocalMaxPacket )
+		return false;
+
+	// skip the command byte; split into lowercase words, and punctuation as separate tokens
+	StrVec_t dTokens;
+	const char * p = (const char *)dBuf.Begin() + 1;
+	const char * pEnd = (const char *)dBuf.Begin() + dBuf.GetLength();
+	while ( p<pEnd )
+	{
+		if ( sphIsSpace ( *p ) )
+		{
+			++p;
+			continue;
+		}
+
+		const char * pTok = p++;
+		if ( sphIsAlpha ( *pTok ) )
+			while ( p<pEnd && sphIsAlpha ( *p ) )
+				++p;
+
+		dTokens.Add().SetBinary ( pTok, int ( p-pTok ) );
+		dTokens.Last().ToLower();
+	}
+
+	if ( dTokens.GetLength()>=2 && dTokens[0]=="show" && dTokens[1]=="status" )
+		return true;
+
+	if ( dTokens.IsEmpty() || dTokens[0]!="select" )
+		return false;
+
+	int iFrom = -1;
+	ARRAY_FOREACH ( i, dTokens )
+	{
+		if ( dTokens[i]==";" )
+			return false;
+		if ( dTokens[i]=="from" )
+		{
+			iFrom = i;
+			break;
+		}
+	}
+
+	// no index at all, like SELECT @@version
+	if ( iFrom<0 )
+		return true;
+
+	if ( g_tAdmission.IsEnabled() )
+		return false;
+
+	auto fnNumber = [&dTokens] ( int i ) { return i<dTokens.GetLength() && isdigit ( (BYTE)dTokens[i].cstr()[0] ); };
+	auto fnToken = [&dTokens] ( int i, const char * sTok ) { return i<dTokens.GetLength() && dTokens[i]==sTok; };
 
-	void				Call () override;
-	void				Clear();
-};
+	// exactly WHERE id=N, then optional LIMIT N[,N], and nothing else
+	int iTok = iFrom+2;
+	if ( !fnToken ( iTok, "where" ) || !fnToken ( iTok+1, "id" ) || !fnToken ( iTok+2, "=" ) || !fnNumber ( iTok+3 ) )
+		return false;
+	iTok += 4;
+	if ( fnToken ( iTok, "limit" ) && fnNumber ( iTok+1 ) )
+	{
+		iTok += 2;
+		if ( fnToken ( iTok, "," ) && fnNumber ( iTok+1 ) )
+			iTok += 2;
+	}
+	if ( iTok!=dTokens.GetLength() )
+		return false;
 
-static int	g_iNetWorkers = 1;
-static int	g_iThrottleAction = 0;
-static int	g_iThrottleAccept = 0;
+	// exactly one local index (distributed ones live in a separate hash), and not a mutable one
+	if ( !sphIsAlpha ( dTokens[iFrom+1].cstr()[0] ) )
+		return false;
+
+	ServedDescRPtr_c pServed ( GetServed ( dTokens[iFrom+1] ) );
+	return pServed && !pServed->IsMutable();
+}
 
 class CSphNetLoop
 {
@@ -21580,6 +23242,8 @@ private:
 	CSphMutex						m_tExtLock;
 	LoopProfiler_t					m_tPrf;
 	NetActionsPoller				m_tPoller;
+	CSphVector<ISphJob *>			m_dLocalJobs;		// small requests to handle right at this thread
+	CrashQuery_t *					m_pCrashQuery = nullptr;
 
 	explicit CSphNetLoop ( CSphVector<Listener_t> & dListeners )
 	{
@@ -21607,6 +23271,8 @@ private:
 	{
 		ARRAY_FOREACH ( i, m_dWorkExternal )
 			SafeDelete ( m_dWorkExternal[i] );
+		ARRAY_FOREACH ( i, m_dLocalJobs )
+			SafeDelete ( m_dLocalJobs[i] );
 	}
 
 	void Tick ()
@@ -21718,6 +23384,8 @@ private:
 			dWorkNext.Resize ( 0 );
 			m_tPrf.EndTask();
 
+			RunLocalJobs();
+
 			// update stats
 			if ( iConnections )
 			{
@@ -21782,6 +23450,20 @@ private:
 		m_tPrf.EndTask();
 	}
 
+	void RunLocalJobs ()
+	{
+		// jobs might add actions back to this very loop, these get polled at the next tick
+		ARRAY_FOREACH ( i, m_dLocalJobs )
+		{
+			m_dLocalJobs[i]->Call();
+			SafeDelete ( m_dLocalJobs[i] );
+		}
+		m_dLocalJobs.Resize ( 0 );
+
+		// job replaced crash info with its own
+		SphCrashLogger_c::SetTopQueryTLS ( m_pCrashQuery );
+	}
+
 public:
 	void AddAction ( ISphNetAction * pElem )
 	{
@@ -21798,15 +23480,49 @@ public:
 		m_tPoller.IterateRemove();
 	}
 
+	// small cheap requests stay at this thread to save on the hand-offs to the pool and back
+	void AddJob ( ISphJob * pJob, bool bLocal, bool bVIP )
+	{
+		if ( bLocal )
+			m_dLocalJobs.Add ( pJob );
+		else if ( bVIP )
+			g_pThdPool->StartJob ( pJob );
+		else
+			g_pThdPool->AddJob ( pJob );
+	}
+
 	// main thread wrapper
-	static void ThdTick ( void * )
+	static void ThdTick ( void * pArg )
 	{
 		CrashQuery_t tQueryTLS;
 		SphCrashLogger_c::SetTopQueryTLS ( &tQueryTLS );
 
-		CSphNetLoop tLoop ( g_dListeners );
+		int iWorker = (int)(intptr_t)pArg;
+		if ( g_bNetReuseport )
+			PinThread ( iWorker );
+
+		// 1st worker uses the original listeners, the rest use their own copies
+		CSphVector<Listener_t> & dListeners = ( iWorker>0 && iWorker<=g_dNetListeners.GetLength() ) ? g_dNetListeners[iWorker-1] : g_dListeners;
+		CSphNetLoop tLoop ( dListeners );
+		tLoop.m_pCrashQuery = &tQueryTLS;
 		tLoop.Tick();
 	}
+
+	static void PinThread ( int iWorker )
+	{
+#ifdef CPU_SET
+		int iCpus = sphCpuThreadsCount();
+		if ( iCpus<=0 )
+			return;
+
+		cpu_set_t tSet;
+		CPU_ZERO ( &tSet );
+		CPU_SET ( iWorker % iCpus, &tSet );
+		int iRes = pthread_setaffinity_np ( pthread_self(), sizeof(tSet), &tSet );
+		if ( iRes )
+			sphWarning ( "net worker %d: failed to set CPU affinity: %s", iWorker, strerrorm ( iRes ) );
+#endif
+	}
 };
 
 struct ThdJobAPI_t : public ISphJob
@@ -21821,6 +23537,19 @@ struct ThdJobAPI_t : public ISphJob
 	void		Call () final;
 };
 
+struct ThdJobMux_t : public ISphJob
+{
+	CSphRefcountedPtr<MuxSession_t>	m_pSession;
+	DWORD				m_uId;
+	SearchdCommand_e	m_eCommand;
+	WORD				m_uCommandVer;
+	CSphVector<BYTE>	m_dBuf;
+
+	ThdJobMux_t ( MuxSession_t * pSession, DWORD uId, SearchdCommand_e eCommand, WORD uCommandVer, CSphVector<BYTE> & dBuf );
+
+	void		Call () final;
+};
+
 struct ThdJobQL_t : public ISphJob
 {
 	CSphScopedPtr<NetStateQL_t>		m_tState;
@@ -22122,14 +23851,12 @@ void NetReceiveDataAPI_t::AddJobAPI ( CSphNetLoop * pLoop )
 	pLoop->RemoveIterEvent();
 	bool bStart = m_tState->m_bVIP;
 	int iLen = m_tState->m_dBuf.GetLength();
+	bool bLocal = IsLocalApiRequest ( m_eCommand, iLen );
 	ThdJobAPI_t * pJob = new ThdJobAPI_t ( pLoop, m_tState.LeakPtr() );
 	pJob->m_eCommand = m_eCommand;
 	pJob->m_uCommandVer = m_uCommandVer;
 	sphLogDebugv ( "%p receive API job created (%p), buf=%d, sock=%d, tick=%u", this, pJob, iLen, m_iSock, pLoop->m_uTick );
-	if ( bStart )
-		g_pThdPool->StartJob ( pJob );
-	else
-		g_pThdPool->AddJob ( pJob );
+	pLoop->AddJob ( pJob, bLocal, bStart );
 }
 
 static char g_sMaxedOutMessage[] = "maxed out, dismissing client";
@@ -22228,7 +23955,34 @@ NetEvent_e NetReceiveDataAPI_t::Tick ( DWORD uGotEvents, CSphVector<ISphNetActio
 		{
 			const bool bMaxedOut = ( g_iThdQueueMax && !m_tState->m_bVIP && g_pThdPool->GetQueueLength()>=g_iThdQueueMax );
 
-			if ( m_eCommand==SEARCHD_COMMAND_PING )
+			if ( m_eCommand==SEARCHD_COMMAND_MUX )
+			{
+				StatCountCommand ( m_eCommand );
+				ISphOutputBuffer tOut;
+				bool bGotError = ( m_tState->m_dBuf.GetLength()<4 );
+				if ( bGotError )
+					SendErrorReply ( tOut, "invalid command (code=%d, len=%d)", m_eCommand, m_tState->m_dBuf.GetLength() );
+				else
+					bGotError = !CheckCommandVersion ( m_uCommandVer, VER_COMMAND_MUX, tOut );
+
+				if ( !bGotError )
+				{
+					tOut.SendWord ( SEARCHD_OK );
+					tOut.SendWord ( VER_COMMAND_MUX );
+					tOut.SendInt ( 4 ); // resplen, 1 dword
+					tOut.SendInt ( 1 ); // multiplexing protocol revision
+				}
+
+				// from now on the connection belongs to the session
+				m_tState->m_dBuf.Reset();
+				CSphRefcountedPtr<MuxSession_t> pSession ( new MuxSession_t ( m_tState.LeakPtr() ) );
+				if ( pSession->Send ( tOut ) && !bGotError )
+				{
+					sphLogDebugv ( "%p API connection switched to multiplexed, sock=%d", this, m_iSock );
+					dNextTick.Add ( new NetReceiveDataMux_t ( pSession ) );
+				}
+
+			} else if ( m_eCommand==SEARCHD_COMMAND_PING )
 			{
 				bool bGotError = false;
 				int iCookie = 0;
@@ -22305,6 +24059,155 @@ void NetReceiveDataAPI_t::CloseSocket()
 		m_tState->CloseSocket();
 }
 
+MuxSession_t::MuxSession_t ( NetStateAPI_t * pState )
+	: m_tState ( pState )
+{}
+
+bool MuxSession_t::Send ( const ISphOutputBuffer & tOut )
+{
+	ScopedMutex_t tLock ( m_tSendLock );
+	if ( m_bBroken )
+		return false;
+
+	NetOutputBuffer_c tNetOut ( m_tState->m_iClientSock );
+	tNetOut.SendBytes ( tOut.GetBufPtr(), tOut.GetSentCount() );
+	tNetOut.Flush();
+	if ( tNetOut.GetError() )
+	{
+		// whoever still handles requests of this session will find it broken
+		m_bBroken = true;
+		Shutdown();
+	}
+	return !m_bBroken;
+}
+
+bool MuxSession_t::SendReply ( DWORD uId, const ISphOutputBuffer & tReply )
+{
+	ISphOutputBuffer tOut;
+	tOut.SendDword ( uId );
+	tOut.SendBytes ( tReply.GetBufPtr(), tReply.GetSentCount() );
+	return Send ( tOut );
+}
+
+// wake up the receiver, so that the session is done with as soon as in-flight requests are
+void MuxSession_t::Shutdown ()
+{
+#if USE_WINDOWS
+	::shutdown ( m_tState->m_iClientSock, SD_BOTH );
+#else
+	::shutdown ( m_tState->m_iClientSock, SHUT_RDWR );
+#endif
+}
+
+const char * g_sErrorNetMux[] = { "failed to receive multiplexed request header", "failed to receive multiplexed request body" };
+STATIC_ASSERT ( sizeof(g_sErrorNetMux)/sizeof(g_sErrorNetMux[0])==AMUX_TOTAL, NOT_ALL_EMUN_DESCRIBERD );
+
+NetReceiveDataMux_t::NetReceiveDataMux_t ( MuxSession_t * pSession )
+	: ISphNetAction ( pSession->m_tState->m_iClientSock )
+	, m_pSession ( pSession )
+{
+	pSession->AddRef();
+	SetupHeaderPhase();
+}
+
+NetEvent_e NetReceiveDataMux_t::Setup ( int64_t tmNow )
+{
+	m_tmTimeout = tmNow + MS2SEC * g_iClientTimeout;
+	return NE_IN;
+}
+
+void NetReceiveDataMux_t::SetupHeaderPhase ()
+{
+	// request id, command, version, length
+	m_dBuf.Resize ( 12 );
+	m_iLeft = m_dBuf.GetLength();
+	m_iPos = 0;
+	m_ePhase = AMUX_HEADER;
+}
+
+void NetReceiveDataMux_t::AddJobMux ( CSphNetLoop * pLoop )
+{
+	const bool bVIP = m_pSession->m_tState->m_bVIP;
+	const bool bMaxedOut = ( g_iThdQueueMax && !bVIP && g_pThdPool->GetQueueLength()>=g_iThdQueueMax );
+	if ( bMaxedOut )
+	{
+		sphWarning ( "%s", g_sMaxedOutMessage );
+		ISphOutputBuffer tOut;
+		tOut.SendWord ( (WORD)SEARCHD_RETRY );
+		tOut.SendWord ( 0 ); // version doesn't matter
+		tOut.SendInt ( 4 + strlen ( g_sMaxedOutMessage ) );
+		tOut.SendString ( g_sMaxedOutMessage );
+		m_pSession->SendReply ( m_uId, tOut );
+	} else
+	{
+		int iLen = m_dBuf.GetLength();
+		auto * pJob = new ThdJobMux_t ( m_pSession, m_uId, m_eCommand, m_uCommandVer, m_dBuf );
+		sphLogDebugv ( "%p mux job created (%p), id=%u, buf=%d, sock=%d, tick=%u", this, pJob, m_uId, iLen, m_iSock, pLoop->m_uTick );
+		// frames of one mux connection share its socket, so none of them may stall the net loop
+		pLoop->AddJob ( pJob, false, bVIP );
+	}
+	SetupHeaderPhase();
+}
+
+NetEvent_e NetReceiveDataMux_t::Tick ( DWORD uGotEvents, CSphVector<ISphNetAction *> &, CSphNetLoop * pLoop )
+{
+	// peer closing the connection between requests is the normal way to end a session
+	bool bDebug = ( m_ePhase==AMUX_HEADER && !m_iPos );
+	const NetStateAPI_t * pState = m_pSession->m_tState.Ptr();
+	if ( CheckSocketError ( uGotEvents, g_sErrorNetMux[m_ePhase], pState, bDebug ) )
+		return NE_REMOVE;
+
+	while (true)
+	{
+		int iRes = NetManageSocket ( m_iSock, (char *)( m_dBuf.Begin() + m_iPos ), m_iLeft, false, false );
+		if ( iRes==-1 )
+		{
+			LogSocketError ( g_sErrorNetMux[m_ePhase], pState, bDebug );
+			return NE_REMOVE;
+		}
+
+		// socket would block - going back to polling
+		if ( !iRes )
+			return NE_KEEP;
+
+		m_iLeft -= iRes;
+		m_iPos += iRes;
+		if ( m_iLeft )
+			continue;
+
+		m_tmTimeout = sphMicroTimer() + MS2SEC * g_iClientTimeout;
+		if ( m_ePhase==AMUX_HEADER )
+		{
+			m_uId = (DWORD) NetBufGetInt ( m_dBuf.Begin() );
+			m_eCommand = ( SearchdCommand_e ) NetBufGetWord ( m_dBuf.Begin() + 4 );
+			m_uCommandVer = NetBufGetWord ( m_dBuf.Begin() + 6 );
+			int iLen = NetBufGetInt ( m_dBuf.Begin() + 8 );
+
+			// a broken frame means the stream is out of sync; nothing to do but drop the session
+			if ( m_eCommand>=SEARCHD_COMMAND_WRONG || m_eCommand==SEARCHD_COMMAND_MUX || iLen<0 || iLen>g_iMaxPacketSize )
+			{
+				sphWarning ( "ill-formed multiplexed request (client=%s(%d), id=%u, command=%d, length=%d)", pState->m_sClientName, pState->m_iConnID, m_uId, m_eCommand, iLen );
+				return NE_REMOVE;
+			}
+
+			m_dBuf.Resize ( iLen );
+			m_iLeft = iLen;
+			m_iPos = 0;
+			m_ePhase = AMUX_BODY;
+			if ( iLen )
+				continue;
+		}
+
+		// got the whole request; keep reading the next ones while this one is handled
+		AddJobMux ( pLoop );
+	}
+}
+
+void NetReceiveDataMux_t::CloseSocket ()
+{
+	m_pSession->Shutdown();
+}
+
 const char * g_sErrorNetQL[] = { "failed to send SphinxQL handshake", "bailing on failed MySQL header", "failed to receive MySQL request body", "failed to send SphinxQL auth" };
 STATIC_ASSERT ( sizeof(g_sErrorNetQL)/sizeof(g_sErrorNetQL[0])==AQL_TOTAL, NOT_ALL_EMUN_DESCRIBERD );
 
@@ -22509,11 +24412,9 @@ NetEvent_e NetReceiveDataQL_t::Tick ( DWORD uGotEvents, CSphVector<ISphNetAction
 
 						// going to actual work now
 						bool bStart = m_tState->m_bVIP;
+						bool bLocal = IsLocalSqlRequest ( dBuf );
 						ThdJobQL_t * pJob = new ThdJobQL_t ( pLoop, m_tState.LeakPtr() );
-						if ( bStart )
-							g_pThdPool->StartJob ( pJob );
-						else
-							g_pThdPool->AddJob ( pJob );
+						pLoop->AddJob ( pJob, bLocal, bStart );
 
 						return NE_REMOVED;
 					} else
@@ -22590,12 +24491,62 @@ NetSendData_t::NetSendData_t ( NetStateCommon_t * pState, ProtocolType_e eProto
 	m_tState->m_iLeft = 0;
 }
 
+NetSendData_t::NetSendData_t ( NetStateCommon_t * pState, ProtocolType_e eProto, SmartOutputBuffer_t * pChunks )
+	: NetSendData_t ( pState, eProto )
+{
+	m_pChunks = pChunks;
+}
+
+NetSendData_t::~NetSendData_t ()
+{
+	SafeRelease ( m_pChunks );
+}
+
+// returns bytes sent, 0 if socket would block, -1 on error
+static int NetSendIOVec ( int iSock, IOVec_c & tIOVec )
+{
+#if USE_WINDOWS
+	DWORD uSent = 0;
+	int iRes = WSASend ( iSock, tIOVec.IOPtr(), (DWORD)tIOVec.IOSize(), &uSent, 0, nullptr, nullptr );
+	if ( iRes==0 )
+		return (int)uSent;
+#else
+	struct msghdr tHdr = { 0 };
+	tHdr.msg_iov = tIOVec.IOPtr();
+	tHdr.msg_iovlen = tIOVec.IOSize();
+	auto iRes = ::sendmsg ( iSock, &tHdr, MSG_NOSIGNAL | MSG_DONTWAIT );
+	if ( iRes>=0 )
+		return (int)iRes;
+#endif
+
+	int iErr = sphSockPeekErrno();
+	return ( ( iErr==EINTR || iErr==EAGAIN || iErr==EWOULDBLOCK ) ? 0 : -1 );
+}
+
 NetEvent_e NetSendData_t::Tick ( DWORD uGotEvents, CSphVector<ISphNetAction *> & dNextTick, CSphNetLoop * pLoop )
 {
 	if ( CheckSocketError ( uGotEvents, "failed to send data", m_tState.Ptr(), false ) )
 		return NE_REMOVE;
 
-	for ( ; m_tState->m_iLeft>0; )
+	while ( m_pChunks && m_tIOVec.HasUnsent() )
+	{
+		int iRes = NetSendIOVec ( m_tState->m_iClientSock, m_tIOVec );
+		if ( iRes==-1 )
+		{
+			LogSocketError ( "failed to send data", m_tState.Ptr(), false );
+			return NE_REMOVE;
+		}
+
+		m_tIOVec.StepForward ( iRes );
+		m_tState->m_iLeft -= iRes;
+		m_tState->m_iPos += iRes;
+
+		// socket would block - going back to polling
+		if ( iRes==0 )
+			return NE_KEEP;
+	}
+
+	for ( ; m_tState->m_iLeft>0 && !m_pChunks; )
 	{
 		int iRes = NetManageSocket ( m_tState->m_iClientSock, (char *)m_tState->m_dBuf.Begin() + m_tState->m_iPos, m_tState->m_iLeft, true, false );
 		if ( iRes==-1 )
@@ -22615,7 +24566,7 @@ NetEvent_e NetSendData_t::Tick ( DWORD uGotEvents, CSphVector<ISphNetAction *> &
 	if ( m_tState->m_iLeft>0 )
 		return NE_KEEP;
 
-	assert ( m_tState->m_iLeft==0 && m_tState->m_iPos==m_tState->m_dBuf.GetLength() );
+	assert ( m_tState->m_iLeft==0 && ( m_pChunks || m_tState->m_iPos==m_tState->m_dBuf.GetLength() ) );
 
 	if ( m_tState->m_bKeepSocket )
 	{
@@ -22662,8 +24613,15 @@ NetEvent_e NetSendData_t::Setup ( int64_t tmNow )
 	{
 		m_tmTimeout = tmNow + MS2SEC * g_iWriteTimeout;
 
-		assert ( m_tState->m_dBuf.GetLength() );
-		m_tState->m_iLeft = m_tState->m_dBuf.GetLength();
+		if ( m_pChunks )
+		{
+			m_tIOVec.BuildFrom ( *m_pChunks );
+			m_tState->m_iLeft = m_pChunks->GetSentCount();
+		} else
+		{
+			assert ( m_tState->m_dBuf.GetLength() );
+			m_tState->m_iLeft = m_tState->m_dBuf.GetLength();
+		}
 		m_tState->m_iPos = 0;
 	}
 	m_bContinue = false;
@@ -22706,14 +24664,17 @@ NetStateQL_t::NetStateQL_t ()
 {}
 
 
+static const int HTTP_READ_CHUNK = 4000;
+
+// buffer might already hold the head of the next pipelined request, left from the previous job
 NetReceiveDataHttp_t::NetReceiveDataHttp_t ( NetStateQL_t *	pState )
 	: ISphNetAction ( pState->m_iClientSock )
 	, m_tState ( pState )
 {
 	assert ( m_tState.Ptr() );
-	m_tState->m_iPos = 0;
-	m_tState->m_iLeft = 4000;
-	m_tState->m_dBuf.Resize ( Max ( m_tState->m_dBuf.GetLimit(), 4000 ) );
+	m_tState->m_iPos = m_tState->m_dBuf.GetLength();
+	m_tState->m_dBuf.Resize ( Max ( m_tState->m_dBuf.GetLimit(), m_tState->m_iPos + HTTP_READ_CHUNK ) );
+	m_tState->m_iLeft = m_tState->m_dBuf.GetLength() - m_tState->m_iPos;
 }
 
 NetEvent_e NetReceiveDataHttp_t::Setup ( int64_t tmNow )
@@ -22747,9 +24708,9 @@ HttpHeaderStreamParser_t::HttpHeaderStreamParser_t ()
 
 bool HttpHeaderStreamParser_t::HeaderFound ( const BYTE * pBuf, int iLen )
 {
-	// early exit at for already found request header
+	// early exit at for already found request header (or nothing new to look at)
 	if ( m_iHeaderEnd || m_iCur>=iLen )
-		return true;
+		return ( m_iHeaderEnd>0 );
 
 	const int iCNwoLFSize = ( g_sContentLengthSize-5 )/2; // size of just Content-Length field name
 	for ( ; m_iCur<iLen; m_iCur++ )
@@ -22786,6 +24747,23 @@ bool HttpHeaderStreamParser_t::HeaderFound ( const BYTE * pBuf, int iLen )
 	return ( m_iHeaderEnd>0 );
 }
 
+// length of the complete request at the buffer start, 0 if it is not received yet, or -1 if it is ill-formed
+static int HttpRequestLength ( const BYTE * pBuf, int iLen )
+{
+	if ( iLen<=0 )
+		return 0;
+
+	HttpHeaderStreamParser_t tParser;
+	if ( !tParser.HeaderFound ( pBuf, iLen ) )
+		return 0;
+
+	int iReqSize = tParser.m_iHeaderEnd + tParser.m_iFieldContentLenVal;
+	if ( tParser.m_iFieldContentLenVal<0 || iReqSize<0 || iReqSize>g_iMaxPacketSize )
+		return -1;
+
+	return ( iReqSize<=iLen ? iReqSize : 0 );
+}
+
 NetEvent_e NetReceiveDataHttp_t::Tick ( DWORD uGotEvents, CSphVector<ISphNetAction *> & , CSphNetLoop * pLoop )
 {
 	assert ( m_tState.Ptr() );
@@ -22796,6 +24774,18 @@ NetEvent_e NetReceiveDataHttp_t::Tick ( DWORD uGotEvents, CSphVector<ISphNetActi
 	// loop to handle similar operations at once
 	while (true)
 	{
+		// header is bigger than we expected (or pipelined requests keep coming)
+		if ( !m_tState->m_iLeft )
+		{
+			if ( m_tState->m_iPos>=g_iMaxPacketSize )
+			{
+				sphWarning ( "ill-formed client request (length=%d out of bounds)", m_tState->m_iPos );
+				return NE_REMOVE;
+			}
+			m_tState->m_dBuf.Resize ( m_tState->m_iPos + HTTP_READ_CHUNK );
+			m_tState->m_iLeft = HTTP_READ_CHUNK;
+		}
+
 		int iRes = NetManageSocket ( m_tState->m_iClientSock, (char *)( m_tState->m_dBuf.Begin() + m_tState->m_iPos ), m_tState->m_iLeft, false, false );
 		if ( iRes==-1 )
 		{
@@ -22806,35 +24796,44 @@ NetEvent_e NetReceiveDataHttp_t::Tick ( DWORD uGotEvents, CSphVector<ISphNetActi
 		m_tState->m_iLeft -= iRes;
 		m_tState->m_iPos += iRes;
 
-		// socket would block - going back to polling
-		if ( iRes==0 && m_tState->m_iLeft )
-			return NE_KEEP;
-
 		// keep fetching data till the end of a header
-		if ( !m_tHeadParser.m_iHeaderEnd )
+		if ( !m_tHeadParser.m_iHeaderEnd && !m_tHeadParser.HeaderFound ( m_tState->m_dBuf.Begin(), m_tState->m_iPos ) )
 		{
-			if ( !m_tHeadParser.HeaderFound ( m_tState->m_dBuf.Begin(), m_tState->m_iPos ) )
-				continue;
+			// socket would block - going back to polling
+			if ( iRes==0 )
+				return NE_KEEP;
+			continue;
+		}
 
-			int iReqSize = m_tHeadParser.m_iHeaderEnd + m_tHeadParser.m_iFieldContentLenVal;
-			if ( m_tHeadParser.m_iFieldContentLenVal && m_tState->m_iPos<iReqSize )
+		// then till the end of a body
+		int iReqSize = m_tHeadParser.m_iHeaderEnd + m_tHeadParser.m_iFieldContentLenVal;
+		if ( m_tHeadParser.m_iFieldContentLenVal<0 || iReqSize<0 || iReqSize>g_iMaxPacketSize )
+		{
+			sphWarning ( "ill-formed client request (length=%d out of bounds)", iReqSize );
+			return NE_REMOVE;
+		}
+		if ( m_tState->m_iPos<iReqSize )
+		{
+			if ( m_tState->m_dBuf.GetLength()<iReqSize )
 			{
 				m_tState->m_dBuf.Resize ( iReqSize );
 				m_tState->m_iLeft = iReqSize - m_tState->m_iPos;
-				continue;
 			}
-
-			m_tState->m_iLeft = 0;
-			m_tState->m_iPos = iReqSize;
-			m_tState->m_dBuf.Resize ( iReqSize + 1 );
-			m_tState->m_dBuf[m_tState->m_iPos] = '\0';
-			m_tState->m_dBuf.Resize ( iReqSize );
+			if ( iRes==0 )
+				return NE_KEEP;
+			continue;
 		}
 
-		// keep reading till end of buffer or data at socket
-		if ( iRes>0 )
+		// request is here; also grab whatever is pipelined after it, till the end of buffer or data at socket
+		if ( iRes>0 && m_tState->m_iLeft )
 			continue;
 
+		// everything past the request is the head of the next pipelined ones
+		m_tState->m_dBuf.Resize ( m_tState->m_iPos + 1 );
+		m_tState->m_dBuf[m_tState->m_iPos] = '\0';
+		m_tState->m_dBuf.Resize ( m_tState->m_iPos );
+		m_tState->m_iLeft = 0;
+
 		pLoop->RemoveIterEvent();
 
 		sphLogDebugv ( "%p HTTP buf=%d, header=%d, content-len=%d, sock=%d, tick=%u", this, m_tState->m_dBuf.GetLength(), m_tHeadParser.m_iHeaderEnd, m_tHeadParser.m_iFieldContentLenVal, m_iSock, pLoop->m_uTick );
@@ -22917,6 +24916,51 @@ void ThdJobAPI_t::Call ()
 }
 
 
+ThdJobMux_t::ThdJobMux_t ( MuxSession_t * pSession, DWORD uId, SearchdCommand_e eCommand, WORD uCommandVer, CSphVector<BYTE> & dBuf )
+	: m_pSession ( pSession )
+	, m_uId ( uId )
+	, m_eCommand ( eCommand )
+	, m_uCommandVer ( uCommandVer )
+{
+	pSession->AddRef();
+	m_dBuf.SwapData ( dBuf );
+}
+
+void ThdJobMux_t::Call ()
+{
+	CrashQuery_t tQueryTLS;
+	SphCrashLogger_c::SetTopQueryTLS ( &tQueryTLS );
+
+	sphLogDebugv ( "%p mux job started, id=%u, command=%d", this, m_uId, m_eCommand );
+
+	ThdDesc_t tThdDesc;
+	tThdDesc.m_eProto = PROTO_SPHINX;
+	tThdDesc.m_iClientSock = m_pSession->m_tState->m_iClientSock;
+	tThdDesc.m_sClientName = m_pSession->m_tState->m_sClientName;
+	tThdDesc.m_iConnID = m_pSession->m_tState->m_iConnID;
+	tThdDesc.m_tmConnect = sphMicroTimer();
+	tThdDesc.m_iTid = GetOsThreadId();
+
+	ThreadAdd ( &tThdDesc );
+
+	MemInputBuffer_c tBuf ( m_dBuf.Begin(), m_dBuf.GetLength() );
+	ISphOutputBuffer tOut;
+
+	if ( g_bMaintenance && !m_pSession->m_tState->m_bVIP )
+		SendErrorReply ( tOut, "server is in maintenance mode" );
+	else
+		LoopClientSphinx ( m_eCommand, m_uCommandVer, m_dBuf.GetLength(), tThdDesc, tBuf, tOut, false );
+
+	ThreadRemove ( &tThdDesc );
+
+	sphLogDebugv ( "%p mux job done, id=%u, command=%d", this, m_uId, m_eCommand );
+
+	// commands without reply (like persist) have nothing to send back
+	if ( !g_bShutdown && tOut.GetSentCount() )
+		m_pSession->SendReply ( m_uId, tOut );
+}
+
+
 ThdJobQL_t::ThdJobQL_t ( CSphNetLoop * pLoop, NetStateQL_t * pState )
 	: m_tState ( pState )
 	, m_pLoop ( pLoop )
@@ -22949,7 +24993,8 @@ void ThdJobQL_t::Call ()
 		m_tState->m_tSession.m_tProfile.Start ( SPH_QSTATE_TOTAL );
 
 	MemInputBuffer_c tIn ( m_tState->m_dBuf.Begin(), m_tState->m_dBuf.GetLength() );
-	ISphOutputBuffer tOut;
+	CSphRefcountedPtr<SmartOutputBuffer_t> pOut ( new SmartOutputBuffer_t );
+	SmartOutputBuffer_t & tOut = *pOut;
 
 	// needed to check permission to turn maintenance mode on/off
 	m_tState->m_tSession.m_tVars.m_bVIP = m_tState->m_bVIP;
@@ -22969,8 +25014,16 @@ void ThdJobQL_t::Call ()
 	if ( bSendResponse && !g_bShutdown )
 	{
 		assert ( m_pLoop );
-		tOut.SwapData ( m_tState->m_dBuf );
-		NetSendData_t * pSend = new NetSendData_t ( m_tState.LeakPtr(), PROTO_MYSQL41 );
+		NetSendData_t * pSend = nullptr;
+		if ( tOut.HasChunks() )
+		{
+			// big reply goes as is, chunk by chunk
+			pSend = new NetSendData_t ( m_tState.LeakPtr(), PROTO_MYSQL41, pOut.Leak() );
+		} else
+		{
+			tOut.SwapData ( m_tState->m_dBuf );
+			pSend = new NetSendData_t ( m_tState.LeakPtr(), PROTO_MYSQL41 );
+		}
 		JobDoSendNB ( pSend, m_pLoop );
 	}
 
@@ -23041,34 +25094,66 @@ void ThdJobHttp_t::Call ()
 
 	assert ( m_tState.Ptr() );
 
-	CrashQuery_t tCrashQuery;
-	tCrashQuery.m_pQuery = m_tState->m_dBuf.Begin();
-	tCrashQuery.m_iSize = m_tState->m_dBuf.GetLength();
-	tCrashQuery.m_bHttp = true;
-	SphCrashLogger_c::SetLastQuery ( tCrashQuery );
+	// handle all the complete pipelined requests at once; replies are queued one after another in the same order
+	CSphRefcountedPtr<SmartOutputBuffer_t> pOut ( new SmartOutputBuffer_t );
+	const BYTE * pBuf = m_tState->m_dBuf.Begin();
+	int iBufLen = m_tState->m_dBuf.GetLength();
+	int iPos = 0;
+	m_tState->m_bKeepSocket = true;
+	while ( m_tState->m_bKeepSocket )
+	{
+		int iReqLen = HttpRequestLength ( pBuf + iPos, iBufLen - iPos );
+		if ( !iReqLen )
+			break;
 
+		// only the first request was checked on receive; bad pipelined one closes the connection
+		if ( iReqLen<0 )
+		{
+			sphWarning ( "ill-formed pipelined client request (length out of bounds)" );
+			CSphVector<BYTE> dError;
+			sphHttpErrorReply ( dError, SPH_HTTP_STATUS_400, "request length out of bounds" );
+			pOut->SendBytes ( dError.Begin(), dError.GetLength() );
+			m_tState->m_bKeepSocket = false;
+			iPos = iBufLen;
+			break;
+		}
 
-	if ( g_bMaintenance && !m_tState->m_bVIP )
-	{
-		sphHttpErrorReply ( m_tState->m_dBuf, SPH_HTTP_STATUS_503, "server is in maintenance mode" );
-		m_tState->m_bKeepSocket = false;
-	} else
-	{
-		CSphVector<BYTE> dResult;
-		m_tState->m_bKeepSocket = sphLoopClientHttp ( m_tState->m_dBuf.Begin(), m_tState->m_dBuf.GetLength(), dResult, tThdDesc );
-		m_tState->m_dBuf = std::move(dResult);
+		CrashQuery_t tCrashQuery;
+		tCrashQuery.m_pQuery = pBuf + iPos;
+		tCrashQuery.m_iSize = iReqLen;
+		tCrashQuery.m_bHttp = true;
+		SphCrashLogger_c::SetLastQuery ( tCrashQuery );
+
+		if ( g_bMaintenance && !m_tState->m_bVIP )
+		{
+			CSphVector<BYTE> dError;
+			sphHttpErrorReply ( dError, SPH_HTTP_STATUS_503, "server is in maintenance mode" );
+			pOut->SendBytes ( dError.Begin(), dError.GetLength() );
+			m_tState->m_bKeepSocket = false;
+		} else
+			m_tState->m_bKeepSocket = sphLoopClientHttp ( pBuf + iPos, iReqLen, *pOut, m_tState->m_iClientSock, tThdDesc );
+
+		iPos += iReqLen;
 	}
+	assert ( iPos>0 );
+
+	// keep the head of the next request (if any) for the next receive
+	int iTail = iBufLen - iPos;
+	if ( iTail )
+		memmove ( m_tState->m_dBuf.Begin(), m_tState->m_dBuf.Begin() + iPos, iTail );
+	m_tState->m_dBuf.Resize ( iTail );
 
 	SphCrashLogger_c::SetLastQuery ( CrashQuery_t() );
 	ThreadRemove ( &tThdDesc );
 
-	sphLogDebugv ( "%p http job done, tick=%u", this, m_pLoop->m_uTick );
+	sphLogDebugv ( "%p http job done, requests=%d bytes, tick=%u", this, iPos, m_pLoop->m_uTick );
 
 	if ( g_bShutdown )
 		return;
 
+	// reply always goes from the chain, as state buffer holds the pipelined tail
 	assert ( m_pLoop );
-	NetSendData_t * pSend = new NetSendData_t ( m_tState.LeakPtr(), PROTO_HTTP );
+	NetSendData_t * pSend = new NetSendData_t ( m_tState.LeakPtr(), PROTO_HTTP, pOut.Leak() );
 	JobDoSendNB ( pSend, m_pLoop );
 }
 
@@ -23240,9 +25325,36 @@ void ConfigureSearchd ( const CSphConfig & hConf, bool bOptPIDFile )
 	if ( hSearchd.Exists ( "persistent_connections_limit" ) && hSearchd["persistent_connections_limit"].intval()>=0 )
 		g_iPersistentPoolSize = hSearchd["persistent_connections_limit"].intval();
 
+	g_iPersistentMux = Max ( hSearchd.GetInt ( "persistent_connections_mux", 0 ), 0 );
+#if !HAVE_POLL
+	if ( g_iPersistentMux )
+	{
+		sphWarning ( "persistent_connections_mux requires poll(); multiplexing disabled" );
+		g_iPersistentMux = 0;
+	}
+#endif
+
 	g_bPreopenIndexes = hSearchd.GetInt ( "preopen_indexes", (int)g_bPreopenIndexes )!=0;
 	sphSetUnlinkOld ( hSearchd.GetInt ( "unlink_old", 1 )!=0 );
 	g_iExpansionLimit = hSearchd.GetInt ( "expansion_limit", 0 );
+	sphSetKeywordDirectory ( hSearchd.GetInt ( "keyword_directory", 0 )!=0 );
+	sphSetExpansionCacheSize ( hSearchd.GetSize64 ( "expansion_cache_max_bytes", 0 ) );
+	sphSetDoclistCacheSize ( hSearchd.GetSize64 ( "doclist_cache_max_bytes", 0 ) );
+	g_tTermStatsCache.Setup ( hSearchd.GetSize64 ( "term_stats_cache_max_bytes", 0 ), hSearchd.GetInt ( "term_stats_cache_ttl_sec", 0 ) );
+
+	g_iMaxQueryMemory = Max ( hSearchd.GetSize64 ( "max_query_memory", 0 ), 0 );
+	g_iMaxQueryCpuMsec = Max ( hSearchd.GetInt ( "max_query_cpu_time", 0 ), 0 );
+	g_iMaxClientMemory = Max ( hSearchd.GetSize64 ( "max_client_memory", 0 ), 0 );
+
+	AdmissionSettings_t tAdmission;
+	tAdmission.m_iMaxExpensive = hSearchd.GetInt ( "max_expensive_queries", 0 );
+	tAdmission.m_iExpensiveMsec = hSearchd.GetInt ( "expensive_query_msec", 0 );
+	tAdmission.m_iRejectMsec = hSearchd.GetInt ( "reject_query_msec", 0 );
+	tAdmission.m_iMaxPerClient = hSearchd.GetInt ( "max_queries_per_client", 0 );
+	tAdmission.m_iMaxPerIndex = hSearchd.GetInt ( "max_queries_per_index", 0 );
+	tAdmission.m_iWaitMsec = Max ( hSearchd.GetInt ( "admission_wait_msec", tAdmission.m_iWaitMsec ), 0 );
+	g_tAdmission.Setup ( tAdmission );
+
 	g_bOnDiskAttrs = ( hSearchd.GetInt ( "ondisk_attrs_default", 0 )==1 );
 	g_bOnDiskPools = ( strcmp ( hSearchd.GetStr ( "ondisk_attrs_default", "" ), "pool" )==0 );
 
@@ -23277,6 +25389,13 @@ void ConfigureSearchd ( const CSphConfig & hConf, bool bOptPIDFile )
 	g_iPingInterval = hSearchd.GetInt ( "ha_ping_interval", 1000 );
 	g_uHAPeriodKarma = hSearchd.GetInt ( "ha_period_karma", 60 );
 	g_iQueryLogMinMsec = hSearchd.GetInt ( "query_log_min_msec", g_iQueryLogMinMsec );
+	int64_t iQueryLogBuffer = hSearchd.GetSize64 ( "query_log_buffer_size", 0 );
+	if ( iQueryLogBuffer>QueryLogWriter_c::MAX_BUFFER_SIZE )
+	{
+		sphWarning ( "query_log_buffer_size " INT64_FMT " out of bounds (max 1G); clamped", iQueryLogBuffer );
+		iQueryLogBuffer = QueryLogWriter_c::MAX_BUFFER_SIZE;
+	}
+	g_tQueryLog.Setup ( (int)Max ( iQueryLogBuffer, 0 ), strcmp ( hSearchd.GetStr ( "query_log_buffer_policy", "block" ), "drop" )!=0 );
 	g_iAgentConnectTimeout = hSearchd.GetInt ( "agent_connect_timeout", g_iAgentConnectTimeout );
 	g_iAgentQueryTimeout = hSearchd.GetInt ( "agent_query_timeout", g_iAgentQueryTimeout );
 	g_iAgentRetryDelay = hSearchd.GetInt ( "agent_retry_delay", g_iAgentRetryDelay );
@@ -23290,6 +25409,8 @@ void ConfigureSearchd ( const CSphConfig & hConf, bool bOptPIDFile )
 	g_iThrottleAccept = hSearchd.GetInt ( "net_throttle_accept", g_iThrottleAccept );
 	g_iNetWorkers = hSearchd.GetInt ( "net_workers", g_iNetWorkers );
 	g_iNetWorkers = Max ( g_iNetWorkers, 1 );
+	g_bNetReuseport = ( hSearchd.GetInt ( "net_workers_reuseport", 0 )!=0 );
+	g_iNetLocalMaxPacket = hSearchd.GetSize ( "net_local_max_packet", g_iNetLocalMaxPacket );
 	CheckSystemTFO();
 	if ( g_iTFO!=TFO_ABSENT && hSearchd.GetInt ( "listen_tfo" )==0 )
 	{
@@ -24291,9 +26412,13 @@ int WINAPI ServiceMain ( int argc, char **argv ) REQUIRES (!MainThread)
 	if ( g_tBinlogAutoflush.m_fnWork && !g_tBinlogFlushThread.Create ( RtBinlogAutoflushThreadFunc, 0 ) )
 		sphDie ( "failed to create binlog flush thread" );
 
-	if ( g_bIOStats && !sphInitIOStats () )
+	// IO counters are always collected for /metrics; --iostats only controls reporting
+	if ( !sphInitIOStats () )
 		sphWarning ( "unable to init IO statistics" );
 
+	if ( !sphInitQueryControl () )
+		sphWarning ( "unable to init query control, KILL and query limits will not work" );
+
 	g_tStats.m_uStarted = (DWORD)time(NULL);
 
 	// threads mode
@@ -24304,6 +26429,9 @@ int WINAPI ServiceMain ( int argc, char **argv ) REQUIRES (!MainThread)
 	if ( !g_tOptimizeThread.Create ( OptimizeThreadFunc, 0 ) )
 		sphDie ( "failed to create optimize thread" );
 
+	if ( g_tQueryLog.IsBuffered() && !g_tQueryLogThread.Create ( QueryLogThreadFunc, 0 ) )
+		sphDie ( "failed to create query log writer thread" );
+
 	g_sSphinxqlState = hSearchd.GetStr ( "sphinxql_state" );
 	if ( !g_sSphinxqlState.IsEmpty() )
 	{
@@ -24365,10 +26493,13 @@ int WINAPI ServiceMain ( int argc, char **argv ) REQUIRES (!MainThread)
 			}
 		}
 
+		if ( g_bNetReuseport && g_iNetWorkers>1 )
+			g_bNetReuseport = CreateNetListeners ( g_iNetWorkers, g_iBacklog );
+
 		g_dTickPoolThread.Resize ( g_iNetWorkers );
 		ARRAY_FOREACH ( iTick, g_dTickPoolThread )
 		{
-			if ( !sphThreadCreate ( g_dTickPoolThread.Begin()+iTick, CSphNetLoop::ThdTick, 0 ) )
+			if ( !sphThreadCreate ( g_dTickPoolThread.Begin()+iTick, CSphNetLoop::ThdTick, (void*)(intptr_t)iTick ) )
 				sphDie ( "failed to create tick pool thread" );
 		}
 	}
@@ -107,6 +107,7 @@
 // declarations for correct work of code analysis
 #include "sphinxutils.h"
 #include "sphinxint.h"
+#include "sphinxjsonquery.h"
 
 const char * sphSockError ( int =0 );
 int sphSockGetErrno ();
@@ -149,6 +150,7 @@ enum SearchdCommand_e : WORD
 	SEARCHD_COMMAND_COMMIT		= 14,
 	SEARCHD_COMMAND_SUGGEST		= 15,
 	SEARCHD_COMMAND_JSON		= 16,
+	SEARCHD_COMMAND_MUX			= 17,
 
 	SEARCHD_COMMAND_TOTAL,
 	SEARCHD_COMMAND_WRONG = SEARCHD_COMMAND_TOTAL,
@@ -168,6 +170,8 @@ enum SearchdCommandV_e : WORD
 	VER_COMMAND_JSON		= 0x100,
 	VER_COMMAND_PING		= 0x100,
 	VER_COMMAND_UVAR		= 0x100,
+	VER_COMMAND_MUX			= 0x100,
+	VER_COMMAND_INSERT		= 0x100,
 
 	VER_COMMAND_WRONG = 0,
 };
@@ -211,6 +215,7 @@ extern ESphLogLevel		g_eLogLevel;
 /// NO data sending itself lives in this class.
 
 #define NETOUTBUF                8192
+#define NETOUTCHUNK              65536
 
 class ISphOutputBuffer : public ISphRefcountedMT
 {
@@ -259,7 +264,13 @@ public:
 	void		SendOutput ( const ISphOutputBuffer & tOut );
 	void		SwapData ( CSphVector<BYTE> & rhs ) { m_dBuf.SwapData ( rhs ); }
 
+	// in-place writing; offsets are from the buffer start
+	int			GetBufLength () const { return m_dBuf.GetLength(); }
+	void		ResizeBuf ( int iLen ) { m_dBuf.Resize ( iLen ); }
+	BYTE *		GetBufAt ( int iOff ) { return m_dBuf.Begin() + iOff; }
+
 	virtual void	Flush () {}
+	virtual void	FinishPacket () {}	///< called on packet boundary; nothing is written in place after that
 	virtual bool	GetError () const { return false; }
 	virtual int		GetSentCount () const { return m_dBuf.GetLength(); }
 	virtual void	SetProfiler ( CSphQueryProfile * ) {}
@@ -329,8 +340,10 @@ public:
 	SmartOutputBuffer_t () = default;
 	~SmartOutputBuffer_t () override;
 	int GetSentCount () const override;
+	void FinishPacket () override;
 
-	void StartNewChunk ();
+	void StartNewChunk ( int iReserve=NETOUTBUF );
+	bool HasChunks () const { return !m_dChunks.IsEmpty(); }
 //	void AppendBuf ( SmartOutputBuffer_t &dBuf );
 //	void PrependBuf ( SmartOutputBuffer_t &dBuf );
 	size_t GetIOVec ( CSphVector<sphIovec> &dOut ) const;
@@ -590,6 +603,37 @@ private:
 };
 #endif
 
+/// per-query resource counters; always collected, summed up per index for /metrics
+struct QueryMetrics_t
+{
+	int64_t		m_iCpuTime = 0;		///< thread cpu time, microseconds
+	int64_t		m_iReadBytes = 0;	///< bytes read from index files
+	int64_t		m_iReadOps = 0;		///< read calls issued against index files
+	int64_t		m_iFetchedDocs = 0;	///< documents decoded from doclists
+	int64_t		m_iFetchedHits = 0;	///< hits decoded from hitlists
+	int64_t		m_iFiltered = 0;	///< matches rejected by filters
+	int64_t		m_iEvicted = 0;		///< matches accepted by sorters but evicted before the result set
+
+	void		Add ( const QueryMetrics_t & tOther );
+};
+
+
+/// cumulative latency histogram over fixed buckets; lock-free, never reset
+struct QueryHistogram_t
+{
+	static const int		BUCKETS = 12;
+	static const int		BOUNDS_MSEC[BUCKETS];	///< upper bucket bounds; the implicit last one is +Inf
+
+	CSphAtomicL				m_dBuckets[BUCKETS+1];	///< per-bucket (non-cumulative) counts
+	CSphAtomicL				m_iSumUsec;
+
+	void					Add ( int64_t iUsec );
+
+	/// emit _bucket, _sum and _count lines in Prometheus text format
+	void					Format ( StringBuilder_c & sOut, const char * sName, const char * sLabels ) const;
+};
+
+
 class ServedStats_c
 {
 public:
@@ -597,6 +641,9 @@ public:
 	virtual				~ServedStats_c();
 
 	void				AddQueryStat ( uint64_t uFoundRows, uint64_t uQueryTime ); //  REQUIRES ( !m_tStatsLock );
+	void				AddQueryMetrics ( const QueryMetrics_t & tMetrics ); //  REQUIRES ( !m_tStatsLock );
+	void				GetQueryMetrics ( QueryMetrics_t & tMetrics, uint64_t & uQueries, uint64_t & uFoundRows ) const; // REQUIRES ( !m_tStatsLock );
+	const QueryHistogram_t & GetQueryHistogram () const { return m_tLatency; }
 						/// since mutex is internal,
 	void				CalculateQueryStats ( QueryStats_t & tRowsFoundStats, QueryStats_t & tQueryTimeStats ) const; // REQUIRES (	!m_tStatsLock );
 #ifndef NDEBUG
@@ -623,6 +670,9 @@ private:
 
 	uint64_t			m_uTotalQueries GUARDED_BY ( m_tStatsLock ) = 0;
 
+	QueryMetrics_t		m_tMetrics GUARDED_BY ( m_tStatsLock );
+	QueryHistogram_t	m_tLatency;
+
 	static void			CalcStatsForInterval ( const QueryStatContainer_i * pContainer, QueryStatElement_t & tRowResult,
 							QueryStatElement_t & tTimeResult, uint64_t uTimestamp, uint64_t uInterval, int iRecords );
 
@@ -995,6 +1045,7 @@ enum SqlStmt_e
 	STMT_RELOAD_INDEXES,
 	STMT_SYSFILTERS,
 	STMT_DEBUG,
+	STMT_KILL,
 
 	STMT_TOTAL
 };
@@ -1210,6 +1261,7 @@ enum ESphHttpEndpoint
 	SPH_HTTP_ENDPOINT_JSON_DELETE,
 	SPH_HTTP_ENDPOINT_JSON_BULK,
 	SPH_HTTP_ENDPOINT_PQ,
+	SPH_HTTP_ENDPOINT_METRICS,
 
 	SPH_HTTP_ENDPOINT_TOTAL
 };
@@ -1225,12 +1277,43 @@ void sphHandleMysqlInsert ( StmtErrorReporter_i & tOut, const SqlStmt_t & tStmt,
 void sphHandleMysqlUpdate ( StmtErrorReporter_i & tOut, const QueryParserFactory_i & tQueryParserFactory, const SqlStmt_t & tStmt, const CSphString & sQuery, CSphString & sWarning, const ThdDesc_t & tThd );
 void sphHandleMysqlDelete ( StmtErrorReporter_i & tOut, const QueryParserFactory_i & tQueryParserFactory, const SqlStmt_t & tStmt, const CSphString & sQuery, bool bCommit, CSphSessionAccum & tAcc, const ThdDesc_t & tThd );
 
-bool				sphLoopClientHttp ( const BYTE * pRequest, int iRequestLen, CSphVector<BYTE> & dResult, const ThdDesc_t & tThd );
+bool				sphLoopClientHttp ( const BYTE * pRequest, int iRequestLen, SmartOutputBuffer_t & tOut, int iSock, const ThdDesc_t & tThd );
 bool				sphProcessHttpQueryNoResponce ( ESphHttpEndpoint eEndpoint, const CSphString & sQuery, const SmallStringHash_T<CSphString> & tOptions, const ThdDesc_t & tThd, CSphVector<BYTE> & dResult );
 void				sphHttpErrorReply ( CSphVector<BYTE> & dData, ESphHttpStatus eCode, const char * szError );
 ESphHttpEndpoint	sphStrToHttpEndpoint ( const CSphString & sEndpoint );
 CSphString			sphHttpEndpointToStr ( ESphHttpEndpoint eEndpoint );
 
+/// reply which body is sent with chunked transfer encoding while it is still being encoded
+/// (small body still goes as a usual reply with Content-Length)
+class HttpChunkedReply_c : public EncodedResultSink_i
+{
+public:
+	HttpChunkedReply_c ( SmartOutputBuffer_t & tOut, int iSock )
+		: m_tOut ( tOut )
+		, m_iSock ( iSock )
+	{}
+
+	void Start ( ESphHttpStatus eCode, const char * sContent );
+	void Flush ( StringBuilder_c & tBody ) override;
+	void Finish ( StringBuilder_c & tBody );
+
+private:
+	SmartOutputBuffer_t &	m_tOut;
+	int						m_iSock;
+	ESphHttpStatus			m_eCode {SPH_HTTP_STATUS_200};
+	const char *			m_sContent {nullptr};
+	bool					m_bChunked {false};	///< header is out, body goes chunk by chunk
+	bool					m_bPush {false};	///< push chunks to the socket right from the worker
+	CSphVector<BYTE>		m_dPending;			///< framed data not sent yet
+	int						m_iSent {0};		///< how much of m_dPending is already sent
+
+	void AddChunk ( const char * sData, int iLen );
+	void Push ();
+};
+
+/// dump daemon, per-index and per-agent counters in Prometheus text exposition format
+void				BuildMetrics ( StringBuilder_c & sOut );
+
 // get tokens from sphinxql
 int sphGetTokTypeInt();
 int sphGetTokTypeFloat();
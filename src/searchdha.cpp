@@ -43,6 +43,7 @@ int				g_iPingInterval		= 0;		// by default ping HA agents every 1 second
 DWORD			g_uHAPeriodKarma	= 60;		// by default use the last 1 minute statistic to determine the best HA agent
 
 int				g_iPersistentPoolSize	= 0;
+int				g_iPersistentMux		= 0;		// multiplexed connections per agent host; 0 means don't multiplex
 
 static auto& g_bShutdown = sphGetShutdown();
 static auto& g_iTFO = sphGetTFO ();
@@ -107,6 +108,9 @@ HostDashboard_t::HostDashboard_t ( const HostDesc_t & tHost )
 HostDashboard_t::~HostDashboard_t ()
 {
 	SafeDelete ( m_pPersPool );
+	if ( m_pMux )
+		m_pMux->Shutdown ();
+	SafeRelease ( m_pMux );
 }
 
 bool HostDashboard_t::IsOlder ( int64_t iTime ) const
@@ -275,7 +279,12 @@ void ClosePersistentSockets()
 {
 	VecRefPtrs_t<HostDashboard_t *> dHosts;
 	g_tDashes.GetActiveDashes ( dHosts );
-	dHosts.Apply ( [] ( HostDashboard_t * &pHost ) { SafeDelete ( pHost->m_pPersPool ); } );
+	dHosts.Apply ( [] ( HostDashboard_t * &pHost ) {
+		SafeDelete ( pHost->m_pPersPool );
+		if ( pHost->m_pMux )
+			pHost->m_pMux->Shutdown ();
+		SafeRelease ( pHost->m_pMux );
+	} );
 }
 
 // check whether sURL contains plain ip-address, and so, m.b. no need to resolve it many times.
@@ -899,6 +908,7 @@ void agent_stats_inc ( AgentConn_t &tAgent, AgentStats_e iCountID )
 	CSphScopedWLock tWguard ( tIndexDash.m_dDataLock );
 	AgentDash_t &tAgentDash = tIndexDash.GetCurrentStat ();
 	tAgentDash.m_dCounters[iCountID]++;
+	tIndexDash.m_dTotalCounters[iCountID]++;
 	if ( iCountID>=eNetworkNonCritical && iCountID<eMaxAgentStat )
 		tIndexDash.m_iErrorsARow = 0;
 	else
@@ -914,6 +924,7 @@ void agent_stats_inc ( AgentConn_t &tAgent, AgentStats_e iCountID )
 	{
 		tAgentDash.m_dMetrics[ehTotalMsecs] += tAgent.m_iEndQuery - tAgent.m_iStartQuery;
 		tAgent.m_tDesc.m_pStats->m_dMetrics[ehTotalMsecs] += tAgent.m_iEndQuery - tAgent.m_iStartQuery;
+		tIndexDash.m_tLatency.Add ( tAgent.m_iEndQuery - tAgent.m_iStartQuery );
 	}
 }
 
@@ -1335,11 +1346,19 @@ int SmartOutputBuffer_t::GetSentCount () const
 	return iSize + m_dBuf.GetLength ();
 }
 
-void SmartOutputBuffer_t::StartNewChunk ()
+void SmartOutputBuffer_t::StartNewChunk ( int iReserve )
 {
 	assert ( BlobsEmpty() );
 	m_dChunks.Add ( new ISphOutputBuffer ( m_dBuf ) );
-	m_dBuf.Reserve ( NETOUTBUF );
+	m_dBuf.Reserve ( iReserve );
+}
+
+// big responses are built as a chain of chunks and then sent scattered,
+// so that they are never reallocated and copied as a whole
+void SmartOutputBuffer_t::FinishPacket ()
+{
+	if ( m_dBuf.GetLength()>=NETOUTCHUNK-NETOUTBUF && BlobsEmpty() )
+		StartNewChunk ( NETOUTCHUNK );
 }
 
 /*
@@ -1391,10 +1410,6 @@ void SmartOutputBuffer_t::LeakTo ( CSphVector<ISphOutputBuffer *> dOut )
 #endif
 
 
-#ifndef UIO_MAXIOV
-#define UIO_MAXIOV (1024)
-#endif
-
 size_t SmartOutputBuffer_t::GetIOVec ( CSphVector<sphIovec> &dOut ) const
 {
 	size_t iOutSize = 0;
@@ -1412,7 +1427,6 @@ size_t SmartOutputBuffer_t::GetIOVec ( CSphVector<sphIovec> &dOut ) const
 		IOLEN ( dIovec ) = m_dBuf.GetLengthBytes ();
 		iOutSize += IOLEN ( dIovec );
 	}
-	assert ( dOut.GetLength ()<UIO_MAXIOV );
 	return iOutSize;
 };
 
@@ -1605,6 +1619,21 @@ bool LoadExFunctions ()
 }
 #endif
 
+/// the reply (or the failure) of a multiplexed request; passed from mux thread to agents poller
+struct MuxReply_t
+{
+	AgentConn_t *	m_pConn = nullptr;			///< addref'ed
+	DWORD			m_uId = 0;
+	WORD			m_uStatus = SEARCHD_ERROR;
+	CSphFixedVector<BYTE> m_dReply { 0 };
+	bool			m_bFailed = false;			///< the connection broke; m_eStat and m_sError tell why
+	bool			m_bUnsupported = false;		///< the host can't multiplex; the request has to go the usual way
+	AgentStats_e	m_eStat = eNetworkErrors;
+	CSphString		m_sError;
+
+	~MuxReply_t () { SafeRelease ( m_pConn ); }
+};
+
 /////////////////////////////////////////////////////////////////////////////
 /// AgentConn_t
 ///
@@ -1614,7 +1643,7 @@ bool LoadExFunctions ()
 AgentConn_t::~AgentConn_t ()
 {
 	sphLogDebugv ( "AgentConn %p destroyed", this );
-	if ( m_iSock>=0 )
+	if ( m_iSock>=0 || m_pMux )
 		Finish ();
 }
 
@@ -1629,7 +1658,7 @@ void AgentConn_t::State ( Agent_e eState )
 // initialize socket from persistent pool (it m.b. disconnected or not initialized, however).
 bool AgentConn_t::IsPersistent ()
 {
-	return m_tDesc.m_bPersistent && m_tDesc.m_pDash && m_tDesc.m_pDash->m_pPersPool;
+	return !m_bMultiplexed && m_tDesc.m_bPersistent && m_tDesc.m_pDash && m_tDesc.m_pDash->m_pPersPool;
 }
 
 
@@ -1682,6 +1711,12 @@ void AgentConn_t::Finish ( bool bFail )
 	LazyDeleteOrChange (); // remove timer and all callbacks, if any
 	m_pPollerTask = nullptr;
 
+	// forget multiplexed request in flight; its reply, if any, will be dropped
+	if ( m_pMux && m_uMuxId )
+		m_pMux->Cancel ( m_uMuxId );
+	m_uMuxId = 0;
+	SafeRelease ( m_pMux );
+
 	ReturnPersist ();
 	if ( m_iStartQuery )
 		m_iWall += sphMicroTimer () - m_iStartQuery; // imitated old behaviour
@@ -1743,6 +1778,9 @@ bool AgentConn_t::StartNextRetry ()
 
 	sphLogDebugA ( "%d Connection %p, host %s, pers=%d", m_iStoreTag, this, m_tDesc.GetMyUrl().cstr(), m_tDesc.m_bPersistent );
 
+	const HostDashboard_t * pDash = m_tDesc.m_pDash;
+	m_bMultiplexed = !IsBlackhole () && m_tDesc.m_bPersistent && pDash && pDash->m_pMux && pDash->m_pMux->IsUsable ();
+
 	if ( IsPersistent() )
 	{
 		assert ( m_iSock==-1 );
@@ -1877,6 +1915,50 @@ void AgentConn_t::RecvCallback ( int64_t iWaited, DWORD uReceived )
 	sphLogDebugA ( "%d <- finished RecvCallback", m_iStoreTag );
 }
 
+void AgentConn_t::MuxReplyCallback ( MuxReply_t & tReply )
+{
+	SetNetLoop ();
+
+	// we've already timed out (and m.b. retried), so that is the reply for nothing
+	if ( !m_uMuxId || m_uMuxId!=tReply.m_uId )
+	{
+		sphLogDebugA ( "%d stale mux reply %u dropped", m_iStoreTag, tReply.m_uId );
+		return;
+	}
+	m_uMuxId = 0; // mux host has already forgotten it
+
+	if ( CheckOrphaned () )
+	{
+		Finish ();
+		return;
+	}
+
+	if ( tReply.m_bUnsupported )
+	{
+		sphLogDebugA ( "%d host can't multiplex, retry with dedicated connection", m_iStoreTag );
+		Finish ();
+		++m_iRetries; // that is not agent's failure, so don't spend a retry on it
+		StartRemoteLoopTry ();
+		return;
+	}
+
+	if ( tReply.m_bFailed )
+	{
+		Fatal ( tReply.m_eStat, "%s", tReply.m_sError.cstr () );
+		StartRemoteLoopTry ();
+		return;
+	}
+
+	m_dReplyBuf.SwapData ( tReply.m_dReply );
+	m_iReplySize = m_dReplyBuf.GetLength ();
+	m_eReplyStatus = ( SearchdStatus_e ) tReply.m_uStatus;
+	if ( CommitResult () )
+		ReportFinish ( true );
+	else
+		StartRemoteLoopTry ();
+	sphLogDebugA ( "%d <- finished MuxReplyCallback", m_iStoreTag );
+}
+
 /// if iovec is empty, prepare (build) the request.
 void AgentConn_t::BuildData ()
 {
@@ -2224,6 +2306,9 @@ void AgentConn_t::StartRemoteLoopTry ()
 bool AgentConn_t::DoQuery()
 {
 	sphLogDebugA ( "%d DoQuery() ref=%d", m_iStoreTag, ( int ) GetRefcount () );
+	if ( m_bMultiplexed )
+		return DoMuxQuery ();
+
 	auto iNow = sphMicroTimer ();
 	if ( m_iSock>=0 )
 	{
@@ -2275,41 +2360,80 @@ bool AgentConn_t::DoQuery()
 	return true;
 }
 
-// here ip resolved; socket is NOT connected.
-// We can initiate connect, or even send the chunk using TFO.
-bool AgentConn_t::EstablishConnection ()
+// put the request into multiplexed connection of the host; the reply comes to MuxReplyCallback
+bool AgentConn_t::DoMuxQuery ()
 {
-	sphLogDebugA ( "%d EstablishConnection() ref=%d", m_iStoreTag, ( int ) GetRefcount () );
-	// first check if we're in bounds of timeout.
-	// usually it is done by outside callback, however in case of deffered DNS we may be here out of sync and so need
-	// to check it explicitly.
-	if ( m_iPoolerTimeout<sphMicroTimer () )
-		return Fatal ( eConnectFailures, "connect timeout reached resolving address for %s", m_tDesc.m_sAddr.cstr () );
+	static CSphAtomic iLastMuxId;
+	sphLogDebugA ( "%d DoMuxQuery() ref=%d", m_iStoreTag, ( int ) GetRefcount () );
 
-	if ( m_tDesc.m_iFamily==AF_INET && !m_tDesc.m_uAddr )
-		return Fatal ( eConnectFailures, "can't get address for %s", m_tDesc.m_sAddr.cstr () );
+	auto * pMux = m_tDesc.m_pDash->m_pMux;
+	if ( pMux )
+	{
+		BuildData ();
+		m_pMux = pMux;
+		m_pMux->AddRef ();
+		do
+			m_uMuxId = ( DWORD ) ++iLastMuxId;
+		while ( !m_uMuxId );
 
-	assert (m_iSock==-1); ///< otherwize why we're here?
+		m_iStartQuery = sphMicroTimer ();
+		m_iPoolerTimeout = m_iStartQuery + 1000 * m_iMyQueryTimeout;
 
+		// timer goes first, since once submitted the reply may come any moment
+		LazyTask ( m_iPoolerTimeout, true );
+		if ( m_pMux->Submit ( this, m_uMuxId, m_tOutput ) )
+			return true;
+	}
+
+	// multiplexing was just switched off, or the host turned out to not support it; retry the usual way
+	sphLogDebugA ( "%d can't multiplex, retry with dedicated connection", m_iStoreTag );
+	Finish ();
+	++m_iRetries;
+	return false;
+}
+
+// fill the address of the (already resolved) host to connect to
+static socklen_t FillSockAddr ( const HostDesc_t & tHost, sockaddr_storage & ss )
+{
 	socklen_t len = 0;
-	sockaddr_storage ss = {0};
-	ss.ss_family = m_tDesc.m_iFamily;
+	ss.ss_family = tHost.m_iFamily;
 
 	if ( ss.ss_family==AF_INET )
 	{
 		auto * pIn = ( struct sockaddr_in * ) &ss;
-		pIn->sin_port = htons ( ( unsigned short ) m_tDesc.m_iPort );
-		pIn->sin_addr.s_addr = m_tDesc.m_uAddr;
+		pIn->sin_port = htons ( ( unsigned short ) tHost.m_iPort );
+		pIn->sin_addr.s_addr = tHost.m_uAddr;
 		len = sizeof ( *pIn );
 	}
 #if !USE_WINDOWS
 	else if ( ss.ss_family==AF_UNIX )
 	{
 		auto * pUn = ( struct sockaddr_un * ) &ss;
-		strncpy ( pUn->sun_path, m_tDesc.m_sAddr.cstr (), sizeof ( pUn->sun_path ) );
+		strncpy ( pUn->sun_path, tHost.m_sAddr.cstr (), sizeof ( pUn->sun_path ) );
 		len = sizeof ( *pUn );
 	}
 #endif
+	return len;
+}
+
+// here ip resolved; socket is NOT connected.
+// We can initiate connect, or even send the chunk using TFO.
+bool AgentConn_t::EstablishConnection ()
+{
+	sphLogDebugA ( "%d EstablishConnection() ref=%d", m_iStoreTag, ( int ) GetRefcount () );
+	// first check if we're in bounds of timeout.
+	// usually it is done by outside callback, however in case of deffered DNS we may be here out of sync and so need
+	// to check it explicitly.
+	if ( m_iPoolerTimeout<sphMicroTimer () )
+		return Fatal ( eConnectFailures, "connect timeout reached resolving address for %s", m_tDesc.m_sAddr.cstr () );
+
+	if ( m_tDesc.m_iFamily==AF_INET && !m_tDesc.m_uAddr )
+		return Fatal ( eConnectFailures, "can't get address for %s", m_tDesc.m_sAddr.cstr () );
+
+	assert (m_iSock==-1); ///< otherwize why we're here?
+
+	sockaddr_storage ss = {0};
+	socklen_t len = FillSockAddr ( m_tDesc, ss );
 
 	m_iSock = socket ( m_tDesc.m_iFamily, SOCK_STREAM, 0 );
 	sphLogDebugA ( "%d Created new socket %d", m_iStoreTag, m_iSock );
@@ -3416,6 +3540,7 @@ class LazyNetEvents_c : ISphNoncopyable, protected NetEventsFlavour_c
 
 	// stuff to transfer (enqueue) tasks
 	VectorTask_c *	m_pEnqueuedTasks GUARDED_BY (m_dActiveLock) = nullptr; // ext. mt queue where we add tasks
+	CSphVector<MuxReply_t *> * m_pMuxReplies GUARDED_BY (m_dActiveLock) = nullptr; // replies came from mux thread
 	VectorTask_c	m_dInternalTasks; // internal queue where we add our tasks without mutex
 	CSphMutex	m_dActiveLock;
 	TimeoutQueue_c m_dTimeouts;
@@ -3549,6 +3674,31 @@ private:
 		m_dInternalTasks.Reset ();
 	}
 
+	/// atomically take the replies of multiplexed requests.
+	CSphVector<MuxReply_t *> * PopMuxReplies () EXCLUDES ( m_dActiveLock )
+	{
+		ScopedMutex_t tLock ( m_dActiveLock );
+		auto * pReplies = m_pMuxReplies;
+		m_pMuxReplies = nullptr;
+		return pReplies;
+	}
+
+	/// pass the replies of multiplexed requests to their agents
+	void ProcessMuxReplies () REQUIRES ( LazyThread )
+	{
+		auto * pReplies = PopMuxReplies ();
+		if ( !pReplies )
+			return;
+
+		sphLogDebugL ( "L processing %d mux replies", pReplies->GetLength () );
+		for ( auto * pReply : *pReplies )
+		{
+			pReply->m_pConn->MuxReplyCallback ( *pReply );
+			SafeDelete ( pReply );
+		}
+		SafeDelete ( pReplies );
+	}
+
 	/// main event loop run in separate thread.
 	void EventLoop () REQUIRES ( LazyThread )
 	{
@@ -3622,6 +3772,7 @@ private:
 	bool EventTick () REQUIRES ( LazyThread )
 	{
 		sphLogDebugL ( "L ---------------------------- EventTick(%d)", m_iTickNo );
+		ProcessMuxReplies ();
 		do
 			ProcessEnqueuedTasks ();
 		while ( HasTimeoutActions () );
@@ -3779,6 +3930,12 @@ public:
 		Fire();
 		sphThreadJoin ( &m_dWorkingThread );
 		events_destroy();
+
+		// replies came after the loop is done; agents are already aborted
+		auto * pReplies = PopMuxReplies ();
+		if ( pReplies )
+			pReplies->Apply ( [] ( MuxReply_t * & pReply ) { SafeDelete ( pReply ); } );
+		SafeDelete ( pReplies );
 	}
 
 	/// New task (only applied to fresh connections; skip already enqueued)
@@ -3850,6 +4007,19 @@ public:
 		}
 	}
 
+	/// take replies of multiplexed requests (will be processed in the loop)
+	void EnqueueMuxReplies ( CSphVector<MuxReply_t *> & dReplies ) EXCLUDES ( m_dActiveLock )
+	{
+		{
+			ScopedMutex_t tLock ( m_dActiveLock );
+			if ( !m_pMuxReplies )
+				m_pMuxReplies = new CSphVector<MuxReply_t *>;
+			m_pMuxReplies->Append ( dReplies );
+		}
+		dReplies.Resize ( 0 );
+		Fire ();
+	}
+
 	/// then signal the poller.
 	void Fire ()
 	{
@@ -3910,6 +4080,583 @@ void FirePoller ()
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// multiplexed connections to agents
+//
+// protocol: after usual handshake, the master sends SEARCHD_COMMAND_MUX, and once agent replied OK,
+// the connection carries frames. Request frame is [DWORD id][usual API request], reply frame is
+// [DWORD id][usual API reply]; the agent handles requests concurrently and replies them in any order.
+/////////////////////////////////////////////////////////////////////////////
+
+enum MuxState_e
+{
+	MUX_CLOSED,		///< no connection
+	MUX_HANDSHAKE,	///< connecting, or waiting the reply to mux command
+	MUX_READY		///< sending requests and receiving replies
+};
+
+static const int MUX_FRAME_HEADER_SIZE = 12;	///< id, status (or command), version, length
+static const int MUX_HANDSHAKE_REPLY_SIZE = 12;	///< protocol version + reply header
+static const int MUX_RECV_CHUNK = 65536;
+
+/// one multiplexed connection; everything is guarded by the lock of the host
+struct MuxChannel_t
+{
+	int					m_iSock = -1;
+	MuxState_e			m_eState = MUX_CLOSED;
+	int64_t				m_tmDeadline = 0;	///< when connect and handshake time out
+	CSphVector<BYTE>	m_dOut;				///< frames to send
+	int					m_iOutPos = 0;		///< how many bytes of them are already sent
+	int					m_iHandshakeLen = 0;	///< the head of m_dOut which is sent before mux command is replied
+	CSphVector<BYTE>	m_dIn;				///< received, but not yet parsed bytes
+	CSphOrderedHash<AgentConn_t *, DWORD, IdentityHash_fn, 256> m_hPending;	///< requests in flight (addref'ed)
+};
+
+// the frames are held until the agent replied mux command, since the one who can't
+// multiplex will just drop the connection after error reply
+static int SendableBytes ( const MuxChannel_t & tChannel )
+{
+	if ( tChannel.m_eState==MUX_READY )
+		return tChannel.m_dOut.GetLength ();
+	return Min ( tChannel.m_iHandshakeLen, tChannel.m_dOut.GetLength () );
+}
+
+MuxParse_e ParseMuxReplies ( const BYTE * pBuf, int iLen, bool & bHandshake, CSphVector<MuxFrame_t> & dFrames,
+	int & iParsed, CSphString & sError )
+{
+	iParsed = 0;
+
+	if ( bHandshake )
+	{
+		if ( iLen<MUX_HANDSHAKE_REPLY_SIZE )
+			return MUX_PARSE_OK;
+
+		MemInputBuffer_c tIn ( pBuf, MUX_HANDSHAKE_REPLY_SIZE );
+		auto iVer = tIn.GetInt ();
+		auto uStat = tIn.GetWord ();
+		tIn.GetWord (); // version of the reply
+		auto iReplySize = tIn.GetInt ();
+
+		if ( iVer!=SPHINX_SEARCHD_PROTO && iVer!=0x01000000UL )
+		{
+			sError.SetSprintf ( "handshake failure (unexpected protocol version=%d)", iVer );
+			return MUX_PARSE_BROKEN;
+		}
+
+		if ( iReplySize<0 || iReplySize>g_iMaxPacketSize )
+		{
+			sError.SetSprintf ( "invalid packet size (status=%d, len=%d, max_packet_size=%d)", uStat, iReplySize, g_iMaxPacketSize );
+			return MUX_PARSE_BROKEN;
+		}
+
+		if ( iLen<MUX_HANDSHAKE_REPLY_SIZE+iReplySize )
+			return MUX_PARSE_OK;
+
+		if ( uStat!=SEARCHD_OK )
+			return MUX_PARSE_UNSUPPORTED;
+
+		bHandshake = false;
+		iParsed = MUX_HANDSHAKE_REPLY_SIZE + iReplySize;
+	}
+
+	while ( iLen-iParsed>=MUX_FRAME_HEADER_SIZE )
+	{
+		MemInputBuffer_c tIn ( pBuf + iParsed, MUX_FRAME_HEADER_SIZE );
+		MuxFrame_t tFrame;
+		tFrame.m_uId = tIn.GetDword ();
+		tFrame.m_uStatus = tIn.GetWord ();
+		tIn.GetWord (); // version of the reply
+		tFrame.m_iLen = tIn.GetInt ();
+
+		if ( tFrame.m_iLen<0 || tFrame.m_iLen>g_iMaxPacketSize )
+		{
+			sError.SetSprintf ( "invalid packet size (status=%d, len=%d, max_packet_size=%d)", tFrame.m_uStatus, tFrame.m_iLen, g_iMaxPacketSize );
+			return MUX_PARSE_BROKEN;
+		}
+
+		if ( iLen-iParsed-MUX_FRAME_HEADER_SIZE<tFrame.m_iLen )
+			break;
+
+		tFrame.m_iOffset = iParsed + MUX_FRAME_HEADER_SIZE;
+		dFrames.Add ( tFrame );
+		iParsed += MUX_FRAME_HEADER_SIZE + tFrame.m_iLen;
+	}
+
+	return MUX_PARSE_OK;
+}
+
+struct MuxPolled_t
+{
+	MuxHost_c *		m_pHost;
+	MuxChannel_t *	m_pChannel;
+};
+
+/// the thread which does the io over all the multiplexed connections
+class MuxPoller_c : ISphNoncopyable
+{
+	CSphMutex					m_tLock;
+	CSphVector<MuxHost_c *>		m_dHosts GUARDED_BY ( m_tLock );	///< addref'ed
+	PollableEvent_t				m_tWakeup;
+	SphThread_t					m_tThread;
+
+public:
+	MuxPoller_c ()
+	{
+		SphCrashLogger_c::ThreadCreate ( &m_tThread, WorkerFunc, this );
+	}
+
+	~MuxPoller_c ()
+	{
+		Wake ();
+		sphThreadJoin ( &m_tThread );
+		ScopedMutex_t tLock ( m_tLock );
+		m_dHosts.Apply ( [] ( MuxHost_c * & pHost ) { SafeRelease ( pHost ); } );
+	}
+
+	void AddHost ( MuxHost_c * pHost ) EXCLUDES ( m_tLock )
+	{
+		ScopedMutex_t tLock ( m_tLock );
+		pHost->AddRef ();
+		m_dHosts.Add ( pHost );
+	}
+
+	void Wake ()
+	{
+		m_tWakeup.FireEvent ();
+	}
+
+private:
+	static void WorkerFunc ( void * pArg )
+	{
+		( ( MuxPoller_c * ) pArg )->Loop ();
+	}
+
+	void Loop () EXCLUDES ( m_tLock )
+	{
+		CSphVector<MuxHost_c *> dHosts;
+		CSphVector<MuxPolled_t> dPolled;
+		CSphVector<MuxReply_t *> dReplies;
+#if HAVE_POLL
+		CSphVector<pollfd> dFds;
+
+		while ( !g_bShutdown )
+		{
+			{
+				ScopedMutex_t tLock ( m_tLock );
+				dHosts = m_dHosts;
+				dHosts.Apply ( [] ( MuxHost_c * pHost ) { pHost->AddRef (); } );
+			}
+
+			auto tmNow = sphMicroTimer ();
+			auto tmWake = tmNow + 1000000; // look around at least once a second
+			dFds.Resize ( 0 );
+			dPolled.Resize ( 0 );
+
+			auto & tWakeup = dFds.Add ();
+			tWakeup.fd = m_tWakeup.m_iPollablefd;
+			tWakeup.events = POLLIN;
+			tWakeup.revents = 0;
+			dPolled.Add ( { nullptr, nullptr } );
+
+			for ( auto * pHost : dHosts )
+				if ( !Prepare ( *pHost, tmNow, tmWake, dFds, dPolled, dReplies ) )
+					RemoveHost ( pHost );
+			Deliver ( dReplies );
+
+			int iRes = ::poll ( dFds.Begin (), dFds.GetLength (), (int) Max ( ( tmWake-tmNow )/1000, 1 ) );
+			if ( iRes>0 )
+			{
+				if ( dFds[0].revents )
+					m_tWakeup.DisposeEvent ();
+
+				for ( int i=1; i<dFds.GetLength (); ++i )
+					if ( dFds[i].revents )
+						Process ( *dPolled[i].m_pHost, *dPolled[i].m_pChannel, dFds[i].revents, dReplies );
+				Deliver ( dReplies );
+			}
+
+			dHosts.Apply ( [] ( MuxHost_c * & pHost ) { SafeRelease ( pHost ); } );
+		}
+#endif
+	}
+
+	void RemoveHost ( MuxHost_c * pHost ) EXCLUDES ( m_tLock )
+	{
+		ScopedMutex_t tLock ( m_tLock );
+		if ( m_dHosts.RemoveValue ( pHost ) )
+			pHost->Release ();
+	}
+
+	static void Deliver ( CSphVector<MuxReply_t *> & dReplies )
+	{
+		if ( !dReplies.IsEmpty () )
+			LazyPoller ().EnqueueMuxReplies ( dReplies );
+	}
+
+#if HAVE_POLL
+	/// open and close channels as necessary, and tell which sockets to poll
+	/// \return false when the host is shut down and has to be forgotten
+	static bool Prepare ( MuxHost_c & tHost, int64_t tmNow, int64_t & tmWake, CSphVector<pollfd> & dFds,
+		CSphVector<MuxPolled_t> & dPolled, CSphVector<MuxReply_t *> & dReplies )
+	{
+		ScopedMutex_t tLock ( tHost.m_tLock );
+		if ( tHost.m_bShutdown )
+		{
+			for ( auto * pChannel : tHost.m_dChannels )
+				Break ( *pChannel, dReplies, false, eNetworkErrors, "agent connections are shut down" );
+			return false;
+		}
+
+		// the channels beyond the limit are dropped (their requests will be retried)
+		while ( tHost.m_dChannels.GetLength ()>tHost.m_iWanted )
+		{
+			auto * pChannel = tHost.m_dChannels.Pop ();
+			Break ( *pChannel, dReplies, false, eNetworkErrors, "connection is closed by reconfiguration" );
+			SafeDelete ( pChannel );
+		}
+
+		for ( auto * pChannel : tHost.m_dChannels )
+		{
+			MuxChannel_t & tChannel = *pChannel;
+			if ( tChannel.m_eState==MUX_CLOSED && tChannel.m_hPending.GetLength () )
+				Connect ( tHost, tChannel, tmNow, dReplies );
+
+			if ( tChannel.m_eState==MUX_HANDSHAKE )
+			{
+				if ( tChannel.m_tmDeadline<=tmNow )
+				{
+					Break ( tChannel, dReplies, false, eTimeoutsConnect, "connect timed out" );
+					continue;
+				}
+				tmWake = Min ( tmWake, tChannel.m_tmDeadline );
+			}
+
+			if ( tChannel.m_iSock<0 )
+				continue;
+
+			auto & tFd = dFds.Add ();
+			tFd.fd = tChannel.m_iSock;
+			tFd.events = POLLIN;
+			if ( tChannel.m_iOutPos<SendableBytes ( tChannel ) )
+				tFd.events |= POLLOUT;
+			tFd.revents = 0;
+			dPolled.Add ( { &tHost, pChannel } );
+		}
+		return true;
+	}
+
+	/// do the io on the ready channel
+	static void Process ( MuxHost_c & tHost, MuxChannel_t & tChannel, int iEvents, CSphVector<MuxReply_t *> & dReplies )
+	{
+		ScopedMutex_t tLock ( tHost.m_tLock );
+		if ( ( iEvents & POLLOUT ) && !Send ( tChannel, dReplies ) )
+			return;
+
+		if ( iEvents & ( POLLIN | POLLERR | POLLHUP ) )
+			Receive ( tHost, tChannel, dReplies );
+	}
+#endif
+
+	/// start connecting; the mux command goes ahead of the requests
+	static void Connect ( const MuxHost_c & tHost, MuxChannel_t & tChannel, int64_t tmNow, CSphVector<MuxReply_t *> & dReplies )
+	{
+		const HostDesc_t & tDesc = tHost.m_tHost;
+		sockaddr_storage ss = {0};
+		socklen_t len = FillSockAddr ( tDesc, ss );
+
+		tChannel.m_iSock = socket ( tDesc.m_iFamily, SOCK_STREAM, 0 );
+		if ( tChannel.m_iSock<0 )
+			return Break ( tChannel, dReplies, false, eConnectFailures, "socket() failed: %s", sphSockError () );
+
+		if ( sphSetSockNB ( tChannel.m_iSock )<0 )
+			return Break ( tChannel, dReplies, false, eConnectFailures, "sphSetSockNB() failed: %s", sphSockError () );
+
+		if ( ::connect ( tChannel.m_iSock, ( struct sockaddr * ) &ss, len )<0 )
+		{
+			int iErr = sphSockGetErrno ();
+			if ( iErr==EINTR || !IS_PENDING_PROGRESS ( iErr ) )
+				return Break ( tChannel, dReplies, false, eConnectFailures, "connect() failed: errno=%d, %s", iErr, sphSockError ( iErr ) );
+		}
+
+		ISphOutputBuffer tOut;
+		tOut.SendDword ( SPHINX_CLIENT_VERSION );
+		tOut.SendWord ( SEARCHD_COMMAND_MUX );
+		tOut.SendWord ( VER_COMMAND_MUX );
+		tOut.SendInt ( 4 ); // request body length
+		tOut.SendInt ( 1 ); // multiplexing protocol revision
+
+		CSphVector<BYTE> dOut;
+		tOut.SwapData ( dOut );
+		tChannel.m_iHandshakeLen = dOut.GetLength ();
+		dOut.Append ( tChannel.m_dOut );
+		tChannel.m_dOut.SwapData ( dOut );
+		tChannel.m_iOutPos = 0;
+
+		tChannel.m_eState = MUX_HANDSHAKE;
+		tChannel.m_tmDeadline = tmNow + 1000 * g_iAgentConnectTimeout;
+		sphLogDebugv ( "mux connection %d to %s initiated", tChannel.m_iSock, tDesc.GetMyUrl ().cstr () );
+	}
+
+	/// close the channel; requests in flight are failed (so that agents will retry them)
+	static void Break ( MuxChannel_t & tChannel, CSphVector<MuxReply_t *> & dReplies, bool bUnsupported,
+		AgentStats_e eStat, const char * sFmt, ... ) __attribute__ ( ( format ( printf, 5, 6 ) ) );
+
+	/// \return false if the channel broke
+	static bool Send ( MuxChannel_t & tChannel, CSphVector<MuxReply_t *> & dReplies )
+	{
+		int iSendable = SendableBytes ( tChannel );
+		while ( tChannel.m_iOutPos<iSendable )
+		{
+			auto iRes = sphSockSend ( tChannel.m_iSock, ( const char * ) tChannel.m_dOut.Begin () + tChannel.m_iOutPos,
+				iSendable - tChannel.m_iOutPos );
+			if ( iRes<0 )
+			{
+				int iErr = sphSockGetErrno ();
+				if ( iErr==EINTR )
+					continue;
+				if ( IS_PENDING_PROGRESS ( iErr ) )
+					return true;
+				Break ( tChannel, dReplies, false, tChannel.m_eState==MUX_HANDSHAKE ? eConnectFailures : eNetworkErrors,
+					"error when sending data: %s", sphSockError ( iErr ) );
+				return false;
+			}
+			tChannel.m_iOutPos += iRes;
+		}
+
+		if ( tChannel.m_iOutPos==tChannel.m_dOut.GetLength () )
+		{
+			tChannel.m_dOut.Resize ( 0 );
+			tChannel.m_iOutPos = 0;
+			tChannel.m_iHandshakeLen = 0;
+		}
+		return true;
+	}
+
+	static void Receive ( MuxHost_c & tHost, MuxChannel_t & tChannel, CSphVector<MuxReply_t *> & dReplies )
+	{
+		while (true)
+		{
+			int iHave = tChannel.m_dIn.GetLength ();
+			tChannel.m_dIn.Resize ( iHave + MUX_RECV_CHUNK );
+			auto iRes = sphSockRecv ( tChannel.m_iSock, ( char * ) tChannel.m_dIn.Begin () + iHave, MUX_RECV_CHUNK );
+			tChannel.m_dIn.Resize ( iHave + Max ( (int) iRes, 0 ) );
+
+			if ( !iRes )
+				return Break ( tChannel, dReplies, false, eUnexpectedClose, "agent closed connection" );
+
+			if ( iRes<0 )
+			{
+				int iErr = sphSockGetErrno ();
+				if ( iErr==EINTR )
+					continue;
+				if ( IS_PENDING ( iErr ) )
+					break;
+				return Break ( tChannel, dReplies, false, eNetworkErrors, "receiving failure (errno=%d, msg=%s)", iErr, sphSockError ( iErr ) );
+			}
+
+			if ( iRes<MUX_RECV_CHUNK )
+				break;
+		}
+
+		ParseReplies ( tHost, tChannel, dReplies );
+	}
+
+	static void ParseReplies ( MuxHost_c & tHost, MuxChannel_t & tChannel, CSphVector<MuxReply_t *> & dReplies )
+	{
+		const BYTE * pBuf = tChannel.m_dIn.Begin ();
+		int iLen = tChannel.m_dIn.GetLength ();
+		bool bHandshake = tChannel.m_eState==MUX_HANDSHAKE;
+		CSphVector<MuxFrame_t> dFrames;
+		int iPos = 0;
+		CSphString sError;
+
+		switch ( ParseMuxReplies ( pBuf, iLen, bHandshake, dFrames, iPos, sError ) )
+		{
+		case MUX_PARSE_BROKEN:
+			return Break ( tChannel, dReplies, false, eWrongReplies, "%s", sError.cstr () );
+
+		// old agent, or one not in thread_pool mode; it will be queried the usual way from now on
+		case MUX_PARSE_UNSUPPORTED:
+			if ( !tHost.m_bUnsupported )
+				sphWarning ( "agent %s can't multiplex connections; using persistent ones", tHost.m_tHost.GetMyUrl ().cstr () );
+			tHost.m_bUnsupported = true;
+			return Break ( tChannel, dReplies, true, eWrongReplies, "multiplexing is not supported by the agent" );
+
+		default:
+			break;
+		}
+
+		if ( tChannel.m_eState==MUX_HANDSHAKE && !bHandshake )
+		{
+			sphLogDebugv ( "mux connection %d is ready", tChannel.m_iSock );
+			tChannel.m_eState = MUX_READY;
+		}
+
+		// no pending request means it is cancelled (timed out); the reply is just dropped
+		for ( const auto & tFrame : dFrames )
+		{
+			AgentConn_t ** ppConn = tChannel.m_hPending ( tFrame.m_uId );
+			if ( !ppConn )
+				continue;
+
+			auto * pReply = new MuxReply_t;
+			pReply->m_pConn = *ppConn;
+			pReply->m_uId = tFrame.m_uId;
+			pReply->m_uStatus = tFrame.m_uStatus;
+			pReply->m_dReply.Reset ( tFrame.m_iLen );
+			memcpy ( pReply->m_dReply.Begin (), pBuf + tFrame.m_iOffset, tFrame.m_iLen );
+			dReplies.Add ( pReply );
+			tChannel.m_hPending.Delete ( tFrame.m_uId );
+		}
+
+		// keep the incomplete frame
+		int iRest = iLen - iPos;
+		if ( iPos && iRest )
+			memmove ( tChannel.m_dIn.Begin (), pBuf + iPos, iRest );
+		tChannel.m_dIn.Resize ( iRest );
+	}
+};
+
+void MuxPoller_c::Break ( MuxChannel_t & tChannel, CSphVector<MuxReply_t *> & dReplies, bool bUnsupported,
+	AgentStats_e eStat, const char * sFmt, ... )
+{
+	CSphString sError;
+	va_list ap;
+	va_start ( ap, sFmt );
+	sError.SetSprintfVa ( sFmt, ap );
+	va_end ( ap );
+	sphLogDebugv ( "mux connection %d closed (%d requests in flight): %s", tChannel.m_iSock, tChannel.m_hPending.GetLength (), sError.cstr () );
+
+	SafeCloseSocket ( tChannel.m_iSock );
+	tChannel.m_eState = MUX_CLOSED;
+	tChannel.m_dOut.Reset ();
+	tChannel.m_iOutPos = 0;
+	tChannel.m_iHandshakeLen = 0;
+	tChannel.m_dIn.Reset ();
+
+	tChannel.m_hPending.IterateStart ();
+	while ( tChannel.m_hPending.IterateNext () )
+	{
+		auto * pReply = new MuxReply_t;
+		pReply->m_pConn = tChannel.m_hPending.IterateGet ();
+		pReply->m_uId = tChannel.m_hPending.IterateGetKey ();
+		pReply->m_bFailed = true;
+		pReply->m_bUnsupported = bUnsupported;
+		pReply->m_eStat = eStat;
+		pReply->m_sError = sError;
+		dReplies.Add ( pReply );
+	}
+	tChannel.m_hPending.Reset ();
+}
+
+//! Get static (singletone) instance of mux poller
+static MuxPoller_c & MuxPoller ()
+{
+	static MuxPoller_c tPoller;
+	return tPoller;
+}
+
+MuxHost_c::MuxHost_c ( const HostDesc_t & tHost )
+{
+	m_tHost.CloneFromHost ( tHost );
+	MuxPoller ().AddHost ( this );
+}
+
+MuxHost_c::~MuxHost_c ()
+{
+	for ( auto * pChannel : m_dChannels )
+	{
+		assert ( !pChannel->m_hPending.GetLength () );
+		SafeCloseSocket ( pChannel->m_iSock );
+		SafeDelete ( pChannel );
+	}
+}
+
+void MuxHost_c::ReInit ( int iChannels )
+{
+	ScopedMutex_t tLock ( m_tLock );
+	m_iWanted = iChannels;
+	while ( m_dChannels.GetLength ()<iChannels )
+		m_dChannels.Add ( new MuxChannel_t );
+
+	// the agent m.b. already upgraded
+	m_bUnsupported = false;
+}
+
+bool MuxHost_c::IsUsable () const
+{
+#if HAVE_POLL
+	if ( m_bUnsupported || m_tHost.m_bNeedResolve )
+		return false;
+
+	ScopedMutex_t tLock ( m_tLock );
+	return !m_bShutdown && m_iWanted>0;
+#else
+	// the poller loop can not serve any channels without poll()
+	return false;
+#endif
+}
+
+// put the request into the least busy channel
+bool MuxHost_c::Submit ( AgentConn_t * pConn, DWORD uId, const SmartOutputBuffer_t & tRequest )
+{
+	assert ( pConn && uId );
+	CSphVector<sphIovec> dRequest;
+	tRequest.GetIOVec ( dRequest );
+
+	{
+		ScopedMutex_t tLock ( m_tLock );
+		if ( m_bShutdown || m_bUnsupported || !m_iWanted )
+			return false;
+
+		MuxChannel_t * pChannel = m_dChannels[0];
+		for ( int i=1; i<m_iWanted; ++i )
+			if ( m_dChannels[i]->m_hPending.GetLength ()<pChannel->m_hPending.GetLength () )
+				pChannel = m_dChannels[i];
+
+		DWORD uNetId = htonl ( uId );
+		pChannel->m_dOut.Append ( &uNetId, sizeof ( uNetId ) );
+		for ( const auto & tChunk : dRequest )
+			pChannel->m_dOut.Append ( ( const void * ) IOPTR ( tChunk ), ( int ) IOLEN ( tChunk ) );
+
+		pConn->AddRef ();
+		pChannel->m_hPending.Add ( pConn, uId );
+	}
+
+	MuxPoller ().Wake ();
+	return true;
+}
+
+void MuxHost_c::Cancel ( DWORD uId )
+{
+	AgentConn_t * pConn = nullptr;
+	{
+		ScopedMutex_t tLock ( m_tLock );
+		for ( auto * pChannel : m_dChannels )
+		{
+			AgentConn_t ** ppConn = pChannel->m_hPending ( uId );
+			if ( ppConn )
+			{
+				pConn = *ppConn;
+				pChannel->m_hPending.Delete ( uId );
+				break;
+			}
+		}
+	}
+	SafeRelease ( pConn );
+}
+
+// requests in flight are failed by mux thread, then it forgets the host
+void MuxHost_c::Shutdown ()
+{
+	{
+		ScopedMutex_t tLock ( m_tLock );
+		m_bShutdown = true;
+	}
+	MuxPoller ().Wake ();
+}
+
+
 class CRemoteAgentsObserver : public IRemoteAgentsObserver
 {
 public:
@@ -44,6 +44,7 @@ extern int				g_iReadTimeout; // defined in searchd.cpp
 extern int				g_iPingInterval;		// by default ping HA agents every 1 second
 extern DWORD			g_uHAPeriodKarma;		// by default use the last 1 minute statistic to determine the best HA agent
 extern int				g_iPersistentPoolSize;
+extern int				g_iPersistentMux;
 
 extern int				g_iAgentConnectTimeout;
 extern int				g_iAgentQueryTimeout;	// global (default). May be override by index-scope values, if one specified
@@ -231,12 +232,67 @@ struct AgentOptions_t
 extern const char * sAgentStatsNames[eMaxAgentStat + ehMaxStat];
 using HostStatSnapshot_t = uint64_t[eMaxAgentStat + ehMaxStat];
 
+struct AgentConn_t;
+struct MuxChannel_t;
+struct MuxReply_t;
+
+// manages multiplexed persistent connections to a host.
+// Unlike the pool, the connection is not rented for the whole query: every request is
+// tagged with an id and put into the least busy connection, so that many queries share
+// a few sockets, and the host replies them in any order. All the io is done by the mux thread;
+// the replies are passed to the agents poller (see AgentConn_t::MuxReplyCallback).
+class MuxHost_c : public ISphRefcountedMT
+{
+	mutable CSphMutex	m_tLock;
+	HostDesc_t			m_tHost;
+	CSphVector<MuxChannel_t *> m_dChannels GUARDED_BY ( m_tLock );
+	int					m_iWanted GUARDED_BY ( m_tLock ) = 0;	// exact num of channels (extra ones are closed by mux thread)
+	bool				m_bShutdown GUARDED_BY ( m_tLock ) = false;
+	volatile bool		m_bUnsupported = false;	// the host replied error to mux handshake; use the pool instead
+
+	friend class MuxPoller_c;
+
+public:
+	explicit MuxHost_c ( const HostDesc_t &tHost );
+	void	ReInit ( int iChannels ) REQUIRES ( !m_tLock );
+	bool	IsUsable () const REQUIRES ( !m_tLock );
+	bool	Submit ( AgentConn_t * pConn, DWORD uId, const SmartOutputBuffer_t &tRequest ) REQUIRES ( !m_tLock );
+	void	Cancel ( DWORD uId ) REQUIRES ( !m_tLock );
+	void	Shutdown () REQUIRES ( !m_tLock );
+
+protected:
+	~MuxHost_c () override;
+};
+
+/// one reply frame received over multiplexed connection; the body is m_iLen bytes at m_iOffset of the parsed buffer
+struct MuxFrame_t
+{
+	DWORD	m_uId = 0;
+	WORD	m_uStatus = 0;
+	int		m_iOffset = 0;
+	int		m_iLen = 0;
+};
+
+enum MuxParse_e
+{
+	MUX_PARSE_OK,			///< zero or more complete frames; the incomplete tail waits for more data
+	MUX_PARSE_UNSUPPORTED,	///< the agent replied error to mux command; it has to be queried the usual way
+	MUX_PARSE_BROKEN		///< garbage in the stream; the connection has to be closed
+};
+
+/// split the bytes received over multiplexed connection into reply frames.
+/// bHandshake means the reply to mux command goes first; it is cleared once that reply is consumed.
+/// iParsed is the length of the consumed head; the rest has to be kept for the next call.
+MuxParse_e ParseMuxReplies ( const BYTE * pBuf, int iLen, bool & bHandshake, CSphVector<MuxFrame_t> & dFrames,
+	int & iParsed, CSphString & sError );
+
 /// per-host dashboard
 struct HostDashboard_t : public ISphRefcountedMT
 {
 	HostDesc_t m_tHost;          // only host info, no indices. Used for ping.
 	volatile int m_iNeedPing = 0;    // we'll ping only HA agents, not everyone
 	PersistentConnectionsPool_c * m_pPersPool = nullptr;    // persistence pool also lives here, one per dashboard
+	MuxHost_c * m_pMux = nullptr;	// multiplexed connections (if persistent_connections_mux is set), one per dashboard
 
 	mutable RwLock_t m_dDataLock;        // guards everything essential (see thread annotations)
 	int64_t m_iLastAnswerTime GUARDED_BY ( m_dDataLock ) = 0;    // updated when we get an answer from the host
@@ -244,6 +300,9 @@ struct HostDashboard_t : public ISphRefcountedMT
 	int64_t m_iErrorsARow GUARDED_BY (
 		m_dDataLock ) = 0;        // num of errors a row, updated when we update the general statistic.
 
+	CSphAtomicL m_dTotalCounters[eMaxAgentStat];	// event counters since start, never reset (for /metrics)
+	QueryHistogram_t m_tLatency;	// query latency since start (for /metrics)
+
 public:
 	explicit HostDashboard_t ( const HostDesc_t &tAgent );
 	bool IsOlder ( int64_t iTime ) const REQUIRES_SHARED ( m_dDataLock );
@@ -411,6 +470,10 @@ protected:
 	using LPKEY = void *;
 #endif
 
+#ifndef UIO_MAXIOV
+#define UIO_MAXIOV (1024)
+#endif
+
 class IOVec_c
 {
 	CSphVector<sphIovec> m_dIOVec;
@@ -443,10 +506,10 @@ public:
 		return m_dIOVec.end () - m_iIOChunks;
 	}
 
-	/// num of io vecs for sendmsg/WSAsend
+	/// num of io vecs for sendmsg/WSAsend (no more than one call can take)
 	inline size_t IOSize () const
 	{
-		return m_iIOChunks;
+		return Min ( m_iIOChunks, (size_t)UIO_MAXIOV );
 	}
 
 #if USE_WINDOWS
@@ -481,6 +544,7 @@ public:
 
 	CSphRefcountedPtr<IReporter_t>	m_pReporter { nullptr };	///< used to report back when we're finished
 	LPKEY			m_pPollerTask = nullptr; ///< internal for poller. fixme! privatize?
+	DWORD			m_uMuxId = 0;	///< id of the request in flight over multiplexed connection, 0 if none
 	CSphAtomic		m_bSuccess;		///< agent got processed, no need to retry
 
 public:
@@ -500,6 +564,7 @@ public:
 	void RecvCallback ( int64_t iWaited, DWORD uReceived );
 	void TimeoutCallback ();
 	void AbortCallback();
+	void MuxReplyCallback ( MuxReply_t & tReply );
 	bool CheckOrphaned();
 
 #if USE_WINDOWS
@@ -543,6 +608,9 @@ private:
 	bool m_bInNetLoop	= false;		///< if we're inside netloop (1-thread work with schedule)
 	bool m_bNeedKick	= false;		///< if we've installed callback from outside th and need to kick netloop
 	bool m_bManyTries = false;			///< to avoid report 'retries limit esceeded' if we have ONLY one retry
+	bool m_bMultiplexed = false;		///< the query goes over multiplexed connection of the host (see MuxHost_c)
+
+	MuxHost_c *	m_pMux = nullptr;		///< the host we've submitted the request to (addref'ed)
 
 	Agent_e			m_eConnState { Agent_e::HEALTHY };	///< current state
 	SearchdStatus_e m_eReplyStatus { SEARCHD_ERROR };    ///< reply status code
@@ -582,6 +650,7 @@ private:
 	int DoTFO ( struct sockaddr * pSs, int iLen );
 
 	bool DoQuery ();
+	bool DoMuxQuery ();
 	bool EstablishConnection ();
 	bool SendQuery (DWORD uSent = 0);
 	bool ReceiveAnswer (DWORD uReceived = 0);
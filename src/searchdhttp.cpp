@@ -51,7 +51,7 @@ static void AppendJsonKey ( const char * sName, JsonEscapedBuilder & tOut )
 }
 
 
-static void EncodeResultJson ( const AggrResult_t & tRes, JsonEscapedBuilder & tOut )
+static void EncodeResultJson ( const AggrResult_t & tRes, JsonEscapedBuilder & tOut, EncodedResultSink_i * pSink )
 {
 	const ISphSchema & tSchema = tRes.m_tSchema;
 	CSphVector<BYTE> dTmp;
@@ -205,6 +205,8 @@ static void EncodeResultJson ( const AggrResult_t & tRes, JsonEscapedBuilder & t
 		}
 
 		tOut += "]";
+		if ( pSink )
+			pSink->Flush ( tOut );
 	}
 	tOut += "],";
 
@@ -242,11 +244,10 @@ const char * g_dHttpStatus[] = { "200 OK", "206 Partial Content", "400 Bad Reque
 STATIC_ASSERT ( sizeof(g_dHttpStatus)/sizeof(g_dHttpStatus[0])==SPH_HTTP_STATUS_TOTAL, SPH_HTTP_STATUS_SHOULD_BE_SAME_AS_SPH_HTTP_STATUS_TOTAL );
 
 
-static void HttpBuildReply ( CSphVector<BYTE> & dData, ESphHttpStatus eCode, const char * sBody, int iBodyLen, bool bHtml )
+static void HttpBuildReply ( CSphVector<BYTE> & dData, ESphHttpStatus eCode, const char * sBody, int iBodyLen, const char * sContent )
 {
 	assert ( sBody && iBodyLen );
 
-	const char * sContent = ( bHtml ? "text/html" : "application/json" );
 	CSphString sHttp;
 	sHttp.SetSprintf ( "HTTP/1.1 %s\r\nServer: %s\r\nContent-Type: %s; charset=UTF-8\r\nContent-Length:%d\r\n\r\n", g_dHttpStatus[eCode], SPHINX_VERSION, sContent, iBodyLen );
 
@@ -257,6 +258,120 @@ static void HttpBuildReply ( CSphVector<BYTE> & dData, ESphHttpStatus eCode, con
 }
 
 
+static void HttpBuildReply ( CSphVector<BYTE> & dData, ESphHttpStatus eCode, const char * sBody, int iBodyLen, bool bHtml )
+{
+	HttpBuildReply ( dData, eCode, sBody, iBodyLen, bHtml ? "text/html" : "application/json" );
+}
+
+
+// appends a complete reply to the ones already queued for the client (pipelined requests)
+static void HttpQueueReply ( SmartOutputBuffer_t & tOut, CSphVector<BYTE> & dReply )
+{
+	if ( !tOut.GetSentCount() )
+		tOut.SwapData ( dReply );
+	else
+		tOut.SendBytes ( dReply.Begin(), dReply.GetLength() );
+}
+
+
+void HttpChunkedReply_c::Start ( ESphHttpStatus eCode, const char * sContent )
+{
+	m_eCode = eCode;
+	m_sContent = sContent;
+	m_bChunked = false;
+	// replies to earlier pipelined requests are still queued, can't push ahead of them
+	m_bPush = ( m_iSock>=0 && !m_tOut.GetSentCount() );
+}
+
+// small body still goes as a usual reply with Content-Length; once the body grows over a chunk,
+// the header is sent, and then every chunk is pushed to the client right away (while the socket takes them
+// without blocking). Whatever was not pushed is queued to the output buffer for the net loop to send.
+void HttpChunkedReply_c::Flush ( StringBuilder_c & tBody )
+{
+	if ( tBody.Length()<NETOUTCHUNK )
+		return;
+
+	if ( !m_bChunked )
+	{
+		CSphString sHttp;
+		sHttp.SetSprintf ( "HTTP/1.1 %s\r\nServer: %s\r\nContent-Type: %s; charset=UTF-8\r\nTransfer-Encoding: chunked\r\n\r\n", g_dHttpStatus[m_eCode], SPHINX_VERSION, m_sContent );
+		m_dPending.Append ( sHttp.cstr(), sHttp.Length() );
+		m_bChunked = true;
+	}
+
+	AddChunk ( tBody.cstr(), tBody.Length() );
+	tBody.Clear();
+	Push();
+}
+
+void HttpChunkedReply_c::Finish ( StringBuilder_c & tBody )
+{
+	if ( !m_bChunked )
+	{
+		CSphVector<BYTE> dReply;
+		HttpBuildReply ( dReply, m_eCode, tBody.cstr(), tBody.Length(), m_sContent );
+		HttpQueueReply ( m_tOut, dReply );
+		return;
+	}
+
+	if ( tBody.Length() )
+		AddChunk ( tBody.cstr(), tBody.Length() );
+	tBody.Clear();
+
+	static const char sLastChunk[] = "0\r\n\r\n";
+	m_dPending.Append ( sLastChunk, sizeof(sLastChunk)-1 );
+	Push();
+
+	if ( !m_iSent )
+		HttpQueueReply ( m_tOut, m_dPending );
+	else if ( m_iSent<m_dPending.GetLength() )
+		m_tOut.SendBytes ( m_dPending.Begin()+m_iSent, m_dPending.GetLength()-m_iSent );
+
+	m_dPending.Reset();
+	m_iSent = 0;
+}
+
+void HttpChunkedReply_c::AddChunk ( const char * sData, int iLen )
+{
+	char sSize[16];
+	int iSizeLen = snprintf ( sSize, sizeof(sSize), "%x\r\n", iLen );
+	m_dPending.Append ( sSize, iSizeLen );
+	m_dPending.Append ( sData, iLen );
+	m_dPending.Append ( "\r\n", 2 );
+}
+
+void HttpChunkedReply_c::Push ()
+{
+	while ( m_bPush && m_iSent<m_dPending.GetLength() )
+	{
+		auto iRes = sphSockSend ( m_iSock, (const char *)m_dPending.Begin()+m_iSent, m_dPending.GetLength()-m_iSent );
+		if ( iRes>=0 )
+		{
+			m_iSent += (int)iRes;
+			continue;
+		}
+
+		int iErr = sphSockPeekErrno();
+		if ( iErr==EINTR )
+			continue;
+
+		// on a real error, stop pushing; the net loop will hit (and report) it on sending the rest
+		if ( iErr!=EAGAIN && iErr!=EWOULDBLOCK )
+			m_bPush = false;
+		break;
+	}
+
+	// client is slow; don't let the sent head grow together with the rest
+	if ( m_iSent==m_dPending.GetLength() || m_iSent>=NETOUTCHUNK )
+	{
+		int iLeft = m_dPending.GetLength()-m_iSent;
+		memmove ( m_dPending.Begin(), m_dPending.Begin()+m_iSent, iLeft );
+		m_dPending.Resize ( iLeft );
+		m_iSent = 0;
+	}
+}
+
+
 static void HttpErrorReply ( CSphVector<BYTE> & dData, ESphHttpStatus eCode, const char * szError )
 {
 	cJSON * pError = cJSON_CreateObject();
@@ -284,6 +399,7 @@ public:
 	const CSphString &		GetInvalidEndpoint() const { return m_sInvalidEndpoint; }
 	const char *			GetError() const { return m_szError; }
 	bool					GetKeepAlive() const { return m_bKeepAlive; }
+	bool					GetChunkedReply() const { return m_bChunkedReply; }
 	http_method				GetRequestType() const { return m_eType; }
 
 	static int				ParserUrl ( http_parser * pParser, const char * sAt, size_t iLen );
@@ -293,6 +409,7 @@ public:
 
 private:
 	bool					m_bKeepAlive {false};
+	bool					m_bChunkedReply {false};	///< client speaks HTTP/1.1, so reply might be sent chunked
 	const char *			m_szError {nullptr};
 	ESphHttpEndpoint		m_eEndpoint {SPH_HTTP_ENDPOINT_TOTAL};
 	CSphString				m_sInvalidEndpoint;
@@ -325,6 +442,7 @@ bool HttpRequestParser_c::Parse ( const BYTE * pData, int iDataLen )
 
 	// connection wide http options
 	m_bKeepAlive = ( http_should_keep_alive ( &tParser )!=0 );
+	m_bChunkedReply = ( tParser.http_major>1 || ( tParser.http_major==1 && tParser.http_minor>=1 ) );
 	// transfer endpoint for further parse
 	m_hOptions.Add ( m_sEndpoint, "endpoint" );
 	m_eType = (http_method)tParser.method;
@@ -702,11 +820,18 @@ public:
 		return m_dData;
 	}
 
+	// handlers which can stream their result send it there instead of m_dData
+	void SetChunkedReply ( HttpChunkedReply_c * pReply )
+	{
+		m_pChunkedReply = pReply;
+	}
+
 protected:
 	const CSphString &	m_sQuery;
 	bool				m_bNeedHttpResponse {false};
 	CSphVector<BYTE>	m_dData;
 	const ThdDesc_t &	m_tThd;
+	HttpChunkedReply_c * m_pChunkedReply {nullptr};
 
 	void ReportError ( const char * szError, ESphHttpStatus eStatus )
 	{
@@ -817,8 +942,17 @@ public:
 		if ( pRes->m_sWarning.IsEmpty() )
 			pRes->m_sWarning = m_sWarning;
 
-		CSphString sResult = EncodeResult ( *pRes, m_bProfile ? &tProfile : NULL );
-		BuildReply ( sResult, SPH_HTTP_STATUS_200 );
+		JsonEscapedBuilder tResult;
+		if ( m_pChunkedReply && m_bNeedHttpResponse )
+		{
+			m_pChunkedReply->Start ( SPH_HTTP_STATUS_200, "application/json" );
+			EncodeResult ( *pRes, m_bProfile ? &tProfile : NULL, tResult, m_pChunkedReply );
+			m_pChunkedReply->Finish ( tResult );
+		} else
+		{
+			EncodeResult ( *pRes, m_bProfile ? &tProfile : NULL, tResult, nullptr );
+			BuildReply ( tResult, SPH_HTTP_STATUS_200 );
+		}
 
 		return true;
 	}
@@ -831,7 +965,7 @@ protected:
 	CSphString				m_sWarning;
 
 	virtual QueryParser_i * PreParseQuery() = 0;
-	virtual CSphString		EncodeResult ( const AggrResult_t & tRes, CSphQueryProfile * pProfile ) = 0;
+	virtual void			EncodeResult ( const AggrResult_t & tRes, CSphQueryProfile * pProfile, JsonEscapedBuilder & tOut, EncodedResultSink_i * pSink ) = 0;
 };
 
 
@@ -861,13 +995,9 @@ protected:
 		return sphCreatePlainQueryParser();
 	}
 
-	CSphString EncodeResult ( const AggrResult_t & tRes, CSphQueryProfile * /*pProfile*/ ) override
+	void EncodeResult ( const AggrResult_t & tRes, CSphQueryProfile * /*pProfile*/, JsonEscapedBuilder & tOut, EncodedResultSink_i * pSink ) override
 	{
-		JsonEscapedBuilder tResBuilder;
-		EncodeResultJson ( tRes, tResBuilder );
-		CSphString sResult;
-		sResult.Adopt ( tResBuilder.Leak() );
-		return sResult;
+		EncodeResultJson ( tRes, tOut, pSink );
 	}
 };
 
@@ -938,9 +1068,9 @@ public:
 	}
 
 protected:
-	CSphString EncodeResult ( const AggrResult_t & tRes, CSphQueryProfile * pProfile ) override
+	void EncodeResult ( const AggrResult_t & tRes, CSphQueryProfile * pProfile, JsonEscapedBuilder & tOut, EncodedResultSink_i * pSink ) override
 	{
-		return sphEncodeResultJson ( tRes, m_tQuery, pProfile, m_bAttrHighlight );
+		sphEncodeResultJson ( tRes, m_tQuery, pProfile, m_bAttrHighlight, tOut, pSink );
 	}
 };
 
@@ -1236,6 +1366,28 @@ private:
 };
 
 
+class HttpHandler_Metrics_c : public HttpHandler_c
+{
+public:
+	HttpHandler_Metrics_c ( const CSphString & sQuery, const ThdDesc_t & tThd, bool bNeedHttpResponse )
+		: HttpHandler_c ( sQuery, tThd, bNeedHttpResponse )
+	{}
+
+	bool Process () override
+	{
+		StringBuilder_c sMetrics;
+		BuildMetrics ( sMetrics );
+
+		// Prometheus text exposition format
+		if ( m_bNeedHttpResponse )
+			HttpBuildReply ( m_dData, SPH_HTTP_STATUS_200, sMetrics.cstr(), sMetrics.Length(), "text/plain; version=0.0.4" );
+		else
+			BuildReply ( sMetrics, SPH_HTTP_STATUS_200 );
+		return true;
+	}
+};
+
+
 static HttpHandler_c * CreateHttpHandler ( ESphHttpEndpoint eEndpoint, const CSphString & sQuery, const OptionsHash_t & tOptions, const ThdDesc_t & tThd, bool bNeedHttpResonse, http_method eRequestType )
 {
 	switch ( eEndpoint )
@@ -1267,6 +1419,9 @@ static HttpHandler_c * CreateHttpHandler ( ESphHttpEndpoint eEndpoint, const CSp
 	case SPH_HTTP_ENDPOINT_PQ:
 		return new HttpHandlerPQ_c ( sQuery, tThd, bNeedHttpResonse, tOptions );
 
+	case SPH_HTTP_ENDPOINT_METRICS:
+		return new HttpHandler_Metrics_c ( sQuery, tThd, bNeedHttpResonse );
+
 	default:
 		break;
 	}
@@ -1275,12 +1430,13 @@ static HttpHandler_c * CreateHttpHandler ( ESphHttpEndpoint eEndpoint, const CSp
 }
 
 
-static bool sphProcessHttpQuery ( ESphHttpEndpoint eEndpoint, const CSphString & sQuery, const SmallStringHash_T<CSphString> & tOptions, const ThdDesc_t & tThd, CSphVector<BYTE> & dResult, bool bNeedHttpResponse, http_method eRequestType )
+static bool sphProcessHttpQuery ( ESphHttpEndpoint eEndpoint, const CSphString & sQuery, const SmallStringHash_T<CSphString> & tOptions, const ThdDesc_t & tThd, CSphVector<BYTE> & dResult, bool bNeedHttpResponse, http_method eRequestType, HttpChunkedReply_c * pChunkedReply=nullptr )
 {
 	CSphScopedPtr<HttpHandler_c> pHandler ( CreateHttpHandler ( eEndpoint, sQuery, tOptions, tThd, bNeedHttpResponse, eRequestType ) );
 	if ( !pHandler.Ptr() )
 		return false;
 
+	pHandler->SetChunkedReply ( pChunkedReply );
 	pHandler->Process();
 	dResult = std::move ( pHandler->GetResult() );
 	return true;
@@ -1293,17 +1449,23 @@ bool sphProcessHttpQueryNoResponce ( ESphHttpEndpoint eEndpoint, const CSphStrin
 }
 
 
-bool sphLoopClientHttp ( const BYTE * pRequest, int iRequestLen, CSphVector<BYTE> & dResult, const ThdDesc_t & tThd )
+bool sphLoopClientHttp ( const BYTE * pRequest, int iRequestLen, SmartOutputBuffer_t & tOut, int iSock, const ThdDesc_t & tThd )
 {
+	CSphVector<BYTE> dResult;
 	HttpRequestParser_c tParser;
 	if ( !tParser.Parse ( pRequest, iRequestLen ) )
 	{
 		HttpErrorReply ( dResult, SPH_HTTP_STATUS_400, tParser.GetError() );
+		HttpQueueReply ( tOut, dResult );
 		return tParser.GetKeepAlive();
 	}
 
+	// HTTP/1.0 clients can't get chunked reply
+	HttpChunkedReply_c tChunkedReply ( tOut, iSock );
+	HttpChunkedReply_c * pChunkedReply = tParser.GetChunkedReply() ? &tChunkedReply : nullptr;
+
 	ESphHttpEndpoint eEndpoint = tParser.GetEndpoint();
-	if ( !sphProcessHttpQuery ( eEndpoint, tParser.GetBody(), tParser.GetOptions(), tThd, dResult, true, tParser.GetRequestType() ) )
+	if ( !sphProcessHttpQuery ( eEndpoint, tParser.GetBody(), tParser.GetOptions(), tThd, dResult, true, tParser.GetRequestType(), pChunkedReply ) )
 	{
 		if ( eEndpoint==SPH_HTTP_ENDPOINT_INDEX )
 			HttpHandlerIndexPage ( dResult );
@@ -1315,6 +1477,10 @@ bool sphLoopClientHttp ( const BYTE * pRequest, int iRequestLen, CSphVector<BYTE
 		}
 	}
 
+	// streamed reply is already queued (or even sent)
+	if ( dResult.GetLength() )
+		HttpQueueReply ( tOut, dResult );
+
 	return tParser.GetKeepAlive();
 }
 
@@ -1325,7 +1491,7 @@ void sphHttpErrorReply ( CSphVector<BYTE> & dData, ESphHttpStatus eCode, const c
 }
 
 
-const char * g_dEndpoints[] = { "index.html", "search", "sql", "json/search", "json/index", "json/create", "json/insert", "json/replace", "json/update", "json/delete", "json/bulk", "json/pq" };
+const char * g_dEndpoints[] = { "index.html", "search", "sql", "json/search", "json/index", "json/create", "json/insert", "json/replace", "json/update", "json/delete", "json/bulk", "json/pq", "metrics" };
 STATIC_ASSERT ( sizeof(g_dEndpoints)/sizeof(g_dEndpoints[0])==SPH_HTTP_ENDPOINT_TOTAL, SPH_HTTP_ENDPOINT_SHOULD_BE_SAME_AS_SPH_HTTP_ENDPOINT_TOTAL );
 
 ESphHttpEndpoint sphStrToHttpEndpoint ( const CSphString & sEndpoint )
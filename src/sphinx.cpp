@@ -179,6 +179,9 @@ static const int	MIN_READ_UNHINTED		= 1024;
 
 static int			g_iReadBuffer			= DEFAULT_READ_BUFFER;
 static int			g_iReadUnhinted			= DEFAULT_READ_UNHINTED;
+static bool			g_bKeywordDirectory		= false;
+
+static CacheCounters_c	g_tDoclistCache;		///< per-index limit
 
 #ifndef SHAREDIR
 #define SHAREDIR "."
@@ -296,6 +299,159 @@ void CSphIOStats::Add ( const CSphIOStats & b )
 }
 
 
+//////////////////////////////////////////////////////////////////////////
+
+static bool g_bQueryControl = false;
+static SphThreadKey_t g_tQueryControlTls;
+
+static const int64_t QUERY_SLOW_CHECK_PERIOD = 10000; // cpu time and client connection are checked that often, in usec
+
+bool sphInitQueryControl ()
+{
+	if ( g_bQueryControl )
+		return true;
+
+	if ( !sphThreadKeyCreate ( &g_tQueryControlTls ) )
+		return false;
+
+	g_bQueryControl = true;
+	return true;
+}
+
+
+static QueryControlScope_c * GetQueryScope ()
+{
+	if ( !g_bQueryControl )
+		return nullptr;
+
+	return (QueryControlScope_c *)sphThreadGet ( g_tQueryControlTls );
+}
+
+
+QueryControl_c * sphGetQueryControl ()
+{
+	QueryControlScope_c * pScope = GetQueryScope();
+	return pScope ? pScope->GetControl() : nullptr;
+}
+
+
+bool sphQueryStopped ()
+{
+	QueryControlScope_c * pScope = GetQueryScope();
+	return pScope && pScope->Poll();
+}
+
+
+void QueryControl_c::Stop ( QueryStop_e eReason )
+{
+	m_iStopped.CAS ( QUERY_RUNNING, eReason );
+}
+
+
+const char * QueryControl_c::GetStopMessage () const
+{
+	switch ( GetStopReason() )
+	{
+	case QUERY_KILLED:			return "query was killed";
+	case QUERY_CLIENT_GONE:		return "client disconnected, query was stopped";
+	case QUERY_MEMORY_LIMIT:	return "query exceeded max_query_memory";
+	case QUERY_CLIENT_MEMORY:	return "queries of this client exceeded max_client_memory";
+	case QUERY_CPU_LIMIT:		return "query exceeded max_query_cpu_time";
+	default:					return nullptr;
+	}
+}
+
+
+static void UpdatePeak ( CSphAtomicL & iPeak, int64_t iValue )
+{
+	int64_t iOld = iPeak;
+	while ( iValue>iOld )
+	{
+		int64_t iSeen = iPeak.CAS ( iOld, iValue );
+		if ( iSeen==iOld )
+			break;
+		iOld = iSeen;
+	}
+}
+
+
+void QueryControl_c::TrackMemory ( int64_t iBytes )
+{
+	int64_t iMemory = m_iMemory.Add ( iBytes ) + iBytes;
+	UpdatePeak ( m_iPeakMemory, iMemory );
+	if ( iBytes>0 && m_iMaxMemory>0 && iMemory>m_iMaxMemory )
+		Stop ( QUERY_MEMORY_LIMIT );
+
+	if ( !m_pShared )
+		return;
+
+	int64_t iShared = m_pShared->m_iMemory.Add ( iBytes ) + iBytes;
+	UpdatePeak ( m_pShared->m_iPeakMemory, iShared );
+	if ( iBytes>0 && m_pShared->m_iMaxMemory>0 && iShared>m_pShared->m_iMaxMemory )
+		Stop ( QUERY_CLIENT_MEMORY );
+}
+
+
+QueryControlScope_c::QueryControlScope_c ( QueryControl_c * pControl )
+	: m_pControl ( pControl )
+{
+	if ( !g_bQueryControl || !m_pControl )
+		return;
+
+	m_pPrev = (QueryControlScope_c *)sphThreadGet ( g_tQueryControlTls );
+	sphThreadSet ( g_tQueryControlTls, this );
+	m_tmCpuStart = sphCpuTimer();
+}
+
+
+QueryControlScope_c::~QueryControlScope_c ()
+{
+	if ( !g_bQueryControl || !m_pControl )
+		return;
+
+	m_pControl->m_iCpuTime += sphCpuTimer() - m_tmCpuStart;
+	sphThreadSet ( g_tQueryControlTls, m_pPrev );
+}
+
+
+bool QueryControlScope_c::Poll ()
+{
+	if ( m_pControl->IsStopped() )
+		return true;
+
+	// cpu time and client checks cost a syscall each, so do them only every few msec
+	if ( ( ++m_uPolls & 15 )!=0 )
+		return false;
+
+	int64_t tmNow = sphMicroTimer();
+	if ( tmNow<m_tmNextCheck )
+		return false;
+	m_tmNextCheck = tmNow + QUERY_SLOW_CHECK_PERIOD;
+
+	if ( m_pControl->m_iMaxCpuTime>0 && m_pControl->m_iCpuTime + sphCpuTimer() - m_tmCpuStart>m_pControl->m_iMaxCpuTime )
+		m_pControl->Stop ( QUERY_CPU_LIMIT );
+
+	if ( m_pControl->IsClientGone() )
+		m_pControl->Stop ( QUERY_CLIENT_GONE );
+
+	return m_pControl->IsStopped();
+}
+
+
+QueryMemTracker_c::QueryMemTracker_c ()
+	: m_pControl ( sphGetQueryControl() )
+{}
+
+
+void QueryMemTracker_c::Set ( int64_t iBytes )
+{
+	if ( m_pControl && iBytes!=m_iBytes )
+		m_pControl->TrackMemory ( iBytes - m_iBytes );
+	m_iBytes = iBytes;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 static CSphIOStats * GetIOStats ()
 {
 	if ( !g_bCollectIOStats )
@@ -598,6 +754,48 @@ public:
 
 /////////////////////////////////////////////////////////////////////////////
 
+#define DOCLIST_CACHE_SHARDS		16
+#define DOCLIST_CACHE_MIN_BYTES		1024	///< shorter doclists are read by a single syscall anyway
+#define DOCLIST_CACHE_MIN_SEEN		2		///< term must be queried that many times before it gets cached
+#define DOCLIST_CACHE_MAX_SEEN		4096	///< forget access counts once that many candidates are tracked per shard
+
+/// raw doclist of a hot term, exactly as stored in .spd (including end marker)
+struct DoclistCacheEntry_t : public ISphRefcountedMT
+{
+	CSphFixedVector<BYTE>	m_dData { 0 };
+	DWORD					m_uLastUse = 0;
+};
+
+/// per-index cache of doclists for frequent terms
+/// sharded by doclist offset to keep lock contention low; admission is by doclist size and access count, eviction is LRU
+class DoclistCache_c : public ISphNoncopyable
+{
+public:
+							~DoclistCache_c () { Reset(); }
+
+	static bool				IsEnabled () { return g_tDoclistCache.IsEnabled(); }
+
+	/// returns addref'ed entry, or NULL if the term is not (yet) worth caching
+	DoclistCacheEntry_t *	Fetch ( SphOffset_t iOffset, int iHint, const CSphAutofile & tDoclist, bool bInlineHits, int iInlineAttrs, bool bHasHitlist );
+	void					Reset ();
+
+private:
+	struct Shard_t
+	{
+		CSphMutex															m_tLock;
+		CSphOrderedHash<DoclistCacheEntry_t *, SphOffset_t, IdentityHash_fn, 256>	m_hEntries;
+		CSphOrderedHash<int, SphOffset_t, IdentityHash_fn, 256>			m_hSeen;
+		int64_t																m_iBytes = 0;
+		DWORD																m_uClock = 0;
+	};
+
+	Shard_t					m_dShards [ DOCLIST_CACHE_SHARDS ];
+
+	static Shard_t &		GetShard ( Shard_t * pShards, SphOffset_t iOffset );
+	static DoclistCacheEntry_t * Load ( SphOffset_t iOffset, int iHint, const CSphAutofile & tDoclist, bool bInlineHits, int iInlineAttrs, bool bHasHitlist );
+	static void				EvictOne ( Shard_t & tShard );
+};
+
 class CSphIndex_VLN;
 
 /// everything required to setup search term
@@ -646,6 +844,7 @@ public:
 	BYTE			m_dHitlistBuf [ MINIBUFFER_LEN ];
 	CSphReader		m_rdDoclist;	///< my doclist reader
 	CSphReader		m_rdHitlist;	///< my hitlist reader
+	CSphRefcountedPtr<DoclistCacheEntry_t>	m_pCachedDoclist;	///< keeps cached doclist alive while m_rdDoclist reads from it
 
 	SphDocID_t		m_iMinID = 0;		///< min ID to fixup
 	int				m_iInlineAttrs = 0;	///< inline attributes count
@@ -696,6 +895,7 @@ public:
 	{
 		m_rdDoclist.Reset ();
 		m_rdDoclist.Reset ();
+		m_pCachedDoclist = nullptr;
 		m_iInlineAttrs = 0;
 		ResetDecoderState();
 	}
@@ -1032,6 +1232,87 @@ struct ISphCheckpointReader
 
 
 // !COMMIT eliminate this, move it to proper dict impls
+struct DiskExpandedEntry_t
+{
+	int		m_iNameOff;
+	int		m_iDocs;
+	int		m_iHits;
+};
+
+struct DiskExpandedPayload_t
+{
+	int			m_iDocs;
+	int			m_iHits;
+	uint64_t	m_uDoclistOff;
+	int			m_iDoclistHint;
+};
+
+struct DictEntryDiskPayload_t;
+
+/// keywords matched by a wildcard, as collected by dictionary scan (ie. prior to expansion limit and payload build)
+struct ExpansionCacheEntry_t
+{
+	CSphVector<DiskExpandedEntry_t>		m_dWordExpand;
+	CSphVector<DiskExpandedPayload_t>	m_dWordPayload;
+	CSphVector<BYTE>					m_dWordBuf;
+
+	CSphString							m_sKey;				///< cache key (dictionary uid included)
+	int64_t								m_iOwner = 0;		///< uid of the dictionary this came from
+	ExpansionCacheEntry_t *				m_pPrev = nullptr;	///< LRU list, most recently used first
+	ExpansionCacheEntry_t *				m_pNext = nullptr;
+
+	int64_t GetBytes () const
+	{
+		return sizeof(*this) + m_dWordExpand.GetLengthBytes() + m_dWordPayload.GetLengthBytes() + m_dWordBuf.GetLengthBytes() + m_sKey.Length();
+	}
+};
+
+/// wildcard expansions cache, shared by all the disk index dictionaries (and all disk chunks of RT indexes)
+/// dictionary is immutable for the whole index lifetime, so entries never go stale; they are dropped
+/// when the dictionary goes away, or when the least recently used ones get evicted to fit the size limit
+class ExpansionCache_c : public ISphNoncopyable
+{
+public:
+						~ExpansionCache_c ();
+
+	void				SetMaxBytes ( int64_t iMaxBytes );
+	bool				IsEnabled () const { return m_tCounters.IsEnabled(); }
+	CacheStatus_t		GetStatus () const { return m_tCounters.GetStatus(); }
+
+	bool				Get ( const CSphString & sKey, DictEntryDiskPayload_t & tDict );
+	void				Add ( int64_t iOwner, const CSphString & sKey, const DictEntryDiskPayload_t & tDict );
+	void				Drop ( int64_t iOwner );	///< forget everything that came from a given dictionary
+
+private:
+	CacheCounters_c								m_tCounters;
+	CSphMutex									m_tLock;
+	SmallStringHash_T<ExpansionCacheEntry_t *>	m_hEntries;
+	ExpansionCacheEntry_t *						m_pHead = nullptr;
+	ExpansionCacheEntry_t *						m_pTail = nullptr;
+	int64_t										m_iBytes = 0;
+
+	void				Link ( ExpansionCacheEntry_t * pEntry );
+	void				Unlink ( ExpansionCacheEntry_t * pEntry );
+	void				Delete ( ExpansionCacheEntry_t * pEntry );
+	void				EvictTo ( int64_t iMaxBytes );
+};
+
+static ExpansionCache_c	g_tExpansionCache;
+static CSphAtomicL		g_iExpansionOwners;		///< dictionary uid generator for the expansion cache
+
+
+/// fully decoded dict=keywords wordlist entry
+struct KeywordDirEntry_t
+{
+	DWORD			m_uWordOff;			///< offset into words arena; keyword is stored as length byte, bytes, zero
+	int				m_iDocs;
+	int				m_iHits;
+	int				m_iDoclistHint;
+	SphOffset_t		m_iDoclistOffset;
+	SphOffset_t		m_iSkiplistOffset;
+};
+
+
 class CWordlist : public ISphWordlist, public DictHeader_t, public ISphWordlistSuggest
 {
 public:
@@ -1046,6 +1327,13 @@ public:
 	bool										m_bHaveSkips = false;	///< whether there are skiplists
 	CSphScopedPtr<ISphCheckpointReader>			m_tMapedCpReader { nullptr };
 
+	// optional keyword directory; sorted decoded keywords, so lookups do binary search instead of block decoding
+	CSphTightVector<KeywordDirEntry_t>			m_dDir;					///< all the keywords, in dictionary order
+	CSphTightVector<BYTE>						m_dDirWords;			///< arena for directory keywords
+	CSphFixedVector<int>						m_dDirCheckpoints {0};	///< first directory entry of every checkpoint block, plus the end
+
+	int64_t										m_iExpansionUid = ++g_iExpansionOwners;	///< tells my entries in the expansion cache
+
 public:
 										~CWordlist () override;
 	void								Reset();
@@ -1064,8 +1352,20 @@ public:
 
 	void								DebugPopulateCheckpoints();
 
+	bool								HasDirectory () const { return m_dDirCheckpoints.GetLength()>0; }
+	bool								GetDirWord ( const char * sWord, int iWordLen, CSphDictEntry & tWord ) const;
+	int64_t								GetDirectoryBytes () const { return m_dDir.GetLengthBytes() + m_dDirWords.GetLengthBytes() + m_dDirCheckpoints.GetLengthBytes(); }
+
 private:
 	bool								m_bWordDict = false;
+
+	void								BuildDirectory ();
+	int									FindDirEntry ( const char * sWord, int iWordLen ) const;
+	const BYTE *						GetDirKeyword ( const KeywordDirEntry_t & tEntry ) const { return m_dDirWords.Begin() + tEntry.m_uWordOff; }
+	void								GetDirEntry ( const KeywordDirEntry_t & tEntry, CSphDictEntry & tWord ) const;
+
+	bool								GetCachedExpansion ( char cType, const char * sWildcard, Args_t & tArgs, CSphString & sKey ) const;
+	void								FinishExpansion ( const CSphString & sKey, DictEntryDiskPayload_t & tDict2Payload, Args_t & tArgs ) const;
 };
 
 
@@ -1427,6 +1727,7 @@ private:
 	CSphMappedBuffer<BYTE>			m_tString;
 	CSphMappedBuffer<SphDocID_t>	m_tKillList;		///< killlist
 	CSphMappedBuffer<BYTE>			m_tSkiplists;		///< (compressed) skiplists data
+	DoclistCache_c					m_tDoclistCache;	///< hot terms doclists
 	CWordlist										m_tWordlist;		///< my wordlist
 	// recalculate on attr load complete
 	CSphLargeBuffer<DWORD>							m_tDocinfoHash;		///< hashed ids, to accelerate lookups
@@ -1849,6 +2150,36 @@ int64_t sphGetFileSize ( const CSphString& sFile, CSphString * sError )
 }
 
 
+void sphSetKeywordDirectory ( bool bEnable )
+{
+	g_bKeywordDirectory = bEnable;
+}
+
+
+void sphSetExpansionCacheSize ( int64_t iMaxBytes )
+{
+	g_tExpansionCache.SetMaxBytes ( iMaxBytes );
+}
+
+
+void sphSetDoclistCacheSize ( int64_t iMaxBytes )
+{
+	g_tDoclistCache.SetMaxBytes ( iMaxBytes );
+}
+
+
+CacheStatus_t sphGetDoclistCacheStatus ()
+{
+	return g_tDoclistCache.GetStatus();
+}
+
+
+CacheStatus_t sphGetExpansionCacheStatus ()
+{
+	return g_tExpansionCache.GetStatus();
+}
+
+
 void sphSetReadBuffers ( int iReadBuffer, int iReadUnhinted )
 {
 	if ( iReadBuffer<=0 )
@@ -2347,6 +2678,9 @@ protected:
 	template < bool IS_QUERY, bool IS_BLEND >
 	BYTE *						DoGetToken();
 
+	template < bool IS_BLEND >
+	inline void					AccumAsciiRun ();
+
 	void						FlushAccum ();
 
 public:
@@ -4780,6 +5114,57 @@ bool CSphTokenizerBase2::CheckException ( const BYTE * pStart, const BYTE * pCur
 	return true;
 }
 
+/// indexing fast path; accumulates a run of plain ASCII word chars (no flags, folded within ASCII) in one go
+/// stops at anything else (separators, specials, blended, non-ASCII input, full accumulator) and leaves it to the generic loop
+template < bool IS_BLEND >
+void CSphTokenizerBase2::AccumAsciiRun ()
+{
+	const int * pLower = m_tLC.m_pChunk[0];
+	const BYTE * pCur = m_pCur;
+
+	// one byte per char here; keep the very same room the generic accumulator keeps
+	int iRoom = Min ( SPH_MAX_WORD_LEN - m_iAccum, (int)( m_sAccum + sizeof(m_sAccum) - SPH_MAX_UTF8_BYTES - m_pAccum ) );
+	if ( iRoom<=0 )
+		return;
+
+	const BYTE * pMax = pCur + Min ( (int64_t)iRoom, (int64_t)( m_pBufferMax-pCur ) );
+	BYTE * pAccum = m_pAccum;
+	while ( pCur<pMax )
+	{
+		int iCode = *pCur;
+		if ( iCode>=128 )
+			break;
+
+		// flagged codes are way above 128, separators are 0
+		iCode = pLower[iCode];
+		if ( iCode<=0 || iCode>=128 )
+			break;
+
+		// sentence detection needs its own look at these; it checks folded codes, and so do we
+		if ( m_bDetectSentences && ( iCode=='.' || iCode=='?' || iCode=='!' ) )
+			break;
+
+		*pAccum++ = (BYTE)iCode;
+		pCur++;
+	}
+
+	int iLen = pCur - m_pCur;
+	if ( !iLen )
+		return;
+
+	if ( !m_iAccum )
+		m_pTokenStart = m_pCur;
+
+	if_const ( IS_BLEND )
+		m_bNonBlended = true;
+
+	m_iAccum += iLen;
+	m_pAccum = pAccum;
+	m_pCur = pCur;
+	m_bBoundary = false;
+}
+
+
 template < bool IS_QUERY, bool IS_BLEND >
 BYTE * CSphTokenizerBase2::DoGetToken ()
 {
@@ -4800,6 +5185,10 @@ BYTE * CSphTokenizerBase2::DoGetToken ()
 	m_pTokenStart = nullptr;
 	while (true)
 	{
+		// plain ASCII words are the bulk of indexed text, take them in runs
+		if_const ( !IS_QUERY )
+			AccumAsciiRun<IS_BLEND>();
+
 		// get next codepoint
 		const BYTE * const pCur = m_pCur; // to redo special char, if there's a token already
 
@@ -5480,6 +5869,8 @@ CSphQuery::CSphQuery ()
 	, m_fGeoLongitude	( 0.0f )
 	, m_uMaxQueryMsec	( 0 )
 	, m_iMaxPredictedMsec ( 0 )
+	, m_iMaxQueryMemory	( 0 )
+	, m_iMaxQueryCpuMsec	( 0 )
 	, m_sComment		( "" )
 	, m_sSelect			( "" )
 	, m_iOuterOffset	( 0 )
@@ -5792,6 +6183,7 @@ CSphQueryStats::CSphQueryStats()
 	, m_iFetchedDocs ( 0 )
 	, m_iFetchedHits ( 0 )
 	, m_iSkips ( 0 )
+	, m_iFiltered ( 0 )
 {
 }
 
@@ -5800,6 +6192,7 @@ void CSphQueryStats::Add ( const CSphQueryStats & tStats )
 	m_iFetchedDocs += tStats.m_iFetchedDocs;
 	m_iFetchedHits += tStats.m_iFetchedHits;
 	m_iSkips += tStats.m_iSkips;
+	m_iFiltered += tStats.m_iFiltered;
 }
 
 
@@ -6864,6 +7257,8 @@ CSphReader::CSphReader ( BYTE * pBuf, int iSize )
 	, m_bBufOwned ( false )
 	, m_iReadUnhinted ( DEFAULT_READ_UNHINTED )
 	, m_bError ( false )
+	, m_pSavedBuff ( NULL )
+	, m_bBufExternal ( false )
 {
 	assert ( pBuf==NULL || iSize>0 );
 }
@@ -6871,6 +7266,7 @@ CSphReader::CSphReader ( BYTE * pBuf, int iSize )
 
 CSphReader::~CSphReader ()
 {
+	RestoreBuffer();
 	if ( m_bBufOwned )
 		SafeDeleteArray ( m_pBuff );
 }
@@ -6886,6 +7282,7 @@ void CSphReader::SetBuffers ( int iReadBuffer, int iReadUnhinted )
 
 void CSphReader::SetFile ( int iFD, const char * sFilename )
 {
+	RestoreBuffer();
 	m_iFD = iFD;
 	m_iPos = 0;
 	m_iBuffPos = 0;
@@ -6953,6 +7350,35 @@ void CSphReader::SeekTo ( SphOffset_t iPos, int iSizeHint )
 }
 
 
+void CSphReader::SetExternalBuffer ( const BYTE * pData, int iLen, SphOffset_t iPos )
+{
+	assert ( pData && iLen>0 && iPos>=0 );
+	if ( !m_bBufExternal )
+	{
+		m_pSavedBuff = m_pBuff;
+		m_bBufExternal = true;
+	}
+
+	// external data is never written to; UpdateCache() switches back to own buffer first
+	m_pBuff = const_cast<BYTE *> ( pData );
+	m_iPos = iPos;
+	m_iBuffPos = 0;
+	m_iBuffUsed = iLen;
+	m_iSizeHint = 0;
+}
+
+
+void CSphReader::RestoreBuffer ()
+{
+	if ( !m_bBufExternal )
+		return;
+
+	m_pBuff = m_pSavedBuff;
+	m_pSavedBuff = NULL;
+	m_bBufExternal = false;
+}
+
+
 void CSphReader::SkipBytes ( int iCount )
 {
 	// 0 means "no hint", so this clamp works alright
@@ -7046,6 +7472,15 @@ void CSphReader::UpdateCache ()
 
 	assert ( m_iFD>=0 );
 
+	// ran out of external data; keep reading from file into own buffer
+	if ( m_bBufExternal )
+	{
+		SphOffset_t iCurPos = m_iPos + Min ( m_iBuffPos, m_iBuffUsed );
+		RestoreBuffer();
+		m_iPos = iCurPos;
+		m_iBuffPos = m_iBuffUsed = 0;
+	}
+
 	// alloc buf on first actual read
 	if ( !m_pBuff )
 	{
@@ -7056,6 +7491,14 @@ void CSphReader::UpdateCache ()
 		m_pBuff = new BYTE [ m_iBufSize ];
 	}
 
+	// stopped query reads no more, so that its doclists and hitlists just end here
+	// that is not an io error, so the error flag stays clear (see CSphReader)
+	if ( sphQueryStopped() )
+	{
+		m_iBuffUsed = m_iBuffPos = 0;
+		return;
+	}
+
 	// stream position could be changed externally
 	// so let's just hope that the OS optimizes redundant seeks
 	SphOffset_t iNewPos = m_iPos + Min ( m_iBuffPos, m_iBuffUsed );
@@ -8832,7 +9275,9 @@ int CSphIndex_VLN::UpdateAttributes ( const CSphAttrUpdate & tUpd, int iIndex, C
 	CSphBitvec dBigint2Float ( iUpdLen );
 	CSphBitvec dFloat2Bigint ( iUpdLen );
 	CSphVector < CSphRefcountedPtr<ISphExpr> > dExpr ( iUpdLen );
+	CSphVector<int> dJsonAttrs ( iUpdLen );
 	dLocators.ZeroMem ();
+	dJsonAttrs.Fill ( -1 );
 
 	uint64_t uDst64 = 0;
 	ARRAY_FOREACH ( i, tUpd.m_dAttrs )
@@ -8854,6 +9299,12 @@ int CSphIndex_VLN::UpdateAttributes ( const CSphAttrUpdate & tUpd, int iIndex, C
 		{
 			// forbid updates on non-int columns
 			const CSphColumnInfo & tCol = m_tSchema.GetAttr(iIdx);
+			if ( sphIsJsonHotAttr ( tCol ) )
+			{
+				sError.SetSprintf ( "attribute '%s' can not be updated (update its JSON column instead)", tUpd.m_dAttrs[i] );
+				return -1;
+			}
+
 			if ( !( tCol.m_eAttrType==SPH_ATTR_BOOL || tCol.m_eAttrType==SPH_ATTR_INTEGER || tCol.m_eAttrType==SPH_ATTR_TIMESTAMP
 				|| tCol.m_eAttrType==SPH_ATTR_UINT32SET || tCol.m_eAttrType==SPH_ATTR_INT64SET
 				|| tCol.m_eAttrType==SPH_ATTR_BIGINT || tCol.m_eAttrType==SPH_ATTR_FLOAT || tCol.m_eAttrType==SPH_ATTR_JSON ))
@@ -8902,8 +9353,10 @@ int CSphIndex_VLN::UpdateAttributes ( const CSphAttrUpdate & tUpd, int iIndex, C
 
 				dFloats.BitSet(i);
 			} else if ( tCol.m_eAttrType==SPH_ATTR_JSON )
+			{
 				dJsonFields.BitSet(i);
-			else if ( tCol.m_eAttrType==SPH_ATTR_BIGINT )
+				dJsonAttrs[i] = iIdx;
+			} else if ( tCol.m_eAttrType==SPH_ATTR_BIGINT )
 			{
 				if ( tUpd.m_dTypes[i]==SPH_ATTR_FLOAT )
 					dFloat2Bigint.BitSet(i);
@@ -9069,6 +9522,11 @@ int CSphIndex_VLN::UpdateAttributes ( const CSphAttrUpdate & tUpd, int iIndex, C
 	DWORD uUpdateMask = 0;
 	int iJsonWarnings = 0;
 
+	// hot JSON paths follow their JSON columns
+	JsonHotAttrs_c tHotAttrs;
+	if ( dJsonFields.BitCount() )
+		tHotAttrs.Setup ( m_tSchema );
+
 	for ( int iUpd=iFirst; iUpd<iLast; iUpd++ )
 	{
 		bool bUpdated = false;
@@ -9150,6 +9608,54 @@ int CSphIndex_VLN::UpdateAttributes ( const CSphAttrUpdate & tUpd, int iIndex, C
 					bUpdated = true;
 					uUpdateMask |= ATTRS_STRINGS_UPDATED;
 
+					if ( tHotAttrs.HasJson ( dJsonAttrs[iCol] ) )
+					{
+						tHotAttrs.RefreshRow ( dJsonAttrs[iCol], dLocators[iCol], m_tString.GetWritePtr(), pEntry );
+						uUpdateMask |= ATTRS_UPDATED;
+
+						// hot values and the exact values mask only ever widen the block and index ranges
+						const CSphAttrLocator & tMaskLoc = tHotAttrs.GetMaskLocator();
+						SphAttr_t uMask = sphGetRowAttr ( pEntry, tMaskLoc );
+						for ( int i=0; i<2; i++ )
+						{
+							DWORD * pMin = DOCINFO2ATTRS ( i ? pBlockRanges : pIndexRanges );
+							DWORD * pMax = DOCINFO2ATTRS ( ( i ? pBlockRanges : pIndexRanges ) + iRowStride );
+							if ( uMask<sphGetRowAttr ( pMin, tMaskLoc ) )
+								sphSetRowAttr ( pMin, tMaskLoc, uMask );
+							if ( uMask>sphGetRowAttr ( pMax, tMaskLoc ) )
+								sphSetRowAttr ( pMax, tMaskLoc, uMask );
+						}
+
+						for ( int iHot=0; iHot<tHotAttrs.GetLength(); iHot++ )
+						{
+							const JsonHotAttrs_c::Attr_t & tHot = tHotAttrs[iHot];
+							if ( tHot.m_iJson!=dJsonAttrs[iCol] || tHot.m_eType==SPH_ATTR_STRING )
+								continue;
+
+							for ( int i=0; i<2; i++ )
+							{
+								DWORD * pMin = DOCINFO2ATTRS ( i ? pBlockRanges : pIndexRanges );
+								DWORD * pMax = DOCINFO2ATTRS ( ( i ? pBlockRanges : pIndexRanges ) + iRowStride );
+								SphAttr_t uMin = sphGetRowAttr ( pMin, tHot.m_tLocator );
+								SphAttr_t uMax = sphGetRowAttr ( pMax, tHot.m_tLocator );
+								bool bLess, bGreater;
+								if ( tHot.m_eType==SPH_ATTR_FLOAT )
+								{
+									bLess = sphDW2F ( (DWORD)tHot.m_uValue )<sphDW2F ( (DWORD)uMin );
+									bGreater = sphDW2F ( (DWORD)tHot.m_uValue )>sphDW2F ( (DWORD)uMax );
+								} else
+								{
+									bLess = tHot.m_uValue<uMin;
+									bGreater = tHot.m_uValue>uMax;
+								}
+								if ( bLess )
+									sphSetRowAttr ( pMin, tHot.m_tLocator, tHot.m_uValue );
+								if ( bGreater )
+									sphSetRowAttr ( pMax, tHot.m_tLocator, tHot.m_uValue );
+							}
+						}
+					}
+
 				} else
 					iJsonWarnings++;
 
@@ -11512,6 +12018,10 @@ int CSphIndex_VLN::Build ( const CSphVector<CSphSource*> & dSources, int iMemory
 	CSphVector<BYTE> dBson;
 	dBson.Reserve ( 1024 );
 
+	// hot JSON paths get extracted from their source JSON blobs
+	JsonHotAttrs_c tHotAttrs;
+	tHotAttrs.Setup ( m_tSchema );
+
 	for ( int i=0; i<m_tSchema.GetAttrsCount(); i++ )
 	{
 		const CSphColumnInfo & tCol = m_tSchema.GetAttr(i);
@@ -11971,6 +12481,22 @@ int CSphIndex_VLN::Build ( const CSphVector<CSphSource*> & dSources, int iMemory
 
 			// store strings and JSON blobs
 			{
+				// hot paths are stored as regular attributes, and they always go after their JSON source
+				auto fnStoreHot = [&] ( int iJsonAttr, const BYTE * pBson )
+				{
+					if ( !tHotAttrs.HasJson ( iJsonAttr ) )
+						return;
+
+					tHotAttrs.Extract ( iJsonAttr, pBson );
+					tHotAttrs.StoreNumeric ( iJsonAttr, pSource->m_tDocInfo.m_pDynamic );
+					for ( int iHot=0; iHot<tHotAttrs.GetLength(); iHot++ )
+					{
+						const JsonHotAttrs_c::Attr_t & tHot = tHotAttrs[iHot];
+						if ( tHot.m_iJson==iJsonAttr && tHot.m_eType==SPH_ATTR_STRING )
+							pSource->m_dStrAttrs[tHot.m_iAttr].SetBinary ( (const char *)tHot.m_pStr, tHot.m_iStrLen );
+					}
+				};
+
 				ARRAY_FOREACH ( i, dStringAttrs )
 				{
 					// FIXME! optimize locators etc?
@@ -11997,6 +12523,8 @@ int CSphIndex_VLN::Build ( const CSphVector<CSphSource*> & dSources, int iMemory
 					// no data
 					if ( !iLen )
 					{
+						if ( tCol.m_eAttrType==SPH_ATTR_JSON )
+							fnStoreHot ( iStrAttr, nullptr );
 						pSource->m_tDocInfo.SetAttr ( tCol.m_tLocator, 0 );
 						continue;
 					}
@@ -12025,12 +12553,14 @@ int CSphIndex_VLN::Build ( const CSphVector<CSphSource*> & dSources, int iMemory
 							// warn and ignore
 							sphWarning ( "%s", m_sLastError.cstr() );
 							m_sLastError = "";
+							fnStoreHot ( iStrAttr, nullptr );
 							pSource->m_tDocInfo.SetAttr ( tCol.m_tLocator, 0 );
 							continue;
 						}
 						if ( !dBson.GetLength() )
 						{
 							// empty SphinxBSON, need not save any data
+							fnStoreHot ( iStrAttr, nullptr );
 							pSource->m_tDocInfo.SetAttr ( tCol.m_tLocator, 0 );
 							continue;
 						}
@@ -12040,6 +12570,9 @@ int CSphIndex_VLN::Build ( const CSphVector<CSphSource*> & dSources, int iMemory
 						iLen = dBson.GetLength();
 					}
 
+					if ( tCol.m_eAttrType==SPH_ATTR_JSON )
+						fnStoreHot ( iStrAttr, (const BYTE *)sData );
+
 					// calc offset, do sanity checks
 					SphOffset_t uOff = tStrWriter.GetPos();
 					if ( uint64_t(uOff)>>32 )
@@ -14543,42 +15076,45 @@ void CSphIndex_VLN::CopyDocinfo ( const CSphQueryContext * pCtx, CSphMatch & tMa
 }
 
 
-static inline void CalcContextItems ( CSphMatch & tMatch, const CSphVector<CSphQueryContext::CalcItem_t> & dItems )
+static inline void CalcContextItem ( CSphMatch & tMatch, const CSphQueryContext::CalcItem_t & tCalc )
 {
-	for ( const CSphQueryContext::CalcItem_t & tCalc : dItems )
+	switch ( tCalc.m_eType )
 	{
-		switch ( tCalc.m_eType )
-		{
-			case SPH_ATTR_INTEGER:
-				tMatch.SetAttr ( tCalc.m_tLoc, tCalc.m_pExpr->IntEval(tMatch) );
-				break;
+		case SPH_ATTR_INTEGER:
+			tMatch.SetAttr ( tCalc.m_tLoc, tCalc.m_pExpr->IntEval(tMatch) );
+			break;
 
-			case SPH_ATTR_BIGINT:
-			case SPH_ATTR_JSON_FIELD:
-				tMatch.SetAttr ( tCalc.m_tLoc, tCalc.m_pExpr->Int64Eval(tMatch) );
-				break;
+		case SPH_ATTR_BIGINT:
+		case SPH_ATTR_JSON_FIELD:
+			tMatch.SetAttr ( tCalc.m_tLoc, tCalc.m_pExpr->Int64Eval(tMatch) );
+			break;
 
-			case SPH_ATTR_STRINGPTR:
-				tMatch.SetAttr ( tCalc.m_tLoc, (SphAttr_t)tCalc.m_pExpr->StringEvalPacked ( tMatch ) );
-				break;
+		case SPH_ATTR_STRINGPTR:
+			tMatch.SetAttr ( tCalc.m_tLoc, (SphAttr_t)tCalc.m_pExpr->StringEvalPacked ( tMatch ) );
+			break;
 
-			case SPH_ATTR_FACTORS:
-			case SPH_ATTR_FACTORS_JSON:
-				tMatch.SetAttr ( tCalc.m_tLoc, (SphAttr_t)tCalc.m_pExpr->FactorEvalPacked ( tMatch ) ); // FIXME! a potential leak of *previous* value?
-				break;
+		case SPH_ATTR_FACTORS:
+		case SPH_ATTR_FACTORS_JSON:
+			tMatch.SetAttr ( tCalc.m_tLoc, (SphAttr_t)tCalc.m_pExpr->FactorEvalPacked ( tMatch ) ); // FIXME! a potential leak of *previous* value?
+			break;
 
-			case SPH_ATTR_INT64SET:
-			case SPH_ATTR_UINT32SET:
-				tMatch.SetAttr ( tCalc.m_tLoc, (SphAttr_t)tCalc.m_pExpr->IntEval ( tMatch ) );
-				break;
+		case SPH_ATTR_INT64SET:
+		case SPH_ATTR_UINT32SET:
+			tMatch.SetAttr ( tCalc.m_tLoc, (SphAttr_t)tCalc.m_pExpr->IntEval ( tMatch ) );
+			break;
 
-			default:
-				tMatch.SetAttrFloat ( tCalc.m_tLoc, tCalc.m_pExpr->Eval(tMatch) );
-				break;
-		}
+		default:
+			tMatch.SetAttrFloat ( tCalc.m_tLoc, tCalc.m_pExpr->Eval(tMatch) );
+			break;
 	}
 }
 
+static inline void CalcContextItems ( CSphMatch & tMatch, const CSphVector<CSphQueryContext::CalcItem_t> & dItems )
+{
+	for ( const CSphQueryContext::CalcItem_t & tCalc : dItems )
+		CalcContextItem ( tMatch, tCalc );
+}
+
 void CSphQueryContext::CalcFilter ( CSphMatch & tMatch ) const
 {
 	CalcContextItems ( tMatch, m_dCalcFilter );
@@ -14596,6 +15132,84 @@ void CSphQueryContext::CalcFinal ( CSphMatch & tMatch ) const
 	CalcContextItems ( tMatch, m_dCalcFinal );
 }
 
+
+static void CalcContextBlock ( CSphMatch * const * ppMatches, int iCount, const CSphVector<CSphQueryContext::CalcItem_t> & dItems )
+{
+	CSphVector<int> dInts;
+	CSphVector<int64_t> dInts64;
+	CSphVector<float> dFloats;
+
+	// item by item, so that every item still sees the values of all the previous ones
+	for ( const CSphQueryContext::CalcItem_t & tCalc : dItems )
+	{
+		// expressions that know how to process a whole block (compiled ones, batch UDFs) go first
+		switch ( tCalc.m_eType )
+		{
+			case SPH_ATTR_INTEGER:
+				dInts.Resize ( iCount );
+				if ( tCalc.m_pExpr->IntEvalBlock ( ppMatches, iCount, dInts.Begin() ) )
+				{
+					for ( int i=0; i<iCount; i++ )
+						ppMatches[i]->SetAttr ( tCalc.m_tLoc, dInts[i] );
+					continue;
+				}
+				break;
+
+			case SPH_ATTR_BIGINT:
+				dInts64.Resize ( iCount );
+				if ( tCalc.m_pExpr->Int64EvalBlock ( ppMatches, iCount, dInts64.Begin() ) )
+				{
+					for ( int i=0; i<iCount; i++ )
+						ppMatches[i]->SetAttr ( tCalc.m_tLoc, dInts64[i] );
+					continue;
+				}
+				break;
+
+			case SPH_ATTR_FLOAT:
+				dFloats.Resize ( iCount );
+				if ( tCalc.m_pExpr->EvalBlock ( ppMatches, iCount, dFloats.Begin() ) )
+				{
+					for ( int i=0; i<iCount; i++ )
+						ppMatches[i]->SetAttrFloat ( tCalc.m_tLoc, dFloats[i] );
+					continue;
+				}
+				break;
+
+			default:
+				break;
+		}
+
+		for ( int i=0; i<iCount; i++ )
+			CalcContextItem ( *ppMatches[i], tCalc );
+	}
+}
+
+/// check whether items could be computed in blocks, and whether that makes any sense
+static bool CanCalcContextBlock ( const CSphVector<CSphQueryContext::CalcItem_t> & dItems, bool bDataPtrs )
+{
+	bool bGotBlock = false;
+	for ( const CSphQueryContext::CalcItem_t & tCalc : dItems )
+	{
+		bool bNumeric = tCalc.m_eType==SPH_ATTR_INTEGER || tCalc.m_eType==SPH_ATTR_BIGINT || tCalc.m_eType==SPH_ATTR_FLOAT;
+		if ( !bNumeric && !bDataPtrs )
+			return false;
+		bGotBlock |= ( bNumeric && tCalc.m_pExpr->CanEvalBlock() );
+	}
+	return bGotBlock;
+}
+
+
+void CSphQueryContext::CalcSort ( CSphMatch * const * ppMatches, int iCount ) const
+{
+	CalcContextBlock ( ppMatches, iCount, m_dCalcSort );
+}
+
+
+void CSphQueryContext::CalcFinal ( CSphMatch * const * ppMatches, int iCount ) const
+{
+	CalcContextBlock ( ppMatches, iCount, m_dCalcFinal );
+}
+
 static inline void FreeDataPtrAttrs ( CSphMatch & tMatch, const CSphVector<CSphQueryContext::CalcItem_t> & dItems )
 {
 	if ( !tMatch.m_pDynamic )
@@ -14740,6 +15354,7 @@ void CSphIndex_VLN::MatchExtended ( CSphQueryContext * pCtx, const CSphQuery * p
 
 	// do searching
 	CSphMatch * pMatch = pRanker->GetMatchesBuffer();
+	CSphVector<CSphMatch *> dBlock;
 	while (true)
 	{
 		// ranker does profile switches internally in GetMatches()
@@ -14749,29 +15364,54 @@ void CSphIndex_VLN::MatchExtended ( CSphQueryContext * pCtx, const CSphQuery * p
 
 		if ( pProfile )
 			pProfile->Switch ( SPH_QSTATE_SORT );
-		for ( int i=0; i<iMatches; i++ )
+
+		// returns false for the matches that must be skipped
+		auto fnPrepare = [&] ( CSphMatch & tMatch )
 		{
 			if ( pCtx->m_bLookupSort )
 			{
-				const CSphRowitem * pRow = FindDocinfo ( pMatch[i].m_uDocID );
+				const CSphRowitem * pRow = FindDocinfo ( tMatch.m_uDocID );
 				if ( !pRow && m_tSettings.m_eDocinfo==SPH_DOCINFO_EXTERN )
 				{
 					pCtx->m_iBadRows++;
-					continue;
+					return false;
 				}
-				CopyDocinfo ( pCtx, pMatch[i], pRow );
+				CopyDocinfo ( pCtx, tMatch, pRow );
 			}
 
-			pMatch[i].m_iWeight *= iIndexWeight;
-			pCtx->CalcSort ( pMatch[i] );
+			tMatch.m_iWeight *= iIndexWeight;
+			return true;
+		};
+
+		// when sorting expressions can go block by block, do all the lookups first, then compute them in one go
+		if ( pCtx->m_bCalcSortBlock )
+		{
+			dBlock.Resize ( 0 );
+			for ( int i=0; i<iMatches; i++ )
+				if ( fnPrepare ( pMatch[i] ) )
+					dBlock.Add ( pMatch+i );
+
+			pCtx->CalcSort ( dBlock.Begin(), dBlock.GetLength() );
+			iMatches = dBlock.GetLength();
+		}
+
+		for ( int i=0; i<iMatches; i++ )
+		{
+			CSphMatch & tMatch = pCtx->m_bCalcSortBlock ? *dBlock[i] : pMatch[i];
+			if ( !pCtx->m_bCalcSortBlock )
+			{
+				if ( !fnPrepare ( tMatch ) )
+					continue;
+				pCtx->CalcSort ( tMatch );
+			}
 
-			if ( pCtx->m_pWeightFilter && !pCtx->m_pWeightFilter->Eval ( pMatch[i] ) )
+			if ( pCtx->m_pWeightFilter && !pCtx->m_pWeightFilter->Eval ( tMatch ) )
 			{
-				pCtx->FreeDataSort ( pMatch[i] );
+				pCtx->FreeDataSort ( tMatch );
 				continue;
 			}
 
-			pMatch[i].m_iTag = iTag;
+			tMatch.m_iTag = iTag;
 
 			bool bRand = false;
 			bool bNewMatch = false;
@@ -14782,12 +15422,12 @@ void CSphIndex_VLN::MatchExtended ( CSphQueryContext * pCtx, const CSphQuery * p
 				if ( !bRand && ppSorters[iSorter]->m_bRandomize )
 				{
 					bRand = true;
-					pMatch[i].m_iWeight = ( sphRand() & 0xffff ) * iIndexWeight;
+					tMatch.m_iWeight = ( sphRand() & 0xffff ) * iIndexWeight;
 
-					if ( pCtx->m_pWeightFilter && !pCtx->m_pWeightFilter->Eval ( pMatch[i] ) )
+					if ( pCtx->m_pWeightFilter && !pCtx->m_pWeightFilter->Eval ( tMatch ) )
 						break;
 				}
-				bNewMatch |= ppSorters[iSorter]->Push ( pMatch[i] );
+				bNewMatch |= ppSorters[iSorter]->Push ( tMatch );
 
 				if ( pCtx->m_uPackedFactorFlags & SPH_FACTOR_ENABLE )
 				{
@@ -14795,7 +15435,7 @@ void CSphIndex_VLN::MatchExtended ( CSphQueryContext * pCtx, const CSphQuery * p
 					pRanker->ExtraData ( EXTRA_SET_MATCHPOPPED, (void**)&(ppSorters[iSorter]->m_dJustPopped) );
 				}
 			}
-			pCtx->FreeDataSort ( pMatch[i] );
+			pCtx->FreeDataSort ( tMatch );
 
 			if ( bNewMatch )
 				if ( --iCutoff==0 )
@@ -14819,13 +15459,29 @@ struct SphFinalMatchCalc_t : ISphMatchProcessor, ISphNoncopyable
 	const CSphQueryContext &	m_tCtx;
 	int64_t						m_iBadRows;
 	int							m_iTag;
+	bool						m_bBlock;		///< collect matches and evaluate them in blocks (for batch UDFs)
+	CSphVector<CSphMatch *>		m_dBlock;
 
-	SphFinalMatchCalc_t ( int iTag, const CSphIndex_VLN * pIndex, const CSphQueryContext & tCtx )
+	SphFinalMatchCalc_t ( int iTag, const CSphIndex_VLN * pIndex, const CSphQueryContext & tCtx, bool bBlock=false )
 		: m_pDocinfoSrc ( pIndex )
 		, m_tCtx ( tCtx )
 		, m_iBadRows ( 0 )
 		, m_iTag ( iTag )
-	{ }
+		, m_bBlock ( bBlock )
+	{
+		if ( m_bBlock )
+			m_dBlock.Reserve ( CSphQueryContext::CALC_BLOCK_SIZE );
+	}
+
+	/// evaluate whatever is left in the current block; must be called after Finalize() in block mode
+	void Flush ()
+	{
+		if ( !m_dBlock.GetLength() )
+			return;
+
+		m_tCtx.CalcFinal ( m_dBlock.Begin(), m_dBlock.GetLength() );
+		m_dBlock.Resize ( 0 );
+	}
 
 	void Process ( CSphMatch * pMatch ) final
 	{
@@ -14850,8 +15506,16 @@ struct SphFinalMatchCalc_t : ISphMatchProcessor, ISphNoncopyable
 			m_pDocinfoSrc->CopyDocinfo ( &m_tCtx, *pMatch, pRow );
 		}
 
-		m_tCtx.CalcFinal ( *pMatch );
 		pMatch->m_iTag = m_iTag;
+		if ( !m_bBlock )
+		{
+			m_tCtx.CalcFinal ( *pMatch );
+			return;
+		}
+
+		m_dBlock.Add ( pMatch );
+		if ( m_dBlock.GetLength()>=CSphQueryContext::CALC_BLOCK_SIZE )
+			Flush();
 	}
 };
 
@@ -15063,6 +15727,10 @@ bool CSphIndex_VLN::MultiScan ( const CSphQuery * pQuery, CSphQueryResult * pRes
 		int64_t iStep = bReverse ? -1 : 1;
 		for ( int64_t iIndexEntry=iStart; iIndexEntry!=iEnd; iIndexEntry+=iStep )
 		{
+			// KILL, client disconnect, or query limits
+			if ( sphQueryStopped() )
+				break;
+
 			// block-level filtering
 			const DWORD * pMin = &m_pDocinfoIndex[ iIndexEntry*uStride*2 ];
 			const DWORD * pMax = pMin + uStride;
@@ -15094,7 +15762,8 @@ bool CSphIndex_VLN::MultiScan ( const CSphQuery * pQuery, CSphQueryResult * pRes
 							tMatch.m_iWeight = ( sphRand() & 0xffff ) * tArgs.m_iIndexWeight;
 						for ( int iSorter=0; iSorter<iSorters; iSorter++ )
 							ppSorters[iSorter]->Push ( tMatch );
-					}
+					} else
+						pResult->m_tStats.m_iFiltered++;
 					// stringptr expressions should be duplicated (or taken over) at this point
 					tCtx.FreeDataFilter ( tMatch );
 				}
@@ -15111,6 +15780,7 @@ bool CSphIndex_VLN::MultiScan ( const CSphQuery * pQuery, CSphQueryResult * pRes
 					tCtx.CalcFilter ( tMatch );
 					if ( tCtx.m_pFilter && !tCtx.m_pFilter->Eval ( tMatch ) )
 					{
+						pResult->m_tStats.m_iFiltered++;
 						tCtx.FreeDataFilter ( tMatch );
 						continue;
 					}
@@ -15278,37 +15948,45 @@ bool DiskIndexQwordSetup_c::Setup ( ISphQword * pWord ) const
 			return false;
 	}
 
-	const CSphWordlistCheckpoint * pCheckpoint = pIndex->m_tWordlist.FindCheckpoint ( sWord, iWordLen, tWord.m_uWordID, false );
-	if ( !pCheckpoint )
-		return false;
-
-	// decode wordlist chunk
-	const BYTE * pBuf = pIndex->m_tWordlist.AcquireDict ( pCheckpoint );
-	assert ( pBuf );
-
 	CSphDictEntry tRes;
-	if ( bWordDict )
+	if ( bWordDict && pIndex->m_tWordlist.HasDirectory() )
 	{
-		KeywordsBlockReader_c tCtx ( pBuf, m_pSkips!=NULL );
-		while ( tCtx.UnpackWord() )
-		{
-			// block is sorted
-			// so once keywords are greater than the reference word, no more matches
-			assert ( tCtx.GetWordLen()>0 );
-			int iCmp = sphDictCmpStrictly ( sWord, iWordLen, tCtx.GetWord(), tCtx.GetWordLen() );
-			if ( iCmp<0 )
-				return false;
-			if ( iCmp==0 )
-				break;
-		}
-		if ( tCtx.GetWordLen()<=0 )
+		if ( !pIndex->m_tWordlist.GetDirWord ( sWord, iWordLen, tRes ) )
 			return false;
-		tRes = tCtx;
 
 	} else
 	{
-		if ( !pIndex->m_tWordlist.GetWord ( pBuf, tWord.m_uWordID, tRes ) )
+		const CSphWordlistCheckpoint * pCheckpoint = pIndex->m_tWordlist.FindCheckpoint ( sWord, iWordLen, tWord.m_uWordID, false );
+		if ( !pCheckpoint )
 			return false;
+
+		// decode wordlist chunk
+		const BYTE * pBuf = pIndex->m_tWordlist.AcquireDict ( pCheckpoint );
+		assert ( pBuf );
+
+		if ( bWordDict )
+		{
+			KeywordsBlockReader_c tCtx ( pBuf, m_pSkips!=NULL );
+			while ( tCtx.UnpackWord() )
+			{
+				// block is sorted
+				// so once keywords are greater than the reference word, no more matches
+				assert ( tCtx.GetWordLen()>0 );
+				int iCmp = sphDictCmpStrictly ( sWord, iWordLen, tCtx.GetWord(), tCtx.GetWordLen() );
+				if ( iCmp<0 )
+					return false;
+				if ( iCmp==0 )
+					break;
+			}
+			if ( tCtx.GetWordLen()<=0 )
+				return false;
+			tRes = tCtx;
+
+		} else
+		{
+			if ( !pIndex->m_tWordlist.GetWord ( pBuf, tWord.m_uWordID, tRes ) )
+				return false;
+		}
 	}
 
 	const ESphHitless eMode = pIndex->m_tSettings.m_eHitless;
@@ -15347,7 +16025,17 @@ bool DiskIndexQwordSetup_c::Setup ( ISphQword * pWord ) const
 			}
 		}
 
-		tWord.m_rdDoclist.SeekTo ( tRes.m_iDoclistOffset, tRes.m_iDoclistHint );
+		tWord.m_pCachedDoclist = nullptr;
+		if ( DoclistCache_c::IsEnabled() )
+			tWord.m_pCachedDoclist = pIndex->m_tDoclistCache.Fetch ( tRes.m_iDoclistOffset, tRes.m_iDoclistHint, m_tDoclist,
+				pIndex->m_tSettings.m_eHitFormat==SPH_HIT_FORMAT_INLINE, tWord.m_iInlineAttrs, tWord.m_bHasHitlist );
+
+		if ( tWord.m_pCachedDoclist )
+		{
+			const CSphFixedVector<BYTE> & dData = tWord.m_pCachedDoclist->m_dData;
+			tWord.m_rdDoclist.SetExternalBuffer ( dData.Begin(), dData.GetLength(), tRes.m_iDoclistOffset );
+		} else
+			tWord.m_rdDoclist.SeekTo ( tRes.m_iDoclistOffset, tRes.m_iDoclistHint );
 
 		tWord.m_rdHitlist.SetBuffers ( g_iReadBuffer, g_iReadUnhinted );
 		tWord.m_rdHitlist.SetFile ( m_tHitlist );
@@ -15360,6 +16048,159 @@ bool DiskIndexQwordSetup_c::Setup ( ISphQword * pWord ) const
 
 //////////////////////////////////////////////////////////////////////////////
 
+DoclistCache_c::Shard_t & DoclistCache_c::GetShard ( Shard_t * pShards, SphOffset_t iOffset )
+{
+	// doclist offsets are byte positions; mix in the high bits so that nearby lists spread evenly
+	uint64_t uHash = (uint64_t)iOffset;
+	uHash ^= uHash>>17;
+	return pShards [ uHash % DOCLIST_CACHE_SHARDS ];
+}
+
+
+DoclistCacheEntry_t * DoclistCache_c::Fetch ( SphOffset_t iOffset, int iHint, const CSphAutofile & tDoclist, bool bInlineHits, int iInlineAttrs, bool bHasHitlist )
+{
+	Shard_t & tShard = GetShard ( m_dShards, iOffset );
+	const int64_t iShardLimit = g_tDoclistCache.GetMaxBytes() / DOCLIST_CACHE_SHARDS;
+
+	{
+		ScopedMutex_t tLock ( tShard.m_tLock );
+		DoclistCacheEntry_t ** ppEntry = tShard.m_hEntries ( iOffset );
+		if ( ppEntry )
+		{
+			g_tDoclistCache.Hit();
+			(*ppEntry)->m_uLastUse = ++tShard.m_uClock;
+			(*ppEntry)->AddRef();
+			return *ppEntry;
+		}
+
+		g_tDoclistCache.Miss();
+
+		// admission; short lists are cheap to read, huge ones would flush everything else
+		if ( iHint<DOCLIST_CACHE_MIN_BYTES || iHint>iShardLimit/4 )
+			return NULL;
+
+		if ( tShard.m_hSeen.GetLength()>=DOCLIST_CACHE_MAX_SEEN )
+			tShard.m_hSeen.Reset();
+
+		int & iSeen = tShard.m_hSeen.AddUnique ( iOffset );
+		if ( ++iSeen<DOCLIST_CACHE_MIN_SEEN )
+			return NULL;
+
+		tShard.m_hSeen.Delete ( iOffset );
+	}
+
+	// concurrent fetches of the same term might both load it; only one gets stored, that's fine
+	DoclistCacheEntry_t * pEntry = Load ( iOffset, iHint, tDoclist, bInlineHits, iInlineAttrs, bHasHitlist );
+	if ( !pEntry )
+		return NULL;
+
+	ScopedMutex_t tLock ( tShard.m_tLock );
+	if ( tShard.m_hEntries.Exists ( iOffset ) )
+		return pEntry; // another query got there first; use own copy, the cached one stays
+
+	int64_t iBytes = pEntry->m_dData.GetLengthBytes();
+	while ( tShard.m_iBytes+iBytes>iShardLimit && tShard.m_hEntries.GetLength() )
+		EvictOne ( tShard );
+
+	pEntry->m_uLastUse = ++tShard.m_uClock;
+	pEntry->AddRef(); // cache reference
+	tShard.m_hEntries.Add ( pEntry, iOffset );
+	tShard.m_iBytes += iBytes;
+	g_tDoclistCache.AddBytes ( iBytes );
+	return pEntry;
+}
+
+
+DoclistCacheEntry_t * DoclistCache_c::Load ( SphOffset_t iOffset, int iHint, const CSphAutofile & tDoclist, bool bInlineHits, int iInlineAttrs, bool bHasHitlist )
+{
+	// walk the doclist to find its exact length
+	CSphReader tReader;
+	tReader.SetBuffers ( g_iReadBuffer, g_iReadUnhinted );
+	tReader.SetFile ( tDoclist );
+	tReader.SeekTo ( iOffset, iHint );
+
+	while ( tReader.UnzipDocid() && !tReader.GetErrorFlag() )
+	{
+		for ( int i=0; i<iInlineAttrs; i++ )
+			tReader.UnzipInt();
+
+		if ( bInlineHits )
+		{
+			DWORD uHits = tReader.UnzipInt();
+			tReader.UnzipInt();
+			if ( uHits==1 && bHasHitlist )
+				tReader.UnzipInt();
+			else
+				tReader.UnzipOffset();
+		} else
+		{
+			tReader.UnzipOffset();
+			tReader.UnzipInt();
+			tReader.UnzipInt();
+		}
+	}
+
+	int64_t iLen = tReader.GetPos() - iOffset;
+	if ( tReader.GetErrorFlag() || iLen<=0 || iLen>g_tDoclistCache.GetMaxBytes() / DOCLIST_CACHE_SHARDS )
+		return NULL;
+
+	DoclistCacheEntry_t * pEntry = new DoclistCacheEntry_t;
+	pEntry->m_dData.Reset ( (int)iLen );
+	if ( sphPread ( tDoclist.GetFD(), pEntry->m_dData.Begin(), (int)iLen, iOffset )!=iLen )
+	{
+		SafeRelease ( pEntry );
+		return NULL;
+	}
+
+	return pEntry;
+}
+
+
+void DoclistCache_c::EvictOne ( Shard_t & tShard )
+{
+	// few big entries per shard, so a linear scan for the least recently used one is fine
+	SphOffset_t iOldest = 0;
+	DWORD uMaxAge = 0;
+	bool bFound = false;
+	tShard.m_hEntries.IterateStart();
+	while ( tShard.m_hEntries.IterateNext() )
+	{
+		DWORD uAge = tShard.m_uClock - tShard.m_hEntries.IterateGet()->m_uLastUse; // unsigned, survives clock wraparound
+		if ( !bFound || uAge>uMaxAge )
+		{
+			bFound = true;
+			uMaxAge = uAge;
+			iOldest = tShard.m_hEntries.IterateGetKey();
+		}
+	}
+	assert ( bFound );
+
+	DoclistCacheEntry_t * pEntry = tShard.m_hEntries[iOldest];
+	int64_t iBytes = pEntry->m_dData.GetLengthBytes();
+	tShard.m_iBytes -= iBytes;
+	g_tDoclistCache.SubBytes ( iBytes );
+	tShard.m_hEntries.Delete ( iOldest );
+	SafeRelease ( pEntry );
+}
+
+
+void DoclistCache_c::Reset ()
+{
+	for ( Shard_t & tShard : m_dShards )
+	{
+		ScopedMutex_t tLock ( tShard.m_tLock );
+		tShard.m_hEntries.IterateStart();
+		while ( tShard.m_hEntries.IterateNext() )
+			SafeRelease ( tShard.m_hEntries.IterateGet() );
+		tShard.m_hEntries.Reset();
+		tShard.m_hSeen.Reset();
+		g_tDoclistCache.SubBytes ( tShard.m_iBytes );
+		tShard.m_iBytes = 0;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 bool RawFileLock ( const CSphString sFile, int &iLockFD, CSphString &sError )
 {
 	if ( iLockFD<0 )
@@ -15424,6 +16265,7 @@ void CSphIndex_VLN::Dealloc ()
 	m_tString.Reset ();
 	m_tKillList.Reset ();
 	m_tSkiplists.Reset ();
+	m_tDoclistCache.Reset ();
 	m_tWordlist.Reset ();
 	m_tDocinfoHash.Reset ();
 	m_tMinMaxLegacy.Reset();
@@ -15743,8 +16585,8 @@ void CSphIndex_VLN::DebugDumpHeader ( FILE * fp, const char * sHeaderName, bool
 				fprintf ( fp, "\tsql_attr_multi = bigint %s from field\n", tAttr.m_sName.cstr() );
 			else if ( tAttr.m_eAttrType==SPH_ATTR_INTEGER && tAttr.m_tLocator.IsBitfield() )
 				fprintf ( fp, "\tsql_attr_uint = %s:%d\n", tAttr.m_sName.cstr(), tAttr.m_tLocator.m_iBitCount );
-			else if ( tAttr.m_eAttrType==SPH_ATTR_TOKENCOUNT )
-			{; // intendedly skip, as these are autogenerated by index_field_lengths=1
+			else if ( tAttr.m_eAttrType==SPH_ATTR_TOKENCOUNT || sphIsJsonHotAttr ( tAttr ) )
+			{; // intendedly skip, as these are autogenerated by index_field_lengths=1 and json_hot_attr_xxx
 			} else
 				fprintf ( fp, "\t%s = %s\n", sphTypeDirective ( tAttr.m_eAttrType ), tAttr.m_sName.cstr() );
 		}
@@ -15771,6 +16613,12 @@ void CSphIndex_VLN::DebugDumpHeader ( FILE * fp, const char * sHeaderName, bool
 			fprintf ( fp, "\tindex_zones = %s\n", m_tSettings.m_sZones.cstr() );
 		if ( m_tSettings.m_bIndexFieldLens )
 			fprintf ( fp, "\tindex_field_lengths = 1\n" );
+		for ( int i=0; i<m_tSchema.GetAttrsCount(); i++ )
+		{
+			const CSphColumnInfo & tAttr = m_tSchema.GetAttr(i);
+			if ( sphJsonHotAttrPath ( tAttr ) )
+				fprintf ( fp, "\tjson_hot_attr_%s = %s\n", sphJsonHotTypeName ( tAttr.m_eAttrType ), sphJsonHotAttrPath ( tAttr ) );
+		}
 		if ( m_tSettings.m_bIndexSP )
 			fprintf ( fp, "\tindex_sp = 1\n" );
 		if ( m_tSettings.m_iBoundaryStep!=0 )
@@ -16452,6 +17300,8 @@ bool CSphQueryContext::SetupCalc ( CSphQueryResult * pResult, const ISphSchema &
 	m_dCalcFilter.Resize ( 0 );
 	m_dCalcSort.Resize ( 0 );
 	m_dCalcFinal.Resize ( 0 );
+	m_bCalcSortBlock = false;
+	m_bCalcFinalBlock = false;
 
 	// quickly verify that all my real attributes can be stashed there
 	if ( tInSchema.GetAttrsCount() < tSchema.GetAttrsCount() )
@@ -16556,6 +17406,10 @@ bool CSphQueryContext::SetupCalc ( CSphQueryResult * pResult, const ISphSchema &
 		}
 	}
 
+	// sorting stage frees stringptrs match by match, so only go block by block when there are none
+	m_bCalcSortBlock = CanCalcContextBlock ( m_dCalcSort, false );
+	m_bCalcFinalBlock = CanCalcContextBlock ( m_dCalcFinal, true );
+
 	// ok, we can emit matches in this schema (incoming for sorter, outgoing for index/searcher)
 	return true;
 }
@@ -18223,12 +19077,12 @@ bool CSphIndex_VLN::ParsedMultiQuery ( const CSphQuery * pQuery, CSphQueryResult
 	tTermSetup.m_pNodeCache = pNodeCache;
 
 	// setup prediction constrain
+	// docs/hits counters are always collected (they feed /metrics), the budget only when predicting
 	CSphQueryStats tQueryStats;
 	bool bCollectPredictionCounters = ( pQuery->m_iMaxPredictedMsec>0 );
 	int64_t iNanoBudget = (int64_t)(pQuery->m_iMaxPredictedMsec) * 1000000; // from milliseconds to nanoseconds
-	tQueryStats.m_pNanoBudget = &iNanoBudget;
-	if ( bCollectPredictionCounters )
-		tTermSetup.m_pStats = &tQueryStats;
+	tQueryStats.m_pNanoBudget = bCollectPredictionCounters ? &iNanoBudget : nullptr;
+	tTermSetup.m_pStats = &tQueryStats;
 
 	// bind weights
 	tCtx.BindWeights ( pQuery, m_tSchema, pResult->m_sWarning );
@@ -18351,11 +19205,12 @@ bool CSphIndex_VLN::ParsedMultiQuery ( const CSphQuery * pQuery, CSphQueryResult
 		ARRAY_FOREACH_COND ( i, tCtx.m_dCalcFinal, !bGotUDF )
 			tCtx.m_dCalcFinal[i].m_pExpr->Command ( SPH_EXPR_GET_UDF, &bGotUDF );
 
-		SphFinalMatchCalc_t tProcessor ( tArgs.m_iTag, bFinalLookup ? this : NULL, tCtx );
+		SphFinalMatchCalc_t tProcessor ( tArgs.m_iTag, bFinalLookup ? this : NULL, tCtx, bGotUDF || tCtx.m_bCalcFinalBlock );
 		for ( int iSorter=0; iSorter<iSorters; iSorter++ )
 		{
 			ISphMatchSorter * pTop = ppSorters[iSorter];
 			pTop->Finalize ( tProcessor, bGotUDF );
+			tProcessor.Flush();
 		}
 		pResult->m_iBadRows += tProcessor.m_iBadRows;
 	}
@@ -18380,11 +19235,9 @@ bool CSphIndex_VLN::ParsedMultiQuery ( const CSphQuery * pQuery, CSphQueryResult
 	if ( pProfile )
 		pProfile->Switch ( eOldState );
 
+	pResult->m_tStats.Add ( tQueryStats );
 	if ( bCollectPredictionCounters )
-	{
-		pResult->m_tStats.Add ( tQueryStats );
 		pResult->m_bHasPrediction = true;
-	}
 
 	return true;
 }
@@ -18407,6 +19260,7 @@ void CSphIndex_VLN::GetStatus ( CSphIndexStatus* pRes ) const
 		+ m_tMva.GetLengthBytes()
 		+ m_tString.GetLengthBytes()
 		+ m_tWordlist.m_tBuf.GetLengthBytes()
+		+ m_tWordlist.GetDirectoryBytes()
 		+ m_tKillList.GetLengthBytes()
 		+ m_tSkiplists.GetLengthBytes();
 
@@ -20142,6 +20996,7 @@ public:
 
 protected:
 	CSphVector < int >	m_dMorph;
+	uint64_t			m_uMorphFNV = 0;	///< GetMorphFNV() of the stemmers above, for morphology cache keys
 #if USE_LIBSTEMMER
 	CSphVector < sb_stemmer * >	m_dStemmers;
 	StrVec_t			m_dDescStemmers;
@@ -20153,6 +21008,8 @@ protected:
 
 protected:
 	int					ParseMorphology ( const char * szMorph, CSphString & sError );
+	void				StemWord ( BYTE * pWord ) const;
+	uint64_t			GetMorphFNV () const;
 	SphWordID_t			FilterStopword ( SphWordID_t uID ) const;	///< filter ID against stopwords list
 	CSphDict *			CloneBase ( CSphTemplateDictTraits * pDict ) const;
 	virtual bool		HasState () const;
@@ -20697,11 +21554,119 @@ int CSphTemplateDictTraits::AddMorph ( int iMorph )
 {
 	if ( !m_dMorph.Contains ( iMorph ) )
 		m_dMorph.Add ( iMorph );
+	m_uMorphFNV = GetMorphFNV();
 	return ST_OK;
 }
 
 
 
+/////////////////////////////////////////////////////////////////////////////
+
+static CacheCounters_c	g_tMorphCacheCounters;	///< per-thread limit, and totals over all threads
+
+/// per-thread cache of stemming results, keyed by morphology settings hash and raw token
+/// natural text is very repetitive, so even a modest cache saves most of stemmer (and especially lemmatizer) calls
+/// every thread has its own one, so lookups take no locks; cache that runs out of memory simply starts over
+class MorphCache_c : public ISphNoncopyable
+{
+public:
+			~MorphCache_c () { Reset(); }
+
+	bool	Get ( uint64_t uKey, uint64_t uMorph, BYTE * pWord, int iLen ) const;
+	void	Add ( uint64_t uKey, uint64_t uMorph, const BYTE * pRaw, int iRawLen, const BYTE * pWord );
+
+private:
+	struct Form_t
+	{
+		uint64_t	m_uMorph;	///< morphology settings hash, to tell hash collisions
+		CSphString	m_sRaw;
+		CSphString	m_sForm;
+	};
+
+	CSphOrderedHash<Form_t, uint64_t, IdentityHash_fn, 4096>	m_hForms;
+	int64_t		m_iBytes = 0;
+
+	void	Reset ();
+};
+
+static thread_local MorphCache_c g_tMorphCache;
+
+
+bool MorphCache_c::Get ( uint64_t uKey, uint64_t uMorph, BYTE * pWord, int iLen ) const
+{
+	const Form_t * pForm = m_hForms ( uKey );
+	if ( !pForm || pForm->m_uMorph!=uMorph || pForm->m_sRaw.Length()!=iLen || memcmp ( pForm->m_sRaw.cstr(), pWord, iLen ) )
+	{
+		g_tMorphCacheCounters.Miss();
+		return false;
+	}
+
+	g_tMorphCacheCounters.Hit();
+	memcpy ( pWord, pForm->m_sForm.cstr(), pForm->m_sForm.Length()+1 );
+	return true;
+}
+
+
+void MorphCache_c::Add ( uint64_t uKey, uint64_t uMorph, const BYTE * pRaw, int iRawLen, const BYTE * pWord )
+{
+	// raw word, stemmed form, and a rough guess of hash entry overhead
+	auto iFormLen = (int) strlen ( (const char *)pWord );
+	int64_t iBytes = iRawLen + iFormLen + 64;
+	if ( m_iBytes+iBytes > g_tMorphCacheCounters.GetMaxBytes() )
+		Reset();
+
+	Form_t tForm;
+	tForm.m_uMorph = uMorph;
+	tForm.m_sRaw.SetBinary ( (const char *)pRaw, iRawLen );
+	tForm.m_sForm.SetBinary ( (const char *)pWord, iFormLen );
+	if ( m_hForms.Add ( tForm, uKey ) )
+	{
+		m_iBytes += iBytes;
+		g_tMorphCacheCounters.AddBytes ( iBytes );
+	}
+}
+
+
+void MorphCache_c::Reset ()
+{
+	g_tMorphCacheCounters.SubBytes ( m_iBytes );
+	m_hForms.Reset();
+	m_iBytes = 0;
+}
+
+
+void sphSetMorphologyCacheSize ( int64_t iMaxBytes )
+{
+	g_tMorphCacheCounters.SetMaxBytes ( iMaxBytes );
+}
+
+
+CacheStatus_t sphGetMorphologyCacheStatus ()
+{
+	return g_tMorphCacheCounters.GetStatus();
+}
+
+
+/// hash of everything that stemmers output depends on (except the word itself)
+uint64_t CSphTemplateDictTraits::GetMorphFNV () const
+{
+	uint64_t uHash = sphFNV64 ( m_dMorph.Begin(), m_dMorph.GetLength()*sizeof(m_dMorph[0]) );
+#if USE_LIBSTEMMER
+	ARRAY_FOREACH ( i, m_dDescStemmers )
+		uHash = sphFNV64 ( m_dDescStemmers[i].cstr(), m_dDescStemmers[i].Length(), uHash );
+#endif
+	return uHash;
+}
+
+
+void CSphTemplateDictTraits::StemWord ( BYTE * pWord ) const
+{
+	ARRAY_FOREACH ( i, m_dMorph )
+		if ( StemById ( pWord, m_dMorph[i] ) )
+			break;
+}
+
+
 void CSphTemplateDictTraits::ApplyStemmers ( BYTE * pWord ) const
 {
 	// try wordforms
@@ -20711,10 +21676,23 @@ void CSphTemplateDictTraits::ApplyStemmers ( BYTE * pWord ) const
 	// check length
 	if ( m_tSettings.m_iMinStemmingLen<=1 || sphUTF8Len ( (const char*)pWord )>=m_tSettings.m_iMinStemmingLen )
 	{
-		// try stemmers
-		ARRAY_FOREACH ( i, m_dMorph )
-			if ( StemById ( pWord, m_dMorph[i] ) )
-				break;
+		// try stemmers, via the cache if it's on
+		// indexes with the same morphology share cached forms
+		if ( g_tMorphCacheCounters.IsEnabled() && m_dMorph.GetLength() )
+		{
+			auto iLen = (int) strlen ( (const char *)pWord );
+			uint64_t uKey = sphFNV64 ( pWord, iLen, m_uMorphFNV );
+			MorphCache_c & tCache = g_tMorphCache;
+			if ( !tCache.Get ( uKey, m_uMorphFNV, pWord, iLen ) )
+			{
+				BYTE sRaw [ 3*SPH_MAX_WORD_LEN+4 ];
+				iLen = Min ( iLen, (int)sizeof(sRaw)-1 );
+				memcpy ( sRaw, pWord, iLen );
+				StemWord ( pWord );
+				tCache.Add ( uKey, m_uMorphFNV, sRaw, iLen, pWord );
+			}
+		} else
+			StemWord ( pWord );
 	}
 
 	if ( m_pWordforms && m_pWordforms->m_bHavePostMorphNF )
@@ -20764,6 +21742,7 @@ CSphDict * CSphTemplateDictTraits::CloneBase ( CSphTemplateDictTraits * pDict )
 		m_pWordforms->m_iRefCount++;
 
 	pDict->m_dMorph = m_dMorph;
+	pDict->m_uMorphFNV = m_uMorphFNV;
 #if USE_LIBSTEMMER
 	assert ( m_dDescStemmers.GetLength()==m_dStemmers.GetLength() );
 	pDict->m_dDescStemmers = m_dDescStemmers;
@@ -21584,6 +22563,7 @@ void CSphTemplateDictTraits::WriteWordforms ( CSphWriter & tWriter ) const
 int CSphTemplateDictTraits::SetMorphology ( const char * szMorph, CSphString & sMessage )
 {
 	m_dMorph.Reset ();
+	m_uMorphFNV = GetMorphFNV();
 #if USE_LIBSTEMMER
 	ARRAY_FOREACH ( i, m_dStemmers )
 		sb_stemmer_delete ( m_dStemmers[i] );
@@ -21598,6 +22578,7 @@ int CSphTemplateDictTraits::SetMorphology ( const char * szMorph, CSphString & s
 
 	CSphString sError;
 	int iRes = ParseMorphology ( sOption.cstr(), sMessage );
+	m_uMorphFNV = GetMorphFNV();
 	if ( iRes==ST_WARNING && sMessage.IsEmpty() )
 		sMessage.SetSprintf ( "invalid morphology option %s; skipped", sOption.cstr() );
 	return iRes;
@@ -25138,6 +26119,7 @@ void CSphSource::Setup ( const CSphSourceSettings & tSettings )
 	m_dPrefixFields = tSettings.m_dPrefixFields;
 	m_dInfixFields = tSettings.m_dInfixFields;
 	m_bIndexFieldLens = tSettings.m_bIndexFieldLens;
+	m_dJsonHotAttrs = tSettings.m_dJsonHotAttrs;
 }
 
 
@@ -25490,12 +26472,336 @@ bool AddFieldLens ( CSphSchema & tSchema, bool bDynamic, CSphString & sError )
 }
 
 
+static const char g_sJsonHotPrefix[] = "@json.";
+static const char g_sJsonHotMask[] = "@json.@exact";
+static const int JSON_HOT_MAX = 64;
+static const int64_t FLOAT_EXACT_INT = 1<<24; // every integer up to this one is a float exactly
+
+bool sphJsonHotAttrName ( const char * sPath, CSphString & sName )
+{
+	if ( !sPath )
+		return false;
+
+	// only plain dotted paths (column.key[.key...]) are eligible; subscripts are not
+	CSphVector<char> dName;
+	dName.Append ( g_sJsonHotPrefix, sizeof(g_sJsonHotPrefix)-1 );
+
+	int iParts = 0;
+	const char * p = sPath;
+	while ( true )
+	{
+		while ( *p==' ' )
+			p++;
+		const char * pStart = p;
+		while ( sphIsAttr(*p) )
+			p++;
+		if ( p==pStart )
+			return false;
+
+		// column names are case insensitive, JSON keys are not
+		for ( const char * s = pStart; s<p; s++ )
+			dName.Add ( iParts ? *s : (char) tolower(*s) );
+		iParts++;
+
+		while ( *p==' ' )
+			p++;
+		if ( !*p )
+			break;
+		if ( *p!='.' )
+			return false;
+		dName.Add ( *p++ );
+	}
+
+	if ( iParts<2 )
+		return false;
+
+	sName.SetBinary ( dName.Begin(), dName.GetLength() );
+	return true;
+}
+
+
+int sphJsonHotAttrIndex ( const ISphSchema & tSchema, const char * sPath )
+{
+	if ( !sPath || !strchr ( sPath, '.' ) )
+		return -1;
+
+	CSphString sName;
+	if ( !sphJsonHotAttrName ( sPath, sName ) )
+		return -1;
+
+	return tSchema.GetAttrIndex ( sName.cstr() );
+}
+
+
+bool sphIsJsonHotAttr ( const CSphColumnInfo & tCol )
+{
+	return tCol.m_sName.Begins ( g_sJsonHotPrefix );
+}
+
+
+int sphJsonHotMaskIndex ( const ISphSchema & tSchema )
+{
+	return tSchema.GetAttrIndex ( g_sJsonHotMask );
+}
+
+
+int sphJsonHotMaskBit ( const ISphSchema & tSchema, int iHot )
+{
+	int iBit = 0;
+	for ( int i=0; i<iHot; i++ )
+	{
+		const CSphColumnInfo & tCol = tSchema.GetAttr(i);
+		if ( sphIsJsonHotAttr ( tCol ) && tCol.m_sName!=g_sJsonHotMask )
+			iBit++;
+	}
+	return iBit;
+}
+
+
+const char * sphJsonHotAttrPath ( const CSphColumnInfo & tCol )
+{
+	return ( sphIsJsonHotAttr ( tCol ) && tCol.m_sName!=g_sJsonHotMask ) ? tCol.m_sName.cstr() + sizeof(g_sJsonHotPrefix) - 1 : nullptr;
+}
+
+
+const char * sphJsonHotTypeName ( ESphAttr eType )
+{
+	switch ( eType )
+	{
+	case SPH_ATTR_INTEGER:	return "uint";
+	case SPH_ATTR_BIGINT:	return "bigint";
+	case SPH_ATTR_FLOAT:	return "float";
+	case SPH_ATTR_STRING:	return "string";
+	default:				return "unknown";
+	}
+}
+
+
+bool AddJsonHotAttrs ( CSphSchema & tSchema, const CSphVector<CSphColumnInfo> & dPaths, bool bDynamic, CSphString & sError )
+{
+	for ( const auto & tPath : dPaths )
+	{
+		CSphColumnInfo tCol;
+		if ( !sphJsonHotAttrName ( tPath.m_sName.cstr(), tCol.m_sName ) )
+		{
+			sError.SetSprintf ( "invalid hot JSON path '%s'", tPath.m_sName.cstr() );
+			return false;
+		}
+
+		// looks like we already added this one
+		const CSphColumnInfo * pGot = tSchema.GetAttr ( tCol.m_sName.cstr() );
+		if ( pGot && pGot->m_eAttrType==tPath.m_eAttrType )
+			continue;
+
+		if ( pGot )
+		{
+			sError.SetSprintf ( "hot JSON path '%s' declared twice", tPath.m_sName.cstr() );
+			return false;
+		}
+
+		CSphString sColumn;
+		sphJsonNameSplit ( tPath.m_sName.cstr(), &sColumn, nullptr );
+		sColumn.ToLower();
+		const CSphColumnInfo * pJson = tSchema.GetAttr ( sColumn.cstr() );
+		if ( !pJson || pJson->m_eAttrType!=SPH_ATTR_JSON )
+		{
+			sError.SetSprintf ( "hot JSON path '%s': '%s' is not a JSON attribute", tPath.m_sName.cstr(), sColumn.cstr() );
+			return false;
+		}
+
+		tCol.m_eAttrType = tPath.m_eAttrType;
+		tSchema.AddAttr ( tCol, bDynamic );
+	}
+
+	if ( !dPaths.GetLength() || tSchema.GetAttr ( g_sJsonHotMask ) )
+		return true;
+
+	// one bit per hot path, set when the row holds the exact JSON value (not a default, nor a lossy conversion)
+	int iHot = 0;
+	for ( int i=0; i<tSchema.GetAttrsCount(); i++ )
+		if ( sphIsJsonHotAttr ( tSchema.GetAttr(i) ) )
+			iHot++;
+
+	if ( iHot>JSON_HOT_MAX )
+	{
+		sError.SetSprintf ( "too many hot JSON paths (%d declared, max %d)", iHot, JSON_HOT_MAX );
+		return false;
+	}
+
+	CSphColumnInfo tMask ( g_sJsonHotMask, SPH_ATTR_BIGINT );
+	tSchema.AddAttr ( tMask, bDynamic );
+	return true;
+}
+
+
+void JsonHotAttrs_c::Setup ( const ISphSchema & tSchema )
+{
+	m_dAttrs.Reset();
+	m_dByAttr.Resize ( tSchema.GetAttrsCount() );
+	m_dByAttr.Fill ( -1 );
+
+	int iMask = sphJsonHotMaskIndex ( tSchema );
+	m_tMaskLocator = iMask>=0 ? tSchema.GetAttr(iMask).m_tLocator : CSphAttrLocator();
+
+	int iBit = 0;
+	for ( int i=0; i<tSchema.GetAttrsCount(); i++ )
+	{
+		const CSphColumnInfo & tCol = tSchema.GetAttr(i);
+		if ( !sphIsJsonHotAttr ( tCol ) || i==iMask )
+			continue;
+
+		// same numbering as sphJsonHotMaskBit()
+		int iAttrBit = iBit++;
+
+		// "@json.column.key1.key2"
+		StrVec_t dParts;
+		sphSplit ( dParts, tCol.m_sName.cstr() + sizeof(g_sJsonHotPrefix)-1, "." );
+		if ( dParts.GetLength()<2 )
+			continue;
+
+		int iJson = tSchema.GetAttrIndex ( dParts[0].cstr() );
+		if ( iJson<0 || tSchema.GetAttr(iJson).m_eAttrType!=SPH_ATTR_JSON )
+			continue;
+
+		m_dByAttr[i] = m_dAttrs.GetLength();
+		Attr_t & tAttr = m_dAttrs.Add();
+		tAttr.m_iAttr = i;
+		tAttr.m_iJson = iJson;
+		tAttr.m_eType = tCol.m_eAttrType;
+		tAttr.m_tLocator = tCol.m_tLocator;
+		tAttr.m_uBit = U64C(1) << iAttrBit;
+		for ( int j=1; j<dParts.GetLength(); j++ )
+			tAttr.m_dKeys.Add ( JsonKey_t ( dParts[j].cstr(), dParts[j].Length() ) );
+	}
+}
+
+
+bool JsonHotAttrs_c::HasJson ( int iJsonAttr ) const
+{
+	for ( const auto & tAttr : m_dAttrs )
+		if ( tAttr.m_iJson==iJsonAttr )
+			return true;
+	return false;
+}
+
+
+void JsonHotAttrs_c::Extract ( int iJsonAttr, const BYTE * pData )
+{
+	for ( auto & tAttr : m_dAttrs )
+	{
+		if ( tAttr.m_iJson!=iJsonAttr )
+			continue;
+
+		tAttr.m_uValue = 0;
+		tAttr.m_bExact = false;
+		tAttr.m_pStr = nullptr;
+		tAttr.m_iStrLen = 0;
+		if ( !pData )
+			continue;
+
+		// walk down the keys; missing keys and type mismatches leave the defaults
+		const BYTE * p = pData;
+		ESphJsonType eJson = JSON_ROOT;
+		for ( const auto & tKey : tAttr.m_dKeys )
+		{
+			if ( eJson!=JSON_ROOT && eJson!=JSON_OBJECT )
+			{
+				eJson = JSON_EOF;
+				break;
+			}
+			eJson = sphJsonFindByKey ( eJson, &p, tKey.m_sKey.cstr(), tKey.m_iLen, tKey.m_uMask );
+			if ( eJson==JSON_EOF )
+				break;
+		}
+
+		if ( tAttr.m_eType==SPH_ATTR_STRING )
+		{
+			if ( eJson==JSON_STRING )
+			{
+				tAttr.m_iStrLen = sphJsonUnpackInt ( &p );
+				tAttr.m_pStr = p;
+				tAttr.m_bExact = true;
+			}
+			continue;
+		}
+
+		// only the values the declared type holds as is are exact; everything else
+		// (missing keys, booleans, strings, out of range or fractional values) is left to the JSON path
+		int64_t iVal = 0;
+		double fVal = 0.0;
+		bool bFloat = false;
+		switch ( eJson )
+		{
+		case JSON_INT32:	iVal = sphJsonLoadInt ( &p ); break;
+		case JSON_INT64:	iVal = sphJsonLoadBigint ( &p ); break;
+		case JSON_DOUBLE:	fVal = sphQW2D ( sphJsonLoadBigint ( &p ) ); bFloat = true; break;
+		default:			continue;
+		}
+
+		if ( tAttr.m_eType==SPH_ATTR_FLOAT )
+		{
+			if ( bFloat && fabs ( fVal )>FLT_MAX )
+				continue;
+			float fHot = bFloat ? (float)fVal : (float)iVal;
+			tAttr.m_uValue = sphF2DW ( fHot );
+			tAttr.m_bExact = bFloat ? ( (double)fHot==fVal ) : ( iVal>=-FLOAT_EXACT_INT && iVal<=FLOAT_EXACT_INT );
+		} else if ( !bFloat )
+		{
+			tAttr.m_uValue = ( tAttr.m_eType==SPH_ATTR_BIGINT ) ? iVal : (DWORD)iVal;
+			tAttr.m_bExact = ( tAttr.m_eType==SPH_ATTR_BIGINT ) || ( iVal>=0 && iVal<=UINT_MAX );
+		}
+	}
+}
+
+
+void JsonHotAttrs_c::StoreNumeric ( int iJsonAttr, CSphRowitem * pRow ) const
+{
+	uint64_t uMask = m_tMaskLocator.m_iBitCount>0 ? sphGetRowAttr ( pRow, m_tMaskLocator ) : 0;
+	for ( const auto & tAttr : m_dAttrs )
+	{
+		if ( tAttr.m_iJson!=iJsonAttr )
+			continue;
+
+		if ( tAttr.m_bExact )
+			uMask |= tAttr.m_uBit;
+		else
+			uMask &= ~tAttr.m_uBit;
+
+		if ( tAttr.m_eType!=SPH_ATTR_STRING )
+			sphSetRowAttr ( pRow, tAttr.m_tLocator, tAttr.m_uValue );
+	}
+
+	if ( m_tMaskLocator.m_iBitCount>0 )
+		sphSetRowAttr ( pRow, m_tMaskLocator, uMask );
+}
+
+
+void JsonHotAttrs_c::RefreshRow ( int iJsonAttr, const CSphAttrLocator & tJsonLoc, const BYTE * pStrings, CSphRowitem * pRow )
+{
+	const BYTE * pData = nullptr;
+	auto uOff = (DWORD)sphGetRowAttr ( pRow, tJsonLoc );
+	if ( uOff && pStrings && !sphUnpackStr ( pStrings+uOff, &pData ) )
+		pData = nullptr;
+
+	Extract ( iJsonAttr, pData );
+
+	// hot strings can not be rewritten in place, so those rows go back to the JSON path
+	for ( auto & tAttr : m_dAttrs )
+		if ( tAttr.m_iJson==iJsonAttr && tAttr.m_eType==SPH_ATTR_STRING )
+			tAttr.m_bExact = false;
+
+	StoreNumeric ( iJsonAttr, pRow );
+}
+
+
 bool CSphSource_Document::AddAutoAttrs ( CSphString & sError )
 {
 	// auto-computed length attributes
-	if ( m_bIndexFieldLens )
-		return AddFieldLens ( m_tSchema, true, sError );
-	return true;
+	if ( m_bIndexFieldLens && !AddFieldLens ( m_tSchema, true, sError ) )
+		return false;
+
+	// hot JSON paths
+	return AddJsonHotAttrs ( m_tSchema, m_dJsonHotAttrs, true, sError );
 }
 
 
@@ -30378,6 +31684,13 @@ void CWordlist::Reset ()
 	m_pWords.Reset ( 0 );
 	SafeDeleteArray ( m_pInfixBlocksWords );
 	m_tMapedCpReader.Reset();
+	m_dDir.Reset();
+	m_dDirWords.Reset();
+	m_dDirCheckpoints.Reset ( 0 );
+
+	// dictionary goes away; whatever gets loaded next needs another uid
+	g_tExpansionCache.Drop ( m_iExpansionUid );
+	m_iExpansionUid = ++g_iExpansionOwners;
 }
 
 
@@ -30562,6 +31875,99 @@ bool CWordlist::Preread ( const char * sName, DWORD uVersion, bool bWordDict, CS
 	if ( !m_tBuf.Setup ( sName, sError, false ) )
 		return false;
 
+	if ( g_bKeywordDirectory )
+		BuildDirectory();
+
+	return true;
+}
+
+
+void CWordlist::BuildDirectory ()
+{
+	if ( !m_dCheckpoints.GetLength() )
+		return;
+
+	m_dDirCheckpoints.Reset ( m_dCheckpoints.GetLength()+1 );
+	ARRAY_FOREACH ( iCP, m_dCheckpoints )
+	{
+		m_dDirCheckpoints[iCP] = m_dDir.GetLength();
+
+		KeywordsBlockReader_c tReader ( AcquireDict ( &m_dCheckpoints[iCP] ), m_bHaveSkips );
+		while ( tReader.UnpackWord() )
+		{
+			// arena offsets are 32 bit; huge dictionaries just go without directory
+			int iLen = tReader.GetWordLen();
+			if ( m_dDirWords.GetLength()+iLen+2>=INT_MAX )
+			{
+				sphWarning ( "keyword directory overflow (keywords=%d); directory disabled", m_dDir.GetLength() );
+				m_dDir.Reset();
+				m_dDirWords.Reset();
+				m_dDirCheckpoints.Reset ( 0 );
+				return;
+			}
+
+			KeywordDirEntry_t & tEntry = m_dDir.Add();
+			tEntry.m_uWordOff = m_dDirWords.GetLength();
+			tEntry.m_iDocs = tReader.m_iDocs;
+			tEntry.m_iHits = tReader.m_iHits;
+			tEntry.m_iDoclistHint = tReader.m_iDoclistHint;
+			tEntry.m_iDoclistOffset = tReader.m_iDoclistOffset;
+			tEntry.m_iSkiplistOffset = tReader.m_iSkiplistOffset;
+
+			BYTE * pWord = m_dDirWords.AddN ( iLen+2 );
+			pWord[0] = (BYTE)iLen;
+			memcpy ( pWord+1, tReader.GetWord(), iLen );
+			pWord[iLen+1] = '\0';
+		}
+	}
+	m_dDirCheckpoints.Last() = m_dDir.GetLength();
+
+	m_dDir.Shrink();
+	m_dDirWords.Shrink();
+}
+
+
+/// returns first directory entry that is not less than given word (or entries count)
+int CWordlist::FindDirEntry ( const char * sWord, int iWordLen ) const
+{
+	int iL = 0;
+	int iR = m_dDir.GetLength();
+	while ( iL<iR )
+	{
+		int iM = iL + ( iR-iL )/2;
+		const BYTE * pKeyword = GetDirKeyword ( m_dDir[iM] );
+		if ( sphDictCmpStrictly ( (const char *)pKeyword+1, pKeyword[0], sWord, iWordLen )<0 )
+			iL = iM+1;
+		else
+			iR = iM;
+	}
+	return iL;
+}
+
+
+void CWordlist::GetDirEntry ( const KeywordDirEntry_t & tEntry, CSphDictEntry & tWord ) const
+{
+	tWord.m_sKeyword = GetDirKeyword ( tEntry ) + 1;
+	tWord.m_iDocs = tEntry.m_iDocs;
+	tWord.m_iHits = tEntry.m_iHits;
+	tWord.m_iDoclistHint = tEntry.m_iDoclistHint;
+	tWord.m_iDoclistOffset = tEntry.m_iDoclistOffset;
+	tWord.m_iSkiplistOffset = tEntry.m_iSkiplistOffset;
+}
+
+
+bool CWordlist::GetDirWord ( const char * sWord, int iWordLen, CSphDictEntry & tWord ) const
+{
+	assert ( HasDirectory() );
+	int iEntry = FindDirEntry ( sWord, iWordLen );
+	if ( iEntry>=m_dDir.GetLength() )
+		return false;
+
+	const BYTE * pKeyword = GetDirKeyword ( m_dDir[iEntry] );
+	if ( sphDictCmpStrictly ( (const char *)pKeyword+1, pKeyword[0], sWord, iWordLen )!=0 )
+		return false;
+
+	GetDirEntry ( m_dDir[iEntry], tWord );
 	return true;
 }
 
@@ -30773,22 +32179,6 @@ const char * ISphWordlist::Args_t::GetWordExpanded ( int iIndex ) const
 }
 
 
-struct DiskExpandedEntry_t
-{
-	int		m_iNameOff;
-	int		m_iDocs;
-	int		m_iHits;
-};
-
-struct DiskExpandedPayload_t
-{
-	int			m_iDocs;
-	int			m_iHits;
-	uint64_t	m_uDoclistOff;
-	int			m_iDoclistHint;
-};
-
-
 struct DictEntryDiskPayload_t
 {
 	explicit DictEntryDiskPayload_t ( bool bPayload, ESphHitless eHitless )
@@ -30901,6 +32291,154 @@ struct DictEntryDiskPayload_t
 };
 
 
+ExpansionCache_c::~ExpansionCache_c ()
+{
+	EvictTo ( 0 );
+}
+
+
+void ExpansionCache_c::SetMaxBytes ( int64_t iMaxBytes )
+{
+	ScopedMutex_t tLock ( m_tLock );
+	m_tCounters.SetMaxBytes ( iMaxBytes );
+	EvictTo ( m_tCounters.GetMaxBytes() );
+}
+
+
+bool ExpansionCache_c::Get ( const CSphString & sKey, DictEntryDiskPayload_t & tDict )
+{
+	ScopedMutex_t tLock ( m_tLock );
+	ExpansionCacheEntry_t ** ppEntry = m_hEntries ( sKey );
+	if ( !ppEntry )
+	{
+		m_tCounters.Miss();
+		return false;
+	}
+
+	ExpansionCacheEntry_t * pEntry = *ppEntry;
+	Unlink ( pEntry );
+	Link ( pEntry );
+	m_tCounters.Hit();
+
+	tDict.m_dWordExpand = pEntry->m_dWordExpand;
+	tDict.m_dWordPayload = pEntry->m_dWordPayload;
+	tDict.m_dWordBuf = pEntry->m_dWordBuf;
+	return true;
+}
+
+
+void ExpansionCache_c::Add ( int64_t iOwner, const CSphString & sKey, const DictEntryDiskPayload_t & tDict )
+{
+	auto * pEntry = new ExpansionCacheEntry_t;
+	pEntry->m_dWordExpand = tDict.m_dWordExpand;
+	pEntry->m_dWordPayload = tDict.m_dWordPayload;
+	pEntry->m_dWordBuf = tDict.m_dWordBuf;
+	pEntry->m_sKey = sKey;
+	pEntry->m_iOwner = iOwner;
+
+	ScopedMutex_t tLock ( m_tLock );
+
+	// do not let a single huge expansion wipe out the whole cache
+	int64_t iBytes = pEntry->GetBytes();
+	if ( iBytes>m_tCounters.GetMaxBytes()/16 || m_hEntries ( sKey ) ) // or, another query got there first
+	{
+		SafeDelete ( pEntry );
+		return;
+	}
+
+	EvictTo ( m_tCounters.GetMaxBytes()-iBytes );
+	m_hEntries.Add ( pEntry, sKey );
+	Link ( pEntry );
+	m_iBytes += iBytes;
+	m_tCounters.AddBytes ( iBytes );
+}
+
+
+void ExpansionCache_c::Drop ( int64_t iOwner )
+{
+	ScopedMutex_t tLock ( m_tLock );
+	ExpansionCacheEntry_t * pEntry = m_pHead;
+	while ( pEntry )
+	{
+		ExpansionCacheEntry_t * pNext = pEntry->m_pNext;
+		if ( pEntry->m_iOwner==iOwner )
+			Delete ( pEntry );
+		pEntry = pNext;
+	}
+}
+
+
+void ExpansionCache_c::Link ( ExpansionCacheEntry_t * pEntry )
+{
+	pEntry->m_pPrev = nullptr;
+	pEntry->m_pNext = m_pHead;
+	if ( m_pHead )
+		m_pHead->m_pPrev = pEntry;
+	m_pHead = pEntry;
+	if ( !m_pTail )
+		m_pTail = pEntry;
+}
+
+
+void ExpansionCache_c::Unlink ( ExpansionCacheEntry_t * pEntry )
+{
+	if ( pEntry->m_pPrev )
+		pEntry->m_pPrev->m_pNext = pEntry->m_pNext;
+	else
+		m_pHead = pEntry->m_pNext;
+
+	if ( pEntry->m_pNext )
+		pEntry->m_pNext->m_pPrev = pEntry->m_pPrev;
+	else
+		m_pTail = pEntry->m_pPrev;
+}
+
+
+void ExpansionCache_c::Delete ( ExpansionCacheEntry_t * pEntry )
+{
+	int64_t iBytes = pEntry->GetBytes();
+	m_iBytes -= iBytes;
+	m_tCounters.SubBytes ( iBytes );
+	Unlink ( pEntry );
+	m_hEntries.Delete ( pEntry->m_sKey );
+	SafeDelete ( pEntry );
+}
+
+
+void ExpansionCache_c::EvictTo ( int64_t iMaxBytes )
+{
+	while ( m_pTail && m_iBytes>iMaxBytes )
+		Delete ( m_pTail );
+}
+
+
+bool CWordlist::GetCachedExpansion ( char cType, const char * sWildcard, Args_t & tArgs, CSphString & sKey ) const
+{
+	if ( !g_tExpansionCache.IsEnabled() )
+		return false;
+
+	// everything that affects the collected keywords goes into the key; expansion limit is applied later, on Convert
+	sKey.SetSprintf ( INT64_FMT "%c%d%d%d%s", m_iExpansionUid, cType, tArgs.m_bPayload ? 1 : 0, (int)tArgs.m_eHitless, tArgs.m_bHasMorphology ? 1 : 0, sWildcard );
+
+	DictEntryDiskPayload_t tDict2Payload ( tArgs.m_bPayload, tArgs.m_eHitless );
+	if ( !g_tExpansionCache.Get ( sKey, tDict2Payload ) )
+		return false;
+
+	tDict2Payload.Convert ( tArgs );
+	return true;
+}
+
+
+void CWordlist::FinishExpansion ( const CSphString & sKey, DictEntryDiskPayload_t & tDict2Payload, Args_t & tArgs ) const
+{
+	// interrupted scan might be incomplete, never cache it
+	if ( !sKey.IsEmpty() && !sphInterrupted() )
+		g_tExpansionCache.Add ( m_iExpansionUid, sKey, tDict2Payload );
+
+	tDict2Payload.Convert ( tArgs );
+}
+
+
 void CWordlist::GetPrefixedWords ( const char * sSubstring, int iSubLen, const char * sWildcard, Args_t & tArgs ) const
 {
 	assert ( sSubstring && *sSubstring && iSubLen>0 );
@@ -30909,13 +32447,46 @@ void CWordlist::GetPrefixedWords ( const char * sSubstring, int iSubLen, const c
 	if ( !m_dCheckpoints.GetLength() )
 		return;
 
+	CSphString sCacheKey;
+	if ( GetCachedExpansion ( 'p', sWildcard, tArgs, sCacheKey ) )
+		return;
+
 	DictEntryDiskPayload_t tDict2Payload ( tArgs.m_bPayload, tArgs.m_eHitless );
 
 	int dWildcard [ SPH_MAX_WORD_LEN + 1 ];
 	int * pWildcard = ( sphIsUTF8 ( sWildcard ) && sphUTF8ToWideChar ( sWildcard, dWildcard, SPH_MAX_WORD_LEN ) ) ? dWildcard : NULL;
 
-	const CSphWordlistCheckpoint * pCheckpoint = FindCheckpoint ( sSubstring, iSubLen, 0, true );
 	const int iSkipMagic = ( BYTE(*sSubstring)<0x20 ); // whether to skip heading magic chars in the prefix, like NONSTEMMED maker
+
+	if ( HasDirectory() )
+	{
+		// matching keywords make a contiguous run right from the prefix lower bound
+		// plain 'prefix*' wildcard matches every keyword of that run, so there's nothing left to check
+		int iWildLen = strlen ( sWildcard );
+		bool bPlainPrefix = ( iWildLen==iSubLen-iSkipMagic+1 && sWildcard[iWildLen-1]=='*' );
+
+		CSphDictEntry tWord;
+		for ( int i=FindDirEntry ( sSubstring, iSubLen ); i<m_dDir.GetLength(); ++i )
+		{
+			const BYTE * pKeyword = GetDirKeyword ( m_dDir[i] );
+			if ( sphDictCmp ( sSubstring, iSubLen, (const char *)pKeyword+1, pKeyword[0] )!=0 )
+				break;
+
+			if ( sphInterrupted() )
+				break;
+
+			if ( bPlainPrefix || sphWildcardMatch ( (const char *)pKeyword + 1 + iSkipMagic, sWildcard, pWildcard ) )
+			{
+				GetDirEntry ( m_dDir[i], tWord );
+				tDict2Payload.Add ( tWord, pKeyword[0] );
+			}
+		}
+
+		FinishExpansion ( sCacheKey, tDict2Payload, tArgs );
+		return;
+	}
+
+	const CSphWordlistCheckpoint * pCheckpoint = FindCheckpoint ( sSubstring, iSubLen, 0, true );
 	while ( pCheckpoint )
 	{
 		// decode wordlist chunk
@@ -30947,7 +32518,7 @@ void CWordlist::GetPrefixedWords ( const char * sSubstring, int iSubLen, const c
 			break;
 	}
 
-	tDict2Payload.Convert ( tArgs );
+	FinishExpansion ( sCacheKey, tDict2Payload, tArgs );
 }
 
 bool operator < ( const InfixBlock_t & a, const char * b )
@@ -31066,6 +32637,10 @@ void CWordlist::GetInfixedWords ( const char * sSubstring, int iSubLen, const ch
 
 	assert ( !m_tMapedCpReader.Ptr() );
 
+	CSphString sCacheKey;
+	if ( GetCachedExpansion ( 'i', sWildcard, tArgs, sCacheKey ) )
+		return;
+
 	// extract key1, upto 6 chars from infix start
 	int iBytes1 = sphGetInfixLength ( sSubstring, iSubLen, m_iInfixCodepointBytes );
 
@@ -31073,7 +32648,12 @@ void CWordlist::GetInfixedWords ( const char * sSubstring, int iSubLen, const ch
 	// OPTIMIZE? maybe lookup key2 and reduce checkpoint set size, if possible?
 	CSphVector<DWORD> dPoints;
 	if ( !sphLookupInfixCheckpoints ( sSubstring, iBytes1, m_tBuf.GetWritePtr(), m_dInfixBlocks, m_iInfixCodepointBytes, dPoints ) )
+	{
+		// remember misses too; empty expansion is as good as any other
+		DictEntryDiskPayload_t tEmpty ( tArgs.m_bPayload, tArgs.m_eHitless );
+		FinishExpansion ( sCacheKey, tEmpty, tArgs );
 		return;
+	}
 
 	DictEntryDiskPayload_t tDict2Payload ( tArgs.m_bPayload, tArgs.m_eHitless );
 	const int iSkipMagic = ( tArgs.m_bHasMorphology ? 1 : 0 ); // whether to skip heading magic chars in the prefix, like NONSTEMMED maker
@@ -31082,6 +32662,34 @@ void CWordlist::GetInfixedWords ( const char * sSubstring, int iSubLen, const ch
 	int * pWildcard = ( sphIsUTF8 ( sWildcard ) && sphUTF8ToWideChar ( sWildcard, dWildcard, SPH_MAX_WORD_LEN ) ) ? dWildcard : NULL;
 
 	// walk those checkpoints, check all their words
+	if ( HasDirectory() )
+	{
+		CSphDictEntry tWord;
+		ARRAY_FOREACH ( i, dPoints )
+		{
+			for ( int iEntry=m_dDirCheckpoints[dPoints[i]-1]; iEntry<m_dDirCheckpoints[dPoints[i]]; ++iEntry )
+			{
+				const BYTE * pKeyword = GetDirKeyword ( m_dDir[iEntry] );
+
+				// stemmed terms should not match suffixes
+				if ( tArgs.m_bHasMorphology && pKeyword[1]!=MAGIC_WORD_HEAD_NONSTEMMED )
+					continue;
+
+				if ( sphWildcardMatch ( (const char *)pKeyword + 1 + iSkipMagic, sWildcard, pWildcard ) )
+				{
+					GetDirEntry ( m_dDir[iEntry], tWord );
+					tDict2Payload.Add ( tWord, pKeyword[0] );
+				}
+			}
+
+			if ( sphInterrupted () )
+				break;
+		}
+
+		FinishExpansion ( sCacheKey, tDict2Payload, tArgs );
+		return;
+	}
+
 	ARRAY_FOREACH ( i, dPoints )
 	{
 		// OPTIMIZE? add a quicker path than a generic wildcard for "*infix*" case?
@@ -31103,7 +32711,7 @@ void CWordlist::GetInfixedWords ( const char * sSubstring, int iSubLen, const ch
 			break;
 	}
 
-	tDict2Payload.Convert ( tArgs );
+	FinishExpansion ( sCacheKey, tDict2Payload, tArgs );
 }
 
 static int BuildUtf8Offsets ( const char * sWord, int iLen, int * pOff, int DEBUGARG ( iBufSize ) )
@@ -260,6 +260,17 @@ bool			sphInitIOStats ();
 /// clean up IO statistics collector
 void			sphDoneIOStats ();
 
+class QueryControl_c;
+
+/// initialize per-query control, see QueryControl_c
+bool			sphInitQueryControl ();
+
+/// current thread query control, if any
+QueryControl_c *	sphGetQueryControl ();
+
+/// cancellation point for the search loops; true means the current thread query has to stop now
+bool			sphQueryStopped ();
+
 
 class CSphIOStats
 {
@@ -285,6 +296,86 @@ private:
 };
 
 
+/// why the query got stopped
+enum QueryStop_e
+{
+	QUERY_RUNNING = 0,
+	QUERY_KILLED,			///< by KILL statement
+	QUERY_CLIENT_GONE,		///< client disconnected
+	QUERY_MEMORY_LIMIT,		///< query memory limit exceeded
+	QUERY_CLIENT_MEMORY,	///< client memory limit exceeded
+	QUERY_CPU_LIMIT			///< query cpu time limit exceeded
+};
+
+/// per-query cpu and memory budget, and cooperative cancellation
+/// every thread that works on the query binds it with QueryControlScope_c, and the search loops
+/// poll sphQueryStopped() at the same spots where they check max_query_time
+class QueryControl_c : public ISphNoncopyable
+{
+public:
+	int64_t				m_iMaxMemory = 0;		///< max tracked memory, in bytes; 0 means no limit
+	int64_t				m_iMaxCpuTime = 0;		///< max cpu time over all the query threads, in usec; 0 means no limit
+	QueryControl_c *	m_pShared = nullptr;	///< optional shared (eg. per-client) memory budget this query also counts against
+
+	virtual				~QueryControl_c () {}
+
+	void				Stop ( QueryStop_e eReason );	///< first reason wins
+	bool				IsStopped () const { return m_iStopped!=QUERY_RUNNING; }
+	QueryStop_e			GetStopReason () const { return (QueryStop_e)(int)m_iStopped; }
+	const char *		GetStopMessage () const;
+
+	void				TrackMemory ( int64_t iBytes );	///< negative size releases memory
+	int64_t				GetMemory () const { return m_iMemory; }
+	int64_t				GetPeakMemory () const { return m_iPeakMemory; }
+	int64_t				GetCpuTime () const { return m_iCpuTime; }
+
+	/// polled every now and then; stops the queries that nobody waits for anymore
+	virtual bool		IsClientGone () { return false; }
+
+protected:
+	friend class QueryControlScope_c;
+
+	CSphAtomic			m_iStopped { QUERY_RUNNING };
+	CSphAtomicL			m_iMemory;
+	CSphAtomicL			m_iPeakMemory;
+	CSphAtomicL			m_iCpuTime;		///< of the threads that already left the query
+};
+
+
+/// binds query control to the current thread for the scope lifetime
+class QueryControlScope_c : public ISphNoncopyable
+{
+public:
+	explicit			QueryControlScope_c ( QueryControl_c * pControl );
+						~QueryControlScope_c ();
+
+	bool				Poll ();
+	QueryControl_c *	GetControl () const { return m_pControl; }
+
+private:
+	QueryControl_c *		m_pControl;
+	QueryControlScope_c *	m_pPrev = nullptr;
+	int64_t					m_tmCpuStart = 0;
+	int64_t					m_tmNextCheck = 0;
+	DWORD					m_uPolls = 0;
+};
+
+
+/// query memory tracked from allocation up to destruction, eg. by a member of the owning object
+class QueryMemTracker_c : public ISphNoncopyable
+{
+public:
+						QueryMemTracker_c ();
+						~QueryMemTracker_c () { Set ( 0 ); }
+
+	void				Set ( int64_t iBytes );		///< update tracked size to the current one
+
+private:
+	QueryControl_c *	m_pControl;
+	int64_t				m_iBytes = 0;
+};
+
+
 //////////////////////////////////////////////////////////////////////////
 
 #if UNALIGNED_RAM_ACCESS
@@ -1826,6 +1917,7 @@ struct CSphSourceSettings
 
 	StrVec_t m_dPrefixFields;	///< list of prefix fields
 	StrVec_t m_dInfixFields;	///< list of infix fields
+	CSphVector<CSphColumnInfo> m_dJsonHotAttrs;	///< hot JSON paths to materialize as hidden attributes (name is the path)
 
 	ESphWordpart			GetWordpart ( const char * sField, bool bWordDict );
 };
@@ -2743,6 +2835,8 @@ public:
 
 	DWORD			m_uMaxQueryMsec;	///< max local index search time, in milliseconds (default is 0; means no limit)
 	int				m_iMaxPredictedMsec; ///< max predicted (!) search time limit, in milliseconds (0 means no limit)
+	int64_t			m_iMaxQueryMemory;	///< max tracked memory of the query, in bytes (0 means daemon default)
+	int				m_iMaxQueryCpuMsec;	///< max cpu time of the query, in milliseconds (0 means daemon default)
 	CSphString		m_sComment;			///< comment to pass verbatim in the log file
 
 	CSphVector<CSphAttrOverride>	m_dOverrides;	///< per-query attribute value overrides
@@ -2803,6 +2897,7 @@ struct CSphQueryStats
 	DWORD		m_iFetchedDocs;		///< processed documents
 	DWORD		m_iFetchedHits;		///< processed hits (aka positions)
 	DWORD		m_iSkips;			///< number of Skip() calls
+	int64_t		m_iFiltered;		///< matches rejected by filters
 
 				CSphQueryStats();
 
@@ -3415,6 +3510,7 @@ public:
 
 public:
 	int64_t						m_iTID = 0;				///< last committed transaction id
+	int64_t						m_iChanges = 0;			///< changes count since load; unlike TID, also counted with binlog disabled
 
 	int							m_iExpandKeywords = KWE_DISABLED;	///< enable automatic query-time keyword expansion (to "( word | =word | *word* )")
 	int							m_iExpansionLimit = 0;
@@ -3525,6 +3621,67 @@ int					sphFlattenQueue ( ISphMatchSorter * pQueue, CSphQueryResult * pResult, i
 /// setup per-keyword read buffer sizes
 void				sphSetReadBuffers ( int iReadBuffer, int iReadUnhinted );
 
+/// whether to keep decoded dict=keywords wordlists of disk indexes in RAM for quicker lookups and expansions
+/// affects indexes loaded after the call
+void				sphSetKeywordDirectory ( bool bEnable );
+
+/// size limit, usage and hit counters of a cache (for SHOW STATUS)
+struct CacheStatus_t
+{
+	int64_t			m_iMaxBytes = 0;
+	int64_t			m_iUsedBytes = 0;
+	int64_t			m_iHits = 0;
+	int64_t			m_iMisses = 0;
+};
+
+/// thread-safe size limit and counters behind CacheStatus_t, shared by the keyword expansion, doclist, morphology and term stats caches
+class CacheCounters_c : public ISphNoncopyable
+{
+public:
+	void			SetMaxBytes ( int64_t iMaxBytes )	{ m_iMaxBytes = Max ( iMaxBytes, 0 ); }
+	int64_t			GetMaxBytes () const				{ return m_iMaxBytes; }
+	bool			IsEnabled () const					{ return m_iMaxBytes>0; }
+
+	void			Hit ()								{ m_iHits.Inc(); }
+	void			Miss ()								{ m_iMisses.Inc(); }
+	void			AddBytes ( int64_t iBytes )			{ m_iUsedBytes.Add ( iBytes ); }
+	void			SubBytes ( int64_t iBytes )			{ m_iUsedBytes.Sub ( iBytes ); }
+
+	CacheStatus_t	GetStatus () const
+	{
+		CacheStatus_t tStatus;
+		tStatus.m_iMaxBytes = m_iMaxBytes;
+		tStatus.m_iUsedBytes = m_iUsedBytes.GetValue();
+		tStatus.m_iHits = m_iHits.GetValue();
+		tStatus.m_iMisses = m_iMisses.GetValue();
+		return tStatus;
+	}
+
+private:
+	int64_t			m_iMaxBytes = 0;	///< 0 means disabled
+	CSphAtomicL		m_iUsedBytes;
+	CSphAtomicL		m_iHits;
+	CSphAtomicL		m_iMisses;
+};
+
+/// set wildcard expansion cache size, shared by all indexes (0 disables the cache)
+void				sphSetExpansionCacheSize ( int64_t iMaxBytes );
+
+/// get wildcard expansion cache stats
+CacheStatus_t		sphGetExpansionCacheStatus ();
+
+/// set per-index doclist cache size (0 disables the cache)
+void				sphSetDoclistCacheSize ( int64_t iMaxBytes );
+
+/// get hot terms doclist cache stats, summed over all indexes (max bytes is the per-index limit)
+CacheStatus_t		sphGetDoclistCacheStatus ();
+
+/// set per-thread stemming results cache size (0 disables the cache)
+void				sphSetMorphologyCacheSize ( int64_t iMaxBytes );
+
+/// get stemming results cache stats, summed over all threads
+CacheStatus_t		sphGetMorphologyCacheStatus ();
+
 /// check query for expressions
 bool				sphHasExpressions ( const CSphQuery & tQuery, const CSphSchema & tSchema );
 
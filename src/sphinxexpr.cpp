@@ -1313,6 +1313,86 @@ protected:
 };
 
 
+/// json.key numeric conversion backed by a hot JSON path attribute
+/// rows that hold the exact JSON value read the typed column, the rest convert the JSON field as usual
+struct Expr_JsonHotConv_c : public Expr_JsonFieldConv_c
+{
+public:
+	Expr_JsonHotConv_c ( ISphExpr * pArg, const CSphColumnInfo & tHot, int iHot, const CSphAttrLocator & tMask, int iMask, int iBit )
+		: Expr_JsonFieldConv_c ( pArg )
+		, m_tHot ( tHot.m_tLocator )
+		, m_iHot ( iHot )
+		, m_bFloat ( tHot.m_eAttrType==SPH_ATTR_FLOAT )
+		, m_tMask ( tMask )
+		, m_iMask ( iMask )
+		, m_uBit ( U64C(1)<<iBit )
+	{}
+
+	float Eval ( const CSphMatch & tMatch ) const final
+	{
+		if ( !IsExact ( tMatch ) )
+			return DoEval<float> ( tMatch );
+		return m_bFloat ? tMatch.GetAttrFloat ( m_tHot ) : (float)GetHot ( tMatch );
+	}
+
+	int IntEval ( const CSphMatch & tMatch ) const final
+	{
+		if ( !IsExact ( tMatch ) )
+			return DoEval<int> ( tMatch );
+		return m_bFloat ? (int)tMatch.GetAttrFloat ( m_tHot ) : (int)GetHot ( tMatch );
+	}
+
+	int64_t Int64Eval ( const CSphMatch & tMatch ) const final
+	{
+		if ( !IsExact ( tMatch ) )
+			return DoEval<int64_t> ( tMatch );
+		return m_bFloat ? (int64_t)tMatch.GetAttrFloat ( m_tHot ) : GetHot ( tMatch );
+	}
+
+	uint64_t GetHash ( const ISphSchema & tSorterSchema, uint64_t uPrevHash, bool & bDisable ) final
+	{
+		EXPR_CLASS_NAME("Expr_JsonHotConv_c");
+		return CALC_PARENT_HASH();
+	}
+
+	void Command ( ESphExprCommand eCmd, void * pArg ) final
+	{
+		Expr_JsonFieldConv_c::Command ( eCmd, pArg );
+		if ( eCmd==SPH_EXPR_GET_DEPENDENT_COLS )
+		{
+			static_cast < CSphVector<int>* >(pArg)->Add ( m_iHot );
+			static_cast < CSphVector<int>* >(pArg)->Add ( m_iMask );
+		}
+	}
+
+	void FixupLocator ( const ISphSchema * pOldSchema, const ISphSchema * pNewSchema ) final
+	{
+		Expr_JsonFieldConv_c::FixupLocator ( pOldSchema, pNewSchema );
+		sphFixupLocator ( m_tHot, pOldSchema, pNewSchema );
+		sphFixupLocator ( m_tMask, pOldSchema, pNewSchema );
+	}
+
+private:
+	CSphAttrLocator		m_tHot;
+	int					m_iHot;
+	bool				m_bFloat;
+	CSphAttrLocator		m_tMask;
+	int					m_iMask;
+	SphAttr_t			m_uBit;
+
+	bool IsExact ( const CSphMatch & tMatch ) const
+	{
+		return ( tMatch.GetAttr ( m_tMask ) & m_uBit )!=0;
+	}
+
+	int64_t GetHot ( const CSphMatch & tMatch ) const
+	{
+		// uint columns are unsigned, bigint ones are signed
+		return m_tHot.m_iBitCount>32 ? (int64_t)tMatch.GetAttr ( m_tHot ) : (int64_t)(DWORD)tMatch.GetAttr ( m_tHot );
+	}
+};
+
+
 template <typename T>
 T JsonAggr ( ESphJsonType eJson, const BYTE * pVal, ESphAggrFunc eFunc, CSphString * pBuf )
 {
@@ -2776,6 +2856,7 @@ class ExprParser_t
 	friend int				yylex ( YYSTYPE * lvalp, ExprParser_t * pParser );
 	friend int				yyparse ( ExprParser_t * pParser );
 	friend void				yyerror ( ExprParser_t * pParser, const char * sMessage );
+	friend class			ExprCompiler_c;
 
 public:
 	ExprParser_t ( ISphExprHook * pHook, CSphQueryProfile * pProfiler, ESphCollation eCollation )
@@ -2799,6 +2880,8 @@ protected:
 
 protected:
 	ESphAttr				GetWidestRet ( int iLeft, int iRight );
+	bool					GetJsonSubkeyPath ( int iNode, CSphString & sPath ) const;
+	ISphExpr *				CreateJsonFieldConv ( int iNode, ISphExpr * pArg );
 
 	int						AddNodeInt ( int64_t iValue );
 	int						AddNodeFloat ( float fValue );
@@ -2841,6 +2924,7 @@ private:
 	int						m_iConstNow = 0;
 	CSphVector<StackNode_t>	m_dGatherStack;
 	CSphVector<UdfCall_t*>	m_dUdfCalls;
+	CSphVector<ISphExpr*>	m_dNodeExprs;	///< evaluators created for every node, to reuse in compiled code
 
 public:
 	bool					m_bHasZonespanlist = false;
@@ -2870,6 +2954,7 @@ private:
 	void					Dump ( int iNode );
 
 	ISphExpr *				CreateTree ( int iNode );
+	ISphExpr *				CreateTreeNode ( int iNode );
 	ISphExpr *				CreateIntervalNode ( int iArgsNode, CSphVector<ISphExpr *> & dArgs );
 	ISphExpr *				CreateInNode ( int iNode );
 	ISphExpr *				CreateLengthNode ( const ExprNode_t & tNode, ISphExpr * pLeft );
@@ -3657,6 +3742,13 @@ protected:
 	CSphQueryProfile *				m_pProfiler;
 	const BYTE *					m_pStrings = nullptr;
 
+	mutable SPH_UDF_BATCH_ARGS		m_tBatch {};
+	mutable CSphVector<int64_t>		m_dBlockVals;		///< block call argument columns
+	mutable CSphVector<int>			m_dBlockLens;		///< block call string length columns
+	mutable CSphVector<void *>		m_dBlockColumns;
+	mutable CSphVector<int *>		m_dBlockLenColumns;
+	mutable CSphVector<BYTE>		m_dBlockData;		///< block call copies of string, json and mva args
+
 public:
 	explicit Expr_Udf_c ( UdfCall_t * pCall, CSphQueryProfile * pProfiler )
 		: m_pCall ( pCall )
@@ -3734,6 +3826,156 @@ public:
 			SafeDeleteArray ( m_pCall->m_tArgs.arg_values[iAttr] );
 	}
 
+	/// fill per-argument columns for a block call
+	/// every column gets iCount 8-byte slots, which fits any element type
+	void FillBlockArgs ( CSphMatch * const * ppMatches, int iCount ) const
+	{
+		const SPH_UDF_ARGS & tArgs = m_pCall->m_tArgs;
+		int iArgs = m_dArgs.GetLength();
+
+		m_dBlockVals.Resize ( iArgs*iCount );
+		m_dBlockLens.Resize ( iArgs*iCount );
+		m_dBlockColumns.Resize ( iArgs );
+		m_dBlockLenColumns.Resize ( iArgs );
+		m_dBlockData.Resize ( 0 );
+
+		CSphVector<BYTE> dTmp;
+		ARRAY_FOREACH ( i, m_dArgs )
+		{
+			int64_t * pVals = m_dBlockVals.Begin() + i*iCount;
+			int * pLens = m_dBlockLens.Begin() + i*iCount;
+			m_dBlockColumns[i] = pVals;
+			m_dBlockLenColumns[i] = nullptr;
+
+			const ISphExpr * pArg = m_dArgs[i];
+			switch ( tArgs.arg_types[i] )
+			{
+			case SPH_UDF_TYPE_UINT32:
+				for ( int j=0; j<iCount; j++ )
+					( (DWORD*)pVals )[j] = pArg->IntEval ( *ppMatches[j] );
+				break;
+
+			case SPH_UDF_TYPE_INT64:
+				for ( int j=0; j<iCount; j++ )
+					pVals[j] = pArg->Int64Eval ( *ppMatches[j] );
+				break;
+
+			case SPH_UDF_TYPE_FLOAT:
+				for ( int j=0; j<iCount; j++ )
+					( (float*)pVals )[j] = pArg->Eval ( *ppMatches[j] );
+				break;
+
+			case SPH_UDF_TYPE_STRING:
+				// string evals might return a temporary or static buffer, so copy everything to the block arena
+				// and only store offsets for now; pointers are fixed up once the arena stops growing
+				m_dBlockLenColumns[i] = pLens;
+				for ( int j=0; j<iCount; j++ )
+				{
+					const BYTE * pStr = nullptr;
+					pLens[j] = pArg->StringEval ( *ppMatches[j], &pStr );
+					pVals[j] = m_dBlockData.GetLength();
+					if ( pLens[j]>0 )
+						m_dBlockData.Append ( pStr, pLens[j] );
+					if ( pArg->IsDataPtrAttr() )
+						SafeDeleteArray ( pStr );
+				}
+				break;
+
+			case SPH_UDF_TYPE_UINT32SET:
+			case SPH_UDF_TYPE_UINT64SET:
+				// same story for mva, the length (in dwords) goes first
+				for ( int j=0; j<iCount; j++ )
+				{
+					const DWORD * pMva = pArg->MvaEval ( *ppMatches[j] );
+					pVals[j] = pMva ? m_dBlockData.GetLength() : -1;
+					if ( pMva )
+						m_dBlockData.Append ( (const BYTE*)pMva, ( 1+pMva[0] )*sizeof(DWORD) );
+				}
+				break;
+
+			case SPH_UDF_TYPE_FACTORS:
+				for ( int j=0; j<iCount; j++ )
+					pVals[j] = (int64_t)(intptr_t) pArg->FactorEval ( *ppMatches[j] );
+				break;
+
+			case SPH_UDF_TYPE_JSON:
+				m_dBlockLenColumns[i] = pLens;
+				for ( int j=0; j<iCount; j++ )
+				{
+					int64_t iPacked = pArg->Int64Eval ( *ppMatches[j] );
+					auto eJson = ESphJsonType ( iPacked>>32 );
+					auto uOff = (DWORD)iPacked;
+					pLens[j] = 0;
+					pVals[j] = -1;
+					if ( !uOff || eJson==JSON_NULL )
+						continue;
+
+					dTmp.Resize ( 0 );
+					sphJsonFieldFormat ( dTmp, m_pStrings+uOff, eJson, false );
+					pLens[j] = dTmp.GetLength();
+					pVals[j] = m_dBlockData.GetLength();
+					m_dBlockData.Append ( dTmp );
+				}
+				break;
+
+			default:
+				assert ( 0 );
+				memset ( pVals, 0, sizeof(int64_t)*iCount );
+				break;
+			}
+		}
+
+		// now that arena is final, turn offsets into pointers
+		ARRAY_FOREACH ( i, m_dArgs )
+		{
+			sphinx_udf_argtype eType = tArgs.arg_types[i];
+			if ( eType!=SPH_UDF_TYPE_STRING && eType!=SPH_UDF_TYPE_JSON && eType!=SPH_UDF_TYPE_UINT32SET && eType!=SPH_UDF_TYPE_UINT64SET )
+				continue;
+
+			int64_t * pVals = m_dBlockVals.Begin() + i*iCount;
+			for ( int j=0; j<iCount; j++ )
+				pVals[j] = pVals[j]<0 ? 0 : (int64_t)(intptr_t)( m_dBlockData.Begin() + pVals[j] );
+		}
+
+		m_tBatch.row_count = iCount;
+		m_tBatch.arg_count = iArgs;
+		m_tBatch.arg_types = tArgs.arg_types;
+		m_tBatch.arg_names = tArgs.arg_names;
+		m_tBatch.fn_malloc = tArgs.fn_malloc;
+		m_tBatch.arg_columns = m_dBlockColumns.Begin();
+		m_tBatch.str_lengths = m_dBlockLenColumns.Begin();
+	}
+
+	void FreeBlockArgs ( int iCount ) const
+	{
+		ARRAY_FOREACH ( i, m_dArgs )
+		{
+			if ( m_pCall->m_tArgs.arg_types[i]!=SPH_UDF_TYPE_FACTORS )
+				continue;
+
+			int64_t * pVals = m_dBlockVals.Begin() + i*iCount;
+			for ( int j=0; j<iCount; j++ )
+			{
+				auto * pFactors = (BYTE *)(intptr_t) pVals[j];
+				SafeDeleteArray ( pFactors );
+			}
+		}
+	}
+
+	/// call batch worker over a block of matches; false means there is no batch worker
+	bool CallBlock ( CSphMatch * const * ppMatches, int iCount, void * pResults ) const
+	{
+		auto pFn = (UdfBatch_fn) m_pCall->m_pUdf->m_fnBatch;
+		if ( !pFn )
+			return false;
+
+		CSphScopedProfile tProf ( m_pProfiler, SPH_QSTATE_EVAL_UDF );
+		FillBlockArgs ( ppMatches, iCount );
+		pFn ( &m_pCall->m_tInit, &m_tBatch, pResults, &m_bError );
+		FreeBlockArgs ( iCount );
+		return true;
+	}
+
 	void AdoptArgs ( ISphExpr * pArglist )
 	{
 		MoveToArgList ( pArglist, m_dArgs );
@@ -3790,6 +4032,42 @@ public:
 
 	int IntEval ( const CSphMatch & tMatch ) const final { return (int) Int64Eval ( tMatch ); }
 	float Eval ( const CSphMatch & tMatch ) const final { return (float) Int64Eval ( tMatch ); }
+
+	bool Int64EvalBlock ( CSphMatch * const * ppMatches, int iCount, int64_t * pRes ) const final
+	{
+		if ( !m_pCall->m_pUdf->m_fnBatch )
+			return false;
+
+		if ( m_bError )
+		{
+			memset ( pRes, 0, sizeof(int64_t)*iCount );
+			return true;
+		}
+
+		STATIC_ASSERT ( sizeof(sphinx_int64_t)==sizeof(int64_t), UNEXPECTED_SPHINX_INT64_SIZE );
+		if ( !CallBlock ( ppMatches, iCount, pRes ) )
+			return false;
+
+		if ( m_bError )
+			memset ( pRes, 0, sizeof(int64_t)*iCount );
+		return true;
+	}
+
+	bool IntEvalBlock ( CSphMatch * const * ppMatches, int iCount, int * pRes ) const final
+	{
+		m_dResults.Resize ( iCount );
+		if ( !Int64EvalBlock ( ppMatches, iCount, m_dResults.Begin() ) )
+			return false;
+
+		for ( int i=0; i<iCount; i++ )
+			pRes[i] = (int) m_dResults[i];
+		return true;
+	}
+
+	bool CanEvalBlock () const final { return m_pCall->m_pUdf->m_fnBatch!=nullptr; }
+
+private:
+	mutable CSphVector<int64_t>	m_dResults;
 };
 
 
@@ -3817,6 +4095,31 @@ public:
 
 	int IntEval ( const CSphMatch & tMatch ) const final { return (int) Eval ( tMatch ); }
 	int64_t Int64Eval ( const CSphMatch & tMatch ) const final { return (int64_t) Eval ( tMatch ); }
+
+	bool EvalBlock ( CSphMatch * const * ppMatches, int iCount, float * pRes ) const final
+	{
+		if ( !m_pCall->m_pUdf->m_fnBatch )
+			return false;
+
+		if ( m_bError )
+		{
+			memset ( pRes, 0, sizeof(float)*iCount );
+			return true;
+		}
+
+		m_dResults.Resize ( iCount );
+		if ( !CallBlock ( ppMatches, iCount, m_dResults.Begin() ) )
+			return false;
+
+		for ( int i=0; i<iCount; i++ )
+			pRes[i] = m_bError ? 0.0f : (float) m_dResults[i];
+		return true;
+	}
+
+	bool CanEvalBlock () const final { return m_pCall->m_pUdf->m_fnBatch!=nullptr; }
+
+private:
+	mutable CSphVector<double>	m_dResults;
 };
 
 
@@ -4614,6 +4917,23 @@ public:
 
 /// fold nodes subtree into opcodes
 ISphExpr * ExprParser_t::CreateTree ( int iNode )
+{
+	ISphExpr * pRes = CreateTreeNode ( iNode );
+	if ( !pRes )
+		return nullptr;
+
+	// remember the evaluator, so that the compiler could call it for the nodes it does not know
+	while ( m_dNodeExprs.GetLength()<m_dNodes.GetLength() )
+		m_dNodeExprs.Add ( nullptr );
+
+	SafeRelease ( m_dNodeExprs[iNode] );
+	m_dNodeExprs[iNode] = pRes;
+	SafeAddRef ( pRes );
+	return pRes;
+}
+
+
+ISphExpr * ExprParser_t::CreateTreeNode ( int iNode )
 {
 	if ( iNode<0 || GetError() )
 		return nullptr;
@@ -4670,9 +4990,9 @@ ISphExpr * ExprParser_t::CreateTree ( int iNode )
 		|| iOp==TOK_LTE || iOp==TOK_GTE || iOp==TOK_EQ || iOp==TOK_NE || iOp==TOK_AND || iOp==TOK_OR || iOp==TOK_NOT )
 	{
 		if ( pLeft && m_dNodes[tNode.m_iLeft].m_eRetType==SPH_ATTR_JSON_FIELD && m_dNodes[tNode.m_iLeft].m_iToken==TOK_ATTR_JSON )
-			pLeft = new Expr_JsonFieldConv_c ( pLeft );
+			pLeft = CreateJsonFieldConv ( tNode.m_iLeft, pLeft );
 		if ( pRight && m_dNodes[tNode.m_iRight].m_eRetType==SPH_ATTR_JSON_FIELD && m_dNodes[tNode.m_iRight].m_iToken==TOK_ATTR_JSON )
-			pRight = new Expr_JsonFieldConv_c ( pRight );
+			pRight = CreateJsonFieldConv ( tNode.m_iRight, pRight );
 	}
 
 	switch ( tNode.m_iToken )
@@ -4752,6 +5072,21 @@ ISphExpr * ExprParser_t::CreateTree ( int iNode )
 					MoveToArgList ( pLeft, dArgs );
 				}
 
+				// madd() and mul3() are fused from arithmetic operators, so their JSON operands need the same autoconversion
+				if ( ( eFunc==FUNC_MADD || eFunc==FUNC_MUL3 ) && !bSkipLeft )
+				{
+					CSphVector<int> dArgNodes;
+					GatherArgNodes ( tNode.m_iLeft, dArgNodes );
+					assert ( dArgNodes.GetLength()==dArgs.GetLength() );
+					ARRAY_FOREACH ( i, dArgs )
+						if ( m_dNodes[dArgNodes[i]].m_eRetType==SPH_ATTR_JSON_FIELD && m_dNodes[dArgNodes[i]].m_iToken==TOK_ATTR_JSON )
+						{
+							ISphExpr * pConverted = CreateJsonFieldConv ( dArgNodes[i], dArgs[i] );
+							SafeRelease ( dArgs[i] );
+							dArgs[i] = pConverted;
+						}
+				}
+
 				// spawn proper function
 				assert ( tNode.m_iFunc>=0 && tNode.m_iFunc<int(sizeof(g_dFuncs)/sizeof(g_dFuncs[0])) );
 				assert (
@@ -6684,6 +7019,9 @@ ExprParser_t::~ExprParser_t ()
 	// free temp map arguments storage
 	ARRAY_FOREACH ( i, m_dIdents )
 		SafeDeleteArray ( m_dIdents[i] );
+
+	for ( auto & pExpr : m_dNodeExprs )
+		SafeRelease ( pExpr );
 }
 
 ESphAttr ExprParser_t::GetWidestRet ( int iLeft, int iRight )
@@ -6773,6 +7111,44 @@ int ExprParser_t::AddNodeWeight ()
 	return m_dNodes.GetLength()-1;
 }
 
+bool ExprParser_t::GetJsonSubkeyPath ( int iNode, CSphString & sPath ) const
+{
+	if ( iNode<0 )
+		return false;
+
+	const ExprNode_t & tNode = m_dNodes[iNode];
+	if ( tNode.m_iToken==',' )
+		return GetJsonSubkeyPath ( tNode.m_iLeft, sPath ) && GetJsonSubkeyPath ( tNode.m_iRight, sPath );
+
+	if ( tNode.m_iToken!=TOK_SUBKEY )
+		return false;
+
+	CSphString sKey;
+	sKey.SetBinary ( m_sExpr+(int)( tNode.m_iConst>>32 ), (int)( tNode.m_iConst & 0xffffffffUL ) );
+	sPath.SetSprintf ( "%s.%s", sPath.cstr(), sKey.cstr() );
+	return true;
+}
+
+
+/// numeric conversion of a json.key operand; goes through the typed column where a hot JSON path attribute exists
+ISphExpr * ExprParser_t::CreateJsonFieldConv ( int iNode, ISphExpr * pArg )
+{
+	const ExprNode_t & tNode = m_dNodes[iNode];
+	assert ( tNode.m_iToken==TOK_ATTR_JSON );
+
+	int iMask = sphJsonHotMaskIndex ( *m_pSchema );
+	if ( iMask<0 || tNode.m_iLeft<0 || tNode.m_iLocator<0 || m_pSchema->GetAttr ( tNode.m_iLocator ).m_eAttrType!=SPH_ATTR_JSON )
+		return new Expr_JsonFieldConv_c ( pArg );
+
+	CSphString sPath = m_pSchema->GetAttr ( tNode.m_iLocator ).m_sName;
+	int iHot = GetJsonSubkeyPath ( tNode.m_iLeft, sPath ) ? sphJsonHotAttrIndex ( *m_pSchema, sPath.cstr() ) : -1;
+	if ( iHot<0 || m_pSchema->GetAttr ( iHot ).m_eAttrType==SPH_ATTR_STRING )
+		return new Expr_JsonFieldConv_c ( pArg );
+
+	return new Expr_JsonHotConv_c ( pArg, m_pSchema->GetAttr ( iHot ), iHot, m_pSchema->GetAttr ( iMask ).m_tLocator, iMask, sphJsonHotMaskBit ( *m_pSchema, iHot ) );
+}
+
+
 int ExprParser_t::AddNodeOp ( int iOp, int iLeft, int iRight )
 {
 	ExprNode_t & tNode = m_dNodes.Add ();
@@ -7688,6 +8064,726 @@ struct HookCheck_fn
 };
 
 
+//////////////////////////////////////////////////////////////////////////
+// EXPRESSION COMPILER
+//////////////////////////////////////////////////////////////////////////
+
+// numeric expression trees additionally get compiled into a flat register-based code,
+// that is then interpreted over a block of matches (or just one match) op by op
+//
+// every node gets compiled for a specific evaluation mode, and follows the semantics of its
+// ISphExpr counterpart in that mode exactly (ie. Eval(), IntEval() or Int64Eval(), respectively)
+// nodes that the compiler does not know are evaluated by their regular ISphExpr evaluators
+
+/// evaluation modes, one per ISphExpr evaluation call
+enum ExprMode_e
+{
+	EXPR_MODE_FLOAT = 0,	///< Eval()
+	EXPR_MODE_INT,			///< IntEval()
+	EXPR_MODE_INT64,		///< Int64Eval()
+
+	EXPR_MODE_TOTAL
+};
+
+union ExprReg_u
+{
+	float		m_fVal;
+	int			m_iVal;
+	int64_t		m_iVal64;
+};
+
+/// opcodes
+/// _F, _I, _L suffixes mean float, int, and int64 operands and result, unless noted otherwise
+enum ExprOpcode_e : BYTE
+{
+	EOP_CONST,
+	EOP_ATTR_F, EOP_ATTR_I, EOP_ATTR_L,		///< integer attribute
+	EOP_FLOAT_F,							///< float attribute
+	EOP_ID_F, EOP_ID_I, EOP_ID_L,
+	EOP_WEIGHT_F, EOP_WEIGHT_I, EOP_WEIGHT_L,
+	EOP_LEAF_F, EOP_LEAF_I, EOP_LEAF_L,		///< regular ISphExpr evaluator call
+
+	EOP_F2I, EOP_F2L, EOP_I2F, EOP_I2L, EOP_L2F, EOP_L2I,
+
+	EOP_ADD_F, EOP_ADD_I, EOP_ADD_L,
+	EOP_SUB_F, EOP_SUB_I, EOP_SUB_L,
+	EOP_MUL_F, EOP_MUL_I, EOP_MUL_L,
+	EOP_DIV_F,
+	EOP_IDIV_F, EOP_IDIV_I, EOP_IDIV_L,
+	EOP_MOD_F, EOP_MOD_I, EOP_MOD_L,
+	EOP_BITAND_F, EOP_BITAND_I, EOP_BITAND_L,
+	EOP_BITOR_F, EOP_BITOR_I, EOP_BITOR_L,
+	EOP_NEG_F, EOP_NEG_I, EOP_NEG_L,
+	EOP_ABS_F, EOP_ABS_I, EOP_ABS_L,
+	EOP_MIN_F, EOP_MIN_I, EOP_MIN_L,
+	EOP_MAX_F, EOP_MAX_I, EOP_MAX_L,
+	EOP_IF_F, EOP_IF_I, EOP_IF_L,
+	EOP_MADD_F, EOP_MADD_I, EOP_MADD_L,
+	EOP_MUL3_F, EOP_MUL3_I, EOP_MUL3_L,
+
+	EOP_CEIL_F, EOP_FLOOR_F, EOP_SIN_F, EOP_COS_F, EOP_EXP_F,
+	EOP_LN_F, EOP_LOG2_F, EOP_LOG10_F, EOP_SQRT_F, EOP_POW_F, EOP_ATAN2_F,
+
+	// comparisons and logic always return int 0 or 1, suffixes are for operands
+	EOP_LT_F, EOP_LT_I, EOP_LT_L,
+	EOP_GT_F, EOP_GT_I, EOP_GT_L,
+	EOP_LTE_F, EOP_LTE_I, EOP_LTE_L,
+	EOP_GTE_F, EOP_GTE_I, EOP_GTE_L,
+	EOP_EQ_F, EOP_EQ_I, EOP_EQ_L,
+	EOP_NE_F, EOP_NE_I, EOP_NE_L,
+	EOP_AND_F, EOP_AND_I, EOP_AND_L,
+	EOP_OR_F, EOP_OR_I, EOP_OR_L,
+	EOP_NOT_I, EOP_NOT_L
+};
+
+struct ExprOp_t
+{
+	ExprOpcode_e	m_eOp;
+	int				m_iDst = 0;
+	int				m_iA = 0;
+	int				m_iB = 0;
+	int				m_iC = 0;
+	int				m_iArg = -1;		///< locator or leaf index
+	ExprReg_u		m_tConst;
+};
+
+/// compiled code for one evaluation mode
+struct ExprCode_t
+{
+	CSphVector<ExprOp_t>			m_dOps;
+	int								m_iRegs = 0;
+	int								m_iResult = 0;
+	mutable CSphVector<ExprReg_u>	m_dRegs;	///< register file, one column of values per register
+};
+
+
+/// compiled expression
+/// keeps the original tree around, for the hashes, the commands, and for the leaves that it owns
+class Expr_Compiled_c : public ISphExpr
+{
+public:
+	static const int				BLOCK_SIZE = 128;	///< max matches per code run
+
+	CSphRefcountedPtr<ISphExpr>		m_pTree;
+	ExprCode_t						m_dCode[EXPR_MODE_TOTAL];
+	CSphVector<CSphAttrLocator>		m_dLocators;
+	VecRefPtrs_t<ISphExpr *>		m_dLeaves;
+
+	explicit Expr_Compiled_c ( ISphExpr * pTree )
+		: m_pTree ( pTree )
+	{
+		SafeAddRef ( pTree );
+	}
+
+	float Eval ( const CSphMatch & tMatch ) const final
+	{
+		const CSphMatch * pMatch = &tMatch;
+		return Run ( m_dCode[EXPR_MODE_FLOAT], &pMatch, 1 )->m_fVal;
+	}
+
+	int IntEval ( const CSphMatch & tMatch ) const final
+	{
+		const CSphMatch * pMatch = &tMatch;
+		return Run ( m_dCode[EXPR_MODE_INT], &pMatch, 1 )->m_iVal;
+	}
+
+	int64_t Int64Eval ( const CSphMatch & tMatch ) const final
+	{
+		const CSphMatch * pMatch = &tMatch;
+		return Run ( m_dCode[EXPR_MODE_INT64], &pMatch, 1 )->m_iVal64;
+	}
+
+	bool EvalBlock ( CSphMatch * const * ppMatches, int iCount, float * pRes ) const final
+	{
+		for ( int iStart=0; iStart<iCount; iStart+=BLOCK_SIZE )
+		{
+			int iChunk = Min ( iCount-iStart, BLOCK_SIZE );
+			const ExprReg_u * pOut = Run ( m_dCode[EXPR_MODE_FLOAT], ppMatches+iStart, iChunk );
+			for ( int i=0; i<iChunk; i++ )
+				pRes[iStart+i] = pOut[i].m_fVal;
+		}
+		return true;
+	}
+
+	bool IntEvalBlock ( CSphMatch * const * ppMatches, int iCount, int * pRes ) const final
+	{
+		for ( int iStart=0; iStart<iCount; iStart+=BLOCK_SIZE )
+		{
+			int iChunk = Min ( iCount-iStart, BLOCK_SIZE );
+			const ExprReg_u * pOut = Run ( m_dCode[EXPR_MODE_INT], ppMatches+iStart, iChunk );
+			for ( int i=0; i<iChunk; i++ )
+				pRes[iStart+i] = pOut[i].m_iVal;
+		}
+		return true;
+	}
+
+	bool Int64EvalBlock ( CSphMatch * const * ppMatches, int iCount, int64_t * pRes ) const final
+	{
+		for ( int iStart=0; iStart<iCount; iStart+=BLOCK_SIZE )
+		{
+			int iChunk = Min ( iCount-iStart, BLOCK_SIZE );
+			const ExprReg_u * pOut = Run ( m_dCode[EXPR_MODE_INT64], ppMatches+iStart, iChunk );
+			for ( int i=0; i<iChunk; i++ )
+				pRes[iStart+i] = pOut[i].m_iVal64;
+		}
+		return true;
+	}
+
+	bool CanEvalBlock () const final { return true; }
+
+	void FixupLocator ( const ISphSchema * pOldSchema, const ISphSchema * pNewSchema ) final
+	{
+		for ( auto & tLocator : m_dLocators )
+			sphFixupLocator ( tLocator, pOldSchema, pNewSchema );
+
+		// leaves are a part of the tree, so they get fixed up here
+		m_pTree->FixupLocator ( pOldSchema, pNewSchema );
+	}
+
+	void Command ( ESphExprCommand eCmd, void * pArg ) final
+	{
+		m_pTree->Command ( eCmd, pArg );
+	}
+
+	uint64_t GetHash ( const ISphSchema & tSorterSchema, uint64_t uPrevHash, bool & bDisable ) final
+	{
+		return m_pTree->GetHash ( tSorterSchema, uPrevHash, bDisable );
+	}
+
+private:
+	const ExprReg_u * Run ( const ExprCode_t & tCode, const CSphMatch * const * ppMatches, int iCount ) const;
+};
+
+
+// both IF branches are evaluated for every row in compiled code, so ops that trap must never do that on the branch not taken
+// zero divisor gives 0 like the tree IDIV() does; INT_MIN/-1 overflows, so -1 divisor is handled via unsigned negation
+static inline int CompiledIdiv ( int iA, int iB )
+{
+	if ( iB==-1 )
+		return (int)( 0U - (DWORD)iA );
+	return iB ? iA/iB : 0;
+}
+
+static inline int64_t CompiledIdiv ( int64_t iA, int64_t iB )
+{
+	if ( iB==-1 )
+		return (int64_t)( 0ULL - (uint64_t)iA );
+	return iB ? iA/iB : 0;
+}
+
+template < typename INT >
+static inline INT CompiledMod ( INT iA, INT iB )
+{
+	return ( iB && iB!=-1 ) ? iA % iB : 0;
+}
+
+
+const ExprReg_u * Expr_Compiled_c::Run ( const ExprCode_t & tCode, const CSphMatch * const * ppMatches, int iCount ) const
+{
+	tCode.m_dRegs.Resize ( tCode.m_iRegs*iCount );
+	ExprReg_u * pRegs = tCode.m_dRegs.Begin();
+
+#define LOC_LOOP(_expr) for ( int j=0; j<iCount; j++ ) { _expr; } break;
+#define LOC_F(_reg) _reg[j].m_fVal
+#define LOC_I(_reg) _reg[j].m_iVal
+#define LOC_L(_reg) _reg[j].m_iVal64
+
+	for ( const ExprOp_t & tOp : tCode.m_dOps )
+	{
+		ExprReg_u * D = pRegs + tOp.m_iDst*iCount;
+		const ExprReg_u * A = pRegs + tOp.m_iA*iCount;
+		const ExprReg_u * B = pRegs + tOp.m_iB*iCount;
+		const ExprReg_u * C = pRegs + tOp.m_iC*iCount;
+
+		switch ( tOp.m_eOp )
+		{
+		case EOP_CONST:		LOC_LOOP ( D[j] = tOp.m_tConst )
+
+		case EOP_ATTR_F:	LOC_LOOP ( LOC_F(D) = (float) ppMatches[j]->GetAttr ( m_dLocators[tOp.m_iArg] ) )
+		case EOP_ATTR_I:	LOC_LOOP ( LOC_I(D) = (int) ppMatches[j]->GetAttr ( m_dLocators[tOp.m_iArg] ) )
+		case EOP_ATTR_L:	LOC_LOOP ( LOC_L(D) = (int64_t) ppMatches[j]->GetAttr ( m_dLocators[tOp.m_iArg] ) )
+		case EOP_FLOAT_F:	LOC_LOOP ( LOC_F(D) = ppMatches[j]->GetAttrFloat ( m_dLocators[tOp.m_iArg] ) )
+
+		case EOP_ID_F:		LOC_LOOP ( LOC_F(D) = (float) ppMatches[j]->m_uDocID )
+		case EOP_ID_I:		LOC_LOOP ( LOC_I(D) = (int) ppMatches[j]->m_uDocID )
+		case EOP_ID_L:		LOC_LOOP ( LOC_L(D) = (int64_t) ppMatches[j]->m_uDocID )
+		case EOP_WEIGHT_F:	LOC_LOOP ( LOC_F(D) = (float) ppMatches[j]->m_iWeight )
+		case EOP_WEIGHT_I:	LOC_LOOP ( LOC_I(D) = (int) ppMatches[j]->m_iWeight )
+		case EOP_WEIGHT_L:	LOC_LOOP ( LOC_L(D) = (int64_t) ppMatches[j]->m_iWeight )
+
+		case EOP_LEAF_F:	LOC_LOOP ( LOC_F(D) = m_dLeaves[tOp.m_iArg]->Eval ( *ppMatches[j] ) )
+		case EOP_LEAF_I:	LOC_LOOP ( LOC_I(D) = m_dLeaves[tOp.m_iArg]->IntEval ( *ppMatches[j] ) )
+		case EOP_LEAF_L:	LOC_LOOP ( LOC_L(D) = m_dLeaves[tOp.m_iArg]->Int64Eval ( *ppMatches[j] ) )
+
+		case EOP_F2I:		LOC_LOOP ( LOC_I(D) = (int) LOC_F(A) )
+		case EOP_F2L:		LOC_LOOP ( LOC_L(D) = (int64_t) LOC_F(A) )
+		case EOP_I2F:		LOC_LOOP ( LOC_F(D) = (float) LOC_I(A) )
+		case EOP_I2L:		LOC_LOOP ( LOC_L(D) = (int64_t) LOC_I(A) )
+		case EOP_L2F:		LOC_LOOP ( LOC_F(D) = (float) LOC_L(A) )
+		case EOP_L2I:		LOC_LOOP ( LOC_I(D) = (int) LOC_L(A) )
+
+		case EOP_ADD_F:		LOC_LOOP ( LOC_F(D) = LOC_F(A) + LOC_F(B) )
+		case EOP_ADD_I:		LOC_LOOP ( LOC_I(D) = (DWORD)LOC_I(A) + (DWORD)LOC_I(B) )
+		case EOP_ADD_L:		LOC_LOOP ( LOC_L(D) = (uint64_t)LOC_L(A) + (uint64_t)LOC_L(B) )
+		case EOP_SUB_F:		LOC_LOOP ( LOC_F(D) = LOC_F(A) - LOC_F(B) )
+		case EOP_SUB_I:		LOC_LOOP ( LOC_I(D) = (DWORD)LOC_I(A) - (DWORD)LOC_I(B) )
+		case EOP_SUB_L:		LOC_LOOP ( LOC_L(D) = (uint64_t)LOC_L(A) - (uint64_t)LOC_L(B) )
+		case EOP_MUL_F:		LOC_LOOP ( LOC_F(D) = LOC_F(A) * LOC_F(B) )
+		case EOP_MUL_I:		LOC_LOOP ( LOC_I(D) = (DWORD)LOC_I(A) * (DWORD)LOC_I(B) )
+		case EOP_MUL_L:		LOC_LOOP ( LOC_L(D) = (uint64_t)LOC_L(A) * (uint64_t)LOC_L(B) )
+		case EOP_DIV_F:		LOC_LOOP ( LOC_F(D) = LOC_F(B) ? LOC_F(A)/LOC_F(B) : 0.0f )
+		case EOP_IDIV_F:	LOC_LOOP ( LOC_F(D) = float ( CompiledIdiv ( int(LOC_F(A)), int(LOC_F(B)) ) ) )
+		case EOP_IDIV_I:	LOC_LOOP ( LOC_I(D) = CompiledIdiv ( LOC_I(A), LOC_I(B) ) )
+		case EOP_IDIV_L:	LOC_LOOP ( LOC_L(D) = CompiledIdiv ( LOC_L(A), LOC_L(B) ) )
+		case EOP_MOD_F:		LOC_LOOP ( LOC_F(D) = (float)CompiledMod ( int(LOC_F(A)), int(LOC_F(B)) ) )
+		case EOP_MOD_I:		LOC_LOOP ( LOC_I(D) = CompiledMod ( LOC_I(A), LOC_I(B) ) )
+		case EOP_MOD_L:		LOC_LOOP ( LOC_L(D) = CompiledMod ( LOC_L(A), LOC_L(B) ) )
+		case EOP_BITAND_F:	LOC_LOOP ( LOC_F(D) = (float)( int(LOC_F(A)) & int(LOC_F(B)) ) )
+		case EOP_BITAND_I:	LOC_LOOP ( LOC_I(D) = LOC_I(A) & LOC_I(B) )
+		case EOP_BITAND_L:	LOC_LOOP ( LOC_L(D) = LOC_L(A) & LOC_L(B) )
+		case EOP_BITOR_F:	LOC_LOOP ( LOC_F(D) = (float)( int(LOC_F(A)) | int(LOC_F(B)) ) )
+		case EOP_BITOR_I:	LOC_LOOP ( LOC_I(D) = LOC_I(A) | LOC_I(B) )
+		case EOP_BITOR_L:	LOC_LOOP ( LOC_L(D) = LOC_L(A) | LOC_L(B) )
+		case EOP_NEG_F:		LOC_LOOP ( LOC_F(D) = -LOC_F(A) )
+		case EOP_NEG_I:		LOC_LOOP ( LOC_I(D) = -LOC_I(A) )
+		case EOP_NEG_L:		LOC_LOOP ( LOC_L(D) = -LOC_L(A) )
+		case EOP_ABS_F:		LOC_LOOP ( LOC_F(D) = (float) fabs ( LOC_F(A) ) )
+		case EOP_ABS_I:		LOC_LOOP ( LOC_I(D) = IABS ( LOC_I(A) ) )
+		case EOP_ABS_L:		LOC_LOOP ( LOC_L(D) = IABS ( LOC_L(A) ) )
+		case EOP_MIN_F:		LOC_LOOP ( LOC_F(D) = Min ( LOC_F(A), LOC_F(B) ) )
+		case EOP_MIN_I:		LOC_LOOP ( LOC_I(D) = Min ( LOC_I(A), LOC_I(B) ) )
+		case EOP_MIN_L:		LOC_LOOP ( LOC_L(D) = Min ( LOC_L(A), LOC_L(B) ) )
+		case EOP_MAX_F:		LOC_LOOP ( LOC_F(D) = Max ( LOC_F(A), LOC_F(B) ) )
+		case EOP_MAX_I:		LOC_LOOP ( LOC_I(D) = Max ( LOC_I(A), LOC_I(B) ) )
+		case EOP_MAX_L:		LOC_LOOP ( LOC_L(D) = Max ( LOC_L(A), LOC_L(B) ) )
+		case EOP_IF_F:		LOC_LOOP ( LOC_F(D) = ( LOC_F(A)!=0.0f ) ? LOC_F(B) : LOC_F(C) )
+		case EOP_IF_I:		LOC_LOOP ( LOC_I(D) = LOC_I(A) ? LOC_I(B) : LOC_I(C) )
+		case EOP_IF_L:		LOC_LOOP ( LOC_L(D) = LOC_L(A) ? LOC_L(B) : LOC_L(C) )
+		case EOP_MADD_F:	LOC_LOOP ( LOC_F(D) = LOC_F(A)*LOC_F(B) + LOC_F(C) )
+		case EOP_MADD_I:	LOC_LOOP ( LOC_I(D) = (DWORD)LOC_I(A)*(DWORD)LOC_I(B) + (DWORD)LOC_I(C) )
+		case EOP_MADD_L:	LOC_LOOP ( LOC_L(D) = (uint64_t)LOC_L(A)*(uint64_t)LOC_L(B) + (uint64_t)LOC_L(C) )
+		case EOP_MUL3_F:	LOC_LOOP ( LOC_F(D) = LOC_F(A)*LOC_F(B)*LOC_F(C) )
+		case EOP_MUL3_I:	LOC_LOOP ( LOC_I(D) = (DWORD)LOC_I(A)*(DWORD)LOC_I(B)*(DWORD)LOC_I(C) )
+		case EOP_MUL3_L:	LOC_LOOP ( LOC_L(D) = (uint64_t)LOC_L(A)*(uint64_t)LOC_L(B)*(uint64_t)LOC_L(C) )
+
+		case EOP_CEIL_F:	LOC_LOOP ( LOC_F(D) = float ( ceil ( LOC_F(A) ) ) )
+		case EOP_FLOOR_F:	LOC_LOOP ( LOC_F(D) = float ( floor ( LOC_F(A) ) ) )
+		case EOP_SIN_F:		LOC_LOOP ( LOC_F(D) = float ( sin ( LOC_F(A) ) ) )
+		case EOP_COS_F:		LOC_LOOP ( LOC_F(D) = float ( cos ( LOC_F(A) ) ) )
+		case EOP_EXP_F:		LOC_LOOP ( LOC_F(D) = float ( exp ( LOC_F(A) ) ) )
+		case EOP_LN_F:		LOC_LOOP ( LOC_F(D) = LOC_F(A)>0.0f ? (float) log ( LOC_F(A) ) : 0.0f )
+		case EOP_LOG2_F:	LOC_LOOP ( LOC_F(D) = LOC_F(A)>0.0f ? (float)( log ( LOC_F(A) )*M_LOG2E ) : 0.0f )
+		case EOP_LOG10_F:	LOC_LOOP ( LOC_F(D) = LOC_F(A)>0.0f ? (float)( log ( LOC_F(A) )*M_LOG10E ) : 0.0f )
+		case EOP_SQRT_F:	LOC_LOOP ( LOC_F(D) = LOC_F(A)>0.0f ? (float) sqrt ( LOC_F(A) ) : 0.0f )
+		case EOP_POW_F:		LOC_LOOP ( LOC_F(D) = float ( pow ( LOC_F(A), LOC_F(B) ) ) )
+		case EOP_ATAN2_F:	LOC_LOOP ( LOC_F(D) = float ( atan2 ( LOC_F(A), LOC_F(B) ) ) )
+
+		case EOP_LT_F:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_F(A)<LOC_F(B) ) )
+		case EOP_LT_I:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_I(A)<LOC_I(B) ) )
+		case EOP_LT_L:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_L(A)<LOC_L(B) ) )
+		case EOP_GT_F:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_F(A)>LOC_F(B) ) )
+		case EOP_GT_I:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_I(A)>LOC_I(B) ) )
+		case EOP_GT_L:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_L(A)>LOC_L(B) ) )
+		case EOP_LTE_F:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_F(A)<=LOC_F(B) ) )
+		case EOP_LTE_I:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_I(A)<=LOC_I(B) ) )
+		case EOP_LTE_L:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_L(A)<=LOC_L(B) ) )
+		case EOP_GTE_F:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_F(A)>=LOC_F(B) ) )
+		case EOP_GTE_I:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_I(A)>=LOC_I(B) ) )
+		case EOP_GTE_L:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_L(A)>=LOC_L(B) ) )
+		case EOP_EQ_F:		LOC_LOOP ( LOC_I(D) = IFINT ( fabs ( LOC_F(A)-LOC_F(B) )<=1e-6 ) )
+		case EOP_EQ_I:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_I(A)==LOC_I(B) ) )
+		case EOP_EQ_L:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_L(A)==LOC_L(B) ) )
+		case EOP_NE_F:		LOC_LOOP ( LOC_I(D) = IFINT ( fabs ( LOC_F(A)-LOC_F(B) )>1e-6 ) )
+		case EOP_NE_I:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_I(A)!=LOC_I(B) ) )
+		case EOP_NE_L:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_L(A)!=LOC_L(B) ) )
+		case EOP_AND_F:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_F(A)!=0.0f && LOC_F(B)!=0.0f ) )
+		case EOP_AND_I:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_I(A) && LOC_I(B) ) )
+		case EOP_AND_L:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_L(A) && LOC_L(B) ) )
+		case EOP_OR_F:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_F(A)!=0.0f || LOC_F(B)!=0.0f ) )
+		case EOP_OR_I:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_I(A) || LOC_I(B) ) )
+		case EOP_OR_L:		LOC_LOOP ( LOC_I(D) = IFINT ( LOC_L(A) || LOC_L(B) ) )
+		case EOP_NOT_I:		LOC_LOOP ( LOC_I(D) = LOC_I(A) ? 0 : 1 )
+		case EOP_NOT_L:		LOC_LOOP ( LOC_I(D) = LOC_L(A) ? 0 : 1 )
+		}
+	}
+
+#undef LOC_LOOP
+#undef LOC_F
+#undef LOC_I
+#undef LOC_L
+
+	return pRegs + tCode.m_iResult*iCount;
+}
+
+
+/// compiles parsed nodes into Expr_Compiled_c
+class ExprCompiler_c : public ISphNoncopyable
+{
+public:
+	ExprCompiler_c ( ExprParser_t & tParser, const CSphVector<ExprNode_t> & dNodes, const CSphVector<ISphExpr *> & dNodeExprs )
+		: m_tParser ( tParser )
+		, m_dNodes ( dNodes )
+		, m_dNodeExprs ( dNodeExprs )
+	{
+		m_dKinds.Resize ( m_dNodes.GetLength() );
+		m_dKinds.Fill ( KIND_UNKNOWN );
+	}
+
+	ISphExpr * Compile ( int iRoot, ISphExpr * pTree )
+	{
+		if ( !IsNumeric ( m_dNodes[iRoot].m_eRetType ) )
+			return nullptr;
+
+		Kind_e eRoot = GetKind ( iRoot );
+		if ( eRoot!=KIND_OP && eRoot!=KIND_PURE )
+			return nullptr;
+
+		// do not bother with tiny trees, virtual calls are just as good there
+		if ( CountOps ( iRoot )<MIN_OPS )
+			return nullptr;
+
+		m_pRes = new Expr_Compiled_c ( pTree );
+		for ( int i=0; i<EXPR_MODE_TOTAL; i++ )
+		{
+			m_pCode = m_pRes->m_dCode + i;
+			m_pCode->m_iResult = Emit ( iRoot, (ExprMode_e)i );
+		}
+		return m_pRes;
+	}
+
+private:
+	static const int MIN_OPS = 4;
+
+	enum Kind_e : BYTE
+	{
+		KIND_UNKNOWN,
+		KIND_NONE,	///< neither compiled nor evaluated by a regular evaluator (eg. a string)
+		KIND_LEAF,	///< evaluated by a regular evaluator
+		KIND_OP,	///< compiled
+		KIND_PURE	///< compiled with all the children (no side effects or conditional evaluation issues)
+	};
+
+	ExprParser_t &						m_tParser;
+	const CSphVector<ExprNode_t> &		m_dNodes;
+	const CSphVector<ISphExpr *> &		m_dNodeExprs;
+	CSphVector<Kind_e>					m_dKinds;
+	Expr_Compiled_c *					m_pRes = nullptr;
+	ExprCode_t *						m_pCode = nullptr;
+
+	static bool IsNumeric ( ESphAttr eAttr )
+	{
+		return eAttr==SPH_ATTR_INTEGER || eAttr==SPH_ATTR_BIGINT || eAttr==SPH_ATTR_FLOAT || eAttr==SPH_ATTR_TIMESTAMP || eAttr==SPH_ATTR_BOOL;
+	}
+
+	static ExprMode_e ArgMode ( ESphAttr eArg )
+	{
+		if ( eArg==SPH_ATTR_INTEGER )
+			return EXPR_MODE_INT;
+		return eArg==SPH_ATTR_BIGINT ? EXPR_MODE_INT64 : EXPR_MODE_FLOAT;
+	}
+
+	void GetArgs ( int iNode, CSphVector<int> & dArgs ) const
+	{
+		const ExprNode_t & tNode = m_dNodes[iNode];
+		if ( tNode.m_iToken==TOK_FUNC )
+		{
+			m_tParser.GatherArgNodes ( tNode.m_iLeft, dArgs );
+			return;
+		}
+
+		if ( tNode.m_iLeft>=0 )
+			dArgs.Add ( tNode.m_iLeft );
+		if ( tNode.m_iRight>=0 )
+			dArgs.Add ( tNode.m_iRight );
+	}
+
+	bool IsPure ( int iNode )
+	{
+		return GetKind ( iNode )==KIND_PURE;
+	}
+
+	/// check whether node itself could be compiled, given that its arguments could
+	bool IsSupported ( int iNode, const CSphVector<int> & dArgs )
+	{
+		const ExprNode_t & tNode = m_dNodes[iNode];
+		for ( int iArg : dArgs )
+			if ( !IsNumeric ( m_dNodes[iArg].m_eRetType ) )
+				return false;
+
+		switch ( tNode.m_iToken )
+		{
+		case TOK_CONST_INT: case TOK_CONST_FLOAT:
+		case TOK_ATTR_INT: case TOK_ATTR_BITS: case TOK_ATTR_SINT: case TOK_ATTR_FLOAT:
+		case TOK_ID: case TOK_WEIGHT:
+			return true;
+
+		case '+': case '-': case '*': case '&': case '|': case '%':
+		case '<': case '>': case TOK_LTE: case TOK_GTE: case TOK_EQ: case TOK_NE:
+			return dArgs.GetLength()==2;
+
+		case TOK_NEG: case TOK_NOT:
+			return dArgs.GetLength()==1;
+
+		// 1st argument only gets evaluated on some conditions, so it must not be a regular evaluator call
+		case '/':
+			return dArgs.GetLength()==2 && IsPure ( dArgs[0] );
+
+		// same for the 2nd one
+		case TOK_AND: case TOK_OR:
+			return dArgs.GetLength()==2 && IsPure ( dArgs[1] );
+
+		case TOK_FUNC:
+			switch ( tNode.m_iFunc )
+			{
+			case FUNC_CEIL: case FUNC_FLOOR: case FUNC_SIN: case FUNC_COS: case FUNC_EXP:
+			case FUNC_LN: case FUNC_LOG2: case FUNC_LOG10: case FUNC_SQRT: case FUNC_SINT:
+				return dArgs.GetLength()==1;
+
+			case FUNC_ABS: // integer abs() evaluates its argument twice
+				return dArgs.GetLength()==1 && IsPure ( dArgs[0] );
+
+			case FUNC_MIN: case FUNC_MAX: case FUNC_POW: case FUNC_ATAN2:
+				return dArgs.GetLength()==2;
+
+			case FUNC_IDIV:
+				return dArgs.GetLength()==2 && IsPure ( dArgs[0] );
+
+			case FUNC_MADD: case FUNC_MUL3:
+				return dArgs.GetLength()==3;
+
+			case FUNC_IF:
+				return dArgs.GetLength()==3 && IsPure ( dArgs[1] ) && IsPure ( dArgs[2] );
+
+			default:
+				return false;
+			}
+
+		default:
+			return false;
+		}
+	}
+
+	Kind_e GetKind ( int iNode )
+	{
+		if ( m_dKinds[iNode]!=KIND_UNKNOWN )
+			return m_dKinds[iNode];
+
+		CSphVector<int> dArgs;
+		GetArgs ( iNode, dArgs );
+
+		bool bOp = true;
+		bool bPure = true;
+		for ( int iArg : dArgs )
+		{
+			Kind_e eArg = GetKind ( iArg );
+			bOp &= ( eArg!=KIND_NONE );
+			bPure &= ( eArg==KIND_PURE );
+		}
+
+		Kind_e eKind = KIND_NONE;
+		if ( bOp && IsSupported ( iNode, dArgs ) )
+			eKind = bPure ? KIND_PURE : KIND_OP;
+		else if ( IsNumeric ( m_dNodes[iNode].m_eRetType ) && iNode<m_dNodeExprs.GetLength() && m_dNodeExprs[iNode] )
+			eKind = KIND_LEAF;
+
+		m_dKinds[iNode] = eKind;
+		return eKind;
+	}
+
+	int CountOps ( int iNode )
+	{
+		if ( GetKind ( iNode )==KIND_LEAF )
+			return 0;
+
+		CSphVector<int> dArgs;
+		GetArgs ( iNode, dArgs );
+		int iOps = 1;
+		for ( int iArg : dArgs )
+			iOps += CountOps ( iArg );
+		return iOps;
+	}
+
+	int AddOp ( ExprOpcode_e eOp, int iA=0, int iB=0, int iC=0, int iArg=-1 )
+	{
+		ExprOp_t & tOp = m_pCode->m_dOps.Add();
+		tOp.m_eOp = eOp;
+		tOp.m_iDst = m_pCode->m_iRegs++;
+		tOp.m_iA = iA;
+		tOp.m_iB = iB;
+		tOp.m_iC = iC;
+		tOp.m_iArg = iArg;
+		tOp.m_tConst.m_iVal64 = 0;
+		return tOp.m_iDst;
+	}
+
+	/// pick an opcode for the given mode (opcodes go in _F, _I, _L triplets)
+	static ExprOpcode_e ModeOp ( ExprOpcode_e eFloatOp, ExprMode_e eMode )
+	{
+		return (ExprOpcode_e)( eFloatOp + eMode );
+	}
+
+	int Convert ( int iReg, ExprMode_e eFrom, ExprMode_e eTo )
+	{
+		if ( eFrom==eTo )
+			return iReg;
+
+		static const ExprOpcode_e dConv[EXPR_MODE_TOTAL][EXPR_MODE_TOTAL] =
+		{
+			{ EOP_CONST, EOP_F2I, EOP_F2L },
+			{ EOP_I2F, EOP_CONST, EOP_I2L },
+			{ EOP_L2F, EOP_L2I, EOP_CONST }
+		};
+		return AddOp ( dConv[eFrom][eTo], iReg );
+	}
+
+	int AddConst ( float fVal, int iVal, int64_t iVal64, ExprMode_e eMode )
+	{
+		int iReg = AddOp ( EOP_CONST );
+		ExprReg_u & tConst = m_pCode->m_dOps.Last().m_tConst;
+		switch ( eMode )
+		{
+		case EXPR_MODE_FLOAT:	tConst.m_fVal = fVal; break;
+		case EXPR_MODE_INT:		tConst.m_iVal = iVal; break;
+		default:				tConst.m_iVal64 = iVal64; break;
+		}
+		return iReg;
+	}
+
+	int AddLocator ( const CSphAttrLocator & tLocator )
+	{
+		m_pRes->m_dLocators.Add ( tLocator );
+		return m_pRes->m_dLocators.GetLength()-1;
+	}
+
+	/// emit the node code, and return the register with its value in a given mode
+	int Emit ( int iNode, ExprMode_e eMode )
+	{
+		const ExprNode_t & tNode = m_dNodes[iNode];
+
+		if ( GetKind ( iNode )==KIND_LEAF )
+		{
+			ISphExpr * pLeaf = m_dNodeExprs[iNode];
+			SafeAddRef ( pLeaf );
+			m_pRes->m_dLeaves.Add ( pLeaf );
+			return AddOp ( ModeOp ( EOP_LEAF_F, eMode ), 0, 0, 0, m_pRes->m_dLeaves.GetLength()-1 );
+		}
+
+		assert ( GetKind ( iNode )==KIND_OP || GetKind ( iNode )==KIND_PURE );
+
+		CSphVector<int> dArgs;
+		GetArgs ( iNode, dArgs );
+
+		// same mode for all the arguments and the result
+		auto fnSameMode = [&] ( ExprOpcode_e eFloatOp )
+		{
+			int dRegs[3] = { 0, 0, 0 };
+			ARRAY_FOREACH ( i, dArgs )
+				dRegs[i] = Emit ( dArgs[i], eMode );
+			return AddOp ( ModeOp ( eFloatOp, eMode ), dRegs[0], dRegs[1], dRegs[2] );
+		};
+
+		// float arguments and result, whatever the mode
+		auto fnFloat = [&] ( ExprOpcode_e eOp )
+		{
+			int dRegs[2] = { 0, 0 };
+			ARRAY_FOREACH ( i, dArgs )
+				dRegs[i] = Emit ( dArgs[i], EXPR_MODE_FLOAT );
+			return Convert ( AddOp ( eOp, dRegs[0], dRegs[1] ), EXPR_MODE_FLOAT, eMode );
+		};
+
+		// arguments in the node argument type mode, int result
+		auto fnCompare = [&] ( ExprOpcode_e eFloatOp )
+		{
+			ExprMode_e eArgMode = ArgMode ( tNode.m_eArgType );
+			int iA = Emit ( dArgs[0], eArgMode );
+			int iB = Emit ( dArgs[1], eArgMode );
+			return Convert ( AddOp ( ModeOp ( eFloatOp, eArgMode ), iA, iB ), EXPR_MODE_INT, eMode );
+		};
+
+		switch ( tNode.m_iToken )
+		{
+		case TOK_CONST_FLOAT:
+			return AddConst ( tNode.m_fConst, (int)tNode.m_fConst, (int64_t)tNode.m_fConst, eMode );
+
+		case TOK_CONST_INT:
+			if ( tNode.m_eRetType==SPH_ATTR_INTEGER )
+				return AddConst ( (float)(int)tNode.m_iConst, (int)tNode.m_iConst, (int)tNode.m_iConst, eMode );
+			if ( tNode.m_eRetType==SPH_ATTR_BIGINT )
+				return AddConst ( (float)tNode.m_iConst, (int)tNode.m_iConst, tNode.m_iConst, eMode );
+			else
+			{
+				auto fConst = float(tNode.m_iConst);
+				return AddConst ( fConst, (int)fConst, (int64_t)fConst, eMode );
+			}
+
+		case TOK_ATTR_INT:
+		case TOK_ATTR_BITS:		return AddOp ( ModeOp ( EOP_ATTR_F, eMode ), 0, 0, 0, AddLocator ( tNode.m_tLocator ) );
+		case TOK_ATTR_SINT:		return Convert ( AddOp ( EOP_ATTR_I, 0, 0, 0, AddLocator ( tNode.m_tLocator ) ), EXPR_MODE_INT, eMode );
+		case TOK_ATTR_FLOAT:	return Convert ( AddOp ( EOP_FLOAT_F, 0, 0, 0, AddLocator ( tNode.m_tLocator ) ), EXPR_MODE_FLOAT, eMode );
+		case TOK_ID:			return AddOp ( ModeOp ( EOP_ID_F, eMode ) );
+		case TOK_WEIGHT:		return AddOp ( ModeOp ( EOP_WEIGHT_F, eMode ) );
+
+		case '+':				return fnSameMode ( EOP_ADD_F );
+		case '-':				return fnSameMode ( EOP_SUB_F );
+		case '*':				return fnSameMode ( EOP_MUL_F );
+		case '&':				return fnSameMode ( EOP_BITAND_F );
+		case '|':				return fnSameMode ( EOP_BITOR_F );
+		case '%':				return fnSameMode ( EOP_MOD_F );
+		case '/':				return fnFloat ( EOP_DIV_F );
+		case TOK_NEG:			return fnSameMode ( EOP_NEG_F );
+
+		case '<':				return fnCompare ( EOP_LT_F );
+		case '>':				return fnCompare ( EOP_GT_F );
+		case TOK_LTE:			return fnCompare ( EOP_LTE_F );
+		case TOK_GTE:			return fnCompare ( EOP_GTE_F );
+		case TOK_EQ:			return fnCompare ( EOP_EQ_F );
+		case TOK_NE:			return fnCompare ( EOP_NE_F );
+		case TOK_AND:			return fnCompare ( EOP_AND_F );
+		case TOK_OR:			return fnCompare ( EOP_OR_F );
+
+		case TOK_NOT:
+			{
+				bool bInt64 = ( tNode.m_eArgType==SPH_ATTR_BIGINT );
+				int iA = Emit ( dArgs[0], bInt64 ? EXPR_MODE_INT64 : EXPR_MODE_INT );
+				return Convert ( AddOp ( bInt64 ? EOP_NOT_L : EOP_NOT_I, iA ), EXPR_MODE_INT, eMode );
+			}
+
+		case TOK_FUNC:
+			switch ( tNode.m_iFunc )
+			{
+			case FUNC_ABS:		return fnSameMode ( EOP_ABS_F );
+			case FUNC_MIN:		return fnSameMode ( EOP_MIN_F );
+			case FUNC_MAX:		return fnSameMode ( EOP_MAX_F );
+			case FUNC_IF:		return fnSameMode ( EOP_IF_F );
+			case FUNC_MADD:		return fnSameMode ( EOP_MADD_F );
+			case FUNC_MUL3:		return fnSameMode ( EOP_MUL3_F );
+			case FUNC_IDIV:		return fnSameMode ( EOP_IDIV_F );
+			case FUNC_SINT:		return Convert ( Emit ( dArgs[0], EXPR_MODE_INT ), EXPR_MODE_INT, eMode );
+
+			case FUNC_CEIL:		return fnFloat ( EOP_CEIL_F );
+			case FUNC_FLOOR:	return fnFloat ( EOP_FLOOR_F );
+			case FUNC_SIN:		return fnFloat ( EOP_SIN_F );
+			case FUNC_COS:		return fnFloat ( EOP_COS_F );
+			case FUNC_EXP:		return fnFloat ( EOP_EXP_F );
+			case FUNC_LN:		return fnFloat ( EOP_LN_F );
+			case FUNC_LOG2:		return fnFloat ( EOP_LOG2_F );
+			case FUNC_LOG10:	return fnFloat ( EOP_LOG10_F );
+			case FUNC_SQRT:		return fnFloat ( EOP_SQRT_F );
+			case FUNC_POW:		return fnFloat ( EOP_POW_F );
+			case FUNC_ATAN2:	return fnFloat ( EOP_ATAN2_F );
+			default:			break;
+			}
+			break;
+
+		default:
+			break;
+		}
+
+		assert ( 0 && "internal error: unsupported node in expression compiler" );
+		return AddConst ( 0.0f, 0, 0, eMode );
+	}
+};
+
 ISphExpr * ExprParser_t::Parse ( const char * sExpr, const ISphSchema & tSchema,
 	ESphAttr * pAttrType, bool * pUsesWeight, CSphString & sError )
 {
@@ -7776,6 +8872,14 @@ ISphExpr * ExprParser_t::Parse ( const char * sExpr, const ISphSchema & tSchema,
 	{
 		sError.SetSprintf ( "empty expression" );
 	}
+	else
+	{
+		// compile numeric trees into a flat code, if possible
+		ExprCompiler_c tCompiler ( *this, m_dNodes, m_dNodeExprs );
+		ISphExpr * pCompiled = tCompiler.Compile ( m_iParsed, pRes );
+		if ( pCompiled )
+			pRes = pCompiled;
+	}
 
 	if ( pAttrType )
 		*pAttrType = eAttrType;
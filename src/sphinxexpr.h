@@ -117,6 +117,21 @@ public:
 	/// evaluate PACKEDFACTORS as a packed data ptr attr
 	virtual const BYTE * FactorEvalPacked ( const CSphMatch & ) const { assert ( 0 ); return NULL; }
 
+	/// evaluate this expression for a block of matches at once, using float math
+	/// returns false when block evaluation is not supported, and then caller must go match by match
+	virtual bool EvalBlock ( CSphMatch * const *, int, float * ) const { return false; }
+
+	/// evaluate this expression for a block of matches at once, using int math
+	/// returns false when block evaluation is not supported, and then caller must go match by match
+	virtual bool IntEvalBlock ( CSphMatch * const *, int, int * ) const { return false; }
+
+	/// evaluate this expression for a block of matches at once, using int64 math
+	/// returns false when block evaluation is not supported, and then caller must go match by match
+	virtual bool Int64EvalBlock ( CSphMatch * const *, int, int64_t * ) const { return false; }
+
+	/// check whether block evaluation calls above are supported at all
+	virtual bool CanEvalBlock () const { return false; }
+
 	/// check for arglist subtype
 	/// FIXME? replace with a single GetType() call?
 	virtual bool IsArglist () const { return false; }
@@ -1524,8 +1524,91 @@ struct Filter_KillList : public ISphFilter
 // PUBLIC FACING INTERFACE
 //////////////////////////////////////////////////////////////////////////
 
+/// hot JSON path filter; rows that hold the exact JSON value in the hot attribute are checked against it,
+/// the rest (missing keys, other types, lossy conversions) go through the regular JSON filter
+struct Filter_JsonHot_c : public ISphFilter
+{
+	ISphFilter *	m_pHot;
+	ISphFilter *	m_pJson;
+	CSphAttrLocator	m_tMask;
+	int				m_iBit;
+	SphAttr_t		m_uBit;
+
+	Filter_JsonHot_c ( ISphFilter * pHot, ISphFilter * pJson, const CSphAttrLocator & tMask, int iBit )
+		: m_pHot ( pHot )
+		, m_pJson ( pJson )
+		, m_tMask ( tMask )
+		, m_iBit ( iBit )
+		, m_uBit ( U64C(1)<<iBit )
+	{}
+
+	~Filter_JsonHot_c ()
+	{
+		SafeDelete ( m_pHot );
+		SafeDelete ( m_pJson );
+	}
+
+	bool Eval ( const CSphMatch & tMatch ) const final
+	{
+		if ( tMatch.GetAttr ( m_tMask ) & m_uBit )
+			return m_pHot->Eval ( tMatch );
+		return m_pJson->Eval ( tMatch );
+	}
+
+	bool EvalBlock ( const DWORD * pMinDocinfo, const DWORD * pMaxDocinfo ) const final
+	{
+		if ( m_tMask.m_bDynamic )
+			return true; // ignore computed attributes
+
+		// hot attribute ranges can only reject a block where every row holds the exact value; mask ranges are numeric,
+		// so that is the case when both ends agree on all the bits from ours up, and ours is set
+		SphAttr_t iMaskMin = sphGetRowAttr ( DOCINFO2ATTRS ( pMinDocinfo ), m_tMask );
+		SphAttr_t iMaskMax = sphGetRowAttr ( DOCINFO2ATTRS ( pMaxDocinfo ), m_tMask );
+		if ( ( iMaskMin<0 )!=( iMaskMax<0 ) )
+			return true;
+
+		auto uMaskMin = (uint64_t)iMaskMin;
+		auto uMaskMax = (uint64_t)iMaskMax;
+		if ( ( uMaskMin>>m_iBit )!=( uMaskMax>>m_iBit ) || !( uMaskMin & m_uBit ) )
+			return true;
+
+		return m_pHot->EvalBlock ( pMinDocinfo, pMaxDocinfo );
+	}
+
+	void SetMVAStorage ( const DWORD * pMva, bool bArenaProhibit ) final
+	{
+		m_pHot->SetMVAStorage ( pMva, bArenaProhibit );
+		m_pJson->SetMVAStorage ( pMva, bArenaProhibit );
+	}
+
+	void SetStringStorage ( const BYTE * pStrings ) final
+	{
+		m_pHot->SetStringStorage ( pStrings );
+		m_pJson->SetStringStorage ( pStrings );
+	}
+};
+
+
+/// whether a filter on the exact JSON value gives the same result when run against the hot attribute of a given type
+static bool IsHotFilterCompatible ( const CSphFilterSettings & tSettings, ESphAttr eHotType )
+{
+	switch ( eHotType )
+	{
+	case SPH_ATTR_STRING:
+		return tSettings.m_eType==SPH_FILTER_STRING || tSettings.m_eType==SPH_FILTER_STRING_LIST;
+
+	case SPH_ATTR_FLOAT:
+		// JSON value lists and integer ranges compare truncated values, float columns do not
+		return tSettings.m_eType==SPH_FILTER_FLOATRANGE;
+
+	default:
+		return tSettings.m_eType==SPH_FILTER_VALUES || tSettings.m_eType==SPH_FILTER_RANGE;
+	}
+}
+
+
 static ISphFilter * CreateFilter ( const CSphFilterSettings & tSettings, const CSphString & sAttrName, const ISphSchema & tSchema, const DWORD * pMvaPool, const BYTE * pStrings,
-	CSphString & sError, CSphString & sWarning, bool bHaving, ESphCollation eCollation, bool bArenaProhibit )
+	CSphString & sError, CSphString & sWarning, bool bHaving, ESphCollation eCollation, bool bArenaProhibit, bool bHotPaths=true )
 {
 	ISphFilter * pFilter = nullptr;
 	const CSphColumnInfo * pAttr = nullptr;
@@ -1554,7 +1637,30 @@ static ISphFilter * CreateFilter ( const CSphFilterSettings & tSettings, const C
 
 	if ( !pFilter )
 	{
-		const int iAttr = ( tSettings.m_eType!=SPH_FILTER_EXPRESSION ? tSchema.GetAttrIndex ( sAttrName.cstr() ) : -1 );
+		int iAttr = ( tSettings.m_eType!=SPH_FILTER_EXPRESSION ? tSchema.GetAttrIndex ( sAttrName.cstr() ) : -1 );
+
+		// json.key filters might be served by a hot JSON path attribute
+		if ( iAttr<0 && tSettings.m_eType!=SPH_FILTER_EXPRESSION && !bHaving && bHotPaths )
+		{
+			int iHot = sphJsonHotAttrIndex ( tSchema, sAttrName.cstr() );
+			int iMask = sphJsonHotMaskIndex ( tSchema );
+			if ( iHot>=0 && iMask>=0 && IsHotFilterCompatible ( tSettings, tSchema.GetAttr(iHot).m_eAttrType ) )
+			{
+				ISphFilter * pHot = CreateFilter ( tSettings, tSchema.GetAttr(iHot).m_sName, tSchema, pMvaPool, pStrings, sError, sWarning, bHaving, eCollation, bArenaProhibit, false );
+				if ( !pHot )
+					return nullptr;
+
+				ISphFilter * pJson = CreateFilter ( tSettings, sAttrName, tSchema, pMvaPool, pStrings, sError, sWarning, bHaving, eCollation, bArenaProhibit, false );
+				if ( !pJson )
+				{
+					SafeDelete ( pHot );
+					return nullptr;
+				}
+
+				return new Filter_JsonHot_c ( pHot, pJson, tSchema.GetAttr(iMask).m_tLocator, sphJsonHotMaskBit ( tSchema, iHot ) );
+			}
+		}
+
 		if ( iAttr<0 || tSettings.m_eType==SPH_FILTER_EXPRESSION )
 		{
 			// try expression
@@ -298,6 +298,9 @@ public:
 
 
 /// file reader with read buffering and int decoder
+/// once the query of the current thread is stopped (see sphQueryStopped()), reads past the buffer return zeroes
+/// without touching the file, and without raising the error flag, as the reader might be reused after the query;
+/// zero ends doclists and hitlists, so these just end early. readers used outside of queries are never affected
 class CSphReader
 {
 public:
@@ -313,6 +316,7 @@ public:
 	void		SetFile ( const CSphAutofile & tFile );
 	void		Reset ();
 	void		SeekTo ( SphOffset_t iPos, int iSizeHint );
+	void		SetExternalBuffer ( const BYTE * pData, int iLen, SphOffset_t iPos ); ///< serve file range [iPos,iPos+iLen) from external memory; anything beyond is read from file as usual
 
 	void		SkipBytes ( int iCount );
 	SphOffset_t	GetPos () const { return m_iPos+m_iBuffPos; }
@@ -359,8 +363,12 @@ protected:
 	CSphString	m_sError;
 	CSphString	m_sFilename;
 
+	BYTE *		m_pSavedBuff;		///< own buffer, parked while reading from external one
+	bool		m_bBufExternal;
+
 protected:
 	virtual void		UpdateCache ();
+	void				RestoreBuffer ();
 };
 
 
@@ -444,6 +452,8 @@ enum QueryDebug_e
 class CSphQueryContext : public ISphNoncopyable
 {
 public:
+	static const int			CALC_BLOCK_SIZE = 256;			///< how many matches to evaluate at once in block mode
+
 	// searching-only, per-query
 	const CSphQuery &			m_tQuery;
 
@@ -469,6 +479,8 @@ public:
 	CSphVector<CalcItem_t>		m_dCalcFilter;			///< items to compute for filtering
 	CSphVector<CalcItem_t>		m_dCalcSort;			///< items to compute for sorting/grouping
 	CSphVector<CalcItem_t>		m_dCalcFinal;			///< items to compute when finalizing result set
+	bool						m_bCalcSortBlock = false;		///< whether sorting items should be computed in blocks of matches
+	bool						m_bCalcFinalBlock = false;		///< whether final items should be computed in blocks of matches
 
 	const CSphVector<CSphAttrOverride> *	m_pOverrides = nullptr;	///< overridden attribute values
 	CSphVector<CSphAttrLocator>				m_dOverrideIn;
@@ -491,7 +503,9 @@ public:
 
 	void						CalcFilter ( CSphMatch & tMatch ) const;
 	void						CalcSort ( CSphMatch & tMatch ) const;
+	void						CalcSort ( CSphMatch * const * ppMatches, int iCount ) const;	///< same, for a block of matches
 	void						CalcFinal ( CSphMatch & tMatch ) const;
+	void						CalcFinal ( CSphMatch * const * ppMatches, int iCount ) const;	///< same, for a block of matches
 
 	void						FreeDataFilter ( CSphMatch & tMatch ) const;
 	void						FreeDataSort ( CSphMatch & tMatch ) const;
@@ -1776,6 +1790,67 @@ void			SaveFieldFilterSettings ( CSphWriter & tWriter, const ISphFieldFilter * p
 
 bool			AddFieldLens ( CSphSchema & tSchema, bool bDynamic, CSphString & sError );
 
+/// hot JSON paths (json_hot_attr_xxx directives) are materialized into hidden typed attributes
+/// named "@json.<column>.<key>[.<key>...]", so that filters, sorting and grouping can use them as regular attributes
+/// a hidden "@json.@exact" bitmask tells which of them hold the exact JSON value in a given row
+bool			sphJsonHotAttrName ( const char * sPath, CSphString & sName );
+int				sphJsonHotAttrIndex ( const ISphSchema & tSchema, const char * sPath );
+int				sphJsonHotMaskIndex ( const ISphSchema & tSchema );
+int				sphJsonHotMaskBit ( const ISphSchema & tSchema, int iHot );
+bool			sphIsJsonHotAttr ( const CSphColumnInfo & tCol );
+const char *	sphJsonHotAttrPath ( const CSphColumnInfo & tCol );
+const char *	sphJsonHotTypeName ( ESphAttr eType );
+bool			AddJsonHotAttrs ( CSphSchema & tSchema, const CSphVector<CSphColumnInfo> & dPaths, bool bDynamic, CSphString & sError );
+
+/// extracts hot JSON path values from SphinxBSON blobs
+class JsonHotAttrs_c
+{
+public:
+	struct Attr_t
+	{
+		int					m_iAttr = -1;		///< hidden attribute index
+		int					m_iJson = -1;		///< source JSON attribute index
+		ESphAttr			m_eType = SPH_ATTR_NONE;
+		CSphAttrLocator		m_tLocator;
+		CSphVector<JsonKey_t>	m_dKeys;
+
+		uint64_t			m_uBit = 0;			///< bit in the exact values mask
+
+		SphAttr_t			m_uValue = 0;		///< last extracted value (numeric types)
+		bool				m_bExact = false;	///< whether the last extracted value is the JSON value as is
+		const BYTE *		m_pStr = nullptr;	///< last extracted value (strings; points into the blob)
+		int					m_iStrLen = 0;
+	};
+
+	void				Setup ( const ISphSchema & tSchema );
+	bool				IsEmpty () const			{ return m_dAttrs.GetLength()==0; }
+	int					GetLength () const			{ return m_dAttrs.GetLength(); }
+	const Attr_t &		operator [] ( int i ) const	{ return m_dAttrs[i]; }
+
+	/// index into hot attrs list by schema attribute index, or -1
+	int					GetHot ( int iAttr ) const	{ return ( iAttr>=0 && iAttr<m_dByAttr.GetLength() ) ? m_dByAttr[iAttr] : -1; }
+
+	/// exact values mask attribute locator
+	const CSphAttrLocator &	GetMaskLocator () const	{ return m_tMaskLocator; }
+
+	/// whether any hot path is sourced from a given JSON attribute
+	bool				HasJson ( int iJsonAttr ) const;
+
+	/// extract the values sourced from a given JSON attribute; pData is the blob (without length), or NULL
+	void				Extract ( int iJsonAttr, const BYTE * pData );
+
+	/// store the numeric values (and the exact values mask) sourced from a given JSON attribute into a row
+	void				StoreNumeric ( int iJsonAttr, CSphRowitem * pRow ) const;
+
+	/// re-extract the numeric values after an in-place JSON update; pStrings is the string pool the row refers to
+	void				RefreshRow ( int iJsonAttr, const CSphAttrLocator & tJsonLoc, const BYTE * pStrings, CSphRowitem * pRow );
+
+private:
+	CSphVector<Attr_t>	m_dAttrs;
+	CSphVector<int>		m_dByAttr;
+	CSphAttrLocator		m_tMaskLocator;
+};
+
 /// Get current thread local index - internal do not use
 ISphRtIndex * sphGetCurrentIndexRT();
 
@@ -1839,7 +1839,7 @@ CSphString sphJsonToString ( const cJSON * pJson )
 }
 
 
-CSphString sphEncodeResultJson ( const AggrResult_t & tRes, const CSphQuery & tQuery, CSphQueryProfile * pProfile, bool bAttrsHighlight )
+void sphEncodeResultJson ( const AggrResult_t & tRes, const CSphQuery & tQuery, CSphQueryProfile * pProfile, bool bAttrsHighlight, StringBuilder_c & tOut, EncodedResultSink_i * pSink )
 {
 	CJsonScopedPtr_c pJsonRoot ( cJSON_CreateObject() );
 	cJSON * pRoot = pJsonRoot.Ptr();
@@ -1851,7 +1851,8 @@ CSphString sphEncodeResultJson ( const AggrResult_t & tRes, const CSphQuery & tQ
 		cJSON_AddItemToObject ( pRoot, "error", pError );
 		cJSON_AddStringToObject ( pError, "type", "Error" );
 		cJSON_AddStringToObject ( pError, "reason", tRes.m_sError.cstr() );
-		return sphJsonToString ( pRoot );
+		tOut += sphJsonToString ( pRoot ).cstr();
+		return;
 	}
 
 	cJSON_AddNumberToObject ( pRoot, "took", tRes.m_iQueryTime );
@@ -1871,6 +1872,12 @@ CSphString sphEncodeResultJson ( const AggrResult_t & tRes, const CSphQuery & tQ
 	cJSON * pHits = cJSON_CreateArray();
 	cJSON_AddItemToObject ( pHitMeta, "hits", pHits );
 
+	// matches are printed (and flushed to the sink) one by one, so the root goes with an empty hits array
+	// and we just cut its tail at the array start; "hits" is the last member, so it ends with "[]}}"
+	CSphString sHead = sphJsonToString ( pRoot );
+	assert ( sHead.Ends ( "[]}}" ) );
+	tOut.Appendf ( "%.*s", sHead.Length()-3, sHead.cstr() );
+
 	const ISphSchema & tSchema = tRes.m_tSchema;
 	CSphVector<BYTE> dTmp;
 	int iAttrsCount = sphSendGetAttrCount ( tSchema );
@@ -1893,8 +1900,8 @@ CSphString sphEncodeResultJson ( const AggrResult_t & tRes, const CSphQuery & tQ
 	{
 		const CSphMatch & tMatch = tRes.m_dMatches[iMatch];
 
-		cJSON * pHit = cJSON_CreateObject();
-		cJSON_AddItemToArray ( pHits, pHit );
+		CJsonScopedPtr_c pJsonHit ( cJSON_CreateObject() );
+		cJSON * pHit = pJsonHit.Ptr();
 		CSphString sTmp;
 		sTmp.SetSprintf ( DOCID_FMT, tMatch.m_uDocID );
 		cJSON_AddStringToObject ( pHit, "_id", sTmp.cstr() );
@@ -1934,10 +1941,21 @@ CSphString sphEncodeResultJson ( const AggrResult_t & tRes, const CSphQuery & tQ
 				UnpackSnippets ( tMatch, tCol.m_tLocator, pSnippets );
 			}
 		}
+
+		if ( iMatch!=tRes.m_iOffset )
+			tOut += ",";
+		tOut += sphJsonToString ( pHit ).cstr();
+		if ( pSink )
+			pSink->Flush ( tOut );
 	}
+	tOut += "]}";
 
 	if ( pProfile )
 	{
+		// same trick as with the head; profile goes to a separate object, which is then unwrapped
+		CJsonScopedPtr_c pJsonProfile ( cJSON_CreateObject() );
+		cJSON * pProfileRoot = pJsonProfile.Ptr();
+
 		cJSON * pProfileResult = pProfile->LeakResultAsJson();
 		// FIXME: result can be empty if we run a fullscan
 		if ( pProfileResult )
@@ -1946,12 +1964,15 @@ CSphString sphEncodeResultJson ( const AggrResult_t & tRes, const CSphQuery & tQ
 			assert ( pProfileMeta );
 			assert ( cJSON_IsObject ( pProfileResult ) );
 			cJSON_AddItemToObject ( pProfileMeta, "query", pProfileResult );
-			cJSON_AddItemToObject ( pRoot, "profile", pProfileMeta );
+			cJSON_AddItemToObject ( pProfileRoot, "profile", pProfileMeta );
 		} else
-			cJSON_AddNullToObject ( pRoot, "profile" );
+			cJSON_AddNullToObject ( pProfileRoot, "profile" );
+
+		CSphString sProfile = sphJsonToString ( pProfileRoot );
+		tOut.Appendf ( ",%.*s", sProfile.Length()-2, sProfile.cstr()+1 );
 	}
 
-	return sphJsonToString ( pRoot );
+	tOut += "}";
 }
 
 
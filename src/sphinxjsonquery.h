@@ -23,6 +23,14 @@ struct cJSON;
 struct XQNode_t;
 struct SqlStmt_t;
 
+/// receives an encoded result piece by piece, so that big results could be sent while still being encoded
+class EncodedResultSink_i
+{
+public:
+	virtual			~EncodedResultSink_i () {}
+	virtual void	Flush ( StringBuilder_c & tOut ) = 0;	///< may take (and clear) everything encoded so far
+};
+
 QueryParser_i *	sphCreateJsonQueryParser();
 bool			sphParseJsonQuery ( const char * szQuery, CSphQuery & tQuery, bool & bProfile, bool & bAttrsHighlight, CSphString & sError, CSphString & sWarning );
 bool			sphParseJsonInsert ( const char * szInsert, SqlStmt_t & tStmt, SphDocID_t & tDocId, bool bReplace, CSphString & sError );
@@ -31,7 +39,7 @@ bool			sphParseJsonDelete ( const char * szDelete, SqlStmt_t & tStmt, SphDocID_t
 bool			sphParseJsonStatement ( const char * szStmt, SqlStmt_t & tStmt, CSphString & sStmt, CSphString & sQuery, SphDocID_t & tDocId, CSphString & sError );
 CSphString		sphJsonToString ( const cJSON * pJson );
 
-CSphString		sphEncodeResultJson ( const AggrResult_t & tRes, const CSphQuery & tQuery, CSphQueryProfile * pProfile, bool bAttrsHighlight );
+void			sphEncodeResultJson ( const AggrResult_t & tRes, const CSphQuery & tQuery, CSphQueryProfile * pProfile, bool bAttrsHighlight, StringBuilder_c & tOut, EncodedResultSink_i * pSink );
 cJSON *			sphEncodeInsertResultJson ( const char * szIndex, bool bReplace, SphDocID_t tDocId );
 cJSON *			sphEncodeUpdateResultJson ( const char * szIndex, SphDocID_t tDocId, int iAffected );
 cJSON *			sphEncodeDeleteResultJson ( const char * szIndex, SphDocID_t tDocId, int iAffected );
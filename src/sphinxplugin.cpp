@@ -38,13 +38,15 @@ class PluginLib_c : public ISphRefcountedMT
 protected:
 	CSphString			m_sName;
 	void *				m_pHandle;				///< handle from dlopen()
+	int					m_iVersion;				///< what <libname>_ver() returned
 
 public:
 	int					m_iHashedPlugins;		///< how many active g_hPlugins entries reference this handle
 
-	explicit			PluginLib_c ( void * pHandle, const char * sName );
+	explicit			PluginLib_c ( void * pHandle, const char * sName, int iVersion );
 	const CSphString &	GetName() const { return m_sName; }
 	void *				GetHandle() const { return m_pHandle; }
+	int					GetVersion() const { return m_iVersion; }
 
 protected:
 						~PluginLib_c() final;
@@ -131,10 +133,11 @@ const char * dlerror()
 
 //////////////////////////////////////////////////////////////////////////
 
-PluginLib_c::PluginLib_c ( void * pHandle, const char * sName )
+PluginLib_c::PluginLib_c ( void * pHandle, const char * sName, int iVersion )
 {
 	assert ( pHandle );
 	m_pHandle = pHandle;
+	m_iVersion = iVersion;
 	m_iHashedPlugins = 0;
 	m_sName = sName;
 	m_sName.ToLower();
@@ -209,19 +212,30 @@ struct SymbolDesc_t
 	int				m_iOffsetOf;	///< pointer member location in the descriptor structure
 	const char *	m_sPostfix;		///< symbol name postfix
 	bool			m_bRequired;	///< whether this symbol must be present
+	int				m_iMinVersion;	///< oldest library version that might export this symbol (0 means any)
 };
 
 #if HAVE_DLOPEN
-static bool PluginLoadSymbols ( void * pDesc, const SymbolDesc_t * pSymbol, void * pHandle, const char * sName, CSphString & sError )
+static bool PluginLoadSymbols ( void * pDesc, const SymbolDesc_t * pSymbol, const PluginLib_c * pLib, const char * sName, CSphString & sError )
 {
 //	sError = "no dlopen(), no plugins";
 //	return false;
 	CSphString s;
 	while ( pSymbol->m_iOffsetOf>=0 )
 	{
-		s.SetSprintf ( pSymbol->m_sPostfix[0] ? "%s_%s" : "%s%s", sName, pSymbol->m_sPostfix );
 		auto ** ppFunc = (void**)((BYTE*)pDesc + pSymbol->m_iOffsetOf);
-		*ppFunc = dlsym ( pHandle, s.cstr() );
+
+		// older libraries might export a same-named symbol that means something else
+		if ( pLib->GetVersion()<pSymbol->m_iMinVersion )
+		{
+			assert ( !pSymbol->m_bRequired );
+			*ppFunc = nullptr;
+			pSymbol++;
+			continue;
+		}
+
+		s.SetSprintf ( pSymbol->m_sPostfix[0] ? "%s_%s" : "%s%s", sName, pSymbol->m_sPostfix );
+		*ppFunc = dlsym ( pLib->GetHandle(), s.cstr() );
 		if ( !*ppFunc && pSymbol->m_bRequired )
 		{
 			sError.SetSprintf ( "symbol %s() not found", s.cstr() );
@@ -248,6 +262,7 @@ static SymbolDesc_t g_dSymbolsUDF[] =
 	{ static_cast<int>( offsetof(PluginUDF_c, m_fnInit)),		"init",		false },
 	{ static_cast<int>( offsetof(PluginUDF_c, m_fnFunc)),		"",			true },
 	{ static_cast<int>( offsetof(PluginUDF_c, m_fnDeinit)),	"deinit",	false },
+	{ static_cast<int>( offsetof(PluginUDF_c, m_fnBatch)),		"batch",	false, SPH_UDF_BATCH_VERSION },
 	{ -1, nullptr, false }
 };
 
@@ -338,13 +353,14 @@ static PluginLib_c * LoadPluginLibrary ( const char * sLibName, CSphString & sEr
 		return nullptr;
 	}
 
-	if ( fnVer() < SPH_UDF_VERSION )
+	int iVersion = fnVer();
+	if ( iVersion < SPH_UDF_MIN_VERSION )
 	{
 		sError.SetSprintf ( "library '%s' was compiled using an older version of sphinxudf.h; it needs to be recompiled", sLibName );
 		dlclose ( pHandle );
 		return nullptr;
 	}
-	return new PluginLib_c ( pHandle, sLibName );
+	return new PluginLib_c ( pHandle, sLibName, iVersion );
 }
 #endif
 
@@ -428,7 +444,7 @@ bool sphPluginCreate ( const char * szLib, PluginType_e eType, const char * sNam
 	// or in other words, transfer the refcount to newly created plugin instance (it does its own addref)
 	pLib->Release();
 
-	if ( !PluginLoadSymbols ( pPlugin, pSym, pLib->GetHandle(), k.m_sName.cstr(), sError ) )
+	if ( !PluginLoadSymbols ( pPlugin, pSym, pLib, k.m_sName.cstr(), sError ) )
 	{
 		sError.SetSprintf ( "%s in %s", sError.cstr(), sLib.cstr() );
 		pPlugin->Release();
@@ -539,7 +555,7 @@ bool sphPluginReload ( const char * sName, CSphString & sError )
 				return false;
 		}
 
-		if ( !PluginLoadSymbols ( pDesc, pSym, pNewLib->GetHandle(), dKeys[i].m_sName.cstr(), sError ) )
+		if ( !PluginLoadSymbols ( pDesc, pSym, pNewLib, dKeys[i].m_sName.cstr(), sError ) )
 		{
 			pDesc->Release();
 			break;
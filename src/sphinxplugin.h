@@ -21,6 +21,12 @@ extern "C"
 
 //////////////////////////////////////////////////////////////////////////
 
+/// oldest udf version we can still load (v.10 only added optional batch calls)
+#define SPH_UDF_MIN_VERSION 9
+
+/// oldest udf version that might have <name>_batch() functions
+#define SPH_UDF_BATCH_VERSION 10
+
 // call prototypes for all the known external plugin symbol types
 
 typedef int				(*PluginVer_fn)		();
@@ -28,6 +34,7 @@ typedef void			(*PluginReinit_fn)	();
 
 typedef int				(*UdfInit_fn)		( SPH_UDF_INIT * init, SPH_UDF_ARGS * args, char * error );
 typedef void			(*UdfDeinit_fn)		( SPH_UDF_INIT * init );
+typedef void			(*UdfBatch_fn)		( SPH_UDF_INIT * init, SPH_UDF_BATCH_ARGS * args, void * results, char * error );
 
 typedef int				(*RankerInit_fn)		( void ** userdata, SPH_RANKER_INIT * ranker, char * error );
 typedef void			(*RankerUpdate_fn)		( void * userdata, SPH_RANKER_HIT * hit );
@@ -91,6 +98,7 @@ public:
 	UdfInit_fn			m_fnInit = nullptr;		///< per-query init function, mandatory
 	UdfDeinit_fn		m_fnDeinit = nullptr;	///< per-query deinit function, optional
 	void *				m_fnFunc = nullptr;		///< per-row worker function, mandatory
+	void *				m_fnBatch = nullptr;	///< per-block worker function, optional
 
 	explicit PluginUDF_c ( PluginLib_c * pLib, ESphAttr eRetType )
 		: PluginDesc_c ( pLib )
@@ -24,6 +24,19 @@
 
 #define QCACHE_NO_ENTRY			(NULL)
 #define QCACHE_DEAD_ENTRY		((QcacheEntry_c*)-1)
+#define FLIGHT_POLL_MSEC		10		// how often waiting followers check for max_query_time and KILL
+
+/// in-flight query
+/// the first query to miss the cache leads, identical concurrent ones wait and reuse its result
+struct QcacheFlight_t
+{
+	uint64_t				m_Key = 0;
+	int64_t					m_iIndexId = -1;
+	CSphVector<uint64_t>	m_dFilters;				///< hashes of the leader filters
+	QcacheEntry_c *			m_pResult = nullptr;	///< leader result, or NULL if leader bailed out
+	int						m_iRefs = 1;			///< leader plus waiting followers
+	CSphAutoEvent			m_tDone;
+};
 
 /// query cache
 class Qcache_c : public QcacheStatus_t
@@ -33,6 +46,7 @@ private:
 	CSphVector<QcacheEntry_c*>	m_hData;			///< our little queries hash
 	int							m_iMaxQueries;		///< max load
 	int							m_iMruHead;			///< most recently used entry
+	CSphVector<QcacheFlight_t*>	m_dFlights;			///< queries in flight, protected by the hash lock
 
 public:
 								Qcache_c();
@@ -42,6 +56,8 @@ public:
 	void						Add ( const CSphQuery & q, QcacheEntry_c * pResult, const ISphSchema & tSorterSchema );
 	QcacheEntry_c *				Find ( int64_t iIndexId, const CSphQuery & q, const ISphSchema & tSorterSchema );
 	void						DeleteIndex ( int64_t iIndexId );
+	QcacheEntry_c *				JoinFlight ( int64_t iIndexId, const CSphQuery & q, const ISphSchema & tSorterSchema, int64_t iMaxTimer, QcacheFlight_t ** ppFlight );
+	void						LeaveFlight ( QcacheFlight_t * pFlight, QcacheEntry_c * pResult );
 
 private:
 	uint64_t					GetKey ( int64_t iIndexId, const CSphQuery & q );
@@ -50,6 +66,7 @@ private:
 	void						MruToHead ( int iRes );
 	void						DeleteEntry ( int iEntry );
 	bool						CanCacheQuery ( const CSphQuery & q ) const;
+	void						ReleaseFlight ( QcacheFlight_t * pFlight );
 };
 
 /// ranker that servers cached results
@@ -260,6 +277,8 @@ Qcache_c::Qcache_c()
 	m_iCachedQueries = 0;
 	m_iUsedBytes = 0;
 	m_iHits = 0;
+	m_iInFlight = 0;
+	m_iCoalesced = 0;
 	m_iMruHead = -1;
 
 	m_hData.Resize ( 256 );
@@ -590,6 +609,128 @@ void Qcache_c::DeleteIndex ( int64_t iIndexId )
 	m_tLock.Unlock();
 }
 
+
+static bool FiltersSubset ( const CSphVector<uint64_t> & dSubset, const CSphVector<uint64_t> & dFilters )
+{
+	ARRAY_FOREACH ( i, dSubset )
+		if ( !dFilters.BinarySearch ( dSubset[i] ) )
+			return false;
+	return true;
+}
+
+
+QcacheEntry_c * Qcache_c::JoinFlight ( int64_t iIndexId, const CSphQuery & q, const ISphSchema & tSorterSchema, int64_t iMaxTimer, QcacheFlight_t ** ppFlight )
+{
+	*ppFlight = NULL;
+	if ( m_iMaxBytes<=0 || !CanCacheQuery(q) )
+		return NULL;
+
+	CSphVector<uint64_t> dFilters;
+	if ( !CalcFilterHashes ( dFilters, q, tSorterSchema ) )
+		return NULL;
+
+	uint64_t k = GetKey ( iIndexId, q );
+
+	m_tLock.Lock();
+
+	// same rules as for cached entries; leader filters must be a subset of ours
+	QcacheFlight_t * pFlight = NULL;
+	ARRAY_FOREACH ( i, m_dFlights )
+	{
+		QcacheFlight_t * f = m_dFlights[i];
+		if ( f->m_Key==k && f->m_iIndexId==iIndexId && FiltersSubset ( f->m_dFilters, dFilters ) )
+		{
+			pFlight = f;
+			break;
+		}
+	}
+
+	// nobody computes this yet, so we lead
+	if ( !pFlight )
+	{
+		pFlight = new QcacheFlight_t;
+		pFlight->m_Key = k;
+		pFlight->m_iIndexId = iIndexId;
+		pFlight->m_dFilters.SwapData ( dFilters );
+		m_dFlights.Add ( pFlight );
+		m_iInFlight = m_dFlights.GetLength();
+		m_tLock.Unlock();
+
+		*ppFlight = pFlight;
+		return NULL;
+	}
+
+	pFlight->m_iRefs++;
+	m_tLock.Unlock();
+
+	// wait in short slices, so that max_query_time and KILL still work while we wait
+	// on either, give up and let the caller run (and stop) the query on its own
+	bool bDone = false;
+	while ( !bDone )
+	{
+		int iWaitMsec = FLIGHT_POLL_MSEC;
+		if ( iMaxTimer )
+		{
+			int64_t iLeft = iMaxTimer - sphMicroTimer();
+			if ( iLeft<=0 )
+				break;
+			iWaitMsec = (int)Min ( (int64_t)iWaitMsec, ( iLeft+999 )/1000 );
+		}
+
+		bDone = pFlight->m_tDone.WaitEvent ( iWaitMsec );
+		if ( !bDone && sphQueryStopped() )
+			break;
+	}
+
+	// wake up is passed along from one follower to another
+	if ( bDone )
+		pFlight->m_tDone.SetEvent();
+
+	m_tLock.Lock();
+	QcacheEntry_c * pResult = bDone ? pFlight->m_pResult : NULL;
+	if ( pResult )
+	{
+		pResult->AddRef();
+		m_iCoalesced++;
+	}
+	ReleaseFlight ( pFlight );
+	m_tLock.Unlock();
+
+	// NULL means the leader failed, or we gave up waiting; caller has to compute the query on its own
+	return pResult;
+}
+
+
+void Qcache_c::LeaveFlight ( QcacheFlight_t * pFlight, QcacheEntry_c * pResult )
+{
+	assert ( pFlight );
+	m_tLock.Lock();
+
+	// no more followers from now on; queries arriving later go to the cache
+	m_dFlights.RemoveValue ( pFlight );
+	m_iInFlight = m_dFlights.GetLength();
+
+	if ( pResult )
+		pResult->AddRef();
+	pFlight->m_pResult = pResult;
+
+	if ( pFlight->m_iRefs>1 )
+		pFlight->m_tDone.SetEvent();
+
+	ReleaseFlight ( pFlight );
+	m_tLock.Unlock();
+}
+
+
+void Qcache_c::ReleaseFlight ( QcacheFlight_t * pFlight )
+{
+	if ( --pFlight->m_iRefs )
+		return;
+
+	SafeRelease ( pFlight->m_pResult );
+	SafeDelete ( pFlight );
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 QcacheRanker_c::QcacheRanker_c ( QcacheEntry_c * pEntry, const ISphQwordSetup & tSetup )
@@ -710,3 +851,13 @@ void QcacheDeleteIndex ( int64_t iIndexId )
 {
 	g_Qcache.DeleteIndex ( iIndexId );
 }
+
+QcacheEntry_c * QcacheJoinFlight ( int64_t iIndexId, const CSphQuery & q, const ISphSchema & tSorterSchema, int64_t iMaxTimer, QcacheFlight_t ** ppFlight )
+{
+	return g_Qcache.JoinFlight ( iIndexId, q, tSorterSchema, iMaxTimer, ppFlight );
+}
+
+void QcacheLeaveFlight ( QcacheFlight_t * pFlight, QcacheEntry_c * pResult )
+{
+	g_Qcache.LeaveFlight ( pFlight, pResult );
+}
@@ -75,8 +75,13 @@ struct QcacheStatus_t
 	int			m_iCachedQueries;	///< cached queries counts
 	int64_t		m_iUsedBytes;		///< used RAM bytes
 	int64_t		m_iHits;			///< cache hits
+	int			m_iInFlight;		///< queries currently being computed that others may wait on
+	int64_t		m_iCoalesced;		///< queries served from a concurrent identical query result
 };
 
+/// in-flight query that identical concurrent queries wait on (opaque)
+struct QcacheFlight_t;
+
 
 void					QcacheAdd ( const CSphQuery & q, QcacheEntry_c * pResult, const ISphSchema & tSorterSchema );
 QcacheEntry_c *			QcacheFind ( int64_t iIndexId, const CSphQuery & q, const ISphSchema & tSorterSchema );
@@ -84,5 +89,7 @@ ISphRanker *			QcacheRanker ( QcacheEntry_c * pEntry, const ISphQwordSetup & tSe
 const QcacheStatus_t &	QcacheGetStatus();
 void					QcacheSetup ( int64_t iMaxBytes, int iThreshMsec, int iTtlSec );
 void					QcacheDeleteIndex ( int64_t iIndexId );
+QcacheEntry_c *			QcacheJoinFlight ( int64_t iIndexId, const CSphQuery & q, const ISphSchema & tSorterSchema, int64_t iMaxTimer, QcacheFlight_t ** ppFlight );
+void					QcacheLeaveFlight ( QcacheFlight_t * pFlight, QcacheEntry_c * pResult );
 
 #endif // _sphinxqcache_
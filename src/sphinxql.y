@@ -82,6 +82,7 @@
 %token	TOK_IS
 %token	TOK_ISOLATION
 %token	TOK_JSON
+%token	TOK_KILL
 %token	TOK_LEVEL
 %token	TOK_LIKE
 %token	TOK_LIMIT
@@ -232,6 +233,7 @@ statement:
 	| flush_logs
 	| sysfilters
 	| debug_clause
+	| kill_query
 	;
 
 //////////////////////////////////////////////////////////////////////////
@@ -254,7 +256,7 @@ ident_set:
 	| TOK_DESC | TOK_DESCRIBE  | TOK_DISTINCT  | TOK_DOUBLE | TOK_DROP
 	| TOK_FLOAT | TOK_FLUSH | TOK_FOR| TOK_FUNCTION | TOK_GLOBAL | TOK_GROUP
 	| TOK_GROUP_CONCAT | TOK_GROUPBY | TOK_HAVING | TOK_HOSTNAMES | TOK_INDEX | TOK_INDEXOF | TOK_INSERT
-	| TOK_INT | TOK_INTEGER | TOK_INTO | TOK_ISOLATION | TOK_JSON | TOK_LEVEL
+	| TOK_INT | TOK_INTEGER | TOK_INTO | TOK_ISOLATION | TOK_JSON | TOK_KILL | TOK_LEVEL
 	| TOK_LIKE | TOK_MATCH | TOK_MAX | TOK_META | TOK_MIN | TOK_MULTI
 	| TOK_MULTI64 | TOK_OPTIMIZE | TOK_OPTION | TOK_PLAN | TOK_PLUGIN
 	| TOK_PLUGINS | TOK_PROFILE | TOK_RAMCHUNK | TOK_RAND | TOK_READ
@@ -1816,6 +1818,30 @@ sysfilters:
 		}
 	;
 
+kill_query:
+	TOK_KILL TOK_CONST_INT
+		{
+			SqlStmt_t & tStmt = *pParser->m_pStmt;
+			tStmt.m_eStmt = STMT_KILL;
+			tStmt.m_iIntParam = (int)$2.m_iValue;
+		}
+	| TOK_KILL ident TOK_CONST_INT
+		{
+			// only queries get killed, so KILL QUERY is the same as plain KILL
+			CSphString sWhat;
+			pParser->ToString ( sWhat, $2 ).ToLower();
+			if ( sWhat!="query" )
+			{
+				yyerror ( pParser, "only KILL [QUERY] <thread id> is supported" );
+				YYERROR;
+			}
+
+			SqlStmt_t & tStmt = *pParser->m_pStmt;
+			tStmt.m_eStmt = STMT_KILL;
+			tStmt.m_iIntParam = (int)$3.m_iValue;
+		}
+	;
+
 debug_clause:
 	TOK_DEBUG opt_par
 		{
@@ -35,10 +35,12 @@
 
 #define BINLOG_WRITE_BUFFER		256*1024
 #define BINLOG_AUTO_FLUSH		1000000
+#define BINLOG_REPLAY_BATCH		64*1024*1024
 
 #define RTDICT_CHECKPOINT_V3			1024
 #define RTDICT_CHECKPOINT_V5			48
 #define SPH_RT_DOUBLE_BUFFER_PERCENT	10
+#define SPH_RT_FORCE_DUMP_SEGMENT_PERCENT	50
 
 #define WORDID_MAX				U64C(0xffffffffffffffff)
 
@@ -379,6 +381,9 @@ public:
 	CSphTightVector<BYTE>			m_dWords;
 	CSphVector<RtWordCheckpoint_t>	m_dWordCheckpoints;
 	CSphTightVector<uint64_t>		m_dInfixFilterCP;
+	CSphTightVector<DWORD>			m_dInfixNgrams;			///< sorted hashes of all the infix ngrams in dictionary
+	CSphTightVector<DWORD>			m_dInfixNgramOffsets;	///< per-ngram start of its postings in m_dInfixNgramWords, plus terminator
+	CSphTightVector<DWORD>			m_dInfixNgramWords;		///< ordinals of the dictionary words that contain given ngram, ascending
 	CSphTightVector<BYTE>		m_dDocs;
 	CSphTightVector<BYTE>		m_dHits;
 
@@ -408,16 +413,45 @@ public:
 
 	int64_t GetUsedRam () const
 	{
-		// FIXME! gonna break on vectors over 2GB
+		// all the storage that is actually allocated, as segment vectors get shrunk once segment is built
 		return
 			( (int64_t)m_dWords.GetLimit() )*sizeof(m_dWords[0]) +
+			( (int64_t)m_dWordCheckpoints.GetLimit() )*sizeof(m_dWordCheckpoints[0]) +
 			( (int64_t)m_dDocs.GetLimit() )*sizeof(m_dDocs[0]) +
 			( (int64_t)m_dHits.GetLimit() )*sizeof(m_dHits[0]) +
 			( (int64_t)m_dStrings.GetLimit() )*sizeof(m_dStrings[0]) +
 			( (int64_t)m_dMvas.GetLimit() )*sizeof(m_dMvas[0]) +
 			( (int64_t)m_dKeywordCheckpoints.GetLimit() )*sizeof(m_dKeywordCheckpoints[0])+
 			( (int64_t)m_dRows.GetLimit() )*sizeof(m_dRows[0]) +
-			( (int64_t)m_dInfixFilterCP.GetLength()*sizeof(m_dInfixFilterCP[0]) );
+			( (int64_t)m_dInfixFilterCP.GetLimit() )*sizeof(m_dInfixFilterCP[0]) +
+			( (int64_t)m_dInfixNgrams.GetLimit() )*sizeof(m_dInfixNgrams[0]) +
+			( (int64_t)m_dInfixNgramOffsets.GetLimit() )*sizeof(m_dInfixNgramOffsets[0]) +
+			( (int64_t)m_dInfixNgramWords.GetLimit() )*sizeof(m_dInfixNgramWords[0]) +
+			( (int64_t)m_pKlist->m_dKilled.GetLength() )*sizeof(SphDocID_t);
+	}
+
+	/// drop growth slack of all the storage vectors; must be called before segment gets published to readers
+	void Shrink ()
+	{
+		m_dWords.Shrink();
+		m_dWordCheckpoints.Shrink();
+		m_dInfixFilterCP.Shrink();
+		m_dInfixNgrams.Shrink();
+		m_dInfixNgramOffsets.Shrink();
+		m_dInfixNgramWords.Shrink();
+		m_dDocs.Shrink();
+		m_dHits.Shrink();
+		m_dRows.Shrink();
+		m_dStrings.Shrink();
+		m_dMvas.Shrink();
+
+		// keyword checkpoints are pointed to by word checkpoints; rebase them
+		const char * pOldBase = (const char *)m_dKeywordCheckpoints.Begin();
+		m_dKeywordCheckpoints.Shrink();
+		const char * pNewBase = (const char *)m_dKeywordCheckpoints.Begin();
+		if ( pOldBase!=pNewBase && m_dKeywordCheckpoints.GetLength() )
+			for ( auto & tCheckpoint : m_dWordCheckpoints )
+				tCheckpoint.m_sWord = pNewBase + ( tCheckpoint.m_sWord - pOldBase );
 	}
 
 	int GetMergeFactor () const
@@ -849,7 +883,11 @@ public:
 private:
 	ISphRtDictWraperRefPtr_c	m_pDictRt;
 	bool						m_bReplace = false;	///< insert or replace mode (affects CleanupDuplicates() behavior)
+	JsonHotAttrs_c				m_tHotAttrs;		///< hot JSON paths extractor for the current index schema
+	const ISphRtIndex *			m_pHotIndex = nullptr;
+	int							m_iHotSchemaAttrs = -1;
 	void				ResetDict ();
+	void				SetupHotAttrs ( const CSphSchema & tSchema );
 public:
 					explicit RtAccum_t ( bool bKeywordDict );
 	void			SetupDict ( const ISphRtIndex * pIndex, CSphDict * pDict, bool bKeywordDict );
@@ -919,6 +957,40 @@ enum Blop_e
 	BLOP_TOTAL
 };
 
+/// binlog txn that was already read and checked during replay, but not applied to its index yet
+struct BinlogReplayTxn_t
+{
+	Blop_e									m_eOp = BLOP_TOTAL;
+	int										m_iIndex = 0;		///< index id within the replayed binlog file
+	int64_t									m_iTID = 0;
+	int64_t									m_iTxnPos = 0;
+
+	CSphScopedPtr<RtSegment_t>				m_pSeg { nullptr };			///< commit only
+	CSphVector<SphDocID_t>					m_dKlist;					///< commit only
+	CSphScopedPtr<CSphAttrUpdate>			m_pUpdate { nullptr };		///< update only
+	CSphScopedPtr<CSphReconfigureSettings>	m_pSettings { nullptr };	///< reconfigure only
+};
+
+/// txns collected from a span of binlog file
+/// txns of the same index are applied in log order, txns of different indexes are applied concurrently
+struct BinlogReplayBatch_t : public ISphNoncopyable
+{
+	CSphVector<BinlogReplayTxn_t *>	m_dTxns;
+	int64_t							m_iStartPos = 0;	///< binlog position where the batch starts
+
+	~BinlogReplayBatch_t ()
+	{
+		Reset();
+	}
+
+	void Reset ()
+	{
+		for ( auto & pTxn : m_dTxns )
+			SafeDelete ( pTxn );
+		m_dTxns.Reset();
+	}
+};
+
 // forward declaration
 class BufferReader_t;
 class RtBinlog_c;
@@ -1016,12 +1088,30 @@ private:
 	bool					m_bDisabled;
 
 	int						m_iRestartSize; // binlog size restart threshold
+	int						m_iReplayThreads = 0; // how many indexes might be replayed concurrently
+
+	CSphString				m_sPrefix; // log and meta file names prefix, 'binlog' or 'binlog.<index>'
+	bool					m_bPerIndex = false; // whether every index writes into its own log stream
+	mutable RwLock_t		m_tIndexLogsLock; // guards per-index streams list
+	SmallStringHash_T<RtBinlog_c *>	m_hIndexLogs; // per-index streams by index name
+	CSphVector<RtBinlog_c *>	m_dIndexLogs; // same streams, in creation order
 
 	// replay stats
 	mutable int				m_iReplayedRows=0;
 
 private:
+	friend struct BinlogStreamReplayJob_t;
+
 	static void				DoAutoFlush ( void * pBinlog );
+	void					AutoFlush ();
+	RtBinlog_c *			GetIndexLog ( const char * sIndexName, bool bCreate );
+	RtBinlog_c *			FindIndexLog ( const char * sIndexName ) const;
+	RtBinlog_c *			CreateIndexLog ( const char * sIndexName ) const;
+	int						ReplayLogs ( const SmallStringHash_T<CSphIndex*> & hIndexes, DWORD uReplayFlags, int iFrom, int iTo );
+	void					LoadIndexLogs ( const SmallStringHash_T<CSphIndex*> & hIndexes, CSphVector<RtBinlog_c *> & dLogs );
+	void					ReplayIndexLogs ( const SmallStringHash_T<CSphIndex*> & hIndexes, DWORD uReplayFlags, const CSphVector<RtBinlog_c *> & dLogs,
+								CSphVector<int> & dReplayed, CSphVector<int> & dLastStates, int64_t tmBefore );
+	int64_t					GetLogStart ( int iBinlog ) const;
 	int 					GetWriteIndexID ( const char * sName, int64_t iTID, int64_t tmNow );
 	void					LoadMeta ();
 	void					SaveMeta ();
@@ -1032,11 +1122,12 @@ private:
 	void					OpenNewLog ( int iLastState=0 );
 
 	int						ReplayBinlog ( const SmallStringHash_T<CSphIndex*> & hIndexes, DWORD uReplayFlags, int iBinlog );
-	bool					ReplayCommit ( int iBinlog, DWORD uReplayFlags, BinlogReader_c & tReader ) const;
-	bool					ReplayUpdateAttributes ( int iBinlog, BinlogReader_c & tReader ) const;
+	bool					ReplayCommit ( int iBinlog, DWORD uReplayFlags, BinlogReader_c & tReader, BinlogReplayBatch_t & tBatch ) const;
+	bool					ReplayUpdateAttributes ( int iBinlog, BinlogReader_c & tReader, BinlogReplayBatch_t & tBatch ) const;
 	bool					ReplayIndexAdd ( int iBinlog, const SmallStringHash_T<CSphIndex*> & hIndexes, BinlogReader_c & tReader ) const;
 	bool					ReplayCacheAdd ( int iBinlog, BinlogReader_c & tReader ) const;
-	bool					ReplayReconfigure ( int iBinlog, DWORD uReplayFlags, BinlogReader_c & tReader ) const;
+	bool					ReplayReconfigure ( int iBinlog, DWORD uReplayFlags, BinlogReader_c & tReader, BinlogReplayBatch_t & tBatch ) const;
+	void					ReplayApplyBatch ( int iBinlog, BinlogReplayBatch_t & tBatch ) const;
 };
 
 
@@ -1186,6 +1277,7 @@ private:
 	void						SaveMeta ( int64_t iTID, const CSphFixedVector<int> & dChunkNames );
 	void						SaveDiskHeader ( const char * sFilename, SphDocID_t iMinDocID, int iCheckpoints, SphOffset_t iCheckpointsPosition, DWORD iInfixBlocksOffset, int iInfixCheckpointWordsSize, DWORD uKillListSize, uint64_t uMinMaxSize, const ChunkStats_t & tStats, int64_t iTotalDocuments ) const;
 	void						SaveDiskDataImpl ( const char * sFilename, const SphChunkGuard_t & tGuard, const ChunkStats_t & tStats ) const;
+	SphOffset_t					SaveDiskAttrs ( const char * sFilename, const SphChunkGuard_t & tGuard, int iTotalDocs ) const;
 	void						SaveDiskChunk ( int64_t iTID, const SphChunkGuard_t & tGuard, const ChunkStats_t & tStats, bool bMoveRetired );
 	CSphIndex *					LoadDiskChunk ( const char * sChunk, CSphString & sError ) const;
 	bool						LoadRamChunk ( DWORD uVersion, bool bRebuildInfixes );
@@ -1713,6 +1805,17 @@ void RtAccum_t::Cleanup ( BYTE eWhat )
 	}
 }
 
+void RtAccum_t::SetupHotAttrs ( const CSphSchema & tSchema )
+{
+	// ALTER always changes the attribute count, so that is enough to detect a stale setup
+	if ( m_pHotIndex==m_pIndex && m_iHotSchemaAttrs==tSchema.GetAttrsCount() )
+		return;
+
+	m_tHotAttrs.Setup ( tSchema );
+	m_pHotIndex = m_pIndex;
+	m_iHotSchemaAttrs = tSchema.GetAttrsCount();
+}
+
 void RtAccum_t::AddDocument ( ISphHits * pHits, const CSphMatch & tDoc, bool bReplace, int iRowSize, const char ** ppStr, const CSphVector<DWORD> & dMvas )
 {
 	MEMORY ( MEM_RT_ACCUM );
@@ -1743,21 +1846,42 @@ void RtAccum_t::AddDocument ( ISphHits * pHits, const CSphMatch & tDoc, bool bRe
 	int iMva = 0;
 
 	const CSphSchema & tSchema = m_pIndex->GetInternalSchema();
+	SetupHotAttrs ( tSchema );
+
 	int iAttr = 0;
 	for ( int i=0; i<tSchema.GetAttrsCount(); i++ )
 	{
 		const CSphColumnInfo & tColumn = tSchema.GetAttr(i);
+		int iHot = m_tHotAttrs.GetHot(i);
+		if ( iHot>=0 && tColumn.m_eAttrType!=SPH_ATTR_STRING )
+			continue; // numeric hot paths were already stored along with their JSON column
+
 		if ( tColumn.m_eAttrType==SPH_ATTR_STRING || tColumn.m_eAttrType==SPH_ATTR_JSON )
 		{
-			const char * pStr = ppStr ? ppStr[iAttr++] : nullptr;
+			const char * pStr = nullptr;
 			int iLen = 0;
-			if ( tColumn.m_eAttrType==SPH_ATTR_STRING )
+			if ( iHot>=0 )
 			{
-				iLen = ( pStr ? strlen ( pStr ) : 0 );
-			} else if ( pStr ) // SPH_ATTR_JSON - len: 4bytes + data
+				// hot string paths are not passed by the caller; they point into the source JSON blob
+				pStr = (const char *) m_tHotAttrs[iHot].m_pStr;
+				iLen = m_tHotAttrs[iHot].m_iStrLen;
+			} else
 			{
-				iLen = sphUnpackStr ( (const BYTE *)pStr, nullptr );
-				pStr += 4;
+				pStr = ppStr ? ppStr[iAttr++] : nullptr;
+				if ( tColumn.m_eAttrType==SPH_ATTR_STRING )
+				{
+					iLen = ( pStr ? strlen ( pStr ) : 0 );
+				} else if ( pStr ) // SPH_ATTR_JSON - len: 4bytes + data
+				{
+					iLen = sphUnpackStr ( (const BYTE *)pStr, nullptr );
+					pStr += 4;
+				}
+			}
+
+			if ( tColumn.m_eAttrType==SPH_ATTR_JSON && m_tHotAttrs.HasJson(i) )
+			{
+				m_tHotAttrs.Extract ( i, iLen ? (const BYTE *)pStr : nullptr );
+				m_tHotAttrs.StoreNumeric ( i, pAttrs );
 			}
 
 			if ( pStr && iLen )
@@ -2666,6 +2790,151 @@ static void BuildSegmentInfixes ( RtSegment_t * pSeg, bool bHasMorphology, bool
 }
 
 
+#define INFIX_NGRAM_LEN 3
+#define INFIX_NGRAM_MIN_CHECKPOINTS 32	///< smaller segments are scanned via bloom filters faster than the index gets built
+
+/// collect sorted unique hashes of all the codepoint ngrams of a word; returns their count
+static int GetInfixNgramHashes ( const BYTE * sWord, int iLen, bool bUtf8, DWORD * pHashes )
+{
+	assert ( iLen<=SPH_MAX_KEYWORD_LEN );
+
+	// byte offset for each codepoint
+	int dOffsets [ SPH_MAX_KEYWORD_LEN+1 ];
+	int iCodes = 0;
+	for ( int iOff=0; iOff<iLen; iCodes++ )
+	{
+		dOffsets[iCodes] = iOff;
+		iOff += ( bUtf8 ? Max ( sphUtf8CharBytes ( sWord[iOff] ), 1 ) : 1 );
+	}
+	dOffsets[iCodes] = iLen;
+
+	int iHashes = 0;
+	for ( int i=0; i<=iCodes-INFIX_NGRAM_LEN; i++ )
+	{
+		int iFrom = dOffsets[i];
+		int iTo = Min ( dOffsets[i+INFIX_NGRAM_LEN], iLen );
+		uint64_t uHash64 = sphFNV64 ( sWord+iFrom, iTo-iFrom );
+		pHashes[iHashes++] = (DWORD)( ( uHash64>>32 ) ^ ( (DWORD)uHash64 ) );
+	}
+
+	if ( iHashes>1 )
+	{
+		sphSort ( pHashes, iHashes );
+		iHashes = int ( sphUniq ( pHashes, iHashes ) );
+	}
+	return iHashes;
+}
+
+
+/// build ngram to word ordinals index over segment dictionary, so that infix lookups only decode the words that might match
+static void BuildSegmentInfixNgrams ( RtSegment_t * pSeg, bool bHasMorphology, bool bKeywordDict, int iMinInfixLen, int iWordsCheckpoint, bool bUtf8 )
+{
+	if ( !pSeg || !bKeywordDict || !iMinInfixLen || iWordsCheckpoint<2 )
+		return;
+
+	pSeg->m_dInfixNgrams.Reset();
+	pSeg->m_dInfixNgramOffsets.Reset();
+	pSeg->m_dInfixNgramWords.Reset();
+	if ( pSeg->m_dWordCheckpoints.GetLength()<INFIX_NGRAM_MIN_CHECKPOINTS )
+		return;
+
+	// (ngram hash, word ordinal) pairs; sorting them yields postings grouped by ngram, ascending by ordinal
+	CSphVector<uint64_t> dPairs;
+	dPairs.Reserve ( pSeg->m_dWords.GetLength() );
+
+	DWORD dHashes [ SPH_MAX_KEYWORD_LEN ];
+	DWORD uWord = 0;
+	const RtWord_t * pWord = NULL;
+	RtWordReader_t rdDict ( pSeg, true, iWordsCheckpoint );
+	for ( ; ( pWord = rdDict.UnzipWord () )!=NULL; uWord++ )
+	{
+		const BYTE * pDictWord = pWord->m_sWord+1;
+		if ( bHasMorphology && *pDictWord!=MAGIC_WORD_HEAD_NONSTEMMED )
+			continue;
+
+		int iLen = pWord->m_sWord[0];
+		if ( *pDictWord<0x20 ) // anyway skip heading magic chars in the prefix, like NONSTEMMED maker
+		{
+			pDictWord++;
+			iLen--;
+		}
+
+		int iHashes = GetInfixNgramHashes ( pDictWord, iLen, bUtf8, dHashes );
+		for ( int i=0; i<iHashes; i++ )
+			dPairs.Add ( ( ( (uint64_t)dHashes[i] )<<32 ) | uWord );
+	}
+	dPairs.Sort();
+
+	pSeg->m_dInfixNgramWords.Resize ( dPairs.GetLength() );
+	ARRAY_FOREACH ( i, dPairs )
+	{
+		auto uHash = (DWORD)( dPairs[i]>>32 );
+		if ( !i || pSeg->m_dInfixNgrams.Last()!=uHash )
+		{
+			pSeg->m_dInfixNgrams.Add ( uHash );
+			pSeg->m_dInfixNgramOffsets.Add ( i );
+		}
+		pSeg->m_dInfixNgramWords[i] = (DWORD)dPairs[i];
+	}
+	pSeg->m_dInfixNgramOffsets.Add ( pSeg->m_dInfixNgramWords.GetLength() );
+}
+
+
+/// collect ordinals of segment words that contain all the ngrams of a given infix
+/// returns false when ngram index can not be used (no index or infix is too short), and caller has to fall back to bloom filters
+static bool ExtractInfixNgramWords ( const char * sInfix, int iBytes, bool bUtf8, const RtSegment_t * pSeg, CSphVector<DWORD> & dWords )
+{
+	if ( !pSeg->m_dInfixNgramOffsets.GetLength() || iBytes>SPH_MAX_KEYWORD_LEN )
+		return false;
+
+	DWORD dHashes [ SPH_MAX_KEYWORD_LEN ];
+	int iHashes = GetInfixNgramHashes ( (const BYTE *)sInfix, iBytes, bUtf8, dHashes );
+	if ( !iHashes )
+		return false;
+
+	// locate postings of every ngram, shortest first; packed as (posting length, ngram index)
+	uint64_t dLists [ SPH_MAX_KEYWORD_LEN ];
+	const DWORD * pNgrams = pSeg->m_dInfixNgrams.Begin();
+	const DWORD * pOffsets = pSeg->m_dInfixNgramOffsets.Begin();
+	dWords.Resize ( 0 );
+	if ( pSeg->m_dInfixNgrams.IsEmpty() )
+		return true;
+
+	for ( int i=0; i<iHashes; i++ )
+	{
+		const DWORD * pFound = sphBinarySearch ( pNgrams, pNgrams+pSeg->m_dInfixNgrams.GetLength()-1, SphIdentityFunctor_T<DWORD>(), dHashes[i] );
+		if ( !pFound )
+			return true;
+
+		auto uNgram = DWORD ( pFound-pNgrams );
+		dLists[i] = ( ( (uint64_t)( pOffsets[uNgram+1]-pOffsets[uNgram] ) )<<32 ) | uNgram;
+	}
+	sphSort ( dLists, iHashes );
+
+	// intersect them
+	const DWORD * pPostings = pSeg->m_dInfixNgramWords.Begin();
+	dWords.Append ( pPostings + pOffsets[(DWORD)dLists[0]], int ( dLists[0]>>32 ) );
+	for ( int i=1; i<iHashes && dWords.GetLength(); i++ )
+	{
+		const DWORD * pCur = pPostings + pOffsets[(DWORD)dLists[i]];
+		const DWORD * pEnd = pCur + ( dLists[i]>>32 );
+		int iOut = 0;
+		ARRAY_FOREACH ( j, dWords )
+		{
+			while ( pCur<pEnd && *pCur<dWords[j] )
+				pCur++;
+			if ( pCur==pEnd )
+				break;
+			if ( *pCur==dWords[j] )
+				dWords[iOut++] = dWords[j];
+		}
+		dWords.Resize ( iOut );
+	}
+
+	return true;
+}
+
+
 RtSegment_t * RtIndex_t::MergeSegments ( const RtSegment_t * pSeg1, const RtSegment_t * pSeg2, const CSphVector<SphDocID_t> * pAccKlist, bool bHasMorphology )
 {
 	if ( pSeg1->m_iTag > pSeg2->m_iTag )
@@ -2803,6 +3072,8 @@ RtSegment_t * RtIndex_t::MergeSegments ( const RtSegment_t * pSeg1, const RtSegm
 		FixupSegmentCheckpoints ( pSeg );
 
 	BuildSegmentInfixes ( pSeg, bHasMorphology, m_bKeywordDict, m_tSettings.m_iMinInfixLen, m_iWordsCheckpoint, ( m_iMaxCodepointLength>1 ) );
+	BuildSegmentInfixNgrams ( pSeg, bHasMorphology, m_bKeywordDict, m_tSettings.m_iMinInfixLen, m_iWordsCheckpoint, ( m_iMaxCodepointLength>1 ) );
+	pSeg->Shrink();
 
 	assert ( pSeg->m_dRows.GetLength() );
 	assert ( pSeg->m_iRows );
@@ -2849,6 +3120,7 @@ void RtIndex_t::Commit ( int * pDeleted, ISphRtAccum * pAccExt )
 	assert ( !pNewSeg || pNewSeg->m_bTlsKlist==false );
 
 	BuildSegmentInfixes ( pNewSeg, m_pDict->HasMorphology(), m_bKeywordDict, m_tSettings.m_iMinInfixLen, m_iWordsCheckpoint, ( m_iMaxCodepointLength>1 ) );
+	BuildSegmentInfixNgrams ( pNewSeg, m_pDict->HasMorphology(), m_bKeywordDict, m_tSettings.m_iMinInfixLen, m_iWordsCheckpoint, ( m_iMaxCodepointLength>1 ) );
 
 #if PARANOID
 	if ( pNewSeg )
@@ -2873,6 +3145,10 @@ void RtIndex_t::Commit ( int * pDeleted, ISphRtAccum * pAccExt )
 
 void RtIndex_t::CommitReplayable ( RtSegment_t * pNewSeg, CSphVector<SphDocID_t> & dAccKlist, int * pTotalKilled )
 {
+	// new segment is still private; cut its growth slack so it doesn't eat into RAM limit
+	if ( pNewSeg )
+		pNewSeg->Shrink();
+
 	// store statistics, because pNewSeg just might get merged
 	int iNewDocs = pNewSeg ? pNewSeg->m_iRows : 0;
 
@@ -2897,6 +3173,7 @@ void RtIndex_t::CommitReplayable ( RtSegment_t * pNewSeg, CSphVector<SphDocID_t>
 	// first of all, binlog txn data for recovery
 	g_pRtBinlog->BinlogCommit ( &m_iTID, m_sIndexName.cstr(), pNewSeg, dAccKlist, m_bKeywordDict );
 	int64_t iTID = m_iTID;
+	m_iChanges++;
 
 	// let merger know that existing segments are subject to additional, TLS K-list filter
 	// safe despite the readers, flag must only be used by writer
@@ -2930,12 +3207,17 @@ void RtIndex_t::CommitReplayable ( RtSegment_t * pNewSeg, CSphVector<SphDocID_t>
 	for ( const auto& dRetired : m_dRetired )
 		iRamLeft = Max ( iRamLeft - dRetired->GetUsedRam(), 0 );
 
+	// forced dump: a batch that alone takes a sizeable part of RAM limit is still built as a RAM segment,
+	// but then the whole RAM chunk (with that segment) is saved as a new disk chunk right away,
+	// instead of merging it with (and then re-merging it into) other RAM segments; not while double buffer saves previous chunk
+	bool bForceDump = pNewSeg && !m_iDoubleBuffer && pNewSeg->GetUsedRam()>=( m_iSoftRamLimit * SPH_RT_FORCE_DUMP_SEGMENT_PERCENT ) / 100;
+
 	// skip merging if no rows were added or no memory left
-	bool bDump = ( iRamLeft==0 );
+	bool bDump = ( iRamLeft==0 ) || bForceDump;
 	const int MAX_SEGMENTS = 32;
 	const int MAX_PROGRESSION_SEGMENT = 8;
 	const int64_t MAX_SEGMENT_VECTOR_LEN = INT_MAX;
-	while ( pNewSeg && iRamLeft>0 )
+	while ( pNewSeg && iRamLeft>0 && !bForceDump )
 	{
 		// segments sort order: large first, smallest last
 		// merge last smallest segments
@@ -3305,46 +3587,17 @@ struct SaveSegment_t
 };
 
 
-void RtIndex_t::SaveDiskDataImpl ( const char * sFilename, const SphChunkGuard_t & tGuard, const ChunkStats_t & tStats ) const
+/// writes .spa (rows and min-max index), .sps and .spm of a new disk chunk
+/// returns min-max index offset in rowitems
+SphOffset_t RtIndex_t::SaveDiskAttrs ( const char * sFilename, const SphChunkGuard_t & tGuard, int iTotalDocs ) const
 {
-	typedef RtDoc_T<SphDocID_t> RTDOC;
-	typedef RtWord_T<SphWordID_t> RTWORD;
-
 	CSphString sName, sError; // FIXME!!! report collected (sError) errors
 
-	CSphWriter wrHits, wrDocs, wrDict, wrRows, wrSkips;
-	sName.SetSprintf ( "%s.spp", sFilename ); wrHits.OpenFile ( sName.cstr(), sError );
-	sName.SetSprintf ( "%s.spd", sFilename ); wrDocs.OpenFile ( sName.cstr(), sError );
-	sName.SetSprintf ( "%s.spi", sFilename ); wrDict.OpenFile ( sName.cstr(), sError );
+	CSphWriter wrRows;
 	sName.SetSprintf ( "%s.spa", sFilename ); wrRows.OpenFile ( sName.cstr(), sError );
-	sName.SetSprintf ( "%s.spe", sFilename ); wrSkips.OpenFile ( sName.cstr(), sError );
-
-
-	wrDict.PutByte ( 1 );
-	wrDocs.PutByte ( 1 );
-	wrHits.PutByte ( 1 );
-	wrSkips.PutByte ( 1 );
-
-	// we don't have enough RAM to create new merged segments
-	// and have to do N-way merge kinda in-place
-	CSphVector<RtWordReader_T<SphWordID_t>*> pWordReaders;
-	CSphVector<RtDocReader_T<SphDocID_t>*> pDocReaders;
-	CSphVector<SaveSegment_t> pSegments;
-	CSphVector<const RTWORD*> pWords;
-	CSphVector<const RTDOC*> pDocs;
 
 	int iSegments = tGuard.m_dRamChunks.GetLength();
 
-	pWordReaders.Reserve ( iSegments );
-	pDocReaders.Reserve ( iSegments );
-	pSegments.Reserve ( iSegments );
-	pWords.Reserve ( iSegments );
-	pDocs.Reserve ( iSegments );
-
-	////////////////////
-	// write attributes
-	////////////////////
-
 	// the new, template-param aligned iStride instead of index-wide
 	int iStride = DWSIZEOF(SphDocID_t) + m_tSchema.GetRowSize();
 	CSphFixedVector<RtRowIterator_T<SphDocID_t>*> pRowIterators ( iSegments );
@@ -3356,10 +3609,6 @@ void RtIndex_t::SaveDiskDataImpl ( const char * sFilename, const SphChunkGuard_t
 		pRows[i] = pRowIterators[i]->GetNextAliveRow();
 
 	// prepare to build min-max index for attributes too
-	int iTotalDocs = 0;
-	ARRAY_FOREACH ( i, tGuard.m_dRamChunks )
-		iTotalDocs += tGuard.m_dRamChunks[i]->m_iAliveRows;
-
 	AttrIndexBuilder_t<SphDocID_t> tMinMaxBuilder ( m_tSchema );
 	CSphVector<DWORD> dMinMaxBuffer ( int ( tMinMaxBuilder.GetExpectedSize ( iTotalDocs ) ) ); // RT index doesn't support over 4Gb .spa
 	tMinMaxBuilder.Prepare ( dMinMaxBuffer.Begin(), dMinMaxBuffer.Begin() + dMinMaxBuffer.GetLength() );
@@ -3374,7 +3623,6 @@ void RtIndex_t::SaveDiskDataImpl ( const char * sFilename, const SphChunkGuard_t
 	tMvaWriter.OpenFile ( sName.cstr(), sError );
 	tMvaWriter.PutDword ( 0 ); // dummy dword, to reserve magic zero offset
 
-	SphDocID_t iMinDocID = DOCID_MAX;
 	CSphRowitem * pFixedRow = new CSphRowitem[iStride];
 
 #ifndef NDEBUG
@@ -3418,9 +3666,6 @@ void RtIndex_t::SaveDiskDataImpl ( const char * sFilename, const SphChunkGuard_t
 		// collect min-max data
 		Verify ( tMinMaxBuilder.Collect ( pRow, pSegment->m_dMvas.Begin(), pSegment->m_dMvas.GetLength(), sError, false ) );
 
-		if ( iMinDocID==DOCID_MAX )
-			iMinDocID = DOCINFO2ID ( pRows[iMinRow] );
-
 		if ( pSegment->m_dStrings.GetLength()>1 || pSegment->m_dMvas.GetLength()>1 ) // should be more then dummy zero elements
 		{
 			// copy row content as we'll fix up its attrs ( string offset for now )
@@ -3452,6 +3697,91 @@ void RtIndex_t::SaveDiskDataImpl ( const char * sFilename, const SphChunkGuard_t
 
 	tMvaWriter.CloseFile();
 	tStrWriter.CloseFile ();
+	wrRows.CloseFile ();
+
+	ARRAY_FOREACH ( i, pRowIterators )
+		SafeDelete ( pRowIterators[i] );
+
+	return uMinMaxOff;
+}
+
+
+struct SaveDiskAttrsCtx_t
+{
+	const RtIndex_t *		m_pIndex;
+	const char *			m_sFilename;
+	const SphChunkGuard_t *	m_pGuard;
+	int						m_iTotalDocs;
+	SphOffset_t				m_uMinMaxOff;
+};
+
+
+void RtIndex_t::SaveDiskDataImpl ( const char * sFilename, const SphChunkGuard_t & tGuard, const ChunkStats_t & tStats ) const
+{
+	typedef RtDoc_T<SphDocID_t> RTDOC;
+	typedef RtWord_T<SphWordID_t> RTWORD;
+
+	CSphString sName, sError; // FIXME!!! report collected (sError) errors
+
+	CSphWriter wrHits, wrDocs, wrDict, wrSkips;
+	sName.SetSprintf ( "%s.spp", sFilename ); wrHits.OpenFile ( sName.cstr(), sError );
+	sName.SetSprintf ( "%s.spd", sFilename ); wrDocs.OpenFile ( sName.cstr(), sError );
+	sName.SetSprintf ( "%s.spi", sFilename ); wrDict.OpenFile ( sName.cstr(), sError );
+	sName.SetSprintf ( "%s.spe", sFilename ); wrSkips.OpenFile ( sName.cstr(), sError );
+
+
+	wrDict.PutByte ( 1 );
+	wrDocs.PutByte ( 1 );
+	wrHits.PutByte ( 1 );
+	wrSkips.PutByte ( 1 );
+
+	// we don't have enough RAM to create new merged segments
+	// and have to do N-way merge kinda in-place
+	CSphVector<RtWordReader_T<SphWordID_t>*> pWordReaders;
+	CSphVector<RtDocReader_T<SphDocID_t>*> pDocReaders;
+	CSphVector<SaveSegment_t> pSegments;
+	CSphVector<const RTWORD*> pWords;
+	CSphVector<const RTDOC*> pDocs;
+
+	int iSegments = tGuard.m_dRamChunks.GetLength();
+
+	pWordReaders.Reserve ( iSegments );
+	pDocReaders.Reserve ( iSegments );
+	pSegments.Reserve ( iSegments );
+	pWords.Reserve ( iSegments );
+	pDocs.Reserve ( iSegments );
+
+	// doclists are delta coded against min alive docid
+	// which is the min of the first alive rows, as segment rows are sorted by docid
+	int iStride = DWSIZEOF(SphDocID_t) + m_tSchema.GetRowSize();
+	int iTotalDocs = 0;
+	SphDocID_t iMinDocID = DOCID_MAX;
+	ARRAY_FOREACH ( i, tGuard.m_dRamChunks )
+	{
+		iTotalDocs += tGuard.m_dRamChunks[i]->m_iAliveRows;
+
+		RtRowIterator_T<SphDocID_t> tIt ( tGuard.m_dRamChunks[i], iStride, false, NULL, tGuard.m_dKill[i]->m_dKilled );
+		const CSphRowitem * pRow = tIt.GetNextAliveRow();
+		if ( pRow )
+			iMinDocID = Min ( iMinDocID, DOCINFO2ID ( pRow ) );
+	}
+
+	////////////////////
+	// write attributes
+	////////////////////
+
+	// attributes do not depend on postings and dictionary, so write them concurrently
+	SaveDiskAttrsCtx_t tAttrsCtx { this, sFilename, &tGuard, iTotalDocs, 0 };
+	auto fnSaveAttrs = [] ( void * pArg )
+	{
+		auto * pCtx = (SaveDiskAttrsCtx_t *)pArg;
+		pCtx->m_uMinMaxOff = pCtx->m_pIndex->SaveDiskAttrs ( pCtx->m_sFilename, *pCtx->m_pGuard, pCtx->m_iTotalDocs );
+	};
+
+	SphThread_t tAttrsThd;
+	bool bAttrsThd = sphThreadCreate ( &tAttrsThd, fnSaveAttrs, &tAttrsCtx );
+	if ( !bAttrsThd )
+		fnSaveAttrs ( &tAttrsCtx );
 
 	////////////////////
 	// write docs & hits
@@ -3771,24 +4101,25 @@ void RtIndex_t::SaveDiskDataImpl ( const char * sFilename, const SphChunkGuard_t
 		wrDummy.PutBytes ( m_dDiskChunkKlist.Begin(), m_dDiskChunkKlist.GetLength()*sizeof ( SphDocID_t ) );
 	wrDummy.CloseFile ();
 
+	// wait for attributes
+	if ( bAttrsThd )
+		sphThreadJoin ( &tAttrsThd );
+
 	// header
 	SaveDiskHeader ( sFilename, iMinDocID, dCheckpoints.GetLength(), iCheckpointsPosition, (DWORD)iInfixBlockOffset, iInfixCheckpointWordsSize,
-		m_dDiskChunkKlist.GetLength(), uMinMaxOff, tStats, iTotalDocs );
+		m_dDiskChunkKlist.GetLength(), tAttrsCtx.m_uMinMaxOff, tStats, iTotalDocs );
 
 	// cleanup
 	ARRAY_FOREACH ( i, pWordReaders )
 		SafeDelete ( pWordReaders[i] );
 	ARRAY_FOREACH ( i, pDocReaders )
 		SafeDelete ( pDocReaders[i] );
-	ARRAY_FOREACH ( i, pRowIterators )
-		SafeDelete ( pRowIterators[i] );
 
 	// done
 	wrSkips.CloseFile ();
 	wrHits.CloseFile ();
 	wrDocs.CloseFile ();
 	wrDict.CloseFile ();
-	wrRows.CloseFile ();
 }
 
 
@@ -4546,6 +4877,11 @@ bool RtIndex_t::LoadRamChunk ( DWORD uVersion, bool bRebuildInfixes )
 			if ( bRebuildInfixes )
 				BuildSegmentInfixes ( pSeg, bHasMorphology, m_bKeywordDict, m_tSettings.m_iMinInfixLen, m_iWordsCheckpoint, ( m_iMaxCodepointLength>1 ) );
 		}
+
+		// ngram index is not stored with RAM chunk; rebuild it from dictionary
+		BuildSegmentInfixNgrams ( pSeg, bHasMorphology, m_bKeywordDict, m_tSettings.m_iMinInfixLen, m_iWordsCheckpoint, ( m_iMaxCodepointLength>1 ) );
+
+		pSeg->Shrink();
 	}
 
 	// field lengths
@@ -6339,6 +6675,7 @@ void RtIndex_t::GetInfixedWords ( const char * sSubstring, int iSubLen, const ch
 
 	// find those prefixes
 	CSphVector<DWORD> dPoints;
+	CSphVector<DWORD> dWords;
 	const int iSkipMagic = ( tArgs.m_bHasMorphology ? 1 : 0 ); // whether to skip heading magic chars in the prefix, like NONSTEMMED maker
 	const CSphFixedVector<RtSegment_t*> & dSegments = *((CSphFixedVector<RtSegment_t*> *)tArgs.m_pIndexData);
 
@@ -6349,13 +6686,58 @@ void RtIndex_t::GetInfixedWords ( const char * sSubstring, int iSubLen, const ch
 		if ( !pSeg->m_dWords.GetLength() )
 			continue;
 
+		int dWildcard [ SPH_MAX_WORD_LEN + 1 ];
+		int * pWildcard = ( sphIsUTF8 ( sWildcard ) && sphUTF8ToWideChar ( sWildcard, dWildcard, SPH_MAX_WORD_LEN ) ) ? dWildcard : NULL;
+
+		auto fnCheckWord = [&] ( const RtWord_t * pWord )
+		{
+			if ( tArgs.m_bHasMorphology && pWord->m_sWord[1]!=MAGIC_WORD_HEAD_NONSTEMMED )
+				return;
+
+			// check it
+			if ( !sphWildcardMatch ( (const char*)pWord->m_sWord+1+iSkipMagic, sWildcard, pWildcard ) )
+				return;
+
+			// matched, lets add
+			tDict2Payload.Add ( pWord, iSeg );
+		};
+
+		// ngram index tells exact candidate words; decode only the checkpoint blocks that hold them
+		if ( ExtractInfixNgramWords ( sSubstring, iSubLen, ( m_iMaxCodepointLength>1 ), pSeg, dWords ) )
+		{
+			const int iBlockWords = m_iWordsCheckpoint-1; // every checkpoint block holds that many words
+			for ( int i=0; i<dWords.GetLength(); )
+			{
+				int iBlock = dWords[i] / iBlockWords;
+				RtWordReader_t tReader ( pSeg, true, m_iWordsCheckpoint );
+				if ( iBlock>0 )
+					tReader.m_pCur = pSeg->m_dWords.Begin() + pSeg->m_dWordCheckpoints[iBlock-1].m_iOffset;
+
+				DWORD uWord = iBlock * iBlockWords;
+				while ( i<dWords.GetLength() && (int)dWords[i]/iBlockWords==iBlock )
+				{
+					const RtWord_t * pWord = tReader.UnzipWord();
+					assert ( pWord );
+					if ( !pWord )
+					{
+						i = dWords.GetLength();
+						break;
+					}
+
+					if ( uWord++==dWords[i] )
+					{
+						fnCheckWord ( pWord );
+						i++;
+					}
+				}
+			}
+			continue;
+		}
+
 		dPoints.Resize ( 0 );
 		if ( !ExtractInfixCheckpoints ( sSubstring, iSubLen, m_iMaxCodepointLength, pSeg->m_dWordCheckpoints.GetLength(), pSeg->m_dInfixFilterCP, dPoints ) )
 			continue;
 
-		int dWildcard [ SPH_MAX_WORD_LEN + 1 ];
-		int * pWildcard = ( sphIsUTF8 ( sWildcard ) && sphUTF8ToWideChar ( sWildcard, dWildcard, SPH_MAX_WORD_LEN ) ) ? dWildcard : NULL;
-
 		// walk those checkpoints, check all their words
 		ARRAY_FOREACH ( i, dPoints )
 		{
@@ -6369,17 +6751,7 @@ void RtIndex_t::GetInfixedWords ( const char * sSubstring, int iSubLen, const ch
 
 			const RtWord_t * pWord = NULL;
 			while ( ( pWord = tReader.UnzipWord() )!=NULL )
-			{
-				if ( tArgs.m_bHasMorphology && pWord->m_sWord[1]!=MAGIC_WORD_HEAD_NONSTEMMED )
-					continue;
-
-				// check it
-				if ( !sphWildcardMatch ( (const char*)pWord->m_sWord+1+iSkipMagic, sWildcard, pWildcard ) )
-					continue;
-
-				// matched, lets add
-				tDict2Payload.Add ( pWord, iSeg );
-			}
+				fnCheckWord ( pWord );
 		}
 	}
 
@@ -6557,14 +6929,29 @@ private:
 	// count per segments matches
 	// to skip iteration of matches at sorter and pool setup for segment without matches at sorter
 	CSphBitvec					m_dSegments;
+	bool						m_bBlock;		///< collect matches and evaluate them in blocks (for batch UDFs)
+	CSphVector<CSphMatch *>		m_dBlock;
 
 public:
-	SphRtFinalMatchCalc_t ( int iSegments, const CSphQueryContext & tCtx )
+	SphRtFinalMatchCalc_t ( int iSegments, const CSphQueryContext & tCtx, bool bBlock )
 		: m_tCtx ( tCtx )
 		, m_iSeg ( 0 )
 		, m_iSegments ( iSegments )
+		, m_bBlock ( bBlock )
 	{
 		m_dSegments.Init ( iSegments );
+		if ( m_bBlock )
+			m_dBlock.Reserve ( CSphQueryContext::CALC_BLOCK_SIZE );
+	}
+
+	/// evaluate whatever is left in the current block; must be called after Finalize() and before pools change
+	void Flush ()
+	{
+		if ( !m_dBlock.GetLength() )
+			return;
+
+		m_tCtx.CalcFinal ( m_dBlock.Begin(), m_dBlock.GetLength() );
+		m_dBlock.Resize ( 0 );
 	}
 
 	bool NextSegment ( int iSeg )
@@ -6592,7 +6979,15 @@ public:
 	{
 		int iMatchSegment = pMatch->m_iTag-1;
 		if ( iMatchSegment==m_iSeg && pMatch->m_pStatic )
-			m_tCtx.CalcFinal ( *pMatch );
+		{
+			if ( m_bBlock )
+			{
+				m_dBlock.Add ( pMatch );
+				if ( m_dBlock.GetLength()>=CSphQueryContext::CALC_BLOCK_SIZE )
+					Flush();
+			} else
+				m_tCtx.CalcFinal ( *pMatch );
+		}
 
 		// count all used segments at 0 pass
 		if ( m_iSeg==0 && iMatchSegment<m_iSegments )
@@ -6925,14 +7320,17 @@ bool RtIndex_t::MultiQuery ( const CSphQuery * pQuery, CSphQueryResult * pResult
 			tMvaArenaFlag.BitSet ( iChunk );
 		pResult->m_iBadRows += tChunkResult.m_iBadRows;
 
-		if ( pResult->m_bHasPrediction )
-			pResult->m_tStats.Add ( tChunkResult.m_tStats );
+		pResult->m_tStats.Add ( tChunkResult.m_tStats );
 
 		if ( iChunk && tmMaxTimer>0 && sphMicroTimer()>=tmMaxTimer )
 		{
 			pResult->m_sWarning = "query time exceeded max_query_time";
 			break;
 		}
+
+		// KILL, client disconnect, or query limits
+		if ( sphQueryStopped() )
+			break;
 	}
 
 	////////////////////
@@ -6990,9 +7388,8 @@ bool RtIndex_t::MultiQuery ( const CSphQuery * pQuery, CSphQueryResult * pResult
 	// setup prediction constrain
 	CSphQueryStats tQueryStats;
 	int64_t iNanoBudget = (int64_t)(pQuery->m_iMaxPredictedMsec) * 1000000; // from milliseconds to nanoseconds
-	tQueryStats.m_pNanoBudget = &iNanoBudget;
-	if ( pResult->m_bHasPrediction )
-		tTermSetup.m_pStats = &tQueryStats;
+	tQueryStats.m_pNanoBudget = pResult->m_bHasPrediction ? &iNanoBudget : nullptr;
+	tTermSetup.m_pStats = &tQueryStats;
 
 	// bind weights
 	tCtx.BindWeights ( pQuery, m_tSchema, pResult->m_sWarning );
@@ -7173,18 +7570,27 @@ bool RtIndex_t::MultiQuery ( const CSphQuery * pQuery, CSphQueryResult * pResult
 				}
 
 				RtRowIterator_t tIt ( tGuard.m_dRamChunks[iSeg], m_iStride, false, NULL, tGuard.m_dKill[iSeg]->m_dKilled );
+				DWORD uRows = 0;
 				while (true)
 				{
 					const CSphRowitem * pRow = tIt.GetNextAliveRow();
 					if ( !pRow )
 						break;
 
+					// KILL, client disconnect, or query limits
+					if ( ( ++uRows & 1023 )==0 && sphQueryStopped() )
+					{
+						iSeg = tGuard.m_dRamChunks.GetLength() - 1;	// outer break
+						break;
+					}
+
 					tMatch.m_uDocID = DOCINFO2ID(pRow);
 					tMatch.m_pStatic = DOCINFO2ATTRS(pRow); // FIXME! overrides
 
 					tCtx.CalcFilter ( tMatch );
 					if ( tCtx.m_pFilter && !tCtx.m_pFilter->Eval ( tMatch ) )
 					{
+						pResult->m_tStats.m_iFiltered++;
 						tCtx.FreeDataFilter ( tMatch );
 						continue;
 					}
@@ -7252,6 +7658,7 @@ bool RtIndex_t::MultiQuery ( const CSphQuery * pQuery, CSphQueryResult * pResult
 				pRanker->ExtraData ( EXTRA_SET_STRINGPOOL, (void**)tGuard.m_dRamChunks[iSeg]->m_dStrings.Begin() );
 
 				CSphMatch * pMatch = pRanker->GetMatchesBuffer();
+				CSphVector<CSphMatch *> dBlock;
 				while (true)
 				{
 					// ranker does profile switches internally in GetMatches()
@@ -7261,7 +7668,9 @@ bool RtIndex_t::MultiQuery ( const CSphQuery * pQuery, CSphQueryResult * pResult
 
 					if ( pProfiler )
 						pProfiler->Switch ( SPH_QSTATE_SORT );
-					for ( int i=0; i<iMatches; i++ )
+
+					// returns false for the matches that must be skipped
+					auto fnPrepare = [&] ( CSphMatch & tMatch )
 					{
 						if ( tCtx.m_bLookupSort )
 						{
@@ -7273,35 +7682,57 @@ bool RtIndex_t::MultiQuery ( const CSphQuery * pQuery, CSphQueryResult * pResult
 							// to catch broken indexes or other bugs in debug, we have that assert
 							// but release builds will simply ignore nonexistent docids, whatever the reason they do not exist
 							assert ( m_iStride==( DOCINFO_IDSIZE + m_tSchema.GetRowSize() ) );
-							const CSphRowitem * pRow = FindDocinfo ( tGuard.m_dRamChunks[iSeg], pMatch[i].m_uDocID, m_iStride );
+							const CSphRowitem * pRow = FindDocinfo ( tGuard.m_dRamChunks[iSeg], tMatch.m_uDocID, m_iStride );
 							assert ( pRanker->IsCache() || pRow );
 							if ( !pRow )
 							{
 								tCtx.m_iBadRows++;
-								continue;
+								return false;
 							}
-							CopyDocinfo ( pMatch[i], pRow );
+							CopyDocinfo ( tMatch, pRow );
 						}
 
-						pMatch[i].m_iWeight *= tArgs.m_iIndexWeight;
+						tMatch.m_iWeight *= tArgs.m_iIndexWeight;
 						if ( bRandomize )
-							pMatch[i].m_iWeight = ( sphRand() & 0xffff ) * tArgs.m_iIndexWeight;
+							tMatch.m_iWeight = ( sphRand() & 0xffff ) * tArgs.m_iIndexWeight;
+						return true;
+					};
+
+					// when sorting expressions can go block by block, do all the lookups first, then compute them in one go
+					if ( tCtx.m_bCalcSortBlock )
+					{
+						dBlock.Resize ( 0 );
+						for ( int i=0; i<iMatches; i++ )
+							if ( fnPrepare ( pMatch[i] ) )
+								dBlock.Add ( pMatch+i );
 
-						tCtx.CalcSort ( pMatch[i] );
+						tCtx.CalcSort ( dBlock.Begin(), dBlock.GetLength() );
+						iMatches = dBlock.GetLength();
+					}
 
-						if ( tCtx.m_pWeightFilter && !tCtx.m_pWeightFilter->Eval ( pMatch[i] ) )
+					for ( int i=0; i<iMatches; i++ )
+					{
+						CSphMatch & tMatch = tCtx.m_bCalcSortBlock ? *dBlock[i] : pMatch[i];
+						if ( !tCtx.m_bCalcSortBlock )
 						{
-							tCtx.FreeDataSort ( pMatch[i] );
+							if ( !fnPrepare ( tMatch ) )
+								continue;
+							tCtx.CalcSort ( tMatch );
+						}
+
+						if ( tCtx.m_pWeightFilter && !tCtx.m_pWeightFilter->Eval ( tMatch ) )
+						{
+							tCtx.FreeDataSort ( tMatch );
 							continue;
 						}
 
 						// storing segment in matches tag for finding strings attrs offset later, biased against default zero
-						pMatch[i].m_iTag = iSeg+1;
+						tMatch.m_iTag = iSeg+1;
 
 						bool bNewMatch = false;
 						ARRAY_FOREACH ( iSorter, dSorters )
 						{
-							bNewMatch |= dSorters[iSorter]->Push ( pMatch[i] );
+							bNewMatch |= dSorters[iSorter]->Push ( tMatch );
 
 							if ( tCtx.m_uPackedFactorFlags & SPH_FACTOR_ENABLE )
 							{
@@ -7311,7 +7742,7 @@ bool RtIndex_t::MultiQuery ( const CSphQuery * pQuery, CSphQueryResult * pResult
 						}
 
 						// stringptr expressions should be duplicated (or taken over) at this point
-						tCtx.FreeDataSort ( pMatch[i] );
+						tCtx.FreeDataSort ( tMatch );
 
 						if ( bNewMatch )
 							if ( --iCutoff==0 )
@@ -7335,7 +7766,11 @@ bool RtIndex_t::MultiQuery ( const CSphQuery * pQuery, CSphQueryResult * pResult
 
 		// at 0 pass processor also fills bitmask of segments these has matches at sorter
 		// then skip sorter processing for these 'empty' segments
-		SphRtFinalMatchCalc_t tFinal ( iSegmentsTotal, tCtx );
+		bool bGotUDF = false;
+		ARRAY_FOREACH_COND ( i, tCtx.m_dCalcFinal, !bGotUDF )
+			tCtx.m_dCalcFinal[i].m_pExpr->Command ( SPH_EXPR_GET_UDF, &bGotUDF );
+
+		SphRtFinalMatchCalc_t tFinal ( iSegmentsTotal, tCtx, bGotUDF || tCtx.m_bCalcFinalBlock );
 
 		ARRAY_FOREACH_COND ( iSeg, tGuard.m_dRamChunks, tFinal.HasSegments() )
 		{
@@ -7351,6 +7786,7 @@ bool RtIndex_t::MultiQuery ( const CSphQuery * pQuery, CSphQueryResult * pResult
 				ISphMatchSorter * pTop = ppSorters[iSorter];
 				if ( pTop )
 					pTop->Finalize ( tFinal, false );
+				tFinal.Flush();
 			}
 		}
 	}
@@ -7379,8 +7815,7 @@ bool RtIndex_t::MultiQuery ( const CSphQuery * pQuery, CSphQueryResult * pResult
 	if ( pProfiler )
 		pProfiler->Switch ( eOldState );
 
-	if ( pResult->m_bHasPrediction )
-		pResult->m_tStats.Add ( tQueryStats );
+	pResult->m_tStats.Add ( tQueryStats );
 
 	// query timer
 	pResult->m_iQueryTime = int ( ( sphMicroTimer()-tmQueryStart )/1000 );
@@ -7546,11 +7981,12 @@ bool RtIndex_t::DoGetKeywords ( CSphVector<CSphKeywordInfo> & dKeywords, const c
 	}
 
 	// get stats from disk chunks too
-	if ( !tSettings.m_bStats )
-		return true;
-
+	// expansions are collected from disk chunks even without stats, as some terms might exist only there
 	if ( bFillOnly )
 	{
+		if ( !tSettings.m_bStats )
+			return true;
+
 		ARRAY_FOREACH ( iChunk, tGuard.m_dDiskChunks )
 			tGuard.m_dDiskChunks[iChunk]->FillKeywords ( dKeywords );
 	} else
@@ -7665,7 +8101,9 @@ int RtIndex_t::UpdateAttributes ( const CSphAttrUpdate & tUpd, int iIndex, CSphS
 	CSphBitvec dBigint2Float ( iUpdLen );
 	CSphBitvec dFloat2Bigint ( iUpdLen );
 	CSphVector < CSphRefcountedPtr<ISphExpr> > dExpr ( iUpdLen );
+	CSphVector<int> dJsonAttrs ( iUpdLen );
 	dLocators.ZeroMem ();
+	dJsonAttrs.Fill ( -1 );
 
 	uint64_t uDst64 = 0;
 	ARRAY_FOREACH ( i, tUpd.m_dAttrs )
@@ -7687,6 +8125,12 @@ int RtIndex_t::UpdateAttributes ( const CSphAttrUpdate & tUpd, int iIndex, CSphS
 		{
 			// forbid updates on non-int columns
 			const CSphColumnInfo & tCol = m_tSchema.GetAttr(iIdx);
+			if ( sphIsJsonHotAttr ( tCol ) )
+			{
+				sError.SetSprintf ( "attribute '%s' can not be updated (update its JSON column instead)", tUpd.m_dAttrs[i] );
+				return -1;
+			}
+
 			if ( !( tCol.m_eAttrType==SPH_ATTR_BOOL || tCol.m_eAttrType==SPH_ATTR_INTEGER || tCol.m_eAttrType==SPH_ATTR_TIMESTAMP
 				|| tCol.m_eAttrType==SPH_ATTR_UINT32SET || tCol.m_eAttrType==SPH_ATTR_INT64SET
 				|| tCol.m_eAttrType==SPH_ATTR_BIGINT || tCol.m_eAttrType==SPH_ATTR_FLOAT || tCol.m_eAttrType==SPH_ATTR_JSON ))
@@ -7720,8 +8164,10 @@ int RtIndex_t::UpdateAttributes ( const CSphAttrUpdate & tUpd, int iIndex, CSphS
 				if ( tUpd.m_dTypes[i]==SPH_ATTR_BIGINT )
 					dBigint2Float.BitSet(i);
 			} else if ( tCol.m_eAttrType==SPH_ATTR_JSON )
+			{
 				dJsonFields.BitSet(i);
-			else if ( tCol.m_eAttrType==SPH_ATTR_BIGINT )
+				dJsonAttrs[i] = iIdx;
+			} else if ( tCol.m_eAttrType==SPH_ATTR_BIGINT )
 			{
 				if ( tUpd.m_dTypes[i]==SPH_ATTR_FLOAT )
 					dFloat2Bigint.BitSet(i);
@@ -7771,6 +8217,11 @@ int RtIndex_t::UpdateAttributes ( const CSphAttrUpdate & tUpd, int iIndex, CSphS
 	DWORD uUpdateMask = 0;
 	int iJsonWarnings = 0;
 
+	// hot JSON paths follow their JSON columns
+	JsonHotAttrs_c tHotAttrs;
+	if ( dJsonFields.BitCount() )
+		tHotAttrs.Setup ( m_tSchema );
+
 	// bRaw do only one pass as it has pointers to actual data at segments
 	// MVA && bRaw should find appropriate segment to update storage there
 
@@ -7855,6 +8306,12 @@ int RtIndex_t::UpdateAttributes ( const CSphAttrUpdate & tUpd, int iIndex, CSphS
 						bUpdated = true;
 						uUpdateMask |= ATTRS_STRINGS_UPDATED;
 
+						if ( tHotAttrs.HasJson ( dJsonAttrs[iCol] ) )
+						{
+							tHotAttrs.RefreshRow ( dJsonAttrs[iCol], dLocators[iCol], pSegment->m_dStrings.Begin(), const_cast<CSphRowitem *>( pRow ) );
+							uUpdateMask |= ATTRS_UPDATED;
+						}
+
 					} else
 						iJsonWarnings++;
 
@@ -8296,6 +8753,7 @@ bool RtIndex_t::AttachDiskIndex ( CSphIndex * pIndex, CSphString & sError )
 	// g_pBinlog->NotifyIndexFlush ( m_sIndexName.cstr(), m_iTID, false );
 
 	// all done, reset cache
+	m_iChanges++;
 	QcacheDeleteIndex ( GetIndexId() );
 	return true;
 }
@@ -8349,6 +8807,7 @@ bool RtIndex_t::Truncate ( CSphString & )
 	m_tKlist.Reset ( NULL, 0 );
 
 	// reset cache
+	m_iChanges++;
 	QcacheDeleteIndex ( GetIndexId() );
 	return true;
 }
@@ -9005,10 +9464,10 @@ uint64_t sphGetSettingsFNV ( const CSphIndexSettings & tSettings )
 extern DWORD g_dSphinxCRC32 [ 256 ];
 
 
-static CSphString MakeBinlogName ( const char * sPath, int iExt )
+static CSphString MakeBinlogName ( const char * sPath, const char * sPrefix, int iExt )
 {
 	CSphString sName;
-	sName.SetSprintf ( "%s/binlog.%03d", sPath, iExt );
+	sName.SetSprintf ( "%s/%s.%03d", sPath, sPrefix, iExt );
 	return sName;
 }
 
@@ -9168,6 +9627,7 @@ RtBinlog_c::RtBinlog_c ()
 	, m_bReplayMode ( false )
 	, m_bDisabled ( true )
 	, m_iRestartSize ( 268435456 )
+	, m_sPrefix ( "binlog" )
 {
 	MEMORY ( MEM_BINLOG );
 
@@ -9176,22 +9636,81 @@ RtBinlog_c::RtBinlog_c ()
 
 RtBinlog_c::~RtBinlog_c ()
 {
+	ARRAY_FOREACH ( i, m_dIndexLogs )
+		SafeDelete ( m_dIndexLogs[i] );
+
 	if ( !m_bDisabled )
 	{
 		m_iFlushPeriod = 0;
 		DoCacheWrite();
 		m_tWriter.CloseFile();
-		LockFile ( false );
+
+		// per-index streams live in the same dir and share the lock of the main log
+		if ( m_iLockFD>=0 )
+			LockFile ( false );
 	}
 }
 
 
+RtBinlog_c * RtBinlog_c::CreateIndexLog ( const char * sIndexName ) const
+{
+	auto * pLog = new RtBinlog_c;
+	pLog->m_eOnCommit = m_eOnCommit;
+	pLog->m_iFlushPeriod = m_iFlushPeriod;
+	pLog->m_sLogPath = m_sLogPath;
+	pLog->m_iRestartSize = m_iRestartSize;
+	pLog->m_iReplayThreads = 1; // stream holds the single index
+	pLog->m_sPrefix.SetSprintf ( "binlog.%s", sIndexName );
+	pLog->m_bDisabled = false;
+	pLog->LoadMeta();
+	return pLog;
+}
+
+
+/// returns existing per-index stream of the index, if any
+RtBinlog_c * RtBinlog_c::FindIndexLog ( const char * sIndexName ) const
+{
+	ScRL_t tLock ( m_tIndexLogsLock );
+	RtBinlog_c * const * ppLog = m_hIndexLogs ( sIndexName );
+	return ppLog ? *ppLog : nullptr;
+}
+
+
+/// returns log stream the index writes into; either per-index one or this (common) one
+RtBinlog_c * RtBinlog_c::GetIndexLog ( const char * sIndexName, bool bCreate )
+{
+	if ( !m_bPerIndex )
+		return this;
+
+	RtBinlog_c * pFound = FindIndexLog ( sIndexName );
+	if ( pFound || !bCreate )
+		return pFound;
+
+	ScWL_t tLock ( m_tIndexLogsLock );
+	RtBinlog_c ** ppLog = m_hIndexLogs ( sIndexName );
+	if ( ppLog )
+		return *ppLog;
+
+	RtBinlog_c * pLog = CreateIndexLog ( sIndexName );
+	pLog->OpenNewLog();
+	m_hIndexLogs.Add ( pLog, sIndexName );
+	m_dIndexLogs.Add ( pLog );
+	return pLog;
+}
+
+
 void RtBinlog_c::BinlogCommit ( int64_t * pTID, const char * sIndexName, const RtSegment_t * pSeg,
 	const CSphVector<SphDocID_t> & dKlist, bool bKeywordDict )
 {
 	if ( m_bReplayMode || m_bDisabled )
 		return;
 
+	if ( m_bPerIndex )
+	{
+		GetIndexLog ( sIndexName, true )->BinlogCommit ( pTID, sIndexName, pSeg, dKlist, bKeywordDict );
+		return;
+	}
+
 	MEMORY ( MEM_BINLOG );
 	Verify ( m_tWriteLock.Lock() );
 
@@ -9256,6 +9775,12 @@ void RtBinlog_c::BinlogUpdateAttributes ( int64_t * pTID, const char * sIndexNam
 	if ( m_bReplayMode || m_bDisabled )
 		return;
 
+	if ( m_bPerIndex )
+	{
+		GetIndexLog ( sIndexName, true )->BinlogUpdateAttributes ( pTID, sIndexName, tUpd );
+		return;
+	}
+
 	MEMORY ( MEM_BINLOG );
 	Verify ( m_tWriteLock.Lock() );
 
@@ -9311,6 +9836,12 @@ void RtBinlog_c::BinlogReconfigure ( int64_t * pTID, const char * sIndexName, co
 	if ( m_bReplayMode || m_bDisabled )
 		return;
 
+	if ( m_bPerIndex )
+	{
+		GetIndexLog ( sIndexName, true )->BinlogReconfigure ( pTID, sIndexName, tSetup );
+		return;
+	}
+
 	MEMORY ( MEM_BINLOG );
 	Verify ( m_tWriteLock.Lock() );
 
@@ -9352,6 +9883,12 @@ void RtBinlog_c::NotifyIndexFlush ( const char * sIndexName, int64_t iTID, bool
 	if ( m_bReplayMode || m_bDisabled )
 		return;
 
+	// stream of that index has to be released too; common log still might hold data logged before the switch
+	// (replayed streams are kept until their index is flushed even when the common log is used)
+	RtBinlog_c * pIndexLog = FindIndexLog ( sIndexName );
+	if ( pIndexLog )
+		pIndexLog->NotifyIndexFlush ( sIndexName, iTID, bShutdown );
+
 	MEMORY ( MEM_BINLOG );
 	assert ( bShutdown || m_dLogFiles.GetLength() );
 
@@ -9396,7 +9933,7 @@ void RtBinlog_c::NotifyIndexFlush ( const char * sIndexName, int64_t iTID, bool
 		}
 
 		// do unlink
-		CSphString sLog = MakeBinlogName ( m_sLogPath.cstr(), tLog.m_iExt );
+		CSphString sLog = MakeBinlogName ( m_sLogPath.cstr(), m_sPrefix.cstr(), tLog.m_iExt );
 		if ( ::unlink ( sLog.cstr() ) )
 			sphWarning ( "binlog: failed to unlink %s: %s (remove it manually)", sLog.cstr(), strerrorm(errno) );
 
@@ -9442,6 +9979,12 @@ void RtBinlog_c::Configure ( const CSphConfigSection & hSearchd, bool bTestMode
 
 	m_iRestartSize = hSearchd.GetSize ( "binlog_max_log_size", m_iRestartSize );
 
+	m_iReplayThreads = hSearchd.GetInt ( "binlog_replay_threads", 0 );
+	if ( m_iReplayThreads<=0 )
+		m_iReplayThreads = sphCpuThreadsCount();
+
+	m_bPerIndex = ( hSearchd.GetInt ( "binlog_common", 1 )==0 );
+
 	if ( !m_bDisabled )
 	{
 		LockFile ( true );
@@ -9459,12 +10002,27 @@ void RtBinlog_c::Replay ( const SmallStringHash_T<CSphIndex*> & hIndexes, DWORD
 	if ( pfnProgressCallback )
 		pfnProgressCallback();
 
-	int64_t tmReplay = sphMicroTimer();
 	// do replay
+	// per-index streams are replayed whatever the current mode, as they might hold data logged prior to switching back.
+	// mode only changes on restart, so common log files and streams never interleave in time;
+	// every stream file goes before the first common log file started after it, so that each index gets its txns in TID order
 	m_bReplayMode = true;
+	CSphVector<RtBinlog_c *> dStreams;
+	LoadIndexLogs ( hIndexes, dStreams );
+
+	CSphVector<int> dReplayed ( dStreams.GetLength() );
+	CSphVector<int> dStreamStates ( dStreams.GetLength() );
+	dReplayed.Fill ( 0 );
+	dStreamStates.Fill ( 0 );
+
+	int64_t tmReplay = sphMicroTimer();
 	int iLastLogState = 0;
 	ARRAY_FOREACH ( i, m_dLogFiles )
 	{
+		int64_t tmStart = GetLogStart ( i );
+		if ( tmStart>=0 )
+			ReplayIndexLogs ( hIndexes, uReplayFlags, dStreams, dReplayed, dStreamStates, tmStart );
+
 		iLastLogState = ReplayBinlog ( hIndexes, uReplayFlags, i );
 		if ( pfnProgressCallback ) // on each replayed binlog
 			pfnProgressCallback();
@@ -9473,11 +10031,12 @@ void RtBinlog_c::Replay ( const SmallStringHash_T<CSphIndex*> & hIndexes, DWORD
 	if ( m_dLogFiles.GetLength()>0 )
 	{
 		tmReplay = sphMicroTimer() - tmReplay;
-		sphInfo ( "binlog: finished replaying total %d in %d.%03d sec",
-			m_dLogFiles.GetLength(),
+		sphInfo ( "binlog: finished replaying total %d in %d.%03d sec", m_dLogFiles.GetLength(),
 			(int)(tmReplay/1000000), (int)((tmReplay/1000)%1000) );
 	}
 
+	ReplayIndexLogs ( hIndexes, uReplayFlags, dStreams, dReplayed, dStreamStates, INT64_MAX );
+
 	// FIXME?
 	// in some cases, indexes might had been flushed during replay
 	// and we might therefore want to update m_iFlushedTID everywhere
@@ -9486,6 +10045,157 @@ void RtBinlog_c::Replay ( const SmallStringHash_T<CSphIndex*> & hIndexes, DWORD
 	// resume normal operation
 	m_bReplayMode = false;
 	OpenNewLog ( iLastLogState );
+
+	ARRAY_FOREACH ( i, dStreams )
+		dStreams[i]->OpenNewLog ( dStreamStates[i] );
+}
+
+/// timestamp of the first txn in the log file; -1 if there is none
+int64_t RtBinlog_c::GetLogStart ( int iBinlog ) const
+{
+	CSphString sError;
+	const CSphString sLog ( MakeBinlogName ( m_sLogPath.cstr(), m_sPrefix.cstr(), m_dLogFiles[iBinlog].m_iExt ) );
+
+	BinlogReader_c tReader;
+	if ( !tReader.Open ( sLog, sError ) || !tReader.GetFilesize() )
+		return -1;
+
+	if ( tReader.GetDword()!=BINLOG_HEADER_MAGIC || tReader.GetDword()!=BINLOG_VERSION )
+		return -1;
+
+	// fresh file always starts with the index of its first txn
+	if ( tReader.GetFilesize()==tReader.GetPos() || tReader.GetDword()!=BLOP_MAGIC || tReader.UnzipOffset()!=BLOP_ADD_INDEX )
+		return -1;
+
+	tReader.UnzipOffset(); // index id
+	tReader.GetString(); // index name
+	tReader.UnzipOffset(); // TID
+	int64_t tmStart = (int64_t)tReader.UnzipOffset();
+	return tReader.GetErrorFlag() ? -1 : tmStart;
+}
+
+int RtBinlog_c::ReplayLogs ( const SmallStringHash_T<CSphIndex*> & hIndexes, DWORD uReplayFlags, int iFrom, int iTo )
+{
+	int64_t tmReplay = sphMicroTimer();
+	int iLastLogState = 0;
+	for ( int i=iFrom; i<iTo; ++i )
+		iLastLogState = ReplayBinlog ( hIndexes, uReplayFlags, i );
+
+	if ( iTo>iFrom )
+	{
+		tmReplay = sphMicroTimer() - tmReplay;
+		sphInfo ( "binlog: finished replaying %s total %d in %d.%03d sec", m_sPrefix.cstr(), iTo-iFrom,
+			(int)(tmReplay/1000000), (int)((tmReplay/1000)%1000) );
+	}
+
+	return iLastLogState;
+}
+
+
+/// replays files range of per-index streams; streams are taken from the shared counter
+struct BinlogStreamReplayJob_t : public ISphJob
+{
+	const CSphVector<RtBinlog_c *> &		m_dLogs;
+	const CSphVector<int> &					m_dFrom;
+	const CSphVector<int> &					m_dTo;
+	CSphVector<int> &						m_dLastStates;
+	const SmallStringHash_T<CSphIndex*> &	m_hIndexes;
+	DWORD									m_uReplayFlags;
+	CSphAtomic &							m_tLogCounter;
+
+	BinlogStreamReplayJob_t ( const CSphVector<RtBinlog_c *> & dLogs, const CSphVector<int> & dFrom, const CSphVector<int> & dTo,
+		CSphVector<int> & dLastStates, const SmallStringHash_T<CSphIndex*> & hIndexes, DWORD uReplayFlags, CSphAtomic & tLogCounter )
+		: m_dLogs ( dLogs )
+		, m_dFrom ( dFrom )
+		, m_dTo ( dTo )
+		, m_dLastStates ( dLastStates )
+		, m_hIndexes ( hIndexes )
+		, m_uReplayFlags ( uReplayFlags )
+		, m_tLogCounter ( tLogCounter )
+	{}
+
+	void Call () final
+	{
+		while ( true )
+		{
+			int iLog = m_tLogCounter.Inc();
+			if ( iLog>=m_dLogs.GetLength() )
+				break;
+
+			if ( m_dFrom[iLog]==m_dTo[iLog] )
+				continue;
+
+			RtBinlog_c * pLog = m_dLogs[iLog];
+			pLog->m_bReplayMode = true;
+			m_dLastStates[iLog] = pLog->ReplayLogs ( m_hIndexes, m_uReplayFlags, m_dFrom[iLog], m_dTo[iLog] );
+			pLog->m_bReplayMode = false;
+		}
+	}
+};
+
+
+/// picks up streams of the served indexes only; streams of gone indexes are left on disk untouched
+void RtBinlog_c::LoadIndexLogs ( const SmallStringHash_T<CSphIndex*> & hIndexes, CSphVector<RtBinlog_c *> & dLogs )
+{
+	hIndexes.IterateStart();
+	while ( hIndexes.IterateNext() )
+	{
+		CSphString sMeta;
+		sMeta.SetSprintf ( "%s/binlog.%s.meta", m_sLogPath.cstr(), hIndexes.IterateGetKey().cstr() );
+		if ( !sphIsReadable ( sMeta.cstr() ) )
+			continue;
+
+		RtBinlog_c * pLog = CreateIndexLog ( hIndexes.IterateGetKey().cstr() );
+		m_hIndexLogs.Add ( pLog, hIndexes.IterateGetKey() );
+		m_dIndexLogs.Add ( pLog );
+		dLogs.Add ( pLog );
+	}
+}
+
+
+/// replays the not yet replayed files of the streams that were started prior to tmBefore
+void RtBinlog_c::ReplayIndexLogs ( const SmallStringHash_T<CSphIndex*> & hIndexes, DWORD uReplayFlags,
+	const CSphVector<RtBinlog_c *> & dLogs, CSphVector<int> & dReplayed, CSphVector<int> & dLastStates, int64_t tmBefore )
+{
+	CSphVector<int> dTo ( dLogs.GetLength() );
+	int iBusy = 0;
+	ARRAY_FOREACH ( i, dLogs )
+	{
+		dTo[i] = dReplayed[i];
+		while ( dTo[i]<dLogs[i]->m_dLogFiles.GetLength() && dLogs[i]->GetLogStart ( dTo[i] )<tmBefore )
+			++dTo[i];
+
+		if ( dTo[i]>dReplayed[i] )
+			++iBusy;
+	}
+
+	if ( !iBusy )
+		return;
+
+	CSphAtomic tLogCounter;
+	BinlogStreamReplayJob_t tJobMain ( dLogs, dReplayed, dTo, dLastStates, hIndexes, uReplayFlags, tLogCounter );
+
+	// one job always goes at current thread
+	int iThreads = Min ( m_iReplayThreads, iBusy );
+	ISphThdPool * pPool = nullptr;
+	if ( iThreads>1 )
+	{
+		CSphString sError;
+		pPool = sphThreadPoolCreate ( iThreads-1, "binlog_replay", sError );
+		if ( !pPool )
+			sphWarning ( "binlog: failed to create thread_pool, single thread replay used: %s", sError.cstr() );
+	}
+
+	if ( pPool )
+		for ( int i=1; i<iThreads; ++i )
+			pPool->AddJob ( new BinlogStreamReplayJob_t ( dLogs, dReplayed, dTo, dLastStates, hIndexes, uReplayFlags, tLogCounter ) );
+
+	tJobMain.Call();
+	if ( pPool )
+		pPool->Shutdown();
+	SafeDelete ( pPool );
+
+	dReplayed.SwapData ( dTo );
 }
 
 void RtBinlog_c::GetFlushInfo ( BinlogFlushInfo_t & tFlush )
@@ -9509,17 +10219,25 @@ void RtBinlog_c::DoAutoFlush ( void * pBinlog )
 		MEMORY ( MEM_BINLOG );
 
 		pLog->m_iFlushTimeLeft = sphMicroTimer() + pLog->m_iFlushPeriod;
+		pLog->AutoFlush();
 
-		if ( pLog->m_eOnCommit==ACTION_NONE || pLog->m_tWriter.HasUnwrittenData() )
-		{
-			Verify ( pLog->m_tWriteLock.Lock() );
-			pLog->m_tWriter.Flush();
-			Verify ( pLog->m_tWriteLock.Unlock() );
-		}
+		ScRL_t tLock ( pLog->m_tIndexLogsLock );
+		ARRAY_FOREACH ( i, pLog->m_dIndexLogs )
+			pLog->m_dIndexLogs[i]->AutoFlush();
+	}
+}
 
-		if ( pLog->m_tWriter.HasUnsyncedData() )
-			pLog->m_tWriter.Fsync();
+void RtBinlog_c::AutoFlush ()
+{
+	if ( m_eOnCommit==ACTION_NONE || m_tWriter.HasUnwrittenData() )
+	{
+		Verify ( m_tWriteLock.Lock() );
+		m_tWriter.Flush();
+		Verify ( m_tWriteLock.Unlock() );
 	}
+
+	if ( m_tWriter.HasUnsyncedData() )
+		m_tWriter.Fsync();
 }
 
 int RtBinlog_c::GetWriteIndexID ( const char * sName, int64_t iTID, int64_t tmNow )
@@ -9570,7 +10288,7 @@ void RtBinlog_c::LoadMeta ()
 	MEMORY ( MEM_BINLOG );
 
 	CSphString sMeta;
-	sMeta.SetSprintf ( "%s/binlog.meta", m_sLogPath.cstr() );
+	sMeta.SetSprintf ( "%s/%s.meta", m_sLogPath.cstr(), m_sPrefix.cstr() );
 	if ( !sphIsReadable ( sMeta.cstr() ) )
 		return;
 
@@ -9617,8 +10335,8 @@ void RtBinlog_c::SaveMeta ()
 	MEMORY ( MEM_BINLOG );
 
 	CSphString sMeta, sMetaOld;
-	sMeta.SetSprintf ( "%s/binlog.meta.new", m_sLogPath.cstr() );
-	sMetaOld.SetSprintf ( "%s/binlog.meta", m_sLogPath.cstr() );
+	sMeta.SetSprintf ( "%s/%s.meta.new", m_sLogPath.cstr(), m_sPrefix.cstr() );
+	sMetaOld.SetSprintf ( "%s/%s.meta", m_sLogPath.cstr(), m_sPrefix.cstr() );
 
 	CSphString sError;
 
@@ -9690,7 +10408,7 @@ void RtBinlog_c::OpenNewLog ( int iLastState )
 	m_dLogFiles.Add ( tLog );
 
 	// create file
-	CSphString sLog = MakeBinlogName ( m_sLogPath.cstr(), tLog.m_iExt );
+	CSphString sLog = MakeBinlogName ( m_sLogPath.cstr(), m_sPrefix.cstr(), tLog.m_iExt );
 
 	if ( !iLastState ) // reuse the last binlog since it is empty or useless.
 		::unlink ( sLog.cstr() );
@@ -9766,7 +10484,7 @@ int RtBinlog_c::ReplayBinlog ( const SmallStringHash_T<CSphIndex*> & hIndexes, D
 	assert ( iBinlog>=0 && iBinlog<m_dLogFiles.GetLength() );
 	CSphString sError;
 
-	const CSphString sLog ( MakeBinlogName ( m_sLogPath.cstr(), m_dLogFiles[iBinlog].m_iExt ) );
+	const CSphString sLog ( MakeBinlogName ( m_sLogPath.cstr(), m_sPrefix.cstr(), m_dLogFiles[iBinlog].m_iExt ) );
 	BinlogFileDesc_t & tLog = m_dLogFiles[iBinlog];
 
 	// open, check, play
@@ -9817,9 +10535,19 @@ int RtBinlog_c::ReplayBinlog ( const SmallStringHash_T<CSphIndex*> & hIndexes, D
 	m_iReplayedRows = 0;
 	int64_t tmReplay = sphMicroTimer();
 
+	// txns are read and checked sequentially, but applied to the indexes in batches
+	BinlogReplayBatch_t tBatch;
+	tBatch.m_iStartPos = tReader.GetPos();
+
 	while ( iFileSize!=tReader.GetPos() && !tReader.GetErrorFlag() && bReplayOK )
 	{
 		iPos = tReader.GetPos();
+		if ( iPos-tBatch.m_iStartPos>=BINLOG_REPLAY_BATCH )
+		{
+			ReplayApplyBatch ( iBinlog, tBatch );
+			tBatch.m_iStartPos = iPos;
+		}
+
 		if ( tReader.GetDword()!=BLOP_MAGIC )
 		{
 			sphDie ( "binlog: log missing txn marker at pos=" INT64_FMT " (corrupted?)", iPos );
@@ -9836,11 +10564,11 @@ int RtBinlog_c::ReplayBinlog ( const SmallStringHash_T<CSphIndex*> & hIndexes, D
 		switch ( uOp )
 		{
 			case BLOP_COMMIT:
-				bReplayOK = ReplayCommit ( iBinlog, uReplayFlags, tReader );
+				bReplayOK = ReplayCommit ( iBinlog, uReplayFlags, tReader, tBatch );
 				break;
 
 			case BLOP_UPDATE_ATTRS:
-				bReplayOK = ReplayUpdateAttributes ( iBinlog, tReader );
+				bReplayOK = ReplayUpdateAttributes ( iBinlog, tReader, tBatch );
 				break;
 
 			case BLOP_ADD_INDEX:
@@ -9855,7 +10583,7 @@ int RtBinlog_c::ReplayBinlog ( const SmallStringHash_T<CSphIndex*> & hIndexes, D
 				break;
 
 			case BLOP_RECONFIGURE:
-				bReplayOK = ReplayReconfigure ( iBinlog, uReplayFlags, tReader );
+				bReplayOK = ReplayReconfigure ( iBinlog, uReplayFlags, tReader, tBatch );
 				break;
 
 			default:
@@ -9866,6 +10594,9 @@ int RtBinlog_c::ReplayBinlog ( const SmallStringHash_T<CSphIndex*> & hIndexes, D
 		dTotal [ BLOP_TOTAL ]++;
 	}
 
+	// txns that passed the checks are applied even if the log is broken further
+	ReplayApplyBatch ( iBinlog, tBatch );
+
 	tmReplay = sphMicroTimer() - tmReplay;
 
 	if ( tReader.GetErrorFlag() )
@@ -9922,7 +10653,13 @@ static BinlogIndexInfo_t & ReplayIndexID ( BinlogReader_c & tReader, BinlogFileD
 }
 
 
-bool RtBinlog_c::ReplayCommit ( int iBinlog, DWORD uReplayFlags, BinlogReader_c & tReader ) const
+static int ReplayIndexNum ( const BinlogFileDesc_t & tLog, const BinlogIndexInfo_t & tIndex )
+{
+	return int ( &tIndex - tLog.m_dIndexInfos.Begin() );
+}
+
+
+bool RtBinlog_c::ReplayCommit ( int iBinlog, DWORD uReplayFlags, BinlogReader_c & tReader, BinlogReplayBatch_t & tBatch ) const
 {
 	// load and lookup index
 	const int64_t iTxnPos = tReader.GetPos();
@@ -9981,30 +10718,17 @@ bool RtBinlog_c::ReplayCommit ( int iBinlog, DWORD uReplayFlags, BinlogReader_c
 		tIndex.m_tmMax = tmStamp;
 	}
 
-	// only replay transaction when index exists and does not have it yet (based on TID)
-	if ( tIndex.m_pRT && iTID > tIndex.m_pRT->m_iTID )
+	// only queue transaction when index exists; actual TID check happens on apply
+	if ( tIndex.m_pRT )
 	{
-		// we normally expect per-index TIDs to be sequential
-		// but let's be graceful about that
-		if ( iTID!=tIndex.m_pRT->m_iTID+1 )
-			sphWarning ( "binlog: commit: unexpected tid (index=%s, indextid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ")",
-				tIndex.m_sName.cstr(), tIndex.m_pRT->m_iTID, iTID, iTxnPos );
-
-		// in case dict=keywords
-		// + cook checkpoint
-		// + build infixes
-		if ( tIndex.m_pRT->IsWordDict() && pSeg.Ptr() )
-		{
-			FixupSegmentCheckpoints ( pSeg.Ptr() );
-			BuildSegmentInfixes ( pSeg.Ptr(), tIndex.m_pRT->GetDictionary()->HasMorphology(),
-				tIndex.m_pRT->IsWordDict(), tIndex.m_pRT->GetSettings().m_iMinInfixLen, tIndex.m_pRT->GetWordCheckoint(), ( tIndex.m_pRT->GetMaxCodepointLength()>1 ) );
-		}
-
-		// actually replay
-		tIndex.m_pRT->CommitReplayable ( pSeg.LeakPtr(), dKlist, NULL );
-
-		// update committed tid on replay in case of unexpected / mismatched tid
-		tIndex.m_pRT->m_iTID = iTID;
+		auto * pTxn = new BinlogReplayTxn_t;
+		pTxn->m_eOp = BLOP_COMMIT;
+		pTxn->m_iIndex = ReplayIndexNum ( tLog, tIndex );
+		pTxn->m_iTID = iTID;
+		pTxn->m_iTxnPos = iTxnPos;
+		pTxn->m_pSeg = pSeg.LeakPtr();
+		pTxn->m_dKlist.SwapData ( dKlist );
+		tBatch.m_dTxns.Add ( pTxn );
 	}
 
 	// update info
@@ -10063,7 +10787,7 @@ bool RtBinlog_c::ReplayIndexAdd ( int iBinlog, const SmallStringHash_T<CSphIndex
 	return true;
 }
 
-bool RtBinlog_c::ReplayUpdateAttributes ( int iBinlog, BinlogReader_c & tReader ) const
+bool RtBinlog_c::ReplayUpdateAttributes ( int iBinlog, BinlogReader_c & tReader, BinlogReplayBatch_t & tBatch ) const
 {
 	// load and lookup index
 	const int64_t iTxnPos = tReader.GetPos();
@@ -10071,7 +10795,8 @@ bool RtBinlog_c::ReplayUpdateAttributes ( int iBinlog, BinlogReader_c & tReader
 	BinlogIndexInfo_t & tIndex = ReplayIndexID ( tReader, tLog, "update" );
 
 	// load transaction data
-	CSphAttrUpdate tUpd;
+	CSphScopedPtr<CSphAttrUpdate> pUpd ( new CSphAttrUpdate );
+	CSphAttrUpdate & tUpd = *pUpd.Ptr();
 	tUpd.m_bIgnoreNonexistent = true;
 
 	int64_t iTID = (int64_t) tReader.UnzipOffset();
@@ -10102,22 +10827,15 @@ bool RtBinlog_c::ReplayUpdateAttributes ( int iBinlog, BinlogReader_c & tReader
 		sphDie ( "binlog: update: descending time (index=%s, lasttime=" INT64_FMT ", logtime=" INT64_FMT ", pos=" INT64_FMT ")",
 			tIndex.m_sName.cstr(), tIndex.m_tmMax, tmStamp, iTxnPos );
 
-	if ( tIndex.m_pIndex && iTID > tIndex.m_pIndex->m_iTID )
+	if ( tIndex.m_pIndex )
 	{
-		// we normally expect per-index TIDs to be sequential
-		// but let's be graceful about that
-		if ( iTID!=tIndex.m_pIndex->m_iTID+1 )
-			sphWarning ( "binlog: update: unexpected tid (index=%s, indextid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ")",
-				tIndex.m_sName.cstr(), tIndex.m_pIndex->m_iTID, iTID, iTxnPos );
-
-		tUpd.m_dRows.Resize ( tUpd.m_dDocids.GetLength() );
-		ARRAY_FOREACH ( i, tUpd.m_dRows ) tUpd.m_dRows[i] = NULL;
-
-		CSphString sError, sWarning;
-		tIndex.m_pIndex->UpdateAttributes ( tUpd, -1, sError, sWarning ); // FIXME! check for errors
-
-		// update committed tid on replay in case of unexpected / mismatched tid
-		tIndex.m_pIndex->m_iTID = iTID;
+		auto * pTxn = new BinlogReplayTxn_t;
+		pTxn->m_eOp = BLOP_UPDATE_ATTRS;
+		pTxn->m_iIndex = ReplayIndexNum ( tLog, tIndex );
+		pTxn->m_iTID = iTID;
+		pTxn->m_iTxnPos = iTxnPos;
+		pTxn->m_pUpdate = pUpd.LeakPtr();
+		tBatch.m_dTxns.Add ( pTxn );
 	}
 
 	// update info
@@ -10184,7 +10902,7 @@ bool RtBinlog_c::ReplayCacheAdd ( int iBinlog, BinlogReader_c & tReader ) const
 	return true;
 }
 
-bool RtBinlog_c::ReplayReconfigure ( int iBinlog, DWORD uReplayFlags, BinlogReader_c & tReader ) const
+bool RtBinlog_c::ReplayReconfigure ( int iBinlog, DWORD uReplayFlags, BinlogReader_c & tReader, BinlogReplayBatch_t & tBatch ) const
 {
 	// load and lookup index
 	const int64_t iTxnPos = tReader.GetPos();
@@ -10200,7 +10918,8 @@ bool RtBinlog_c::ReplayReconfigure ( int iBinlog, DWORD uReplayFlags, BinlogRead
 	CSphDictSettings tDictSettings;
 	CSphEmbeddedFiles tEmbeddedFiles;
 
-	CSphReconfigureSettings tSettings;
+	CSphScopedPtr<CSphReconfigureSettings> pSettings ( new CSphReconfigureSettings );
+	CSphReconfigureSettings & tSettings = *pSettings.Ptr();
 	LoadIndexSettings ( tSettings.m_tIndex, tReader, INDEX_FORMAT_VERSION );
 	if ( !LoadTokenizerSettings ( tReader, tSettings.m_tTokenizer, tEmbeddedFiles, INDEX_FORMAT_VERSION, sError ) )
 		sphDie ( "binlog: reconfigure: failed to load settings (index=%s, lasttid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ", error=%s)",
@@ -10230,28 +10949,15 @@ bool RtBinlog_c::ReplayReconfigure ( int iBinlog, DWORD uReplayFlags, BinlogRead
 		tIndex.m_tmMax = tmStamp;
 	}
 
-	// only replay transaction when index exists and does not have it yet (based on TID)
-	if ( tIndex.m_pRT && iTID > tIndex.m_pRT->m_iTID )
+	if ( tIndex.m_pRT )
 	{
-		// we normally expect per-index TIDs to be sequential
-		// but let's be graceful about that
-		if ( iTID!=tIndex.m_pRT->m_iTID+1 )
-			sphWarning ( "binlog: reconfigure: unexpected tid (index=%s, indextid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ")",
-				tIndex.m_sName.cstr(), tIndex.m_pRT->m_iTID, iTID, iTxnPos );
-
-		sError = "";
-		CSphReconfigureSetup tSetup;
-		bool bSame = tIndex.m_pRT->IsSameSettings ( tSettings, tSetup, sError );
-
-		if ( !sError.IsEmpty() )
-			sphWarning ( "binlog: reconfigure: wrong settings (index=%s, indextid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ", error=%s)",
-				tIndex.m_sName.cstr(), tIndex.m_pRT->m_iTID, iTID, iTxnPos, sError.cstr() );
-
-		if ( !bSame )
-			tIndex.m_pRT->Reconfigure ( tSetup );
-
-		// update committed tid on replay in case of unexpected / mismatched tid
-		tIndex.m_pRT->m_iTID = iTID;
+		auto * pTxn = new BinlogReplayTxn_t;
+		pTxn->m_eOp = BLOP_RECONFIGURE;
+		pTxn->m_iIndex = ReplayIndexNum ( tLog, tIndex );
+		pTxn->m_iTID = iTID;
+		pTxn->m_iTxnPos = iTxnPos;
+		pTxn->m_pSettings = pSettings.LeakPtr();
+		tBatch.m_dTxns.Add ( pTxn );
 	}
 
 	// update info
@@ -10262,6 +10968,170 @@ bool RtBinlog_c::ReplayReconfigure ( int iBinlog, DWORD uReplayFlags, BinlogRead
 	return true;
 }
 
+/// apply one already checked txn to its index
+static void ReplayApplyTxn ( BinlogIndexInfo_t & tIndex, BinlogReplayTxn_t & tTxn )
+{
+	const int64_t iTID = tTxn.m_iTID;
+	const int64_t iTxnPos = tTxn.m_iTxnPos;
+
+	// only replay transaction when index does not have it yet (based on TID)
+	if ( iTID<=tIndex.m_pIndex->m_iTID )
+		return;
+
+	// we normally expect per-index TIDs to be sequential
+	// but let's be graceful about that
+	if ( iTID!=tIndex.m_pIndex->m_iTID+1 )
+		sphWarning ( "binlog: %s: unexpected tid (index=%s, indextid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ")",
+			tTxn.m_eOp==BLOP_COMMIT ? "commit" : ( tTxn.m_eOp==BLOP_UPDATE_ATTRS ? "update" : "reconfigure" ),
+			tIndex.m_sName.cstr(), tIndex.m_pIndex->m_iTID, iTID, iTxnPos );
+
+	switch ( tTxn.m_eOp )
+	{
+	case BLOP_COMMIT:
+		{
+			RtIndex_t * pRT = tIndex.m_pRT;
+			assert ( pRT );
+
+			// in case dict=keywords
+			// + cook checkpoint
+			// + build infixes
+			if ( pRT->IsWordDict() && tTxn.m_pSeg.Ptr() )
+			{
+				FixupSegmentCheckpoints ( tTxn.m_pSeg.Ptr() );
+				BuildSegmentInfixes ( tTxn.m_pSeg.Ptr(), pRT->GetDictionary()->HasMorphology(),
+					pRT->IsWordDict(), pRT->GetSettings().m_iMinInfixLen, pRT->GetWordCheckoint(), ( pRT->GetMaxCodepointLength()>1 ) );
+				BuildSegmentInfixNgrams ( tTxn.m_pSeg.Ptr(), pRT->GetDictionary()->HasMorphology(),
+					pRT->IsWordDict(), pRT->GetSettings().m_iMinInfixLen, pRT->GetWordCheckoint(), ( pRT->GetMaxCodepointLength()>1 ) );
+			}
+
+			// actually replay
+			pRT->CommitReplayable ( tTxn.m_pSeg.LeakPtr(), tTxn.m_dKlist, NULL );
+		}
+		break;
+
+	case BLOP_UPDATE_ATTRS:
+		{
+			CSphAttrUpdate & tUpd = *tTxn.m_pUpdate.Ptr();
+			tUpd.m_dRows.Resize ( tUpd.m_dDocids.GetLength() );
+			ARRAY_FOREACH ( i, tUpd.m_dRows ) tUpd.m_dRows[i] = NULL;
+
+			CSphString sError, sWarning;
+			tIndex.m_pIndex->UpdateAttributes ( tUpd, -1, sError, sWarning ); // FIXME! check for errors
+		}
+		break;
+
+	case BLOP_RECONFIGURE:
+		{
+			RtIndex_t * pRT = tIndex.m_pRT;
+			assert ( pRT );
+
+			CSphString sError;
+			CSphReconfigureSetup tSetup;
+			bool bSame = pRT->IsSameSettings ( *tTxn.m_pSettings.Ptr(), tSetup, sError );
+
+			if ( !sError.IsEmpty() )
+				sphWarning ( "binlog: reconfigure: wrong settings (index=%s, indextid=" INT64_FMT ", logtid=" INT64_FMT ", pos=" INT64_FMT ", error=%s)",
+					tIndex.m_sName.cstr(), pRT->m_iTID, iTID, iTxnPos, sError.cstr() );
+
+			if ( !bSame )
+				pRT->Reconfigure ( tSetup );
+		}
+		break;
+
+	default:
+		assert ( 0 && "unexpected replayed txn" );
+		break;
+	}
+
+	// update committed tid on replay in case of unexpected / mismatched tid
+	tIndex.m_pIndex->m_iTID = iTID;
+}
+
+
+struct CmpReplayTxn_fn
+{
+	inline bool IsLess ( const BinlogReplayTxn_t * a, const BinlogReplayTxn_t * b ) const
+	{
+		return ( a->m_iIndex<b->m_iIndex ) || ( a->m_iIndex==b->m_iIndex && a->m_iTxnPos<b->m_iTxnPos );
+	}
+};
+
+
+/// applies txns of one index at a time; indexes are taken from the shared counter
+struct BinlogReplayJob_t : public ISphJob
+{
+	CSphVector<BinlogIndexInfo_t> &			m_dIndexInfos;
+	const CSphVector<BinlogReplayTxn_t *> &	m_dTxns;		///< sorted by index, then by log position
+	const CSphVector<int> &					m_dGroups;		///< per-index txn spans starts, plus terminating end
+	CSphAtomic &							m_tGroupCounter;
+
+	BinlogReplayJob_t ( CSphVector<BinlogIndexInfo_t> & dIndexInfos, const CSphVector<BinlogReplayTxn_t *> & dTxns,
+		const CSphVector<int> & dGroups, CSphAtomic & tGroupCounter )
+		: m_dIndexInfos ( dIndexInfos )
+		, m_dTxns ( dTxns )
+		, m_dGroups ( dGroups )
+		, m_tGroupCounter ( tGroupCounter )
+	{}
+
+	void Call () final
+	{
+		while ( true )
+		{
+			int iGroup = m_tGroupCounter.Inc();
+			if ( iGroup>=m_dGroups.GetLength()-1 )
+				break;
+
+			for ( int i=m_dGroups[iGroup]; i<m_dGroups[iGroup+1]; ++i )
+			{
+				BinlogReplayTxn_t & tTxn = *m_dTxns[i];
+				ReplayApplyTxn ( m_dIndexInfos[tTxn.m_iIndex], tTxn );
+			}
+		}
+	}
+};
+
+
+void RtBinlog_c::ReplayApplyBatch ( int iBinlog, BinlogReplayBatch_t & tBatch ) const
+{
+	if ( !tBatch.m_dTxns.GetLength() )
+		return;
+
+	CSphVector<BinlogReplayTxn_t *> & dTxns = tBatch.m_dTxns;
+	dTxns.Sort ( CmpReplayTxn_fn() );
+
+	CSphVector<int> dGroups;
+	ARRAY_FOREACH ( i, dTxns )
+		if ( !i || dTxns[i]->m_iIndex!=dTxns[i-1]->m_iIndex )
+			dGroups.Add ( i );
+	dGroups.Add ( dTxns.GetLength() );
+
+	CSphAtomic tGroupCounter;
+	BinlogReplayJob_t tJobMain ( m_dLogFiles[iBinlog].m_dIndexInfos, dTxns, dGroups, tGroupCounter );
+
+	// one job always goes at current thread
+	int iThreads = Min ( m_iReplayThreads, dGroups.GetLength()-1 );
+	ISphThdPool * pPool = nullptr;
+	if ( iThreads>1 )
+	{
+		CSphString sError;
+		pPool = sphThreadPoolCreate ( iThreads-1, "binlog_replay", sError );
+		if ( !pPool )
+			sphWarning ( "binlog: failed to create thread_pool, single thread replay used: %s", sError.cstr() );
+	}
+
+	if ( pPool )
+		for ( int i=1; i<iThreads; ++i )
+			pPool->AddJob ( new BinlogReplayJob_t ( m_dLogFiles[iBinlog].m_dIndexInfos, dTxns, dGroups, tGroupCounter ) );
+
+	tJobMain.Call();
+	if ( pPool )
+		pPool->Shutdown();
+	SafeDelete ( pPool );
+
+	tBatch.Reset();
+}
+
+
 void RtBinlog_c::CheckPath ( const CSphConfigSection & hSearchd, bool bTestMode )
 {
 #ifndef DATADIR
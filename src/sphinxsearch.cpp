@@ -1109,6 +1109,7 @@ public:
 	virtual bool				InitState ( const CSphQueryContext &, CSphString & )	{ return true; }
 
 	virtual void				FinalizeCache ( const ISphSchema & tSorterSchema );
+	void						SetQcacheFlight ( QcacheFlight_t * pFlight ) { m_pQcacheFlight = pFlight; }
 
 public:
 	// FIXME? hide and friend?
@@ -1133,8 +1134,12 @@ protected:
 	CSphMatch					m_tTestMatch;
 	const CSphIndex *			m_pIndex = nullptr;					///< this is he who'll do my filtering!
 	CSphQueryContext *			m_pCtx = nullptr;
+	CSphQueryStats *			m_pStats = nullptr;
 	int64_t *					m_pNanoBudget = nullptr;
+	int64_t						m_iMaxTimer = 0;					///< max_query_time deadline, to tell if the result got cut short
+	bool						m_bExhausted = false;				///< doclist was read up to its end (ie. not stopped by cutoff)
 	QcacheEntry_c *				m_pQcacheEntry = nullptr;			///< data to cache if we decide that the current query is worth caching
+	QcacheFlight_t *			m_pQcacheFlight = nullptr;			///< identical concurrent queries waiting for our result, if we lead
 
 protected:
 	StrVec_t					m_dZones;
@@ -1531,6 +1536,7 @@ private:
 
 	int64_t							m_iMaxTimer;		///< work until this timestamp
 	CSphString *					m_pWarning;
+	QueryMemTracker_c				m_tMemory;			///< cached docs and hits, against the query memory limit
 
 public:
 	explicit						ExtPayload_c ( const XQNode_t * pNode, const ISphQwordSetup & tSetup );
@@ -1600,8 +1606,10 @@ void ExtPayload_c::PopulateCache ( const ISphQwordSetup & tSetup, bool bFillStat
 		m_tWord.m_iHits = pQword->m_iHits;
 	}
 	m_dCache.Reserve ( Max ( pQword->m_iHits, pQword->m_iDocs ) );
+	m_tMemory.Set ( int64_t ( m_dCache.GetLimit() )*sizeof(ExtPayloadEntry_t) );
 
 	// read and cache all docs and hits
+	int iDocs = 0;
 	if ( bOk )
 		while (true)
 	{
@@ -1609,6 +1617,14 @@ void ExtPayload_c::PopulateCache ( const ISphQwordSetup & tSetup, bool bFillStat
 		if ( !tMatch.m_uDocID )
 			break;
 
+		// huge expansions take a while; keep tracking memory and stop along with the query
+		if ( ( ++iDocs & 0xfff )==0 )
+		{
+			m_tMemory.Set ( int64_t ( m_dCache.GetLimit() )*sizeof(ExtPayloadEntry_t) );
+			if ( sphQueryStopped() )
+				break;
+		}
+
 		pQword->SeekHitlist ( pQword->m_iHitlistPos );
 		for ( Hitpos_t uHit = pQword->GetNextHit(); uHit!=EMPTY_HIT; uHit = pQword->GetNextHit() )
 		{
@@ -1631,6 +1647,7 @@ void ExtPayload_c::PopulateCache ( const ISphQwordSetup & tSetup, bool bFillStat
 		}
 	}
 
+	m_tMemory.Set ( int64_t ( m_dCache.GetLimit() )*sizeof(ExtPayloadEntry_t) );
 	m_dCache.Sort();
 	if ( bFillStat && m_dCache.GetLength() )
 	{
@@ -1688,6 +1705,14 @@ const ExtDoc_t * ExtPayload_c::GetDocsChunk()
 		return NULL;
 	}
 
+	// KILL, client disconnect, or query cpu and memory limits
+	if ( sphQueryStopped() )
+	{
+		if ( m_pWarning )
+			*m_pWarning = "query was stopped";
+		return NULL;
+	}
+
 	int iDoc = 0;
 	int iEnd = m_iCurDocsEnd; // shortcut, and vs2005 optimization
 	while ( iDoc<MAX_DOCS-1 && iEnd<m_dCache.GetLength() )
@@ -2074,6 +2099,14 @@ const ExtDoc_t * ExtTerm_c::GetDocsChunk()
 		return NULL;
 	}
 
+	// KILL, client disconnect, or query cpu and memory limits
+	if ( sphQueryStopped() )
+	{
+		if ( m_pWarning )
+			*m_pWarning = "query was stopped";
+		return NULL;
+	}
+
 	int iDoc = 0;
 	CSphRowitem * pDocinfo = m_pDocinfo;
 	while ( iDoc<MAX_DOCS-1 )
@@ -5848,7 +5881,9 @@ ExtRanker_c::ExtRanker_c ( const XQQuery_t & tXQ, const ISphQwordSetup & tSetup,
 
 	m_pIndex = tSetup.m_pIndex;
 	m_pCtx = tSetup.m_pCtx;
+	m_pStats = tSetup.m_pStats;
 	m_pNanoBudget = tSetup.m_pStats ? tSetup.m_pStats->m_pNanoBudget : NULL;
+	m_iMaxTimer = tSetup.m_iMaxTimer;
 
 	m_dZones = tXQ.m_dZones;
 	m_dZoneStart.Resize ( m_dZones.GetLength() );
@@ -5889,6 +5924,9 @@ ExtRanker_c::ExtRanker_c ( const XQQuery_t & tXQ, const ISphQwordSetup & tSetup,
 
 ExtRanker_c::~ExtRanker_c ()
 {
+	// bailed out before finalizing; let the followers compute on their own
+	if ( m_pQcacheFlight )
+		QcacheLeaveFlight ( m_pQcacheFlight, NULL );
 	SafeRelease ( m_pQcacheEntry );
 
 	SafeDelete ( m_pRoot );
@@ -5930,6 +5968,8 @@ void ExtRanker_c::Reset ( const ISphQwordSetup & tSetup )
 		m_dZoneInfo[i].Reset();
 	}
 
+	m_bExhausted = false;
+
 	// Ranker::Reset() happens on a switch to next RT segment
 	// next segment => new and shiny docids => gotta restart encoding
 	if ( m_pQcacheEntry )
@@ -5947,9 +5987,20 @@ void ExtRanker_c::UpdateQcache ( int iMatches )
 
 void ExtRanker_c::FinalizeCache ( const ISphSchema & tSorterSchema )
 {
-	if ( m_pQcacheEntry )
+	// stopped query (KILL, limits, client gone) has a truncated doclist; neither cache nor share it
+	// same goes for the one cut short by cutoff, max_query_time or max_predicted_time, as it has no warning to pass along
+	bool bComplete = m_bExhausted && !sphQueryStopped()
+		&& !( m_iMaxTimer>0 && sphMicroTimer()>=m_iMaxTimer )
+		&& !( m_pNanoBudget && *m_pNanoBudget<0 );
+
+	if ( m_pQcacheEntry && bComplete )
 		QcacheAdd ( m_pCtx->m_tQuery, m_pQcacheEntry, tSorterSchema );
 
+	// share the result with identical queries that waited for us, even if it was too fast to cache
+	if ( m_pQcacheFlight )
+		QcacheLeaveFlight ( m_pQcacheFlight, bComplete ? m_pQcacheEntry : nullptr );
+	m_pQcacheFlight = nullptr;
+
 	SafeRelease ( m_pQcacheEntry );
 }
 
@@ -5968,6 +6019,7 @@ const ExtDoc_t * ExtRanker_c::GetFilteredDocs ()
 		const ExtDoc_t * pCand = m_pRoot->GetDocsChunk();
 		if ( !pCand )
 		{
+			m_bExhausted = true;
 			if ( m_pCtx->m_pProfile )
 				m_pCtx->m_pProfile->Switch ( SPH_QSTATE_RANK );
 			return NULL;
@@ -5987,6 +6039,8 @@ const ExtDoc_t * ExtRanker_c::GetFilteredDocs ()
 
 			if ( m_pIndex->EarlyReject ( m_pCtx, m_tTestMatch ) )
 			{
+				if ( m_pStats )
+					m_pStats->m_iFiltered++;
 				pCand++;
 				continue;
 			}
@@ -9396,10 +9450,13 @@ ISphRanker * sphCreateRanker ( const XQQuery_t & tXQ, const CSphQuery * pQuery,
 	bool bGotDupes = HasQwordDupes ( tXQ.m_pRoot );
 	bool bSkipQCache = tCtx.m_bSkipQCache;
 
-	// can we serve this from cache?
+	// can we serve this from cache, or from an identical query that is being computed right now?
 	QcacheEntry_c * pCached = NULL;
+	QcacheFlight_t * pFlight = NULL;
 	if ( !bSkipQCache )
 		pCached = QcacheFind ( pIndex->GetIndexId(), *pQuery, tSorterSchema );
+	if ( !pCached && !bSkipQCache )
+		pCached = QcacheJoinFlight ( pIndex->GetIndexId(), *pQuery, tSorterSchema, tTermSetup.m_iMaxTimer, &pFlight );
 	if ( pCached )
 		return QcacheRanker ( pCached, tTermSetup );
 	SafeRelease ( pCached );
@@ -9488,6 +9545,7 @@ ISphRanker * sphCreateRanker ( const XQQuery_t & tXQ, const CSphQuery * pQuery,
 	}
 	assert ( pRanker );
 	pRanker->m_uPayloadMask = uPayloadMask;
+	pRanker->SetQcacheFlight ( pFlight );
 
 	// setup IDFs
 	ExtQwordsHash_t hQwords;
@@ -119,6 +119,7 @@ protected:
 
 private:
 	const int					m_iDataLength;
+	QueryMemTracker_c			m_tMemory;	///< matches storage, against the query memory limit
 
 public:
 	/// ctor
@@ -130,11 +131,19 @@ public:
 		assert ( iSize>0 );
 		m_pData = new CSphMatch [ m_iDataLength ];
 		assert ( m_pData );
+		m_tMemory.Set ( int64_t ( m_iDataLength ) * sizeof(CSphMatch) );
 
 		m_tState.m_iNow = (DWORD) time ( nullptr );
 		m_iMatchCapacity = m_iDataLength;
 	}
 
+	/// dynamic rows are allocated as the matches come in, but account for the whole queue right away
+	void SetSchema ( ISphSchema * pSchema ) override
+	{
+		ISphMatchSorter::SetSchema ( pSchema );
+		m_tMemory.Set ( int64_t ( m_iDataLength ) * ( sizeof(CSphMatch) + pSchema->GetDynamicSize()*sizeof(CSphRowitem) ) );
+	}
+
 	/// dtor
 	~CSphMatchQueueTraits () override
 	{
@@ -1872,7 +1881,7 @@ public:
 	void SetSchema ( ISphSchema * pSchema ) override
 	{
 		FixupSorterLocators ( *this, m_pSchema, pSchema, &m_tGroupSorter, m_dAggregates, m_tPregroup );
-		ISphMatchSorter::SetSchema ( pSchema );
+		CSphMatchQueueTraits::SetSchema ( pSchema );
 		m_dAvgs.Resize ( 0 );
 		SetupBaseGrouper<DISTINCT> ( pSchema, m_tGroupSorter.m_eKeypart, m_tGroupSorter.m_tLocator, &m_dAvgs );
 	}
@@ -2319,7 +2328,7 @@ public:
 	void SetSchema ( ISphSchema * pSchema ) override
 	{
 		FixupSorterLocators ( *this, m_pSchema, pSchema, &m_tGroupSorter, m_dAggregates, m_tPregroup );
-		ISphMatchSorter::SetSchema ( pSchema );
+		CSphMatchQueueTraits::SetSchema ( pSchema );
 		m_dAvgs.Resize ( 0 );
 		SetupBaseGrouper<DISTINCT> ( pSchema, m_tGroupSorter.m_eKeypart, m_tGroupSorter.m_tLocator, &m_dAvgs );
 	}
@@ -3895,6 +3904,10 @@ ESortClauseParseResult sphParseSortClause ( const CSphQuery * pQuery, const char
 				}
 			}
 
+			// try hot JSON path attribute
+			if ( iAttr<0 )
+				iAttr = sphJsonHotAttrIndex ( tSchema, pTok );
+
 			// try JSON attribute and use JSON attribute instead of JSON field
 			bool bJsonAttr = false;
 
@@ -4248,13 +4261,17 @@ static bool SetupGroupbySettings ( const CSphQuery * pQuery, const ISphSchema &
 		{
 			CSphString sJsonExpr;
 			dJsonKeys.Add ( nullptr );
-			if ( sphJsonNameSplit ( dGroupBy[i].cstr(), &sJsonColumn, &sJsonKey ) )
+
+			// hot JSON paths group as regular attributes
+			int iAttr = sphJsonHotAttrIndex ( tSchema, dGroupBy[i].cstr() );
+			if ( iAttr<0 && sphJsonNameSplit ( dGroupBy[i].cstr(), &sJsonColumn, &sJsonKey ) )
 			{
 				sJsonExpr = dGroupBy[i];
 				dGroupBy[i] = sJsonColumn;
 			}
 
-			const int iAttr = tSchema.GetAttrIndex ( dGroupBy[i].cstr() );
+			if ( iAttr<0 )
+				iAttr = tSchema.GetAttrIndex ( dGroupBy[i].cstr() );
 			if ( iAttr<0 )
 			{
 				sError.SetSprintf ( "group-by attribute '%s' not found", dGroupBy[i].cstr() );
@@ -4282,6 +4299,17 @@ static bool SetupGroupbySettings ( const CSphQuery * pQuery, const ISphSchema &
 
 		tSettings.m_pGrouper = sphCreateGrouperMulti ( dLocators, dAttrTypes, dJsonKeys, pQuery->m_eCollation );
 
+	} else if ( pQuery->m_eGroupFunc==SPH_GROUPBY_ATTR && sphJsonHotAttrIndex ( tSchema, pQuery->m_sGroupBy.cstr() )>=0 )
+	{
+		// hot JSON path, group as a regular attribute
+		const int iAttr = sphJsonHotAttrIndex ( tSchema, pQuery->m_sGroupBy.cstr() );
+		const CSphColumnInfo & tAttr = tSchema.GetAttr(iAttr);
+		if ( tAttr.m_eAttrType==SPH_ATTR_STRING )
+			tSettings.m_pGrouper = sphCreateGrouperString ( tAttr.m_tLocator, pQuery->m_eCollation );
+		else
+			tSettings.m_pGrouper = new CSphGrouperAttr ( tAttr.m_tLocator );
+		dGroupColumns.Add ( iAttr );
+
 	} else if ( sphJsonNameSplit ( pQuery->m_sGroupBy.cstr(), &sJsonColumn, &sJsonKey ) )
 	{
 		const int iAttr = tSchema.GetAttrIndex ( sJsonColumn.cstr() );
@@ -1180,6 +1180,17 @@ void CSphAutoEvent::WaitEvent()
 	WaitForSingleObject ( m_hEvent, INFINITE );
 }
 
+bool CSphAutoEvent::WaitEvent ( int iMsec )
+{
+	if ( m_iSent )
+	{
+		m_iSent = 0;
+		return true;
+	}
+
+	return WaitForSingleObject ( m_hEvent, iMsec )==WAIT_OBJECT_0;
+}
+
 #else
 
 // UNIX mutex implementation
@@ -1291,6 +1302,30 @@ void CSphAutoEvent::WaitEvent()
 	pthread_mutex_unlock ( &m_tMutex );
 }
 
+bool CSphAutoEvent::WaitEvent ( int iMsec )
+{
+	if ( !m_bInitialized )
+		return false;
+
+	struct timeval tvNow;
+	gettimeofday ( &tvNow, nullptr );
+	int64_t iNsec = int64_t ( tvNow.tv_usec )*1000 + int64_t ( iMsec%1000 )*1000000;
+	struct timespec tsTill;
+	tsTill.tv_sec = tvNow.tv_sec + iMsec/1000 + iNsec/1000000000;
+	tsTill.tv_nsec = iNsec%1000000000;
+
+	pthread_mutex_lock ( &m_tMutex );
+	int iRes = 0;
+	while ( !m_iSent && iRes!=ETIMEDOUT )
+		iRes = pthread_cond_timedwait ( &m_tCond, &m_tMutex, &tsTill );
+
+	bool bGot = ( m_iSent>0 );
+	if ( bGot )
+		--m_iSent;
+	pthread_mutex_unlock ( &m_tMutex );
+	return bGot;
+}
+
 #endif
 
 //////////////////////////////////////////////////////////////////////////
@@ -1545,6 +1580,35 @@ int64_t sphMicroTimer()
 #endif // USE_WINDOWS
 }
 
+/// return cpu time, in microseconds
+int64_t sphCpuTimer ()
+{
+#ifdef HAVE_CLOCK_GETTIME
+#if defined (CLOCK_THREAD_CPUTIME_ID)
+// CPU time (user+sys), Linux style, current thread
+#define LOC_CLOCK CLOCK_THREAD_CPUTIME_ID
+#elif defined(CLOCK_PROCESS_CPUTIME_ID)
+// CPU time (user+sys), Linux style
+#define LOC_CLOCK CLOCK_PROCESS_CPUTIME_ID
+#elif defined(CLOCK_PROF)
+// CPU time (user+sys), FreeBSD style
+#define LOC_CLOCK CLOCK_PROF
+#else
+// POSIX fallback (wall time)
+#define LOC_CLOCK CLOCK_REALTIME
+#endif
+
+	struct timespec tp;
+	if ( clock_gettime ( LOC_CLOCK, &tp ) )
+		return 0;
+
+	return tp.tv_sec*1000000 + tp.tv_nsec/1000;
+#else
+	return sphMicroTimer();
+#endif
+}
+
+
 //////////////////////////////////////////////////////////////////////////
 
 int CSphStrHashFunc::Hash ( const CSphString & sKey )
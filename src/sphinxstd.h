@@ -372,6 +372,9 @@ inline double sphQW2D ( uint64_t d )	{ union { double f; uint64_t d; } u; u.d =
 /// current UNIX timestamp in seconds multiplied by 1000000, plus microseconds since the beginning of current second
 int64_t		sphMicroTimer ();
 
+/// current thread cpu time (user+sys), in microseconds; falls back to wall time where not available
+int64_t		sphCpuTimer ();
+
 /// double argument squared
 inline double sqr ( double v ) { return v*v;}
 
@@ -1181,6 +1184,24 @@ public:
 		m_iLimit = 0;
 	}
 
+	/// release reserved but unused tail (realloc to exactly fit the current length)
+	void Shrink ()
+	{
+		if ( m_iLimit==m_iCount )
+			return;
+
+		T * pNew = nullptr;
+		if ( m_iCount )
+		{
+			pNew = new T[m_iCount];
+			POLICY::Move ( pNew, m_pData, m_iCount );
+		}
+		SafeDeleteArray ( m_pData );
+
+		m_pData = pNew;
+		m_iLimit = (int) m_iCount;
+	}
+
 	/// memset whole reserved vec
 	void ZeroMem ()
 	{
@@ -3022,6 +3043,9 @@ public:
 	// decrease event's count. If count empty, go to sleep until new events
 	void WaitEvent();
 
+	// same, but give up after iMsec; returns false on timeout
+	bool WaitEvent ( int iMsec );
+
 	inline bool Initialized() const
 	{
 		return m_bInitialized;
@@ -29,7 +29,7 @@ extern "C" {
 #endif
 
 /// current udf version
-#define SPH_UDF_VERSION 9
+#define SPH_UDF_VERSION 10
 
 /// error buffer size
 #define SPH_UDF_ERROR_LEN 256
@@ -66,6 +66,26 @@ typedef struct st_sphinx_udf_args
 	sphinx_malloc_fn *			fn_malloc;		///< malloc() replacement to allocate returned values
 } SPH_UDF_ARGS;
 
+/// batch UDF call arguments (added in v.10)
+/// optional <name>_batch() function gets a block of rows at once, one column array per argument,
+/// and must write exactly row_count results; it is used instead of per-row calls wherever searchd
+/// evaluates a block of rows, and per-row function (which stays mandatory) is used otherwise
+///
+/// column element types are: unsigned int for UINT32, sphinx_int64_t for INT64, float for FLOAT,
+/// and const char * for everything else (strings and json are not ASCIIZ; see str_lengths below)
+/// result element type is sphinx_int64_t for INT and BIGINT functions, and double for FLOAT ones
+/// STRING functions are always called per-row
+typedef struct st_sphinx_udf_batch_args
+{
+	int							row_count;		///< number of rows in this block
+	int							arg_count;		///< number of arguments
+	enum sphinx_udf_argtype *	arg_types;		///< argument types
+	void **						arg_columns;	///< argument values, row_count per argument
+	char **						arg_names;		///< argument names (ASCIIZ argname in 'expr AS argname' case; NULL otherwise)
+	int **						str_lengths;	///< string argument lengths, row_count per argument (NULL for non-string arguments)
+	sphinx_malloc_fn *			fn_malloc;		///< malloc() replacement to allocate returned values
+} SPH_UDF_BATCH_ARGS;
+
 /// UDF initialization
 typedef struct st_sphinx_udf_init
 {
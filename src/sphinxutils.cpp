@@ -605,6 +605,10 @@ static KeyDesc_t g_dKeysIndex[] =
 	{ "bigram_freq_words",		0, NULL },
 	{ "bigram_index",			0, NULL },
 	{ "index_field_lengths",	0, NULL },
+	{ "json_hot_attr_uint",		KEY_LIST, NULL },
+	{ "json_hot_attr_bigint",	KEY_LIST, NULL },
+	{ "json_hot_attr_float",	KEY_LIST, NULL },
+	{ "json_hot_attr_string",	KEY_LIST, NULL },
 	{ "divide_remote_ranges",	KEY_HIDDEN, NULL },
 	{ "stopwords_unstemmed",	0, NULL },
 	{ "global_idf",				0, NULL },
@@ -668,8 +672,15 @@ static KeyDesc_t g_dKeysSearchd[] =
 	{ "binlog_flush",			0, NULL },
 	{ "binlog_path",			0, NULL },
 	{ "binlog_max_log_size",	0, NULL },
+	{ "binlog_replay_threads",	0, NULL },
+	{ "binlog_common",			0, NULL },
 	{ "thread_stack",			0, NULL },
 	{ "expansion_limit",		0, NULL },
+	{ "expansion_cache_max_bytes",	0, NULL },
+	{ "doclist_cache_max_bytes",	0, NULL },
+	{ "term_stats_cache_max_bytes",	0, NULL },
+	{ "term_stats_cache_ttl_sec",	0, NULL },
+	{ "keyword_directory",		0, NULL },
 	{ "rt_flush_period",		0, NULL },
 	{ "query_log_format",		0, NULL },
 	{ "mysql_version_string",	0, NULL },
@@ -686,6 +697,7 @@ static KeyDesc_t g_dKeysSearchd[] =
 	{ "ha_period_karma",		0, NULL },
 	{ "predicted_time_costs",	0, NULL },
 	{ "persistent_connections_limit",	0, NULL },
+	{ "persistent_connections_mux",		0, NULL },
 	{ "ondisk_attrs_default",	0, NULL },
 	{ "shutdown_timeout",		0, NULL },
 	{ "query_log_min_msec",		0, NULL },
@@ -698,6 +710,8 @@ static KeyDesc_t g_dKeysSearchd[] =
 	{ "net_throttle_accept",	0, NULL },
 	{ "net_send_job",			0, NULL },
 	{ "net_workers",			0, NULL },
+	{ "net_workers_reuseport",	0, NULL },
+	{ "net_local_max_packet",	0, NULL },
 	{ "queue_max_length",		0, NULL },
 	{ "qcache_ttl_sec",			0, NULL },
 	{ "qcache_max_bytes",		0, NULL },
@@ -706,6 +720,17 @@ static KeyDesc_t g_dKeysSearchd[] =
 	{ "hostname_lookup",		0, NULL },
 	{ "grouping_in_utc",		0, NULL },
 	{ "query_log_mode",			0, NULL },
+	{ "query_log_buffer_size",	0, NULL },
+	{ "query_log_buffer_policy",	0, NULL },
+	{ "max_expensive_queries",	0, NULL },
+	{ "expensive_query_msec",	0, NULL },
+	{ "reject_query_msec",		0, NULL },
+	{ "max_queries_per_client",	0, NULL },
+	{ "max_queries_per_index",	0, NULL },
+	{ "admission_wait_msec",	0, NULL },
+	{ "max_query_memory",		0, NULL },
+	{ "max_query_cpu_time",		0, NULL },
+	{ "max_client_memory",		0, NULL },
 	{ "prefer_rotate",			KEY_DEPRECATED, "seamless_rotate" },
 	{ "shutdown_token",			0, NULL },
 	{ NULL,						0, NULL }
@@ -715,6 +740,7 @@ static KeyDesc_t g_dKeysSearchd[] =
 static KeyDesc_t g_dKeysCommon[] =
 {
 	{ "lemmatizer_base",		0, NULL },
+	{ "morphology_cache_max_bytes",	0, NULL },
 	{ "on_json_attr_error",		0, NULL },
 	{ "json_autoconv_numbers",	0, NULL },
 	{ "json_autoconv_keynames",	0, NULL },
@@ -1449,6 +1475,32 @@ bool sphConfIndex ( const CSphConfigSection & hIndex, CSphIndexSettings & tSetti
 	tSettings.m_bIndexFieldLens = hIndex.GetInt ( "index_field_lengths" )!=0;
 	tSettings.m_sIndexTokenFilter = hIndex.GetStr ( "index_token_filter" );
 
+	// hot JSON paths
+	static const struct { const char * m_sKey; ESphAttr m_eType; } dHotKeys[] =
+	{
+		{ "json_hot_attr_uint",		SPH_ATTR_INTEGER },
+		{ "json_hot_attr_bigint",	SPH_ATTR_BIGINT },
+		{ "json_hot_attr_float",	SPH_ATTR_FLOAT },
+		{ "json_hot_attr_string",	SPH_ATTR_STRING }
+	};
+
+	tSettings.m_dJsonHotAttrs.Reset();
+	for ( const auto & tKey : dHotKeys )
+		for ( CSphVariant * pPath = hIndex ( tKey.m_sKey ); pPath; pPath = pPath->m_pNext )
+		{
+			CSphString sName;
+			if ( !sphJsonHotAttrName ( pPath->cstr(), sName ) )
+			{
+				sError.SetSprintf ( "%s: invalid JSON path '%s' (expected column.key[.key...])", tKey.m_sKey, pPath->cstr() );
+				return false;
+			}
+
+			// keep the path as is; JSON keys are case sensitive
+			CSphColumnInfo & tCol = tSettings.m_dJsonHotAttrs.Add();
+			tCol.m_sName = pPath->strval();
+			tCol.m_eAttrType = tKey.m_eType;
+		}
+
 	// prefix/infix fields
 	CSphString sFields;
 
@@ -2680,6 +2732,7 @@ void sphConfigureCommon ( const CSphConfig & hConf )
 
 	CSphConfigSection & hCommon = hConf["common"]["common"];
 	g_sLemmatizerBase = hCommon.GetStr ( "lemmatizer_base" );
+	sphSetMorphologyCacheSize ( hCommon.GetSize64 ( "morphology_cache_max_bytes", 0 ) );
 	sphConfigureRLP ( hCommon );
 
 	bool bJsonStrict = false;
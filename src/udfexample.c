@@ -97,6 +97,23 @@ DLLEXPORT sphinx_int64_t sequence ( SPH_UDF_INIT * init, SPH_UDF_ARGS * args, ch
 	return res;
 }
 
+
+/// UDF batch implementation (optional)
+/// gets called for a block of rows instead of the per-row function, wherever possible
+DLLEXPORT void sequence_batch ( SPH_UDF_INIT * init, SPH_UDF_BATCH_ARGS * args, void * results, char * error_flag )
+{
+	sphinx_int64_t * res = (sphinx_int64_t*) results;
+	const unsigned int * col = args->arg_count ? (const unsigned int*) args->arg_columns[0] : NULL;
+	int i;
+
+	for ( i=0; i<args->row_count; i++ )
+	{
+		res[i] = (*(int*)init->func_data)++;
+		if ( col )
+			res[i] += col[i];
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 DLLEXPORT int strtoint_init ( SPH_UDF_INIT * init, SPH_UDF_ARGS * args, char * error_message )